@@ -89,6 +89,46 @@
 #define SLJIT_EXECUTABLE_ALLOCATOR 1
 #endif
 
+/* Number of independent executable allocator shards. Each thread is
+   bound to one shard, and every shard has its own chunks, free block
+   list and lock. Blocks freed by a thread of another shard are handed
+   back to the owner without locking. A value of 1 selects the single
+   global allocator. Ignored if SLJIT_EXECUTABLE_ALLOCATOR is 0. */
+#ifndef SLJIT_EXECUTABLE_ALLOCATOR_SHARDS
+/* A single shard by default. */
+#define SLJIT_EXECUTABLE_ALLOCATOR_SHARDS 1
+#endif
+
+/* W^X executable memory: the code is written through a writable mapping
+   and executed through a separate executable mapping of the same shared
+   memory pages, so no page is writable and executable at the same time.
+   Only supported by the built-in allocator on POSIX systems. */
+#ifndef SLJIT_WX_EXECUTABLE_ALLOCATOR
+/* Disabled by default. */
+#define SLJIT_WX_EXECUTABLE_ALLOCATOR 0
+#endif
+
+/* Atomic patching: the immediates rewritten by sljit_set_jump_addr and
+   sljit_set_const are padded with nops to their natural alignment, so
+   a single aligned store updates them while other threads execute the
+   code. Only supported by the x86 backends. */
+#ifndef SLJIT_ATOMIC_PATCHING
+/* Disabled by default. */
+#define SLJIT_ATOMIC_PATCHING 0
+#endif
+
+/* Near rewritable jumps: the built-in allocator places all executable
+   code into a single reserved address range (SLJIT_NEAR_REGION_SIZE), and
+   rewritable jumps use the 5 byte rel32 forms instead of loading the
+   target into a register on x86-64. A target passed to
+   sljit_set_jump_addr which is not within +/-2 GByte of the jump is
+   reached through a stub of the jump, which is placed after the code.
+   Only supported by the x86 backends. */
+#ifndef SLJIT_NEAR_REWRITABLE_JUMPS
+/* Disabled by default. */
+#define SLJIT_NEAR_REWRITABLE_JUMPS 0
+#endif
+
 /* Return with error when an invalid argument is passed. */
 #ifndef SLJIT_ARGUMENT_CHECKS
 /* Disabled by default */
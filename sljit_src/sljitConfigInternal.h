@@ -37,6 +37,11 @@
      SLJIT_BIG_ENDIAN : big endian architecture
      SLJIT_UNALIGNED : allows unaligned memory accesses for non-fpu operations (only!)
      SLJIT_INDIRECT_CALL : see SLJIT_FUNC_OFFSET() for more information
+     SLJIT_MEM2_DISPLACEMENT : SLJIT_MEM2 accepts a displacement, see SLJIT_MEM2_DISP()
+     SLJIT_EXTENDED_CALLS : up to six word and floating point arguments, see SLJIT_FLOAT_ARGS()
+     SLJIT_TAIL_CALL_SUPPORT : calls can be combined with SLJIT_TAIL_CALL
+     SLJIT_DIV_IMM_SUPPORT : division by immediate is supported, see SLJIT_UDIV_IMM
+     SLJIT_SWITCH_SUPPORT : jump tables are supported, see sljit_emit_switch
 
    Constants:
      SLJIT_NUM_REGS : number of available regs
@@ -56,6 +61,7 @@
    Other macros:
      SLJIT_CALL : C calling convention define for both calling JIT form C and C callbacks for JIT
      SLJIT_W(number) : defining 64 bit constants on 64 bit architectures (compiler independent helper)
+     SLJIT_EXEC_OFFSET(ptr) : distance of the executable and writable view of executable memory
 */
 
 /*****************/
@@ -152,6 +158,13 @@
 #undef SLJIT_EXECUTABLE_ALLOCATOR
 #endif
 
+#if (defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED) \
+	|| !(defined SLJIT_EXECUTABLE_ALLOCATOR_SHARDS && SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+/* Sharding is only useful for multi-threaded applications. */
+#undef SLJIT_EXECUTABLE_ALLOCATOR_SHARDS
+#define SLJIT_EXECUTABLE_ALLOCATOR_SHARDS 1
+#endif
+
 /******************************/
 /* CPU family type detection. */
 /******************************/
@@ -335,6 +348,45 @@ typedef signed char	s_char;
 
 #endif /* !SLJIT_UNALIGNED */
 
+/* Native on x86, emulated with a temporary register on the other targets. */
+#define SLJIT_MEM2_DISPLACEMENT 1
+
+#ifndef SLJIT_EXTENDED_CALLS
+
+#if ((defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) && !defined(_WIN64)) \
+	|| (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+#define SLJIT_EXTENDED_CALLS 1
+#endif
+
+#endif /* !SLJIT_EXTENDED_CALLS */
+
+#ifndef SLJIT_TAIL_CALL_SUPPORT
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	|| (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+#define SLJIT_TAIL_CALL_SUPPORT 1
+#endif
+
+#endif /* !SLJIT_TAIL_CALL_SUPPORT */
+
+#ifndef SLJIT_DIV_IMM_SUPPORT
+
+#if ((defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) && !defined(_WIN64)) \
+	|| (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+#define SLJIT_DIV_IMM_SUPPORT 1
+#endif
+
+#endif /* !SLJIT_DIV_IMM_SUPPORT */
+
+#ifndef SLJIT_SWITCH_SUPPORT
+
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) \
+	|| (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+#define SLJIT_SWITCH_SUPPORT 1
+#endif
+
+#endif /* !SLJIT_SWITCH_SUPPORT */
+
 /*****************************************************************************************/
 /* Calling convention of functions generated by SLJIT or called from the generated code. */
 /*****************************************************************************************/
@@ -400,8 +452,93 @@ determine the next executed instruction after return. */
 void* sljit_malloc_exec(unsigned long size);
 void sljit_free_exec(void* ptr);
 void sljit_free_unused_memory_exec(void);
+
+/* Fragmentation statistics of the executable allocator. The sizes
+   include the block headers. Blocks freed by another shard are counted
+   as allocated until their owner shard releases them. */
+struct sljit_exec_allocator_stats {
+	/* Size of the blocks in use. */
+	unsigned long allocated_size;
+	/* Size of all chunks requested from the OS, except the
+	   block header which terminates each chunk. */
+	unsigned long total_size;
+	/* Number of free blocks. */
+	unsigned long free_block_count;
+};
+
+void sljit_get_exec_allocator_stats(struct sljit_exec_allocator_stats *stats);
 #define SLJIT_MALLOC_EXEC(size) sljit_malloc_exec(size)
 #define SLJIT_FREE_EXEC(ptr) sljit_free_exec(ptr)
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+
+#ifdef _WIN32
+#error "SLJIT_WX_EXECUTABLE_ALLOCATOR is not supported on Windows"
+#endif
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+#error "SLJIT_WX_EXECUTABLE_ALLOCATOR is only supported by the x86 backends"
+#endif
+
+/* Size of the address range reserved for both views. */
+#ifndef SLJIT_WX_REGION_SIZE
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+#define SLJIT_WX_REGION_SIZE (1024UL * 1024 * 1024)
+#else
+#define SLJIT_WX_REGION_SIZE (64UL * 1024 * 1024)
+#endif
+#endif /* !SLJIT_WX_REGION_SIZE */
+
+/* Returns with the distance of the executable and writable view of ptr,
+   where ptr can be an address in any of the two views. The memory blocks
+   returned by sljit_malloc_exec are in the writable view, and
+   sljit_free_exec accepts addresses of both views. */
+long sljit_exec_offset(void* ptr);
+#define SLJIT_EXEC_OFFSET(ptr) sljit_exec_offset(ptr)
+
+#endif /* SLJIT_WX_EXECUTABLE_ALLOCATOR */
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+
+#ifdef _WIN32
+#error "SLJIT_NEAR_REWRITABLE_JUMPS is not supported by the built-in allocator on Windows"
+#endif
+
+/* Size of the address range reserved for the executable code. */
+#ifndef SLJIT_NEAR_REGION_SIZE
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+#define SLJIT_NEAR_REGION_SIZE (1024UL * 1024 * 1024)
+#else
+#define SLJIT_NEAR_REGION_SIZE (64UL * 1024 * 1024)
+#endif
+#endif /* !SLJIT_NEAR_REGION_SIZE */
+
+#if SLJIT_NEAR_REGION_SIZE > 0x80000000UL
+#error "SLJIT_NEAR_REGION_SIZE must not be greater than 2 GByte"
+#endif
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR) \
+	&& SLJIT_WX_REGION_SIZE > 0x80000000UL
+#error "SLJIT_WX_REGION_SIZE must not be greater than 2 GByte when SLJIT_NEAR_REWRITABLE_JUMPS is enabled"
+#endif
+
+#endif /* SLJIT_NEAR_REWRITABLE_JUMPS */
+#endif /* SLJIT_EXECUTABLE_ALLOCATOR */
+
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING) \
+	&& !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+#error "SLJIT_ATOMIC_PATCHING is only supported by the x86 backends"
+#endif
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS) \
+	&& !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+#error "SLJIT_NEAR_REWRITABLE_JUMPS is only supported by the x86 backends"
+#endif
+
+/* Distance of the executable and writable view of the memory block
+   returned by SLJIT_MALLOC_EXEC. Zero if they are the same. */
+#ifndef SLJIT_EXEC_OFFSET
+#define SLJIT_EXEC_OFFSET(ptr) 0
 #endif
 
 /**********************************************/
@@ -428,7 +565,8 @@ void sljit_free_unused_memory_exec(void);
 #else
 #define SLJIT_NUM_REGS 12
 #define SLJIT_NUM_SAVED_REGS 8
-#define SLJIT_LOCALS_OFFSET_BASE ((4 + 2) * sizeof(long))
+/* Shadow space of the called functions. */
+#define SLJIT_LOCALS_OFFSET_BASE (4 * sizeof(long))
 #endif /* _WIN64 */
 
 #elif (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5) || (defined SLJIT_CONFIG_ARM_V7 && SLJIT_CONFIG_ARM_V7)
@@ -494,10 +632,20 @@ void sljit_free_unused_memory_exec(void);
 #define SLJIT_NUM_SCRATCH_REGS \
 	(SLJIT_NUM_REGS - SLJIT_NUM_SAVED_REGS)
 
-#define SLJIT_NUM_FLOAT_REGS 6
-#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) && (defined _WIN64)
-#define SLJIT_NUM_SAVED_FLOAT_REGS 1
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+/* xmm0 is a temporary reg, xmm6 - xmm15 are callee saved on Win64. */
+#define SLJIT_NUM_FLOAT_REGS 15
+#ifdef _WIN64
+#define SLJIT_NUM_SAVED_FLOAT_REGS 10
+#else
+#define SLJIT_NUM_SAVED_FLOAT_REGS 0
+#endif
+#elif (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+/* v0 and v31 are temporary regs, d8 - d15 are callee saved. */
+#define SLJIT_NUM_FLOAT_REGS 30
+#define SLJIT_NUM_SAVED_FLOAT_REGS 8
 #else
+#define SLJIT_NUM_FLOAT_REGS 6
 #define SLJIT_NUM_SAVED_FLOAT_REGS 0
 #endif
 
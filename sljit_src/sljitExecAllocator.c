@@ -49,9 +49,13 @@
        n - The size of the previous block.
 
    Using these size values we can go forward or backward on the block chain.
-   The unused blocks are stored in a chain list pointed by free_blocks. This
-   list is useful if we need to find a suitable memory area when the allocator
-   is called.
+   The unused blocks are stored in segregated free lists (a two level scheme
+   similar to TLSF). The first level index is the position of the highest set
+   bit of the block size, and the second level splits each power of two range
+   into FREE_LIST_SL_COUNT equal parts. Two bitmaps record the non-empty lists.
+   The allocator rounds the requested size up to the next list boundary, so
+   the first block of any non-empty list found by the bitmaps is large enough.
+   Both allocation and release are constant time operations.
 
    When a block is freed, the new free block is connected to its adjacent free
    blocks if possible.
@@ -59,6 +63,16 @@
      [ free block ][ used block ][ free block ]
    and "used block" is freed, the three blocks are connected together:
      [           one big free block           ]
+
+   Sharding (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1):
+     The chunks, the free block lists and the statistics are stored in shards,
+     each protected by its own lock. Threads are bound to shards in a round
+     robin fashion when they first call the allocator, and used blocks record
+     the index of their shard in their header. A block freed by a thread bound
+     to another shard is pushed onto the remote_frees list of its owner with
+     an atomic compare and swap, and the owner releases these blocks the next
+     time it holds its lock. Since blocks are only pushed individually and the
+     list is always taken as a whole, the list is free from the ABA problem.
 */
 
 /* --------------------------------------------------------------------- */
@@ -79,7 +93,224 @@
        as it only uses local variables
 */
 
-#ifdef _WIN32
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR) \
+	|| (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+
+/*
+   Region mode: a single address range is reserved when the first chunk is
+   allocated, and all chunks are allocated from this region. A bitmap
+   records the chunks in use. The pages are only backed by memory after
+   they are written.
+
+   W^X mode: a region of a shared memory object is mapped twice, once
+   readable / writable and once readable / executable. No page is ever
+   mapped both writable and executable. The chunks are allocated from the
+   writable view, and all allocator data structures are stored there. The
+   distance of the two views is fixed (wx_exec_offset), so any address can
+   be translated to the other view without a lookup.
+
+   Near rewritable jumps: the distance of any two executable addresses in
+   the region fits into a rel32 displacement. The region is requested
+   right below the code of the allocator, so the functions of the
+   application are likely reachable as well, but this is only a hint.
+*/
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+#include <fcntl.h>
+#include <sys/syscall.h>
+#define REGION_SIZE	SLJIT_WX_REGION_SIZE
+#else
+#define REGION_SIZE	SLJIT_NEAR_REGION_SIZE
+#endif
+
+#if !(defined SLJIT_SINGLE_THREADED && SLJIT_SINGLE_THREADED)
+#include <pthread.h>
+/* Shared by all shards. */
+static pthread_mutex_t region_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define REGION_GRAB_LOCK()	pthread_mutex_lock(&region_mutex)
+#define REGION_RELEASE_LOCK()	pthread_mutex_unlock(&region_mutex)
+#else
+#define REGION_GRAB_LOCK()
+#define REGION_RELEASE_LOCK()
+#endif
+
+#define REGION_CHUNK_COUNT	(REGION_SIZE / CHUNK_SIZE)
+
+/* The writable view in W^X mode. */
+static u_char *region_base;
+/* One bit for each chunk of the region, set if it is in use. */
+static u_char region_chunk_map[(REGION_CHUNK_COUNT + 7) / 8];
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+static void* region_hint(void)
+{
+	unsigned long text = (unsigned long)SLJIT_FUNC_OFFSET(sljit_malloc_exec);
+
+	if (text < REGION_SIZE + CHUNK_SIZE)
+		return NULL;
+	return (void*)((text - REGION_SIZE - CHUNK_SIZE) & ~(unsigned long)(CHUNK_SIZE - 1));
+}
+#else
+#define region_hint() NULL
+#endif
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+
+static u_char *wx_exec_base;
+static long wx_exec_offset;
+
+static int wx_open_shared_memory(void)
+{
+	int fd;
+#ifdef SYS_memfd_create
+	/* 0x1 is MFD_CLOEXEC. */
+	fd = (int)syscall(SYS_memfd_create, "sljit", 0x1);
+	if (fd >= 0)
+		return fd;
+#endif
+	{
+		char name[64];
+
+		snprintf(name, sizeof(name), "/sljit-%ld-%p", (long)getpid(), (void*)&wx_exec_offset);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0)
+			shm_unlink(name);
+	}
+	return fd;
+}
+
+static int init_region(void)
+{
+	void *writable;
+	void *exec;
+	int fd = wx_open_shared_memory();
+
+	if (fd < 0)
+		return 1;
+
+	/* The file is sparse, pages are allocated when they are written. */
+	if (ftruncate(fd, REGION_SIZE) != 0) {
+		close(fd);
+		return 1;
+	}
+
+	writable = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (writable == MAP_FAILED) {
+		close(fd);
+		return 1;
+	}
+
+	exec = mmap(region_hint(), REGION_SIZE, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+	/* The mappings keep the memory object alive. */
+	close(fd);
+	if (exec == MAP_FAILED) {
+		munmap(writable, REGION_SIZE);
+		return 1;
+	}
+
+	wx_exec_offset = (u_char*)exec - (u_char*)writable;
+	wx_exec_base = (u_char*)exec;
+	region_base = (u_char*)writable;
+	return 0;
+}
+
+#else /* !SLJIT_WX_EXECUTABLE_ALLOCATOR */
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+static int init_region(void)
+{
+	void *region;
+
+#ifdef MAP_ANON
+	region = mmap(region_hint(), REGION_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+#else
+	if (dev_zero < 0) {
+		if (open_dev_zero())
+			return 1;
+	}
+	region = mmap(region_hint(), REGION_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_NORESERVE, dev_zero, 0);
+#endif
+
+	if (region == MAP_FAILED)
+		return 1;
+	region_base = (u_char*)region;
+	return 0;
+}
+
+#endif /* SLJIT_WX_EXECUTABLE_ALLOCATOR */
+
+#define REGION_CHUNK_USED(index)	(region_chunk_map[(index) >> 3] & (1 << ((index) & 0x7)))
+
+static void* alloc_chunk(unsigned long size)
+{
+	unsigned long count = size / CHUNK_SIZE;
+	unsigned long start = 0;
+	unsigned long i;
+
+	REGION_GRAB_LOCK();
+	if (!region_base && init_region()) {
+		REGION_RELEASE_LOCK();
+		return NULL;
+	}
+
+	/* First fit, chunk allocation is rare. */
+	for (i = 0; i < REGION_CHUNK_COUNT; i++) {
+		if (REGION_CHUNK_USED(i)) {
+			start = i + 1;
+			continue;
+		}
+		if (i + 1 - start == count)
+			break;
+	}
+
+	if (i >= REGION_CHUNK_COUNT) {
+		REGION_RELEASE_LOCK();
+		return NULL;
+	}
+
+	for (i = start; i < start + count; i++)
+		region_chunk_map[i >> 3] |= 1 << (i & 0x7);
+	REGION_RELEASE_LOCK();
+	return region_base + start * CHUNK_SIZE;
+}
+
+static void free_chunk(void* chunk, unsigned long size)
+{
+	unsigned long start = ((u_char*)chunk - region_base) / CHUNK_SIZE;
+	unsigned long i;
+
+	/* Give the pages back to the system. The next user
+	   of the chunk gets zero filled pages. */
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+#ifdef MADV_REMOVE
+	madvise(chunk, size, MADV_REMOVE);
+#endif
+#elif defined MADV_DONTNEED
+	madvise(chunk, size, MADV_DONTNEED);
+#endif
+
+	REGION_GRAB_LOCK();
+	for (i = start; i < start + size / CHUNK_SIZE; i++)
+		region_chunk_map[i >> 3] &= ~(1 << (i & 0x7));
+	REGION_RELEASE_LOCK();
+}
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+
+/* Translates an executable address to the writable view. */
+static __inline void* wx_to_writable(void *ptr)
+{
+	if ((u_char*)ptr >= wx_exec_base && (u_char*)ptr < wx_exec_base + REGION_SIZE)
+		return (u_char*)ptr - wx_exec_offset;
+	return ptr;
+}
+
+#endif /* SLJIT_WX_EXECUTABLE_ALLOCATOR */
+
+#elif defined _WIN32
 
 static __inline void* alloc_chunk(unsigned long size)
 {
@@ -127,6 +358,10 @@ static __inline void free_chunk(void* chunk, unsigned long size)
 struct block_header {
 	unsigned long size;
 	unsigned long prev_size;
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	/* Index of the owner shard (used blocks only). */
+	unsigned long shard;
+#endif
 };
 
 struct free_block {
@@ -143,170 +378,459 @@ struct free_block {
 #define MEM_START(base)		((void*)(((u_char*)base) + sizeof(struct block_header)))
 #define ALIGN_SIZE(size)	(((size) + sizeof(struct block_header) + 7) & ~7)
 
-static struct free_block* free_blocks;
-static unsigned long allocated_size;
-static unsigned long total_size;
+/* Number of second level lists in each power of two range (log2). */
+#define FREE_LIST_SL_SHIFT	2
+#define FREE_LIST_SL_COUNT	(1 << FREE_LIST_SL_SHIFT)
+#define FREE_LIST_FL_COUNT	(int)(sizeof(unsigned long) * 8)
+
+struct exec_shard {
+	unsigned long fl_map;
+	u_char sl_map[FREE_LIST_FL_COUNT];
+	struct free_block* free_blocks[FREE_LIST_FL_COUNT][FREE_LIST_SL_COUNT];
+	unsigned long free_block_count;
+	unsigned long allocated_size;
+	unsigned long total_size;
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	/* Blocks freed by other threads, linked by their next member. */
+	struct free_block* volatile remote_frees;
+#endif
+};
+
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+
+/* Each shard starts on its own cache line to avoid false sharing. */
+#define SHARD_SLOT_SIZE ((sizeof(struct exec_shard) + 63) & ~(unsigned long)63)
+
+union exec_shard_slot {
+	struct exec_shard shard;
+	u_char cache_line[SHARD_SLOT_SIZE];
+};
+
+static union exec_shard_slot shards[SLJIT_EXECUTABLE_ALLOCATOR_SHARDS];
+static volatile long next_shard_index;
+
+#define GET_SHARD(index)	(&shards[index].shard)
+
+#ifdef _WIN32
+
+static __declspec(thread) int thread_shard_index;
+
+static __inline long get_next_shard_index(void)
+{
+	return InterlockedIncrement(&next_shard_index) - 1;
+}
+
+static __inline int push_remote_free(struct exec_shard *shard, struct free_block *free_block, struct free_block *head)
+{
+	return InterlockedCompareExchangePointer((PVOID volatile*)&shard->remote_frees, free_block, head) == head;
+}
+
+static __inline struct free_block* take_remote_frees(struct exec_shard *shard)
+{
+	return (struct free_block*)InterlockedExchangePointer((PVOID volatile*)&shard->remote_frees, NULL);
+}
+
+#else /* !_WIN32 */
+
+static __thread int thread_shard_index;
+
+static __inline long get_next_shard_index(void)
+{
+	return __sync_fetch_and_add(&next_shard_index, 1);
+}
+
+static __inline int push_remote_free(struct exec_shard *shard, struct free_block *free_block, struct free_block *head)
+{
+	return __sync_bool_compare_and_swap(&shard->remote_frees, head, free_block);
+}
+
+static __inline struct free_block* take_remote_frees(struct exec_shard *shard)
+{
+	/* Full barrier, the pushed blocks are visible after this call. */
+	__sync_synchronize();
+	return __sync_lock_test_and_set(&shard->remote_frees, NULL);
+}
+
+#endif /* _WIN32 */
+
+static __inline int get_shard_index(void)
+{
+	/* Zero means the thread is not bound yet. */
+	if (!thread_shard_index)
+		thread_shard_index = (int)(get_next_shard_index() % SLJIT_EXECUTABLE_ALLOCATOR_SHARDS) + 1;
+	return thread_shard_index - 1;
+}
+
+#else /* SLJIT_EXECUTABLE_ALLOCATOR_SHARDS <= 1 */
+
+static struct exec_shard global_shard;
+
+#define GET_SHARD(index)	(&global_shard)
+
+static __inline int get_shard_index(void)
+{
+	return 0;
+}
+
+#endif /* SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1 */
 
-static __inline void sljit_insert_free_block(struct free_block *free_block, unsigned long size)
+static __inline int highest_bit(unsigned long value)
 {
+#if defined(__GNUC__)
+	return (int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl(value);
+#else
+	int bit = 0;
+
+	while (value >>= 1)
+		bit++;
+	return bit;
+#endif
+}
+
+static __inline int lowest_bit(unsigned long value)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzl(value);
+#else
+	int bit = 0;
+
+	while (!(value & 0x1)) {
+		value >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+/* Block sizes are always >= sizeof(struct free_block) > FREE_LIST_SL_COUNT. */
+static __inline void get_free_list(unsigned long size, int *fl, int *sl)
+{
+	*fl = highest_bit(size);
+	*sl = (int)(size >> (*fl - FREE_LIST_SL_SHIFT)) & (FREE_LIST_SL_COUNT - 1);
+}
+
+static __inline void sljit_insert_free_block(struct exec_shard *shard, struct free_block *free_block, unsigned long size)
+{
+	struct free_block **list;
+	int fl, sl;
+
 	free_block->header.size = 0;
 	free_block->size = size;
 
-	free_block->next = free_blocks;
+	get_free_list(size, &fl, &sl);
+	list = &shard->free_blocks[fl][sl];
+
+	free_block->next = *list;
 	free_block->prev = NULL;
-	if (free_blocks)
-		free_blocks->prev = free_block;
-	free_blocks = free_block;
+	if (*list)
+		(*list)->prev = free_block;
+	*list = free_block;
+
+	shard->fl_map |= (unsigned long)1 << fl;
+	shard->sl_map[fl] |= 1 << sl;
+	shard->free_block_count++;
 }
 
-static __inline void sljit_remove_free_block(struct free_block *free_block)
+static __inline void sljit_remove_free_block(struct exec_shard *shard, struct free_block *free_block)
 {
+	struct free_block **list;
+	int fl, sl;
+
 	if (free_block->next)
 		free_block->next->prev = free_block->prev;
 
 	if (free_block->prev)
 		free_block->prev->next = free_block->next;
 	else {
-		SLJIT_ASSERT(free_blocks == free_block);
-		free_blocks = free_block->next;
+		get_free_list(free_block->size, &fl, &sl);
+		list = &shard->free_blocks[fl][sl];
+		SLJIT_ASSERT(*list == free_block);
+		*list = free_block->next;
+		if (!*list) {
+			shard->sl_map[fl] &= ~(1 << sl);
+			if (!shard->sl_map[fl])
+				shard->fl_map &= ~((unsigned long)1 << fl);
+		}
 	}
+	shard->free_block_count--;
 }
 
-void* sljit_malloc_exec(unsigned long size)
+/* Returns with a free block which size is at least size, or NULL. */
+static __inline struct free_block* find_free_block(struct exec_shard *shard, unsigned long size)
+{
+	unsigned long map;
+	int fl, sl;
+
+	/* Round up to the next list boundary, so any block in the list is large enough. */
+	fl = highest_bit(size);
+	size += ((unsigned long)1 << (fl - FREE_LIST_SL_SHIFT)) - 1;
+	get_free_list(size, &fl, &sl);
+
+	map = shard->sl_map[fl] & (~0UL << sl);
+	if (!map) {
+		if (fl + 1 >= FREE_LIST_FL_COUNT)
+			return NULL;
+		map = shard->fl_map & (~0UL << (fl + 1));
+		if (!map)
+			return NULL;
+		fl = lowest_bit(map);
+		map = shard->sl_map[fl];
+	}
+
+	return shard->free_blocks[fl][lowest_bit(map)];
+}
+
+static void* shard_malloc(struct exec_shard *shard, int index, unsigned long size)
 {
 	struct block_header *header;
 	struct block_header *next_header;
 	struct free_block *free_block;
 	unsigned long chunk_size;
 
-	allocator_grab_lock();
+	(void)index;
+
 	if (size < sizeof(struct free_block))
 		size = sizeof(struct free_block);
 	size = ALIGN_SIZE(size);
 
-	free_block = free_blocks;
-	while (free_block) {
-		if (free_block->size >= size) {
-			chunk_size = free_block->size;
-			if (chunk_size > size + 64) {
-				/* We just cut a block from the end of the free block. */
-				chunk_size -= size;
-				free_block->size = chunk_size;
-				header = AS_BLOCK_HEADER(free_block, chunk_size);
-				header->prev_size = chunk_size;
-				AS_BLOCK_HEADER(header, size)->prev_size = size;
-			}
-			else {
-				sljit_remove_free_block(free_block);
-				header = (struct block_header*)free_block;
-				size = chunk_size;
-			}
-			allocated_size += size;
-			header->size = size;
-			allocator_release_lock();
-			return MEM_START(header);
+	free_block = find_free_block(shard, size);
+	if (free_block) {
+		chunk_size = free_block->size;
+		sljit_remove_free_block(shard, free_block);
+		if (chunk_size > size + 64) {
+			/* We just cut a block from the end of the free block. */
+			chunk_size -= size;
+			sljit_insert_free_block(shard, free_block, chunk_size);
+			header = AS_BLOCK_HEADER(free_block, chunk_size);
+			header->prev_size = chunk_size;
+			AS_BLOCK_HEADER(header, size)->prev_size = size;
 		}
-		free_block = free_block->next;
+		else {
+			header = (struct block_header*)free_block;
+			size = chunk_size;
+		}
+		shard->allocated_size += size;
+		header->size = size;
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+		header->shard = index;
+#endif
+		return MEM_START(header);
 	}
 
 	chunk_size = (size + sizeof(struct block_header) + CHUNK_SIZE - 1) & CHUNK_MASK;
 	header = (struct block_header*)alloc_chunk(chunk_size);
-	if (!header) {
-		allocator_release_lock();
+	if (!header)
 		return NULL;
-	}
 
 	chunk_size -= sizeof(struct block_header);
-	total_size += chunk_size;
+	shard->total_size += chunk_size;
 
 	header->prev_size = 0;
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	header->shard = index;
+#endif
 	if (chunk_size > size + 64) {
 		/* Cut the allocated space into a free and a used block. */
-		allocated_size += size;
+		shard->allocated_size += size;
 		header->size = size;
 		chunk_size -= size;
 
 		free_block = AS_FREE_BLOCK(header, size);
 		free_block->header.prev_size = size;
-		sljit_insert_free_block(free_block, chunk_size);
+		sljit_insert_free_block(shard, free_block, chunk_size);
 		next_header = AS_BLOCK_HEADER(free_block, chunk_size);
 	}
 	else {
 		/* All space belongs to this allocation. */
-		allocated_size += chunk_size;
+		shard->allocated_size += chunk_size;
 		header->size = chunk_size;
 		next_header = AS_BLOCK_HEADER(header, chunk_size);
 	}
 	next_header->size = 1;
 	next_header->prev_size = chunk_size;
-	allocator_release_lock();
 	return MEM_START(header);
 }
 
-void sljit_free_exec(void* ptr)
+static void shard_free(struct exec_shard *shard, struct block_header *header)
 {
-	struct block_header *header;
 	struct free_block* free_block;
+	unsigned long size = header->size;
 
-	allocator_grab_lock();
-	header = AS_BLOCK_HEADER(ptr, -(long)sizeof(struct block_header));
-	allocated_size -= header->size;
+	shard->allocated_size -= size;
 
-	/* Connecting free blocks together if possible. */
+	/* Connecting free blocks together if possible. The list of a free
+	   block depends on its size, so it is removed before it grows. */
 
 	/* If header->prev_size == 0, free_block will equal to header.
 	   In this case, free_block->header.size will be > 0. */
 	free_block = AS_FREE_BLOCK(header, -(long)header->prev_size);
 	if (!free_block->header.size) {
-		free_block->size += header->size;
-		header = AS_BLOCK_HEADER(free_block, free_block->size);
-		header->prev_size = free_block->size;
+		sljit_remove_free_block(shard, free_block);
+		size += free_block->size;
 	}
-	else {
+	else
 		free_block = (struct free_block*)header;
-		sljit_insert_free_block(free_block, header->size);
-	}
 
-	header = AS_BLOCK_HEADER(free_block, free_block->size);
+	header = AS_BLOCK_HEADER(free_block, size);
 	if (!header->size) {
-		free_block->size += ((struct free_block*)header)->size;
-		sljit_remove_free_block((struct free_block*)header);
-		header = AS_BLOCK_HEADER(free_block, free_block->size);
-		header->prev_size = free_block->size;
+		sljit_remove_free_block(shard, (struct free_block*)header);
+		size += ((struct free_block*)header)->size;
+		header = AS_BLOCK_HEADER(free_block, size);
 	}
+	header->prev_size = size;
 
 	/* The whole chunk is free. */
 	if (!free_block->header.prev_size && header->size == 1) {
 		/* If this block is freed, we still have (allocated_size / 2) free space. */
-		if (total_size - free_block->size > (allocated_size * 3 / 2)) {
-			total_size -= free_block->size;
-			sljit_remove_free_block(free_block);
-			free_chunk(free_block, free_block->size + sizeof(struct block_header));
+		if (shard->total_size - size > (shard->allocated_size * 3 / 2)) {
+			shard->total_size -= size;
+			free_chunk(free_block, size + sizeof(struct block_header));
+			return;
 		}
 	}
 
-	allocator_release_lock();
+	sljit_insert_free_block(shard, free_block, size);
 }
 
-void sljit_free_unused_memory_exec(void)
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+
+/* Must be called with the lock of the shard held. */
+static __inline void release_remote_frees(struct exec_shard *shard)
 {
-	struct free_block* free_block;
-	struct free_block* next_free_block;
+	struct free_block *free_block;
+	struct free_block *next_free_block;
 
-	allocator_grab_lock();
+	if (!shard->remote_frees)
+		return;
 
-	free_block = free_blocks;
+	free_block = take_remote_frees(shard);
 	while (free_block) {
 		next_free_block = free_block->next;
-		if (!free_block->header.prev_size && 
-				AS_BLOCK_HEADER(free_block, free_block->size)->size == 1) {
-			total_size -= free_block->size;
-			sljit_remove_free_block(free_block);
-			free_chunk(free_block, free_block->size + sizeof(struct block_header));
-		}
+		shard_free(shard, &free_block->header);
 		free_block = next_free_block;
 	}
+}
+
+#endif /* SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1 */
+
+void* sljit_malloc_exec(unsigned long size)
+{
+	int index = get_shard_index();
+	struct exec_shard *shard = GET_SHARD(index);
+	void *ptr;
+
+	allocator_grab_lock(index);
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	release_remote_frees(shard);
+#endif
+	ptr = shard_malloc(shard, index, size);
+	allocator_release_lock(index);
+	return ptr;
+}
+
+void sljit_free_exec(void* ptr)
+{
+	struct block_header *header;
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	int index;
+	struct exec_shard *shard;
+	struct free_block *free_block;
+	struct free_block *head;
+#else
+	int index = 0;
+	struct exec_shard *shard = GET_SHARD(index);
+#endif
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+	/* Both views are accepted. */
+	ptr = wx_to_writable(ptr);
+#endif
+	header = AS_BLOCK_HEADER(ptr, -(long)sizeof(struct block_header));
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+	index = (int)header->shard;
+	shard = GET_SHARD(index);
+
+	SLJIT_ASSERT(index >= 0 && index < SLJIT_EXECUTABLE_ALLOCATOR_SHARDS);
+
+	if (index != get_shard_index()) {
+		/* The block is handed back to its owner without locking. */
+		free_block = (struct free_block*)header;
+		do {
+			head = shard->remote_frees;
+			free_block->next = head;
+		} while (!push_remote_free(shard, free_block, head));
+		return;
+	}
+#endif
 
-	SLJIT_ASSERT((total_size && free_blocks) || (!total_size && !free_blocks));
-	allocator_release_lock();
+	allocator_grab_lock(index);
+	shard_free(shard, header);
+	allocator_release_lock(index);
 }
+
+void sljit_free_unused_memory_exec(void)
+{
+	struct exec_shard *shard;
+	struct free_block* free_block;
+	struct free_block* next_free_block;
+	int index;
+	int fl, sl;
+
+	for (index = 0; index < SLJIT_EXECUTABLE_ALLOCATOR_SHARDS; index++) {
+		shard = GET_SHARD(index);
+		allocator_grab_lock(index);
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+		release_remote_frees(shard);
+#endif
+
+		for (fl = 0; fl < FREE_LIST_FL_COUNT; fl++) {
+			if (!(shard->fl_map & ((unsigned long)1 << fl)))
+				continue;
+			for (sl = 0; sl < FREE_LIST_SL_COUNT; sl++) {
+				free_block = shard->free_blocks[fl][sl];
+				while (free_block) {
+					next_free_block = free_block->next;
+					if (!free_block->header.prev_size &&
+							AS_BLOCK_HEADER(free_block, free_block->size)->size == 1) {
+						shard->total_size -= free_block->size;
+						sljit_remove_free_block(shard, free_block);
+						free_chunk(free_block, free_block->size + sizeof(struct block_header));
+					}
+					free_block = next_free_block;
+				}
+			}
+		}
+
+		SLJIT_ASSERT((shard->total_size && shard->fl_map) || (!shard->total_size && !shard->fl_map));
+		allocator_release_lock(index);
+	}
+}
+
+void sljit_get_exec_allocator_stats(struct sljit_exec_allocator_stats *stats)
+{
+	struct exec_shard *shard;
+	int index;
+
+	stats->allocated_size = 0;
+	stats->total_size = 0;
+	stats->free_block_count = 0;
+
+	for (index = 0; index < SLJIT_EXECUTABLE_ALLOCATOR_SHARDS; index++) {
+		shard = GET_SHARD(index);
+		allocator_grab_lock(index);
+		stats->allocated_size += shard->allocated_size;
+		stats->total_size += shard->total_size;
+		stats->free_block_count += shard->free_block_count;
+		allocator_release_lock(index);
+	}
+}
+
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+
+long sljit_exec_offset(void* ptr)
+{
+	(void)ptr;
+	return wx_exec_offset;
+}
+
+#endif /* SLJIT_WX_EXECUTABLE_ALLOCATOR */
@@ -30,16 +30,22 @@
 
 #include "sljitLir.h"
 
+/* The operations buffered by SLJIT_IR_OPTIMIZER are emitted
+   before anything else. */
 #define CHECK_ERROR() \
 	do { \
 		if (compiler->error) \
 			return compiler->error; \
+		if (compiler->ir_count > 0) \
+			FAIL_IF(ir_flush(compiler)); \
 	} while (0)
 
 #define CHECK_ERROR_PTR() \
 	do { \
 		if (compiler->error) \
 			return NULL; \
+		if (compiler->ir_count > 0 && ir_flush(compiler)) \
+			return NULL; \
 	} while (0)
 
 #define FAIL_IF(expr) \
@@ -75,6 +81,8 @@
 #define GET_ALL_FLAGS(op) \
 	((op) & (SLJIT_INT_OP | SLJIT_SET_E | SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_O | SLJIT_SET_C | SLJIT_KEEP_FLAGS))
 
+static int ir_flush(struct sljit_compiler *compiler);
+
 #define TYPE_CAST_NEEDED(op) \
 	(((op) >= SLJIT_MOV_UB && (op) <= SLJIT_MOV_SH) || ((op) >= SLJIT_MOVU_UB && (op) <= SLJIT_MOVU_SH))
 
@@ -91,6 +99,9 @@
 #define OFFS_REG(reg)		(((reg) >> 8) & REG_MASK)
 #define OFFS_REG_MASK		(REG_MASK << 8)
 #define TO_OFFS_REG(reg)	((reg) << 8)
+/* Decoding the immediate argument of SLJIT_MEM2, see SLJIT_MEM2_DISP. */
+#define MEM2_SHIFT(w)		((w) & 0x3)
+#define MEM2_DISP(w)		(((w) - MEM2_SHIFT(w)) / 4)
 /* When reg cannot be unused. */
 #define FAST_IS_REG(reg)	((reg) <= REG_MASK)
 /* When reg can be unused. */
@@ -106,6 +117,7 @@
 #	define PATCH_MW	0x8
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 #	define PATCH_MD	0x10
+#	define IS_TAIL_CALL	0x20
 #endif
 #endif
 
@@ -213,6 +225,10 @@
 #	define FCC_IS_SET	(1 << 24)
 #endif
 
+/* Argument counts of sljit_emit_enter and the call types. */
+#define GET_WORD_ARGS(args)	((args) & 0xffff)
+#define GET_FLOAT_ARGS(type)	(((type) >> 16) & 0xf)
+
 /* Stack management. */
 
 #define GET_SAVED_REGS_SIZE(scratches, saveds, extra) \
@@ -220,6 +236,10 @@
 		(saveds < SLJIT_NUM_SAVED_REGS ? saveds : SLJIT_NUM_SAVED_REGS) + \
 		extra) * sizeof(long))
 
+#define GET_SAVED_FLOAT_REGS_SIZE(fscratches, fsaveds, size) \
+	(((fscratches < SLJIT_NUM_SCRATCH_FLOAT_REGS ? 0 : (fscratches - SLJIT_NUM_SCRATCH_FLOAT_REGS)) + \
+		(fsaveds < SLJIT_NUM_SAVED_FLOAT_REGS ? fsaveds : SLJIT_NUM_SAVED_FLOAT_REGS)) * (size))
+
 #define ADJUST_LOCAL_OFFSET(p, i) \
 	if ((p) == (SLJIT_MEM1(SLJIT_SP))) \
 		(i) += SLJIT_LOCALS_OFFSET;
@@ -315,12 +335,91 @@ static int compiler_initialized = 0;
 static void init_compiler(void);
 #endif
 
+static void init_compiler_members(struct sljit_compiler *compiler)
+{
+	/* Only the non-zero members must be set. */
+	compiler->error = SLJIT_SUCCESS;
+
+	compiler->scratches = -1;
+	compiler->saveds = -1;
+	compiler->fscratches = -1;
+	compiler->fsaveds = -1;
+	compiler->local_size = -1;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	compiler->args = -1;
+#endif
+
+#if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
+	compiler->cpool_diff = 0xffffffff;
+#endif
+
+#if (defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
+	compiler->delay_slot = UNMOVABLE_INS;
+#endif
+
+#if (defined SLJIT_CONFIG_SPARC_32 && SLJIT_CONFIG_SPARC_32)
+	compiler->delay_slot = UNMOVABLE_INS;
+#endif
+}
+
+static void* default_alloc(unsigned long size, void *allocator_data)
+{
+	(void)allocator_data;
+	return malloc(size);
+}
+
+static void default_free(void *ptr, void *allocator_data)
+{
+	(void)allocator_data;
+	free(ptr);
+}
+
+static const struct sljit_allocator default_allocator = {
+	default_alloc, default_free, NULL
+};
+
+static __inline void* compiler_alloc(struct sljit_compiler *compiler, unsigned long size)
+{
+	return compiler->allocator.alloc(size, compiler->allocator.allocator_data);
+}
+
+static __inline void compiler_free(struct sljit_compiler *compiler, void *ptr)
+{
+	/* A NULL free callback means the memory is released by the owner. */
+	if (compiler->allocator.free)
+		compiler->allocator.free(ptr, compiler->allocator.allocator_data);
+}
+
+static void free_fragments(struct sljit_compiler *compiler, struct sljit_memory_fragment *buf)
+{
+	struct sljit_memory_fragment *curr;
+
+	while (buf != NULL) {
+		curr = buf;
+		buf = buf->next;
+		compiler_free(compiler, curr);
+	}
+}
+
 struct sljit_compiler* sljit_create_compiler(void)
 {
-	struct sljit_compiler *compiler = malloc(sizeof(struct sljit_compiler));
+	return sljit_create_compiler_with_allocator(NULL);
+}
+
+struct sljit_compiler* sljit_create_compiler_with_allocator(const struct sljit_allocator *allocator)
+{
+	struct sljit_compiler *compiler;
+
+	if (!allocator)
+		allocator = &default_allocator;
+
+	SLJIT_ASSERT(allocator->alloc);
+	compiler = allocator->alloc(sizeof(struct sljit_compiler), allocator->allocator_data);
 	if (!compiler)
 		return NULL;
 	memset(compiler, 0, sizeof(struct sljit_compiler));
+	compiler->allocator = *allocator;
 
 	SLJIT_COMPILE_ASSERT(
 		sizeof(s_char) == 1 && sizeof(u_char) == 1
@@ -336,18 +435,15 @@ struct sljit_compiler* sljit_create_compiler(void)
 	SLJIT_COMPILE_ASSERT(SLJIT_REWRITABLE_JUMP != SLJIT_SINGLE_OP,
 		rewritable_jump_and_single_op_must_not_be_the_same);
 
-	/* Only the non-zero members must be set. */
-	compiler->error = SLJIT_SUCCESS;
-
-	compiler->buf = malloc(BUF_SIZE);
-	compiler->abuf = malloc(ABUF_SIZE);
+	compiler->buf = compiler_alloc(compiler, BUF_SIZE);
+	compiler->abuf = compiler_alloc(compiler, ABUF_SIZE);
 
 	if (!compiler->buf || !compiler->abuf) {
 		if (compiler->buf)
-			free(compiler->buf);
+			compiler_free(compiler, compiler->buf);
 		if (compiler->abuf)
-			free(compiler->abuf);
-		free(compiler);
+			compiler_free(compiler, compiler->abuf);
+		compiler_free(compiler, compiler);
 		return NULL;
 	}
 
@@ -356,35 +452,18 @@ struct sljit_compiler* sljit_create_compiler(void)
 	compiler->abuf->next = NULL;
 	compiler->abuf->used_size = 0;
 
-	compiler->scratches = -1;
-	compiler->saveds = -1;
-	compiler->fscratches = -1;
-	compiler->fsaveds = -1;
-	compiler->local_size = -1;
-
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	compiler->args = -1;
-#endif
-
 #if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
-	compiler->cpool = malloc(CPOOL_SIZE * sizeof(unsigned long) + CPOOL_SIZE * sizeof(u_char));
+	compiler->cpool = compiler_alloc(compiler, CPOOL_SIZE * sizeof(unsigned long) + CPOOL_SIZE * sizeof(u_char));
 	if (!compiler->cpool) {
-		free(compiler->buf);
-		free(compiler->abuf);
-		free(compiler);
+		compiler_free(compiler, compiler->buf);
+		compiler_free(compiler, compiler->abuf);
+		compiler_free(compiler, compiler);
 		return NULL;
 	}
 	compiler->cpool_unique = (u_char*)(compiler->cpool + CPOOL_SIZE);
-	compiler->cpool_diff = 0xffffffff;
-#endif
-
-#if (defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
-	compiler->delay_slot = UNMOVABLE_INS;
 #endif
 
-#if (defined SLJIT_CONFIG_SPARC_32 && SLJIT_CONFIG_SPARC_32)
-	compiler->delay_slot = UNMOVABLE_INS;
-#endif
+	init_compiler_members(compiler);
 
 #if (defined SLJIT_NEEDS_COMPILER_INIT && SLJIT_NEEDS_COMPILER_INIT)
 	if (!compiler_initialized) {
@@ -396,29 +475,95 @@ struct sljit_compiler* sljit_create_compiler(void)
 	return compiler;
 }
 
+static void free_switches(struct sljit_compiler *compiler)
+{
+	struct sljit_switch *curr;
+	struct sljit_switch *switch_ = compiler->switches;
+
+	while (switch_ != NULL) {
+		curr = switch_;
+		switch_ = switch_->next;
+		compiler_free(compiler, curr);
+	}
+}
+
 void sljit_free_compiler(struct sljit_compiler *compiler)
 {
-	struct sljit_memory_fragment *buf;
+	free_switches(compiler);
+	free_fragments(compiler, compiler->buf);
+	free_fragments(compiler, compiler->abuf);
+	free_fragments(compiler, compiler->free_buf);
+	free_fragments(compiler, compiler->free_abuf);
+
+#if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
+	compiler_free(compiler, compiler->cpool);
+#endif
+	if (compiler->ir_ops)
+		compiler_free(compiler, compiler->ir_ops);
+	/* The compiler is released last, the allocator is stored in it. */
+	compiler_free(compiler, compiler);
+}
+
+/* Keeps the first fragment of the chain, the others are moved to the free list. */
+static struct sljit_memory_fragment* recycle_fragments(struct sljit_memory_fragment *buf,
+	struct sljit_memory_fragment **free_list)
+{
 	struct sljit_memory_fragment *curr;
+	struct sljit_memory_fragment *next = buf->next;
 
-	buf = compiler->buf;
-	while (buf != NULL) {
-		curr = buf;
-		buf = buf->next;
-		free(curr);
+	while (next != NULL) {
+		curr = next;
+		next = next->next;
+		curr->next = *free_list;
+		*free_list = curr;
 	}
 
-	buf = compiler->abuf;
-	while (buf != NULL) {
-		curr = buf;
-		buf = buf->next;
-		free(curr);
-	}
+	buf->next = NULL;
+	buf->used_size = 0;
+	return buf;
+}
+
+void sljit_reset_compiler(struct sljit_compiler *compiler)
+{
+	struct sljit_memory_fragment *buf;
+	struct sljit_memory_fragment *abuf;
+	struct sljit_memory_fragment *free_buf;
+	struct sljit_memory_fragment *free_abuf;
+	struct sljit_allocator allocator = compiler->allocator;
+	struct sljit_ir_op *ir_ops = compiler->ir_ops;
+#if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
+	unsigned long *cpool = compiler->cpool;
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	FILE* verbose = compiler->verbose;
+#endif
+
+	/* The switches are not recycled, their size depends on the label count. */
+	free_switches(compiler);
+
+	free_buf = compiler->free_buf;
+	free_abuf = compiler->free_abuf;
+	buf = recycle_fragments(compiler->buf, &free_buf);
+	abuf = recycle_fragments(compiler->abuf, &free_abuf);
+
+	memset(compiler, 0, sizeof(struct sljit_compiler));
+
+	compiler->buf = buf;
+	compiler->abuf = abuf;
+	compiler->free_buf = free_buf;
+	compiler->free_abuf = free_abuf;
+	compiler->allocator = allocator;
+	compiler->ir_ops = ir_ops;
 
 #if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
-	free(compiler->cpool);
+	compiler->cpool = cpool;
+	compiler->cpool_unique = (u_char*)(cpool + CPOOL_SIZE);
 #endif
-	free(compiler);
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	compiler->verbose = verbose;
+#endif
+
+	init_compiler_members(compiler);
 }
 
 #if (defined SLJIT_CONFIG_ARM_THUMB2 && SLJIT_CONFIG_ARM_THUMB2)
@@ -459,6 +604,14 @@ void sljit_set_target(struct sljit_jump *jump, unsigned long target)
 	}
 }
 
+void sljit_set_switch_label(struct sljit_switch *switch_, long index, struct sljit_label *label)
+{
+	if (!!switch_ && !!label) {
+		SLJIT_ASSERT(index >= 0 && index < switch_->count);
+		switch_->labels[index] = label;
+	}
+}
+
 /* --------------------------------------------------------------------- */
 /*  Private functions                                                    */
 /* --------------------------------------------------------------------- */
@@ -474,8 +627,13 @@ static void* ensure_buf(struct sljit_compiler *compiler, unsigned long size)
 		compiler->buf->used_size += size;
 		return ret;
 	}
-	new_frag = malloc(BUF_SIZE);
-	PTR_FAIL_IF_NULL(new_frag);
+	new_frag = compiler->free_buf;
+	if (new_frag)
+		compiler->free_buf = new_frag->next;
+	else {
+		new_frag = compiler_alloc(compiler, BUF_SIZE);
+		PTR_FAIL_IF_NULL(new_frag);
+	}
 	new_frag->next = compiler->buf;
 	compiler->buf = new_frag;
 	new_frag->used_size = size;
@@ -493,8 +651,13 @@ static void* ensure_abuf(struct sljit_compiler *compiler, unsigned long size)
 		compiler->abuf->used_size += size;
 		return ret;
 	}
-	new_frag = malloc(ABUF_SIZE);
-	PTR_FAIL_IF_NULL(new_frag);
+	new_frag = compiler->free_abuf;
+	if (new_frag)
+		compiler->free_abuf = new_frag->next;
+	else {
+		new_frag = compiler_alloc(compiler, ABUF_SIZE);
+		PTR_FAIL_IF_NULL(new_frag);
+	}
 	new_frag->next = compiler->abuf;
 	compiler->abuf = new_frag;
 	new_frag->used_size = size;
@@ -508,11 +671,11 @@ void* sljit_alloc_memory(struct sljit_compiler *compiler, int size)
 #if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
 	if (size <= 0 || size > 128)
 		return NULL;
-	size = (size + 7) & ~0x111;
+	size = (size + 7) & ~7;
 #else
 	if (size <= 0 || size > 64)
 		return NULL;
-	size = (size + 3) & ~0x11;
+	size = (size + 3) & ~3;
 #endif
 	return ensure_abuf(compiler, size);
 }
@@ -598,6 +761,65 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 	compiler->last_const = const_;
 }
 
+#if (defined SLJIT_SWITCH_SUPPORT && SLJIT_SWITCH_SUPPORT)
+
+/* The switch and its labels are allocated together, since the
+   label count can be bigger than the size limit of ensure_abuf. */
+static struct sljit_switch* set_switch(struct sljit_compiler *compiler, struct sljit_label **labels, long count)
+{
+	struct sljit_switch *switch_;
+	long i;
+
+	switch_ = compiler_alloc(compiler, sizeof(struct sljit_switch) + count * sizeof(struct sljit_label*));
+	PTR_FAIL_IF_NULL(switch_);
+
+	switch_->next = NULL;
+	switch_->addr = 0;
+	switch_->count = count;
+	switch_->labels = (struct sljit_label**)(switch_ + 1);
+	for (i = 0; i < count; i++)
+		switch_->labels[i] = labels ? labels[i] : NULL;
+
+	if (compiler->last_switch)
+		compiler->last_switch->next = switch_;
+	else
+		compiler->switches = switch_;
+	compiler->last_switch = switch_;
+	return switch_;
+}
+
+/* Size of the jump tables in bytes (including the alignment). */
+static unsigned long get_switch_tables_size(struct sljit_compiler *compiler)
+{
+	struct sljit_switch *switch_ = compiler->switches;
+	unsigned long size;
+
+	if (!switch_)
+		return 0;
+
+	size = sizeof(long) - 1;
+	do {
+		size += switch_->count * sizeof(long);
+		switch_ = switch_->next;
+	} while (switch_);
+	return size;
+}
+
+/* Writes the jump table of the switch to the first word aligned address
+   from ptr, and returns with the start of the table. The labels must
+   have their final addresses. */
+static unsigned long* write_switch_table(struct sljit_switch *switch_, void *ptr)
+{
+	unsigned long *table = (unsigned long*)(((unsigned long)ptr + sizeof(long) - 1) & ~(sizeof(long) - 1));
+	long i;
+
+	for (i = 0; i < switch_->count; i++)
+		table[i] = switch_->labels[i]->addr;
+	return table;
+}
+
+#endif /* SLJIT_SWITCH_SUPPORT */
+
 #define ADDRESSING_DEPENDS_ON(exp, reg) \
 	(((exp) & SLJIT_MEM) && (((exp) & REG_MASK) == reg || OFFS_REG(exp) == reg))
 
@@ -607,6 +829,8 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 	switch (GET_OPCODE(op)) { \
 	case SLJIT_NOT: \
 	case SLJIT_CLZ: \
+	case SLJIT_CTZ: \
+	case SLJIT_POPCNT: \
 	case SLJIT_AND: \
 	case SLJIT_OR: \
 	case SLJIT_XOR: \
@@ -618,6 +842,12 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 	case SLJIT_NEG: \
 		CHECK_ARGUMENT(!(op & (SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_C))); \
 		break; \
+	case SLJIT_BSWAP: \
+	case SLJIT_BSWAP16: \
+	case SLJIT_ROTL: \
+	case SLJIT_ROTR: \
+		CHECK_ARGUMENT(!(op & (SLJIT_SET_E | SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_O | SLJIT_SET_C))); \
+		break; \
 	case SLJIT_MUL: \
 		CHECK_ARGUMENT(!(op & (SLJIT_SET_E | SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_C))); \
 		break; \
@@ -640,6 +870,10 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 	case SLJIT_MOVU: \
 	case SLJIT_MOVU_UI: \
 	case SLJIT_MOVU_P: \
+	case SLJIT_PREFETCH_L1: \
+	case SLJIT_PREFETCH_L2: \
+	case SLJIT_PREFETCH_L3: \
+	case SLJIT_PREFETCH_ONCE: \
 		/* Nothing allowed */ \
 		CHECK_ARGUMENT(!(op & (SLJIT_INT_OP | SLJIT_SET_E | SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_O | SLJIT_SET_C | SLJIT_KEEP_FLAGS))); \
 		break; \
@@ -666,6 +900,15 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 	(((r) >= SLJIT_R0 && (r) < (SLJIT_R0 + compiler->scratches)) || \
 	((r) > (SLJIT_S0 - compiler->saveds) && (r) <= SLJIT_S0))
 
+#define FUNCTION_CHECK_IS_FREG(r) \
+	(((r) >= SLJIT_FR0 && (r) < (SLJIT_FR0 + compiler->fscratches)) || \
+	((r) > (SLJIT_FS0 - compiler->fsaveds) && (r) <= SLJIT_FS0))
+
+#define FUNCTION_CHECK_VOP() \
+	CHECK_ARGUMENT(compiler->fscratches != -1 && compiler->fsaveds != -1); \
+	/* Only the lane and vector size flags are allowed. */ \
+	CHECK_ARGUMENT(!(op & (SLJIT_SET_S | SLJIT_SET_O | SLJIT_SET_C | SLJIT_KEEP_FLAGS)));
+
 #define FUNCTION_CHECK_IS_REG_OR_UNUSED(r) \
 	((r) == SLJIT_UNUSED || \
 	((r) >= SLJIT_R0 && (r) < (SLJIT_R0 + compiler->scratches)) || \
@@ -694,7 +937,6 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 			CHECK_ARGUMENT(((p) & REG_MASK) != SLJIT_UNUSED); \
 			CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(OFFS_REG(p))); \
 			CHECK_NOT_VIRTUAL_REG(OFFS_REG(p)); \
-			CHECK_ARGUMENT(!((i) & ~0x3)); \
 		} \
 		CHECK_ARGUMENT(!((p) & ~(SLJIT_MEM | SLJIT_IMM | REG_MASK | OFFS_REG_MASK))); \
 	}
@@ -713,7 +955,6 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 			CHECK_ARGUMENT(((p) & REG_MASK) != SLJIT_UNUSED); \
 			CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(OFFS_REG(p))); \
 			CHECK_NOT_VIRTUAL_REG(OFFS_REG(p)); \
-			CHECK_ARGUMENT(!((i) & ~0x3)); \
 		} \
 		CHECK_ARGUMENT(!((p) & ~(SLJIT_MEM | SLJIT_IMM | REG_MASK | OFFS_REG_MASK))); \
 	}
@@ -733,12 +974,16 @@ static __inline void set_const(struct sljit_const *const_, struct sljit_compiler
 			CHECK_ARGUMENT(((p) & REG_MASK) != SLJIT_UNUSED); \
 			CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(OFFS_REG(p))); \
 			CHECK_NOT_VIRTUAL_REG(OFFS_REG(p)); \
-			CHECK_ARGUMENT(((p) & OFFS_REG_MASK) != TO_OFFS_REG(SLJIT_SP) && !(i & ~0x3)); \
+			CHECK_ARGUMENT(((p) & OFFS_REG_MASK) != TO_OFFS_REG(SLJIT_SP)); \
 		} \
 		CHECK_ARGUMENT(!((p) & ~(SLJIT_MEM | SLJIT_IMM | REG_MASK | OFFS_REG_MASK))); \
 	}
 
 #define FUNCTION_CHECK_OP1() \
+	if (GET_OPCODE(op) >= SLJIT_PREFETCH_L1 && GET_OPCODE(op) <= SLJIT_PREFETCH_ONCE) { \
+		CHECK_ARGUMENT(dst == SLJIT_UNUSED && dstw == 0); \
+		CHECK_ARGUMENT(src & SLJIT_MEM); \
+	} \
 	if (GET_OPCODE(op) >= SLJIT_MOVU && GET_OPCODE(op) <= SLJIT_MOVU_P) { \
 		CHECK_ARGUMENT(!(src & SLJIT_MEM) || (src & REG_MASK) != SLJIT_SP); \
 		CHECK_ARGUMENT(!(dst & SLJIT_MEM) || (dst & REG_MASK) != SLJIT_SP); \
@@ -783,8 +1028,10 @@ void sljit_compiler_verbose(struct sljit_compiler *compiler, FILE* verbose)
 			if ((p) & OFFS_REG_MASK) { \
 				fprintf(compiler->verbose, " + "); \
 				sljit_verbose_reg(compiler, OFFS_REG(p)); \
-				if (i) \
-					fprintf(compiler->verbose, " * %d", 1 << (i)); \
+				if (MEM2_SHIFT(i)) \
+					fprintf(compiler->verbose, " * %d", 1 << MEM2_SHIFT(i)); \
+				if (MEM2_DISP(i)) \
+					fprintf(compiler->verbose, " + %" SLJIT_PRINT_D "d", MEM2_DISP(i)); \
 			} \
 			else if (i) \
 				fprintf(compiler->verbose, " + %" SLJIT_PRINT_D "d", (i)); \
@@ -805,8 +1052,10 @@ void sljit_compiler_verbose(struct sljit_compiler *compiler, FILE* verbose)
 			if ((p) & OFFS_REG_MASK) { \
 				fprintf(compiler->verbose, " + "); \
 				sljit_verbose_reg(compiler, OFFS_REG(p)); \
-				if (i) \
-					fprintf(compiler->verbose, "%d", 1 << (i)); \
+				if (MEM2_SHIFT(i)) \
+					fprintf(compiler->verbose, "%d", 1 << MEM2_SHIFT(i)); \
+				if (MEM2_DISP(i)) \
+					fprintf(compiler->verbose, "%" SLJIT_PRINT_D "d", MEM2_DISP(i)); \
 			} \
 			else if (i) \
 				fprintf(compiler->verbose, "%" SLJIT_PRINT_D "d", (i)); \
@@ -822,6 +1071,14 @@ void sljit_compiler_verbose(struct sljit_compiler *compiler, FILE* verbose)
 			fprintf(compiler->verbose, "fs%d", SLJIT_NUM_FLOAT_REGS - (p)); \
 	}
 
+#define sljit_verbose_call_type(compiler, type) \
+	if (GET_FLOAT_ARGS(type)) \
+		fprintf(compiler->verbose, ".fargs%d", GET_FLOAT_ARGS(type)); \
+	if ((type) & SLJIT_CALL_RETURN_DOUBLE) \
+		fprintf(compiler->verbose, ".dret"); \
+	if ((type) & SLJIT_TAIL_CALL) \
+		fprintf(compiler->verbose, ".tail");
+
 static const char* op0_names[] = {
 	(char*)"breakpoint", (char*)"nop",
 	(char*)"lumul", (char*)"lsmul", (char*)"ludiv", (char*)"lsdiv",
@@ -832,13 +1089,17 @@ static const char* op1_names[] = {
 	(char*)"mov_sh", (char*)"mov_ui", (char*)"mov_si", (char*)"mov_p",
 	(char*)"movu", (char*)"movu_ub", (char*)"movu_sb", (char*)"movu_uh",
 	(char*)"movu_sh", (char*)"movu_ui", (char*)"movu_si", (char*)"movu_p",
-	(char*)"not", (char*)"neg", (char*)"clz",
+	(char*)"not", (char*)"neg", (char*)"clz", (char*)"ctz",
+	(char*)"popcnt", (char*)"bswap", (char*)"bswap16", (char*)"prefetch_l1",
+	(char*)"prefetch_l2", (char*)"prefetch_l3", (char*)"prefetch_once",
 };
 
 static const char* op2_names[] = {
 	(char*)"add", (char*)"addc", (char*)"sub", (char*)"subc",
 	(char*)"mul", (char*)"and", (char*)"or", (char*)"xor",
-	(char*)"shl", (char*)"lshr", (char*)"ashr",
+	(char*)"shl", (char*)"lshr", (char*)"ashr", (char*)"rotl",
+	(char*)"rotr", (char*)"udiv", (char*)"sdiv", (char*)"umod",
+	(char*)"smod",
 };
 
 static const char* fop1_names[] = {
@@ -851,6 +1112,18 @@ static const char* fop2_names[] = {
 	(char*)"add", (char*)"sub", (char*)"mul", (char*)"div"
 };
 
+static const char* vop1_names[] = {
+	(char*)"vmov", (char*)"vbroadcast", (char*)"vmovemask"
+};
+
+static const char* vop2_names[] = {
+	(char*)"vadd", (char*)"vsub", (char*)"vand", (char*)"vor",
+	(char*)"vxor", (char*)"vcmpeq", (char*)"vcmpgt", (char*)"vshuffle"
+};
+
+#define VOP_LANE_BITS(op) \
+	(8 << (((op) & SLJIT_VEC_64) >> 8))
+
 #define JUMP_PREFIX(type) \
 	((type & 0xff) <= SLJIT_MUL_NOT_OVERFLOW ? ((type & SLJIT_INT_OP) ? "i_" : "") \
 	: ((type & 0xff) <= SLJIT_D_ORDERED ? ((type & SLJIT_SINGLE_OP) ? "s_" : "d_") : ""))
@@ -868,7 +1141,8 @@ static char* jump_names[] = {
 	(char*)"greater", (char*)"less_equal",
 	(char*)"unordered", (char*)"ordered",
 	(char*)"jump", (char*)"fast_call",
-	(char*)"call0", (char*)"call1", (char*)"call2", (char*)"call3"
+	(char*)"call0", (char*)"call1", (char*)"call2", (char*)"call3",
+	(char*)"call4", (char*)"call5", (char*)"call6"
 };
 
 #endif /* SLJIT_VERBOSE */
@@ -884,6 +1158,8 @@ static __inline CHECK_RETURN_TYPE check_sljit_generate_code(struct sljit_compile
 {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	struct sljit_jump *jump;
+	struct sljit_switch *switch_;
+	long i;
 #endif
 
 	(void)compiler;
@@ -896,10 +1172,54 @@ static __inline CHECK_RETURN_TYPE check_sljit_generate_code(struct sljit_compile
 		CHECK_ARGUMENT(jump->flags & (JUMP_LABEL | JUMP_ADDR));
 		jump = jump->next;
 	}
+	switch_ = compiler->switches;
+	while (switch_) {
+		/* All switch items have target. */
+		for (i = 0; i < switch_->count; i++)
+			CHECK_ARGUMENT(switch_->labels[i]);
+		switch_ = switch_->next;
+	}
 #endif
 	CHECK_RETURN_OK;
 }
 
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+
+#define LAST_CALL_TYPE		SLJIT_CALL6
+#define EXTENDED_CALL_FLAGS	(SLJIT_FLOAT_ARGS(0xf) | SLJIT_CALL_RETURN_DOUBLE)
+
+#define FUNCTION_CHECK_ARGS(args) \
+	CHECK_ARGUMENT(!((args) & ~(0xffff | SLJIT_FLOAT_ARGS(0xf)))); \
+	CHECK_ARGUMENT(GET_WORD_ARGS(args) <= 6 && GET_FLOAT_ARGS(args) <= 8);
+
+#else /* !SLJIT_EXTENDED_CALLS */
+
+#define LAST_CALL_TYPE		SLJIT_CALL3
+#define EXTENDED_CALL_FLAGS	0
+
+#define FUNCTION_CHECK_ARGS(args) \
+	CHECK_ARGUMENT((args) >= 0 && (args) <= 3);
+
+#endif /* SLJIT_EXTENDED_CALLS */
+
+#if (defined SLJIT_TAIL_CALL_SUPPORT && SLJIT_TAIL_CALL_SUPPORT)
+#define CALL_TYPE_FLAGS		(EXTENDED_CALL_FLAGS | SLJIT_TAIL_CALL)
+#else
+#define CALL_TYPE_FLAGS		EXTENDED_CALL_FLAGS
+#endif
+
+/* The double arguments and the double result of a call are passed in
+   the scratch floating point regs starting from SLJIT_FR0. A tail call
+   releases the stack frame, so it needs a context. */
+#define FUNCTION_CHECK_CALL_TYPE(type) \
+	if ((type) & CALL_TYPE_FLAGS) { \
+		CHECK_ARGUMENT(((type) & 0xff) >= SLJIT_CALL0); \
+		CHECK_ARGUMENT(GET_FLOAT_ARGS(type) <= 8 && GET_FLOAT_ARGS(type) <= compiler->fscratches); \
+		CHECK_ARGUMENT(!((type) & SLJIT_CALL_RETURN_DOUBLE) || compiler->fscratches >= 1); \
+		CHECK_ARGUMENT(!((type) & SLJIT_TAIL_CALL) || !((type) & SLJIT_CALL_RETURN_DOUBLE)); \
+		CHECK_ARGUMENT(!((type) & SLJIT_TAIL_CALL) || compiler->scratches >= 0); \
+	}
+
 static __inline CHECK_RETURN_TYPE check_sljit_emit_enter(struct sljit_compiler *compiler,
 	int options, int args, int scratches, int saveds,
 	int fscratches, int fsaveds, int local_size)
@@ -907,21 +1227,22 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_enter(struct sljit_compiler *
 	(void)compiler;
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(!(options & ~SLJIT_DOUBLE_ALIGNMENT));
-	CHECK_ARGUMENT(args >= 0 && args <= 3);
+	CHECK_ARGUMENT(!(options & ~(SLJIT_DOUBLE_ALIGNMENT | SLJIT_PEEPHOLE_OPTIMIZER | SLJIT_IR_OPTIMIZER)));
+	FUNCTION_CHECK_ARGS(args);
 	CHECK_ARGUMENT(scratches >= 0 && scratches <= SLJIT_NUM_REGS);
 	CHECK_ARGUMENT(saveds >= 0 && saveds <= SLJIT_NUM_REGS);
 	CHECK_ARGUMENT(scratches + saveds <= SLJIT_NUM_REGS);
-	CHECK_ARGUMENT(args <= saveds);
+	CHECK_ARGUMENT(GET_WORD_ARGS(args) <= saveds);
 	CHECK_ARGUMENT(fscratches >= 0 && fscratches <= SLJIT_NUM_FLOAT_REGS);
 	CHECK_ARGUMENT(fsaveds >= 0 && fsaveds <= SLJIT_NUM_FLOAT_REGS);
 	CHECK_ARGUMENT(fscratches + fsaveds <= SLJIT_NUM_FLOAT_REGS);
+	CHECK_ARGUMENT(GET_FLOAT_ARGS(args) <= fscratches);
 	CHECK_ARGUMENT(local_size >= 0 && local_size <= SLJIT_MAX_LOCAL_SIZE);
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose)
-		fprintf(compiler->verbose, "  enter options:none args:%d scratches:%d saveds:%d fscratches:%d fsaveds:%d local_size:%d\n",
-			args, scratches, saveds, fscratches, fsaveds, local_size);
+		fprintf(compiler->verbose, "  enter options:none args:%d fargs:%d scratches:%d saveds:%d fscratches:%d fsaveds:%d local_size:%d\n",
+			GET_WORD_ARGS(args), GET_FLOAT_ARGS(args), scratches, saveds, fscratches, fsaveds, local_size);
 #endif
 	CHECK_RETURN_OK;
 }
@@ -936,21 +1257,22 @@ static __inline CHECK_RETURN_TYPE check_sljit_set_context(struct sljit_compiler
 	}
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(!(options & ~SLJIT_DOUBLE_ALIGNMENT));
-	CHECK_ARGUMENT(args >= 0 && args <= 3);
+	CHECK_ARGUMENT(!(options & ~(SLJIT_DOUBLE_ALIGNMENT | SLJIT_PEEPHOLE_OPTIMIZER | SLJIT_IR_OPTIMIZER)));
+	FUNCTION_CHECK_ARGS(args);
 	CHECK_ARGUMENT(scratches >= 0 && scratches <= SLJIT_NUM_REGS);
 	CHECK_ARGUMENT(saveds >= 0 && saveds <= SLJIT_NUM_REGS);
 	CHECK_ARGUMENT(scratches + saveds <= SLJIT_NUM_REGS);
-	CHECK_ARGUMENT(args <= saveds);
+	CHECK_ARGUMENT(GET_WORD_ARGS(args) <= saveds);
 	CHECK_ARGUMENT(fscratches >= 0 && fscratches <= SLJIT_NUM_FLOAT_REGS);
 	CHECK_ARGUMENT(fsaveds >= 0 && fsaveds <= SLJIT_NUM_FLOAT_REGS);
 	CHECK_ARGUMENT(fscratches + fsaveds <= SLJIT_NUM_FLOAT_REGS);
+	CHECK_ARGUMENT(GET_FLOAT_ARGS(args) <= fscratches);
 	CHECK_ARGUMENT(local_size >= 0 && local_size <= SLJIT_MAX_LOCAL_SIZE);
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose)
-		fprintf(compiler->verbose, "  set_context options:none args:%d scratches:%d saveds:%d fscratches:%d fsaveds:%d local_size:%d\n",
-			args, scratches, saveds, fscratches, fsaveds, local_size);
+		fprintf(compiler->verbose, "  set_context options:none args:%d fargs:%d scratches:%d saveds:%d fscratches:%d fsaveds:%d local_size:%d\n",
+			GET_WORD_ARGS(args), GET_FLOAT_ARGS(args), scratches, saveds, fscratches, fsaveds, local_size);
 #endif
 	CHECK_RETURN_OK;
 }
@@ -959,6 +1281,13 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_return(struct sljit_compiler
 {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
 	CHECK_ARGUMENT(compiler->scratches >= 0);
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+	if (op == SLJIT_DMOV) {
+		CHECK_ARGUMENT(sljit_is_fpu_available());
+		FUNCTION_FCHECK(src, srcw);
+	}
+	else
+#endif
 	if (op != SLJIT_UNUSED) {
 		CHECK_ARGUMENT(op >= SLJIT_MOV && op <= SLJIT_MOV_P);
 		FUNCTION_CHECK_SRC(src, srcw);
@@ -970,6 +1299,11 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_return(struct sljit_compiler
 	if (!!compiler->verbose) {
 		if (op == SLJIT_UNUSED)
 			fprintf(compiler->verbose, "  return\n");
+		else if (op == SLJIT_DMOV) {
+			fprintf(compiler->verbose, "  return.dmov ");
+			sljit_verbose_fparam(compiler, src, srcw);
+			fprintf(compiler->verbose, "\n");
+		}
 		else {
 			fprintf(compiler->verbose, "  return.%s ", op1_names[op - SLJIT_OP1_BASE]);
 			sljit_verbose_param(compiler, src, srcw);
@@ -1034,7 +1368,7 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_op1(struct sljit_compiler *co
 	}
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_MOV && GET_OPCODE(op) <= SLJIT_CLZ);
+	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_MOV && GET_OPCODE(op) <= SLJIT_PREFETCH_ONCE);
 	FUNCTION_CHECK_OP();
 	FUNCTION_CHECK_SRC(src, srcw);
 	FUNCTION_CHECK_DST(dst, dstw);
@@ -1065,11 +1399,13 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_op2(struct sljit_compiler *co
 	}
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_ADD && GET_OPCODE(op) <= SLJIT_ASHR);
+	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_ADD && GET_OPCODE(op) <= SLJIT_SMOD_IMM);
 	FUNCTION_CHECK_OP();
 	FUNCTION_CHECK_SRC(src1, src1w);
 	FUNCTION_CHECK_SRC(src2, src2w);
 	FUNCTION_CHECK_DST(dst, dstw);
+	if (GET_OPCODE(op) >= SLJIT_UDIV_IMM)
+		CHECK_ARGUMENT(src2 == SLJIT_IMM && ((op & SLJIT_INT_OP) ? (int)src2w : src2w) != 0);
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose) {
@@ -1287,6 +1623,86 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_fop2(struct sljit_compiler *c
 	CHECK_RETURN_OK;
 }
 
+static __inline CHECK_RETURN_TYPE check_sljit_emit_vop1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_VMOV && GET_OPCODE(op) <= SLJIT_VMOVEMASK);
+	FUNCTION_CHECK_VOP();
+	switch (GET_OPCODE(op)) {
+	case SLJIT_VMOV:
+		FUNCTION_FCHECK(src, srcw);
+		FUNCTION_FCHECK(dst, dstw);
+		CHECK_ARGUMENT(!(src & SLJIT_MEM) || !(dst & SLJIT_MEM));
+		break;
+	case SLJIT_VBROADCAST:
+		FUNCTION_CHECK_SRC(src, srcw);
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(dst) && dstw == 0);
+		break;
+	default:
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src) && srcw == 0);
+		FUNCTION_CHECK_DST(dst, dstw);
+		break;
+	}
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  %s.%d%s ", vop1_names[GET_OPCODE(op) - SLJIT_VOP1_BASE],
+			VOP_LANE_BITS(op), (op & SLJIT_VEC_256) ? ".256" : "");
+		if (GET_OPCODE(op) == SLJIT_VMOVEMASK) {
+			sljit_verbose_param(compiler, dst, dstw);
+		} else {
+			sljit_verbose_fparam(compiler, dst, dstw);
+		}
+		fprintf(compiler->verbose, ", ");
+		if (GET_OPCODE(op) == SLJIT_VBROADCAST) {
+			sljit_verbose_param(compiler, src, srcw);
+		} else {
+			sljit_verbose_fparam(compiler, src, srcw);
+		}
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static __inline CHECK_RETURN_TYPE check_sljit_emit_vop2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(GET_OPCODE(op) >= SLJIT_VADD && GET_OPCODE(op) <= SLJIT_VSHUFFLE);
+	FUNCTION_CHECK_VOP();
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(dst) && dstw == 0);
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src1) && src1w == 0);
+	if (GET_OPCODE(op) == SLJIT_VSHUFFLE) {
+		CHECK_ARGUMENT((op & SLJIT_VEC_64) == SLJIT_VEC_32);
+		CHECK_ARGUMENT(src2 == SLJIT_IMM && !(src2w & ~0xff));
+	}
+	else
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_FREG(src2) && src2w == 0);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  %s.%d%s ", vop2_names[GET_OPCODE(op) - SLJIT_VOP2_BASE],
+			VOP_LANE_BITS(op), (op & SLJIT_VEC_256) ? ".256" : "");
+		sljit_verbose_fparam(compiler, dst, dstw);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_fparam(compiler, src1, src1w);
+		fprintf(compiler->verbose, ", ");
+		if (src2 == SLJIT_IMM) {
+			sljit_verbose_param(compiler, src2, src2w);
+		} else {
+			sljit_verbose_fparam(compiler, src2, src2w);
+		}
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
 static __inline CHECK_RETURN_TYPE check_sljit_emit_label(struct sljit_compiler *compiler)
 {
 	(void)compiler;
@@ -1306,14 +1722,18 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_jump(struct sljit_compiler *c
 	}
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(!(type & ~(0xff | SLJIT_REWRITABLE_JUMP | SLJIT_INT_OP)));
-	CHECK_ARGUMENT((type & 0xff) >= SLJIT_EQUAL && (type & 0xff) <= SLJIT_CALL3);
+	CHECK_ARGUMENT(!(type & ~(0xff | SLJIT_REWRITABLE_JUMP | SLJIT_INT_OP | CALL_TYPE_FLAGS)));
+	CHECK_ARGUMENT((type & 0xff) >= SLJIT_EQUAL && (type & 0xff) <= LAST_CALL_TYPE);
 	CHECK_ARGUMENT((type & 0xff) < SLJIT_JUMP || !(type & SLJIT_INT_OP));
+	FUNCTION_CHECK_CALL_TYPE(type);
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
-	if (!!compiler->verbose)
-		fprintf(compiler->verbose, "  jump%s.%s%s\n", !(type & SLJIT_REWRITABLE_JUMP) ? "" : ".r",
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  jump%s.%s%s", !(type & SLJIT_REWRITABLE_JUMP) ? "" : ".r",
 			JUMP_PREFIX(type), jump_names[type & 0xff]);
+		sljit_verbose_call_type(compiler, type);
+		fprintf(compiler->verbose, "\n");
+	}
 #endif
 	CHECK_RETURN_OK;
 }
@@ -1373,12 +1793,16 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_ijump(struct sljit_compiler *
 	}
 
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	CHECK_ARGUMENT(type >= SLJIT_JUMP && type <= SLJIT_CALL3);
+	CHECK_ARGUMENT(!(type & ~(0xff | CALL_TYPE_FLAGS)));
+	CHECK_ARGUMENT((type & 0xff) >= SLJIT_JUMP && (type & 0xff) <= LAST_CALL_TYPE);
+	FUNCTION_CHECK_CALL_TYPE(type);
 	FUNCTION_CHECK_SRC(src, srcw);
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose) {
-		fprintf(compiler->verbose, "  ijump.%s ", jump_names[type]);
+		fprintf(compiler->verbose, "  ijump.%s", jump_names[type & 0xff]);
+		sljit_verbose_call_type(compiler, type);
+		fprintf(compiler->verbose, " ");
 		sljit_verbose_param(compiler, src, srcw);
 		fprintf(compiler->verbose, "\n");
 	}
@@ -1386,6 +1810,26 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_ijump(struct sljit_compiler *
 	CHECK_RETURN_OK;
 }
 
+static __inline CHECK_RETURN_TYPE check_sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count)
+{
+	(void)labels;
+
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	FUNCTION_CHECK_SRC(src, srcw);
+	CHECK_ARGUMENT(count > 0);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  switch ");
+		sljit_verbose_param(compiler, src, srcw);
+		fprintf(compiler->verbose, ", #%" SLJIT_PRINT_D "d\n", count);
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
 static __inline CHECK_RETURN_TYPE check_sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src, long srcw,
@@ -1421,32 +1865,130 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_op_flags(struct sljit_compile
 	CHECK_RETURN_OK;
 }
 
-static __inline CHECK_RETURN_TYPE check_sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
+static __inline CHECK_RETURN_TYPE check_sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
 {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	FUNCTION_CHECK_DST(dst, dstw);
+	CHECK_ARGUMENT(!(type & ~(0xff | SLJIT_INT_OP)));
+	CHECK_ARGUMENT((type & 0xff) >= SLJIT_EQUAL && (type & 0xff) <= SLJIT_D_ORDERED);
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(dst_reg));
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(src2_reg));
+	FUNCTION_CHECK_SRC(src1, src1w);
+	if ((src1 & SLJIT_MEM) && dst_reg != src2_reg) {
+		CHECK_ARGUMENT((src1 & REG_MASK) != dst_reg && OFFS_REG(src1) != dst_reg);
+	}
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose) {
-		fprintf(compiler->verbose, "  local_base ");
-		sljit_verbose_param(compiler, dst, dstw);
-		fprintf(compiler->verbose, ", #%" SLJIT_PRINT_D "d\n", offset);
+		fprintf(compiler->verbose, "  select.%s%s ", !(type & SLJIT_INT_OP) ? "" : "i", jump_names[type & 0xff]);
+		sljit_verbose_reg(compiler, dst_reg);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_param(compiler, src1, src1w);
+		fprintf(compiler->verbose, ", ");
+		sljit_verbose_reg(compiler, src2_reg);
+		fprintf(compiler->verbose, "\n");
 	}
 #endif
 	CHECK_RETURN_OK;
 }
 
-static __inline CHECK_RETURN_TYPE check_sljit_emit_const(struct sljit_compiler *compiler, int dst, long dstw, long init_value)
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+static const char* atomic_names[] = {
+	(char*)"load", (char*)"store", (char*)"xchg", (char*)"add", (char*)"cas"
+};
+
+static const char* order_names[] = {
+	(char*)"relaxed", (char*)"acquire", (char*)"release", (char*)"seq_cst"
+};
+#endif
+
+static __inline CHECK_RETURN_TYPE check_sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg)
 {
 #if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	FUNCTION_CHECK_DST(dst, dstw);
+	int type = op & 0xf;
+	int order = op & SLJIT_ORDER_SEQ_CST;
+
+	CHECK_ARGUMENT(!(op & ~(0xf | SLJIT_ORDER_SEQ_CST | SLJIT_INT_OP)));
+	CHECK_ARGUMENT(type >= SLJIT_ATOMIC_LOAD && type <= SLJIT_ATOMIC_CAS);
+	CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(mem_reg));
+	CHECK_NOT_VIRTUAL_REG(mem_reg);
+	if (type == SLJIT_ATOMIC_LOAD) {
+		CHECK_ARGUMENT(order != SLJIT_ORDER_RELEASE);
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(dst_reg) && src_reg == SLJIT_UNUSED);
+	}
+	else if (type == SLJIT_ATOMIC_STORE) {
+		CHECK_ARGUMENT(order != SLJIT_ORDER_ACQUIRE);
+		CHECK_ARGUMENT(dst_reg == SLJIT_UNUSED && FUNCTION_CHECK_IS_REG(src_reg));
+	}
+	else if (type == SLJIT_ATOMIC_CAS)
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG(dst_reg) && FUNCTION_CHECK_IS_REG(src_reg));
+	else
+		CHECK_ARGUMENT(FUNCTION_CHECK_IS_REG_OR_UNUSED(dst_reg) && FUNCTION_CHECK_IS_REG(src_reg));
 #endif
 #if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	if (!!compiler->verbose) {
-		fprintf(compiler->verbose, "  const ");
-		sljit_verbose_param(compiler, dst, dstw);
-		fprintf(compiler->verbose, ", #%" SLJIT_PRINT_D "d\n", init_value);
-	}
+		fprintf(compiler->verbose, "  atomic_%s%s.%s ", !(op & SLJIT_INT_OP) ? "" : "i",
+			atomic_names[op & 0xf], order_names[(op & SLJIT_ORDER_SEQ_CST) >> 4]);
+		if (dst_reg != SLJIT_UNUSED) {
+			sljit_verbose_reg(compiler, dst_reg);
+			fprintf(compiler->verbose, ", ");
+		}
+		fprintf(compiler->verbose, "[");
+		sljit_verbose_reg(compiler, mem_reg);
+		fprintf(compiler->verbose, "]");
+		if (src_reg != SLJIT_UNUSED) {
+			fprintf(compiler->verbose, ", ");
+			sljit_verbose_reg(compiler, src_reg);
+		}
+		fprintf(compiler->verbose, "\n");
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static __inline CHECK_RETURN_TYPE check_sljit_emit_fence(struct sljit_compiler *compiler, int type)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	CHECK_ARGUMENT(type == SLJIT_ORDER_ACQUIRE || type == SLJIT_ORDER_RELEASE || type == SLJIT_ORDER_SEQ_CST);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose)
+		fprintf(compiler->verbose, "  fence.%s\n", order_names[type >> 4]);
+#endif
+	CHECK_RETURN_OK;
+}
+
+static __inline CHECK_RETURN_TYPE check_sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	FUNCTION_CHECK_DST(dst, dstw);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  local_base ");
+		sljit_verbose_param(compiler, dst, dstw);
+		fprintf(compiler->verbose, ", #%" SLJIT_PRINT_D "d\n", offset);
+	}
+#endif
+	CHECK_RETURN_OK;
+}
+
+static __inline CHECK_RETURN_TYPE check_sljit_emit_const(struct sljit_compiler *compiler, int dst, long dstw, long init_value)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	FUNCTION_CHECK_DST(dst, dstw);
+#endif
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	if (!!compiler->verbose) {
+		fprintf(compiler->verbose, "  const ");
+		sljit_verbose_param(compiler, dst, dstw);
+		fprintf(compiler->verbose, ", #%" SLJIT_PRINT_D "d\n", init_value);
+	}
 #endif
 	CHECK_RETURN_OK;
 }
@@ -1478,6 +2020,482 @@ static __inline CHECK_RETURN_TYPE check_sljit_emit_const(struct sljit_compiler *
 	ADJUST_LOCAL_OFFSET(dst, dstw); \
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
+/* --------------------------------------------------------------------- */
+/*  IR optimizer                                                         */
+/* --------------------------------------------------------------------- */
+
+/* When SLJIT_IR_OPTIMIZER is enabled, sljit_emit_op1 and sljit_emit_op2
+   only record the operation. The buffer is optimized and emitted by
+   ir_flush, which is called by CHECK_ERROR of any other function, so
+   the buffer never contains a label or a jump. */
+
+#define IR_RECORD_OP1(op, dst, dstw, src, srcw) \
+	if ((compiler->options & SLJIT_IR_OPTIMIZER) && !compiler->ir_flushing) \
+		return ir_record_op1(compiler, op, dst, dstw, src, srcw);
+
+#define IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w) \
+	if ((compiler->options & SLJIT_IR_OPTIMIZER) && !compiler->ir_flushing) \
+		return ir_record_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w);
+
+#define IR_DELETED	-1
+
+/* Knowledge about the value of a register. */
+#define IR_UNKNOWN	0
+#define IR_CONST	1
+#define IR_COPY		2
+
+/* Number of memory locations tracked by the passes. */
+#define IR_MAX_MEMS	8
+
+#define IR_IS_REG(arg)	((arg) >= SLJIT_R0 && (arg) <= SLJIT_NUM_REGS)
+#define IR_IS_OP1(op)	(GET_OPCODE(op) < SLJIT_OP2_BASE)
+#define IR_IS_MOVU(op)	(GET_OPCODE(op) >= SLJIT_MOVU && GET_OPCODE(op) <= SLJIT_MOVU_P)
+#define IR_IS_WORD_MOV(op) \
+	((op) == SLJIT_MOV || (op) == SLJIT_MOV_P)
+
+/* Virtual registers cannot be used for memory addressing on x86-32. */
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+#define IR_IS_BASE_REG(reg)	((reg) < SLJIT_R3 || (reg) > SLJIT_R6)
+#else
+#define IR_IS_BASE_REG(reg)	1
+#endif
+
+static int ir_emit(struct sljit_compiler *compiler, struct sljit_ir_op *ir)
+{
+	int result;
+
+	compiler->ir_flushing = 1;
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	compiler->skip_checks = 1;
+#endif
+	if (IR_IS_OP1(ir->op))
+		result = sljit_emit_op1(compiler, ir->op, ir->dst, ir->dstw, ir->src1, ir->src1w);
+	else
+		result = sljit_emit_op2(compiler, ir->op, ir->dst, ir->dstw, ir->src1, ir->src1w, ir->src2, ir->src2w);
+	compiler->ir_flushing = 0;
+	return result;
+}
+
+/* Internal calls use temporary registers, or SLJIT_SP as a register. */
+static int ir_is_public_arg(int arg)
+{
+	if (arg & SLJIT_MEM) {
+		if ((arg & REG_MASK) > SLJIT_NUM_REGS && (arg & REG_MASK) != SLJIT_SP)
+			return 0;
+		return OFFS_REG(arg) <= SLJIT_NUM_REGS;
+	}
+	return arg == SLJIT_IMM || arg <= SLJIT_NUM_REGS;
+}
+
+static int ir_record(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	struct sljit_ir_op *ir;
+	struct sljit_ir_op direct;
+
+	if (!ir_is_public_arg(dst) || !ir_is_public_arg(src1) || !ir_is_public_arg(src2)) {
+		FAIL_IF(ir_flush(compiler));
+		ir = &direct;
+	}
+	else {
+		if (!compiler->ir_ops) {
+			compiler->ir_ops = (struct sljit_ir_op*)compiler_alloc(compiler, SLJIT_IR_MAX_OPS * sizeof(struct sljit_ir_op));
+			if (!compiler->ir_ops) {
+				compiler->error = SLJIT_ERR_ALLOC_FAILED;
+				return compiler->error;
+			}
+		}
+		if (compiler->ir_count >= SLJIT_IR_MAX_OPS)
+			FAIL_IF(ir_flush(compiler));
+		ir = compiler->ir_ops + compiler->ir_count++;
+	}
+
+	ir->op = op;
+	ir->dst = dst;
+	ir->dstw = dstw;
+	ir->src1 = src1;
+	ir->src1w = src1w;
+	ir->src2 = src2;
+	ir->src2w = src2w;
+
+	if (ir == &direct)
+		return ir_emit(compiler, ir);
+	return SLJIT_SUCCESS;
+}
+
+static int ir_record_op1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	if (compiler->error)
+		return compiler->error;
+	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	return ir_record(compiler, op, dst, dstw, src, srcw, SLJIT_UNUSED, 0);
+}
+
+static int ir_record_op2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	if (compiler->error)
+		return compiler->error;
+	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	return ir_record(compiler, op, dst, dstw, src1, src1w, src2, src2w);
+}
+
+static int ir_arg_uses(int arg, int reg)
+{
+	if (arg & SLJIT_MEM)
+		return (arg & REG_MASK) == reg || OFFS_REG(arg) == reg;
+	return arg == reg;
+}
+
+struct ir_state {
+	int kind[SLJIT_NUM_REGS + 1];
+	long value[SLJIT_NUM_REGS + 1];
+	/* Memory locations, whose value is stored in a register. */
+	int mem_count;
+	int mem_arg[IR_MAX_MEMS];
+	long mem_argw[IR_MAX_MEMS];
+	int mem_reg[IR_MAX_MEMS];
+};
+
+static void ir_forget_reg(struct ir_state *state, int reg)
+{
+	int i;
+
+	state->kind[reg] = IR_UNKNOWN;
+	for (i = SLJIT_R0; i <= SLJIT_NUM_REGS; i++)
+		if (state->kind[i] == IR_COPY && state->value[i] == reg)
+			state->kind[i] = IR_UNKNOWN;
+
+	for (i = 0; i < state->mem_count; ) {
+		if (state->mem_reg[i] == reg || ir_arg_uses(state->mem_arg[i], reg)) {
+			state->mem_count--;
+			state->mem_arg[i] = state->mem_arg[state->mem_count];
+			state->mem_argw[i] = state->mem_argw[state->mem_count];
+			state->mem_reg[i] = state->mem_reg[state->mem_count];
+		}
+		else
+			i++;
+	}
+}
+
+static void ir_add_mem(struct ir_state *state, int arg, long argw, int reg)
+{
+	if (state->mem_count >= IR_MAX_MEMS || ir_arg_uses(arg, reg))
+		return;
+	state->mem_arg[state->mem_count] = arg;
+	state->mem_argw[state->mem_count] = argw;
+	state->mem_reg[state->mem_count] = reg;
+	state->mem_count++;
+}
+
+/* Replaces the registers of an operand with their known values. */
+static void ir_propagate_arg(struct ir_state *state, int *arg, long *argw, int allow_imm)
+{
+	int reg;
+
+	if (IR_IS_REG(*arg)) {
+		reg = *arg;
+		if (state->kind[reg] == IR_CONST && (allow_imm > 1 || (allow_imm && state->value[reg] == (int)state->value[reg]))) {
+			*arg = SLJIT_IMM;
+			*argw = state->value[reg];
+		}
+		else if (state->kind[reg] == IR_COPY)
+			*arg = state->value[reg];
+		return;
+	}
+
+	if (!(*arg & SLJIT_MEM))
+		return;
+
+	reg = *arg & REG_MASK;
+	if (IR_IS_REG(reg) && state->kind[reg] == IR_COPY && IR_IS_BASE_REG(state->value[reg]))
+		*arg = (*arg & ~REG_MASK) | state->value[reg];
+
+	reg = OFFS_REG(*arg);
+	if (IR_IS_REG(reg) && state->kind[reg] == IR_COPY && IR_IS_BASE_REG(state->value[reg]))
+		*arg = (*arg & ~OFFS_REG_MASK) | TO_OFFS_REG(state->value[reg]);
+}
+
+/* Computes the result of operations on immediates. */
+static int ir_fold(struct sljit_ir_op *ir)
+{
+	int opcode = GET_OPCODE(ir->op);
+	unsigned long a = (unsigned long)ir->src1w;
+	unsigned long b = (unsigned long)ir->src2w;
+	unsigned long bits = (ir->op & SLJIT_INT_OP) ? 32 : sizeof(long) * 8;
+	unsigned long result;
+
+	if (GET_FLAGS(ir->op) || ir->dst == SLJIT_UNUSED || ir->src1 != SLJIT_IMM)
+		return 0;
+
+	if (IR_IS_OP1(ir->op)) {
+		if (opcode == SLJIT_NOT)
+			result = ~a;
+		else if (opcode == SLJIT_NEG)
+			result = -a;
+		else
+			return 0;
+	}
+	else {
+		if (ir->src2 != SLJIT_IMM)
+			return 0;
+
+		switch (opcode) {
+		case SLJIT_ADD:
+			result = a + b;
+			break;
+		case SLJIT_SUB:
+			result = a - b;
+			break;
+		case SLJIT_MUL:
+			result = a * b;
+			break;
+		case SLJIT_AND:
+			result = a & b;
+			break;
+		case SLJIT_OR:
+			result = a | b;
+			break;
+		case SLJIT_XOR:
+			result = a ^ b;
+			break;
+		case SLJIT_SHL:
+			result = a << (b & (bits - 1));
+			break;
+		case SLJIT_LSHR:
+			if (ir->op & SLJIT_INT_OP)
+				a = (unsigned int)a;
+			result = a >> (b & (bits - 1));
+			break;
+		case SLJIT_ASHR:
+			if (ir->op & SLJIT_INT_OP)
+				result = (unsigned long)(long)((int)a >> (b & (bits - 1)));
+			else
+				result = (unsigned long)((long)a >> (b & (bits - 1)));
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	if (ir->op & SLJIT_INT_OP) {
+		ir->op = SLJIT_MOV_SI;
+		ir->src1w = (int)result;
+	}
+	else {
+		ir->op = SLJIT_MOV;
+		ir->src1w = (long)result;
+	}
+	ir->src2 = SLJIT_UNUSED;
+	ir->src2w = 0;
+	return 1;
+}
+
+/* Constant and copy propagation, constant folding and
+   redundant load elimination in a forward pass. */
+static void ir_propagate(struct sljit_ir_op *ir, int count)
+{
+	struct ir_state state;
+	int opcode, allow_imm, i;
+
+	memset(&state, 0, sizeof(state));
+
+	for (; count > 0; ir++, count--) {
+		opcode = GET_OPCODE(ir->op);
+
+		if (IR_IS_MOVU(ir->op)) {
+			/* The base register is updated as well. */
+			memset(&state, 0, sizeof(state));
+			continue;
+		}
+
+		if (IR_IS_OP1(ir->op)) {
+			allow_imm = 0;
+			if (opcode <= SLJIT_MOV_P)
+				allow_imm = 2;
+			else if (opcode == SLJIT_NOT || opcode == SLJIT_NEG)
+				allow_imm = 1;
+			ir_propagate_arg(&state, &ir->src1, &ir->src1w, allow_imm);
+		}
+		else {
+			ir_propagate_arg(&state, &ir->src1, &ir->src1w, 1);
+			ir_propagate_arg(&state, &ir->src2, &ir->src2w, 1);
+		}
+		if (ir->dst & SLJIT_MEM)
+			ir_propagate_arg(&state, &ir->dst, &ir->dstw, 0);
+
+		if (IR_IS_WORD_MOV(ir->op) && (ir->src1 & SLJIT_MEM)) {
+			for (i = 0; i < state.mem_count; i++) {
+				if (state.mem_arg[i] == ir->src1 && state.mem_argw[i] == ir->src1w) {
+					ir->src1 = state.mem_reg[i];
+					ir->src1w = 0;
+					break;
+				}
+			}
+		}
+
+		ir_fold(ir);
+
+		if (IR_IS_WORD_MOV(ir->op) && ir->dst == ir->src1 && IR_IS_REG(ir->dst)) {
+			ir->op = IR_DELETED;
+			continue;
+		}
+
+		if (IR_IS_REG(ir->dst))
+			ir_forget_reg(&state, ir->dst);
+		else if (ir->dst & SLJIT_MEM)
+			state.mem_count = 0;
+
+		if (!IR_IS_WORD_MOV(ir->op))
+			continue;
+
+		if (IR_IS_REG(ir->dst)) {
+			if (ir->src1 == SLJIT_IMM) {
+				state.kind[ir->dst] = IR_CONST;
+				state.value[ir->dst] = ir->src1w;
+			}
+			else if (IR_IS_REG(ir->src1)) {
+				state.kind[ir->dst] = IR_COPY;
+				state.value[ir->dst] = ir->src1;
+			}
+			else if (ir->src1 & SLJIT_MEM)
+				ir_add_mem(&state, ir->src1, ir->src1w, ir->dst);
+		}
+		else if ((ir->dst & SLJIT_MEM) && IR_IS_REG(ir->src1))
+			ir_add_mem(&state, ir->dst, ir->dstw, ir->src1);
+	}
+}
+
+static void ir_use_arg(char *dead, int arg)
+{
+	if (arg & SLJIT_MEM) {
+		if (IR_IS_REG(arg & REG_MASK))
+			dead[arg & REG_MASK] = 0;
+		if (IR_IS_REG(OFFS_REG(arg)))
+			dead[OFFS_REG(arg)] = 0;
+	}
+	else if (IR_IS_REG(arg))
+		dead[arg] = 0;
+}
+
+/* Dead store elimination in a backward pass. The registers and memory
+   locations are live at the end of the buffer. */
+static void ir_remove_dead(struct sljit_ir_op *ir, int count)
+{
+	char dead[SLJIT_NUM_REGS + 1];
+	int mem_arg[IR_MAX_MEMS];
+	long mem_argw[IR_MAX_MEMS];
+	int mem_count = 0;
+	int opcode, i;
+
+	memset(dead, 0, sizeof(dead));
+
+	for (ir += count - 1; count > 0; ir--, count--) {
+		if (ir->op == IR_DELETED)
+			continue;
+
+		opcode = GET_OPCODE(ir->op);
+		if (IR_IS_MOVU(ir->op)) {
+			memset(dead, 0, sizeof(dead));
+			mem_count = 0;
+			continue;
+		}
+
+		if (!GET_FLAGS(ir->op)) {
+			if (!IR_IS_OP1(ir->op) && ir->dst == SLJIT_UNUSED) {
+				ir->op = IR_DELETED;
+				continue;
+			}
+			if (IR_IS_REG(ir->dst) && dead[ir->dst]) {
+				ir->op = IR_DELETED;
+				continue;
+			}
+			if (ir->dst & SLJIT_MEM) {
+				for (i = 0; i < mem_count; i++)
+					if (mem_arg[i] == ir->dst && mem_argw[i] == ir->dstw)
+						break;
+				if (i < mem_count) {
+					ir->op = IR_DELETED;
+					continue;
+				}
+			}
+		}
+
+		if (IR_IS_REG(ir->dst)) {
+			dead[ir->dst] = 1;
+			/* The address was different before this instruction. */
+			for (i = 0; i < mem_count; ) {
+				if (ir_arg_uses(mem_arg[i], ir->dst)) {
+					mem_count--;
+					mem_arg[i] = mem_arg[mem_count];
+					mem_argw[i] = mem_argw[mem_count];
+				}
+				else
+					i++;
+			}
+		}
+		else if (ir->dst & SLJIT_MEM) {
+			/* Only word sized stores overwrite any previous store. */
+			if (!(ir->op & SLJIT_INT_OP) && mem_count < IR_MAX_MEMS
+					&& (!IR_IS_OP1(ir->op) || IR_IS_WORD_MOV(opcode) || opcode == SLJIT_NOT || opcode == SLJIT_NEG)) {
+				mem_arg[mem_count] = ir->dst;
+				mem_argw[mem_count] = ir->dstw;
+				mem_count++;
+			}
+			ir_use_arg(dead, ir->dst);
+		}
+
+		if ((ir->src1 & SLJIT_MEM) || (ir->src2 & SLJIT_MEM))
+			mem_count = 0;
+		ir_use_arg(dead, ir->src1);
+		ir_use_arg(dead, ir->src2);
+	}
+}
+
+static int ir_flush(struct sljit_compiler *compiler)
+{
+	struct sljit_ir_op *ir = compiler->ir_ops;
+	int count = compiler->ir_count;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	/* The caller may set mode32 before CHECK_ERROR. */
+	int mode32 = compiler->mode32;
+#endif
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_DEBUG && SLJIT_DEBUG) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	/* Or skip_checks, which must survive the emitted operations. */
+	int skip_checks = compiler->skip_checks;
+#endif
+
+	compiler->ir_count = 0;
+	if (count == 0)
+		return SLJIT_SUCCESS;
+
+	ir_propagate(ir, count);
+	ir_remove_dead(ir, count);
+
+	for (; count > 0; ir++, count--)
+		if (ir->op != IR_DELETED)
+			FAIL_IF(ir_emit(compiler, ir));
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = mode32;
+#endif
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_DEBUG && SLJIT_DEBUG) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	compiler->skip_checks = skip_checks;
+#endif
+	return SLJIT_SUCCESS;
+}
+
 static __inline int emit_mov_before_return(struct sljit_compiler *compiler, int op, int src, long srcw)
 {
 	/* Return if don't need to do anything. */
@@ -1497,9 +2515,62 @@ static __inline int emit_mov_before_return(struct sljit_compiler *compiler, int
 		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	compiler->skip_checks = 1;
 #endif
-	return sljit_emit_op1(compiler, op, SLJIT_RETURN_REG, 0, src, srcw);
+	FAIL_IF(sljit_emit_op1(compiler, op, SLJIT_RETURN_REG, 0, src, srcw));
+	/* The epilogue follows the move directly. */
+	return ir_flush(compiler);
 }
 
+#if !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+/* Implements sljit_emit_select with a conditional jump. The
+   arguments must be checked, but not adjusted by the caller. */
+static int emit_select_with_jump(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
+{
+	struct sljit_jump *jump;
+	struct sljit_label *label;
+	int op = (type & SLJIT_INT_OP) ? SLJIT_IMOV : SLJIT_MOV;
+
+	if (dst_reg != src2_reg) {
+		if (src1 == dst_reg) {
+			/* dst_reg = (!condition) ? src2_reg : dst_reg */
+			src1 = src2_reg;
+			src1w = 0;
+			src2_reg = dst_reg;
+			type ^= 0x1;
+		}
+		else {
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+			compiler->skip_checks = 1;
+#endif
+			FAIL_IF(sljit_emit_op1(compiler, op, dst_reg, 0, src2_reg, 0));
+		}
+	}
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	jump = sljit_emit_jump(compiler, type ^ 0x1);
+	FAIL_IF(!jump);
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	FAIL_IF(sljit_emit_op1(compiler, op, dst_reg, 0, src1, src1w));
+
+	label = sljit_emit_label(compiler);
+	FAIL_IF(!label);
+	sljit_set_label(jump, label);
+	return SLJIT_SUCCESS;
+}
+
+#endif
+
 /* CPU description section */
 
 #if (defined SLJIT_32BIT_ARCHITECTURE && SLJIT_32BIT_ARCHITECTURE)
@@ -1526,6 +2597,46 @@ static __inline int emit_mov_before_return(struct sljit_compiler *compiler, int
 
 #define SLJIT_CPUINFO SLJIT_CPUINFO_PART1 SLJIT_CPUINFO_PART2 SLJIT_CPUINFO_PART3
 
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) && !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+/* Implements the bit manipulation operators (SLJIT_CTZ ... SLJIT_BSWAP16,
+   SLJIT_ROTL and SLJIT_ROTR) with simpler operations. The arguments are
+   not adjusted by ADJUST_LOCAL_OFFSET. */
+static int emit_bit_op(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w);
+
+/* These backends have no native instructions for the bit manipulation
+   operators, and the division by immediate operators are not implemented. */
+#define CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w) \
+	do { \
+		if ((GET_OPCODE(op) >= SLJIT_CTZ && GET_OPCODE(op) <= SLJIT_BSWAP16) \
+				|| (GET_OPCODE(op) >= SLJIT_ROTL && GET_OPCODE(op) <= SLJIT_ROTR)) \
+			return emit_bit_op(compiler, op, dst, dstw, src1, src1w, src2, src2w); \
+		if (GET_OPCODE(op) > SLJIT_ROTR) { \
+			compiler->error = SLJIT_ERR_UNSUPPORTED; \
+			return SLJIT_ERR_UNSUPPORTED; \
+		} \
+	} while (0)
+
+/* Prefetching is only a hint, these backends ignore it. */
+#define SKIP_PREFETCH(op) \
+	do { \
+		if (GET_OPCODE(op) >= SLJIT_PREFETCH_L1 && GET_OPCODE(op) <= SLJIT_PREFETCH_ONCE) \
+			return SLJIT_SUCCESS; \
+	} while (0)
+#endif
+
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+/* Implements SLJIT_UDIV_IMM ... SLJIT_SMOD_IMM with the emit_mul_high
+   function of the backend. The arguments are not adjusted by
+   ADJUST_LOCAL_OFFSET. */
+static int emit_div_imm(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	long src2w);
+#endif
+
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
 #	include "sljitNativeX86_common.c"
 #elif (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
@@ -1546,135 +2657,680 @@ static __inline int emit_mov_before_return(struct sljit_compiler *compiler, int
 #	include "sljitNativeTILEGX_64.c"
 #endif
 
-#if !(defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
+#if !(defined SLJIT_CONFIG_MIPS && SLJIT_CONFIG_MIPS)
+
+struct sljit_jump* sljit_emit_cmp(struct sljit_compiler *compiler, int type,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	/* Default compare for most architectures. */
+	int flags, tmp_src, condition;
+	long tmp_srcw;
+
+	CHECK_ERROR_PTR();
+	CHECK_PTR(check_sljit_emit_cmp(compiler, type, src1, src1w, src2, src2w));
+
+	condition = type & 0xff;
+#if (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+	if ((condition == SLJIT_EQUAL || condition == SLJIT_NOT_EQUAL)) {
+		if ((src1 & SLJIT_IMM) && !src1w) {
+			src1 = src2;
+			src1w = src2w;
+			src2 = SLJIT_IMM;
+			src2w = 0;
+		}
+		if ((src2 & SLJIT_IMM) && !src2w)
+			return emit_cmp_to0(compiler, type, src1, src1w);
+	}
+#endif
+
+	if ((src1 & SLJIT_IMM) && !(src2 & SLJIT_IMM)) {
+		/* Immediate is prefered as second argument by most architectures. */
+		switch (condition) {
+		case SLJIT_LESS:
+			condition = SLJIT_GREATER;
+			break;
+		case SLJIT_GREATER_EQUAL:
+			condition = SLJIT_LESS_EQUAL;
+			break;
+		case SLJIT_GREATER:
+			condition = SLJIT_LESS;
+			break;
+		case SLJIT_LESS_EQUAL:
+			condition = SLJIT_GREATER_EQUAL;
+			break;
+		case SLJIT_SIG_LESS:
+			condition = SLJIT_SIG_GREATER;
+			break;
+		case SLJIT_SIG_GREATER_EQUAL:
+			condition = SLJIT_SIG_LESS_EQUAL;
+			break;
+		case SLJIT_SIG_GREATER:
+			condition = SLJIT_SIG_LESS;
+			break;
+		case SLJIT_SIG_LESS_EQUAL:
+			condition = SLJIT_SIG_GREATER_EQUAL;
+			break;
+		}
+		type = condition | (type & (SLJIT_INT_OP | SLJIT_REWRITABLE_JUMP));
+		tmp_src = src1;
+		src1 = src2;
+		src2 = tmp_src;
+		tmp_srcw = src1w;
+		src1w = src2w;
+		src2w = tmp_srcw;
+	}
+
+	if (condition <= SLJIT_NOT_ZERO)
+		flags = SLJIT_SET_E;
+	else if (condition <= SLJIT_LESS_EQUAL)
+		flags = SLJIT_SET_U;
+	else
+		flags = SLJIT_SET_S;
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	if (sljit_emit_op2(compiler, SLJIT_SUB | flags | (type & SLJIT_INT_OP),
+	    SLJIT_UNUSED, 0, src1, src1w, src2, src2w))
+		return NULL;
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	return sljit_emit_jump(compiler, condition | (type & SLJIT_REWRITABLE_JUMP));
+}
+
+struct sljit_jump* sljit_emit_fcmp(struct sljit_compiler *compiler, int type,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	int flags, condition;
+
+	CHECK_ERROR_PTR();
+	CHECK_PTR(check_sljit_emit_fcmp(compiler, type, src1, src1w, src2, src2w));
+
+	condition = type & 0xff;
+	flags = (condition <= SLJIT_D_NOT_EQUAL) ? SLJIT_SET_E : SLJIT_SET_S;
+	if (type & SLJIT_SINGLE_OP)
+		flags |= SLJIT_SINGLE_OP;
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	sljit_emit_fop1(compiler, SLJIT_DCMP | flags, src1, src1w, src2, src2w);
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	return sljit_emit_jump(compiler, condition | (type & SLJIT_REWRITABLE_JUMP));
+}
+
+#endif
+
+#if (defined SLJIT_CONFIG_PPC && SLJIT_CONFIG_PPC) || (defined SLJIT_CONFIG_SPARC && SLJIT_CONFIG_SPARC)
+#define FLUSH_PATCHED_CODE(from, to) SLJIT_CACHE_FLUSH((sljit_ins*)(from), (sljit_ins*)(to))
+#else
+#define FLUSH_PATCHED_CODE(from, to) SLJIT_CACHE_FLUSH((u_char*)(from), (u_char*)(to))
+#endif
+
+/* Patches closer than this are flushed together. Since the gap is smaller
+   than a page, the memory between them is always mapped. */
+#define PATCH_FLUSH_GAP 256
+
+void sljit_set_patches(const struct sljit_patch *patches, int count)
+{
+	unsigned long start = 0;
+	unsigned long end = 0;
+	unsigned long addr;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		addr = patches[i].addr;
+
+		if (PATCHED_CODE_SIZE == 0) {
+			/* The backend cannot tell which bytes are changed. */
+			if (patches[i].type == SLJIT_PATCH_JUMP_ADDR)
+				inline_set_jump_addr(addr, (unsigned long)patches[i].value, 1);
+			else
+				inline_set_const(addr, patches[i].value, 1);
+			continue;
+		}
+
+		if (patches[i].type == SLJIT_PATCH_JUMP_ADDR)
+			inline_set_jump_addr(addr, (unsigned long)patches[i].value, 0);
+		else
+			inline_set_const(addr, patches[i].value, 0);
+
+		if (start != end && addr + PATCHED_CODE_SIZE + PATCH_FLUSH_GAP >= start && addr <= end + PATCH_FLUSH_GAP) {
+			if (addr < start)
+				start = addr;
+			if (addr + PATCHED_CODE_SIZE > end)
+				end = addr + PATCHED_CODE_SIZE;
+			continue;
+		}
+
+		if (start != end) {
+			FLUSH_PATCHED_CODE(start, end);
+		}
+		start = addr;
+		end = addr + PATCHED_CODE_SIZE;
+	}
+
+	/* SLJIT_CACHE_FLUSH is empty on x86. */
+	if (start != end) {
+		FLUSH_PATCHED_CODE(start, end);
+	}
+}
+
+#undef FLUSH_PATCHED_CODE
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+
+int sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_get_local_base(compiler, dst, dstw, offset));
+
+	ADJUST_LOCAL_OFFSET(SLJIT_MEM1(SLJIT_SP), offset);
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
+		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	compiler->skip_checks = 1;
+#endif
+	if (offset != 0)
+		return sljit_emit_op2(compiler, SLJIT_ADD | SLJIT_KEEP_FLAGS, dst, dstw, SLJIT_SP, 0, SLJIT_IMM, offset);
+	return sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_SP, 0);
+}
+
+int sljit_get_vector_size(void)
+{
+	return 0;
+}
+
+int sljit_emit_vop1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_vop1(compiler, op, dst, dstw, src, srcw));
+
+	compiler->error = SLJIT_ERR_UNSUPPORTED;
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+int sljit_emit_vop2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_vop2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+
+	compiler->error = SLJIT_ERR_UNSUPPORTED;
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+#endif
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) && !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+
+int sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_select(compiler, type, dst_reg, src1, src1w, src2_reg));
+
+	return emit_select_with_jump(compiler, type, dst_reg, src1, src1w, src2_reg);
+}
+
+int sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_atomic(compiler, op, dst_reg, mem_reg, src_reg));
+
+	compiler->error = SLJIT_ERR_UNSUPPORTED;
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+int sljit_emit_fence(struct sljit_compiler *compiler, int type)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_fence(compiler, type));
+
+	compiler->error = SLJIT_ERR_UNSUPPORTED;
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+struct sljit_switch* sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count)
+{
+	CHECK_ERROR_PTR();
+	CHECK_PTR(check_sljit_emit_switch(compiler, src, srcw, labels, count));
+
+	compiler->error = SLJIT_ERR_UNSUPPORTED;
+	return NULL;
+}
+
+#endif
+
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+
+/* --------------------------------------------------------------------- */
+/*  Division by constant                                                 */
+/* --------------------------------------------------------------------- */
+
+/* The magic numbers are computed by the algorithms described in
+   Hacker's Delight (chapter 10), which are based on the paper of
+   Granlund and Montgomery: "Division by Invariant Integers using
+   Multiplication". The divisor must not be a power of 2. */
+
+#define DIV_WORD_BITS	((int)sizeof(long) * 8)
+
+static void div_unsigned_magic(unsigned long d, unsigned long *magic, int *add, int *shift)
+{
+	const unsigned long max_half = ~(unsigned long)0 >> 1;
+	unsigned long q = max_half / d;
+	unsigned long r = max_half - q * d;
+	unsigned long p_word = 0;
+	unsigned long delta;
+	int p = DIV_WORD_BITS - 1;
+
+	*add = 0;
+	do {
+		p++;
+		/* p_word is 2^(p - DIV_WORD_BITS). */
+		p_word = (p == DIV_WORD_BITS) ? 1 : (p_word << 1);
+		if (r + 1 >= d - r) {
+			if (q >= max_half)
+				*add = 1;
+			q = 2 * q + 1;
+			r = 2 * r + 1 - d;
+		}
+		else {
+			if (q >= max_half + 1)
+				*add = 1;
+			q = 2 * q;
+			r = 2 * r + 1;
+		}
+		delta = d - 1 - r;
+	} while (p < 2 * DIV_WORD_BITS && (p_word < delta || (p_word == delta && r == 0)));
+
+	*magic = q + 1;
+	*shift = p - DIV_WORD_BITS;
+}
+
+static void div_signed_magic(long d, long *magic, int *shift)
+{
+	const unsigned long sign_bit = (unsigned long)1 << (DIV_WORD_BITS - 1);
+	unsigned long abs_d = (d < 0) ? -(unsigned long)d : (unsigned long)d;
+	unsigned long t = sign_bit + ((unsigned long)d >> (DIV_WORD_BITS - 1));
+	unsigned long abs_nc = t - 1 - t % abs_d;
+	unsigned long q1 = sign_bit / abs_nc;
+	unsigned long r1 = sign_bit - q1 * abs_nc;
+	unsigned long q2 = sign_bit / abs_d;
+	unsigned long r2 = sign_bit - q2 * abs_d;
+	unsigned long delta;
+	int p = DIV_WORD_BITS - 1;
+
+	do {
+		p++;
+		q1 <<= 1;
+		r1 <<= 1;
+		if (r1 >= abs_nc) {
+			q1++;
+			r1 -= abs_nc;
+		}
+		q2 <<= 1;
+		r2 <<= 1;
+		if (r2 >= abs_d) {
+			q2++;
+			r2 -= abs_d;
+		}
+		delta = abs_d - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+
+	q2++;
+	*magic = (long)((d < 0) ? -q2 : q2);
+	*shift = p - DIV_WORD_BITS;
+}
+
+static int div_op1(struct sljit_compiler *compiler, int op, int dst, int src, long srcw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	compiler->skip_checks = 1;
+#endif
+	return sljit_emit_op1(compiler, op, dst, 0, src, srcw);
+}
+
+/* The destination is always the same as the first source, and the
+   second source is a register or a shift amount, since the backends
+   may use temporary registers for the other forms. */
+static int div_op2(struct sljit_compiler *compiler, int op, int dst, int src, long srcw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	compiler->skip_checks = 1;
+#endif
+	return sljit_emit_op2(compiler, op, dst, 0, dst, 0, src, srcw);
+}
 
-struct sljit_jump* sljit_emit_cmp(struct sljit_compiler *compiler, int type,
-	int src1, long src1w,
-	int src2, long src2w)
+static int div_shift_amount(unsigned long value)
 {
-	/* Default compare for most architectures. */
-	int flags, tmp_src, condition;
-	long tmp_srcw;
+	int shift = 0;
 
-	CHECK_ERROR_PTR();
-	CHECK_PTR(check_sljit_emit_cmp(compiler, type, src1, src1w, src2, src2w));
+	while (value > 1) {
+		value >>= 1;
+		shift++;
+	}
+	return shift;
+}
 
-	condition = type & 0xff;
-#if (defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
-	if ((condition == SLJIT_EQUAL || condition == SLJIT_NOT_EQUAL)) {
-		if ((src1 & SLJIT_IMM) && !src1w) {
-			src1 = src2;
-			src1w = src2w;
-			src2 = SLJIT_IMM;
-			src2w = 0;
+/* The value of src1 is loaded into TMP_REG2, and the result is computed
+   into TMP_REG1 or TMP_REG2, since storing the result may overwrite
+   TMP_REG3. The emit_mul_high function of the backend sets TMP_REG1 to
+   the high word of the product of TMP_REG2 and a constant, and it may
+   overwrite TMP_REG3 as well. Moving a register to TMP_REG1 is avoided,
+   since the ARM-64 backend treats it as a store. */
+static int emit_div_imm(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	long src2w)
+{
+	int opcode = GET_OPCODE(op);
+	int is_signed = (opcode == SLJIT_SDIV_IMM || opcode == SLJIT_SMOD_IMM);
+	int is_div = (opcode == SLJIT_UDIV_IMM || opcode == SLJIT_SDIV_IMM);
+	int result = is_div ? TMP_REG1 : TMP_REG2;
+	unsigned long abs_d, umagic;
+	long smagic;
+	int shift, add;
+
+	/* The 32 bit operations are computed on extended values. */
+	if (op & SLJIT_INT_OP) {
+		src2w = is_signed ? (long)(int)src2w : (long)(unsigned int)src2w;
+		FAIL_IF(div_op1(compiler, is_signed ? SLJIT_MOV_SI : SLJIT_MOV_UI, TMP_REG2, src1, src1w));
+	}
+	else
+		FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG2, src1, src1w));
+
+	abs_d = (is_signed && src2w < 0) ? -(unsigned long)src2w : (unsigned long)src2w;
+
+	if (abs_d == 1) {
+		if (!is_div)
+			FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG2, SLJIT_IMM, 0));
+		else if (src2w < 0)
+			FAIL_IF(div_op1(compiler, SLJIT_NEG, TMP_REG2, TMP_REG2, 0));
+		result = TMP_REG2;
+	}
+	else if (!(abs_d & (abs_d - 1))) {
+		shift = div_shift_amount(abs_d);
+		result = TMP_REG2;
+
+		if (!is_signed) {
+			if (is_div)
+				FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG2, SLJIT_IMM, shift));
+			else {
+				FAIL_IF(div_op2(compiler, SLJIT_SHL, TMP_REG2, SLJIT_IMM, DIV_WORD_BITS - shift));
+				FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG2, SLJIT_IMM, DIV_WORD_BITS - shift));
+			}
+		}
+		else {
+			/* Negative values are rounded toward zero by adding 2^shift - 1. */
+			FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG3, TMP_REG2, 0));
+			if (shift > 1)
+				FAIL_IF(div_op2(compiler, SLJIT_ASHR, TMP_REG3, SLJIT_IMM, shift - 1));
+			FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG3, SLJIT_IMM, DIV_WORD_BITS - shift));
+
+			if (is_div) {
+				FAIL_IF(div_op2(compiler, SLJIT_ADD, TMP_REG2, TMP_REG3, 0));
+				FAIL_IF(div_op2(compiler, SLJIT_ASHR, TMP_REG2, SLJIT_IMM, shift));
+				if (src2w < 0)
+					FAIL_IF(div_op1(compiler, SLJIT_NEG, TMP_REG2, TMP_REG2, 0));
+			}
+			else {
+				FAIL_IF(div_op2(compiler, SLJIT_ADD, TMP_REG3, TMP_REG2, 0));
+				FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG3, SLJIT_IMM, shift));
+				FAIL_IF(div_op2(compiler, SLJIT_SHL, TMP_REG3, SLJIT_IMM, shift));
+				FAIL_IF(div_op2(compiler, SLJIT_SUB, TMP_REG2, TMP_REG3, 0));
+			}
 		}
-		if ((src2 & SLJIT_IMM) && !src2w)
-			return emit_cmp_to0(compiler, type, src1, src1w);
 	}
-#endif
+	else {
+		if (!is_signed) {
+			div_unsigned_magic(abs_d, &umagic, &add, &shift);
+			FAIL_IF(emit_mul_high(compiler, 0, (long)umagic));
+
+			if (add) {
+				FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG3, TMP_REG2, 0));
+				FAIL_IF(div_op2(compiler, SLJIT_SUB, TMP_REG3, TMP_REG1, 0));
+				FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG3, SLJIT_IMM, 1));
+				FAIL_IF(div_op2(compiler, SLJIT_ADD, TMP_REG1, TMP_REG3, 0));
+				shift--;
+			}
+			if (shift > 0)
+				FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG1, SLJIT_IMM, shift));
+		}
+		else {
+			div_signed_magic(src2w, &smagic, &shift);
+			FAIL_IF(emit_mul_high(compiler, 1, smagic));
+
+			if (src2w > 0 && smagic < 0)
+				FAIL_IF(div_op2(compiler, SLJIT_ADD, TMP_REG1, TMP_REG2, 0));
+			else if (src2w < 0 && smagic > 0)
+				FAIL_IF(div_op2(compiler, SLJIT_SUB, TMP_REG1, TMP_REG2, 0));
+			if (shift > 0)
+				FAIL_IF(div_op2(compiler, SLJIT_ASHR, TMP_REG1, SLJIT_IMM, shift));
+
+			/* Add one to negative quotients. */
+			FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG3, TMP_REG1, 0));
+			FAIL_IF(div_op2(compiler, SLJIT_LSHR, TMP_REG3, SLJIT_IMM, DIV_WORD_BITS - 1));
+			FAIL_IF(div_op2(compiler, SLJIT_ADD, TMP_REG1, TMP_REG3, 0));
+		}
 
-	if ((src1 & SLJIT_IMM) && !(src2 & SLJIT_IMM)) {
-		/* Immediate is prefered as second argument by most architectures. */
-		switch (condition) {
-		case SLJIT_LESS:
-			condition = SLJIT_GREATER;
-			break;
-		case SLJIT_GREATER_EQUAL:
-			condition = SLJIT_LESS_EQUAL;
-			break;
-		case SLJIT_GREATER:
-			condition = SLJIT_LESS;
-			break;
-		case SLJIT_LESS_EQUAL:
-			condition = SLJIT_GREATER_EQUAL;
-			break;
-		case SLJIT_SIG_LESS:
-			condition = SLJIT_SIG_GREATER;
-			break;
-		case SLJIT_SIG_GREATER_EQUAL:
-			condition = SLJIT_SIG_LESS_EQUAL;
-			break;
-		case SLJIT_SIG_GREATER:
-			condition = SLJIT_SIG_LESS;
-			break;
-		case SLJIT_SIG_LESS_EQUAL:
-			condition = SLJIT_SIG_GREATER_EQUAL;
-			break;
+		if (!is_div) {
+			FAIL_IF(div_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, src2w));
+			FAIL_IF(div_op2(compiler, SLJIT_MUL, TMP_REG1, TMP_REG3, 0));
+			FAIL_IF(div_op2(compiler, SLJIT_SUB, TMP_REG2, TMP_REG1, 0));
 		}
-		type = condition | (type & (SLJIT_INT_OP | SLJIT_REWRITABLE_JUMP));
-		tmp_src = src1;
-		src1 = src2;
-		src2 = tmp_src;
-		tmp_srcw = src1w;
-		src1w = src2w;
-		src2w = tmp_srcw;
 	}
 
-	if (condition <= SLJIT_NOT_ZERO)
-		flags = SLJIT_SET_E;
-	else if (condition <= SLJIT_LESS_EQUAL)
-		flags = SLJIT_SET_U;
-	else
-		flags = SLJIT_SET_S;
+	if (dst == SLJIT_UNUSED)
+		return SLJIT_SUCCESS;
 
-#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
-		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
-	compiler->skip_checks = 1;
-#endif
-	if (sljit_emit_op2(compiler, SLJIT_SUB | flags | (type & SLJIT_INT_OP),
-	    SLJIT_UNUSED, 0, src1, src1w, src2, src2w))
-		return NULL;
-#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
-		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	compiler->skip_checks = 1;
 #endif
-	return sljit_emit_jump(compiler, condition | (type & SLJIT_REWRITABLE_JUMP));
+	return sljit_emit_op1(compiler, (op & SLJIT_INT_OP) ? SLJIT_MOV_UI : SLJIT_MOV, dst, dstw, result, 0);
 }
 
-struct sljit_jump* sljit_emit_fcmp(struct sljit_compiler *compiler, int type,
-	int src1, long src1w,
-	int src2, long src2w)
-{
-	int flags, condition;
+#endif /* SLJIT_DIV_IMM_SUPPORT */
 
-	CHECK_ERROR_PTR();
-	CHECK_PTR(check_sljit_emit_fcmp(compiler, type, src1, src1w, src2, src2w));
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) && !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
 
-	condition = type & 0xff;
-	flags = (condition <= SLJIT_D_NOT_EQUAL) ? SLJIT_SET_E : SLJIT_SET_S;
-	if (type & SLJIT_SINGLE_OP)
-		flags |= SLJIT_SINGLE_OP;
+/* --------------------------------------------------------------------- */
+/*  Bit manipulation                                                     */
+/* --------------------------------------------------------------------- */
 
-#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
-		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+static int bit_op1(struct sljit_compiler *compiler, int op, int dst, int src, long srcw)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	compiler->skip_checks = 1;
 #endif
-	sljit_emit_fop1(compiler, SLJIT_DCMP | flags, src1, src1w, src2, src2w);
+	return sljit_emit_op1(compiler, op, dst, 0, src, srcw);
+}
 
-#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
-		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+/* The operands are registers, except immediate shift amounts, since
+   the backends may use temporary registers for the other forms. */
+static int bit_op2(struct sljit_compiler *compiler, int op, int dst, int src1, int src2, long src2w)
+{
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	compiler->skip_checks = 1;
 #endif
-	return sljit_emit_jump(compiler, condition | (type & SLJIT_REWRITABLE_JUMP));
+	return sljit_emit_op2(compiler, op, dst, 0, src1, 0, src2, src2w);
 }
 
-#endif
+/* Returns the bits-wide constant, which repeats the lowest
+   bits of (2^bits - 1) / divisor. */
+static long bit_mask(int bits, unsigned long divisor)
+{
+	unsigned long all = (bits == 32) ? 0xffffffffUL : ~0UL;
 
-#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+	return (long)(all / divisor);
+}
 
-int sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
+/* Counts the bits of TMP_REG2 into TMP_REG2. */
+static int bit_popcnt(struct sljit_compiler *compiler, int flags, int bits)
 {
-	CHECK_ERROR();
-	CHECK(check_sljit_get_local_base(compiler, dst, dstw, offset));
+	FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bit_mask(bits, 3)));
+	FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, 1));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG1, TMP_REG1, TMP_REG3, 0));
+	FAIL_IF(bit_op2(compiler, SLJIT_SUB | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
 
-	ADJUST_LOCAL_OFFSET(SLJIT_MEM1(SLJIT_SP), offset);
-#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE) \
-		|| (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS)
+	FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bit_mask(bits, 5)));
+	FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, 2));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG1, TMP_REG1, TMP_REG3, 0));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+	FAIL_IF(bit_op2(compiler, SLJIT_ADD | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
+
+	FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, 4));
+	FAIL_IF(bit_op2(compiler, SLJIT_ADD | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
+	FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bit_mask(bits, 17)));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+
+	/* The sum of the byte counters is moved to the highest byte. */
+	FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bit_mask(bits, 255)));
+	FAIL_IF(bit_op2(compiler, SLJIT_MUL | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+	return bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, bits - 8);
+}
+
+/* Swaps the neighbouring shift-wide fields of TMP_REG2. */
+static int bit_swap_fields(struct sljit_compiler *compiler, int flags, int bits, int shift)
+{
+	FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bit_mask(bits, (1UL << shift) + 1)));
+	FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, shift));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG1, TMP_REG1, TMP_REG3, 0));
+	FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+	FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, shift));
+	return bit_op2(compiler, SLJIT_OR | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0);
+}
+
+/* Rotates TMP_REG2 to the left by a constant amount between 1 and bits - 1. */
+static int bit_rotl_imm(struct sljit_compiler *compiler, int flags, int bits, int amount)
+{
+	FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, amount));
+	FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, bits - amount));
+	return bit_op2(compiler, SLJIT_OR | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0);
+}
+
+/* Implements SLJIT_CTZ ... SLJIT_BSWAP16, SLJIT_ROTL and SLJIT_ROTR with
+   shift, logical, add and multiply operations. The sources are loaded into
+   TMP_REG2 and TMP_REG1 first, since loading may overwrite TMP_REG3, and
+   the result is computed into TMP_REG2, since storing may overwrite the
+   other two. The arguments are not adjusted by ADJUST_LOCAL_OFFSET. */
+static int emit_bit_op(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	int opcode = GET_OPCODE(op);
+	int flags = op & (SLJIT_INT_OP | SLJIT_KEEP_FLAGS);
+	int bits = (op & SLJIT_INT_OP) ? 32 : (int)sizeof(long) * 8;
+	int amount;
+
+	/* The 32 bit values are sign extended, since the 32 bit
+	   operations of the 64 bit MIPS targets require it. */
+	FAIL_IF(bit_op1(compiler, (op & SLJIT_INT_OP) ? SLJIT_MOV_SI : SLJIT_MOV, TMP_REG2, src1, src1w));
+
+	switch (opcode) {
+	case SLJIT_CTZ:
+		/* The trailing zeroes are turned into ones by ~x & (x - 1). */
+		FAIL_IF(bit_op1(compiler, SLJIT_NEG | flags, TMP_REG1, TMP_REG2, 0));
+		FAIL_IF(bit_op1(compiler, SLJIT_NOT | flags, TMP_REG1, TMP_REG1, 0));
+		FAIL_IF(bit_op1(compiler, SLJIT_NOT | flags, TMP_REG2, TMP_REG2, 0));
+		FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
+		FAIL_IF(bit_popcnt(compiler, flags, bits));
+		break;
+
+	case SLJIT_POPCNT:
+		FAIL_IF(bit_popcnt(compiler, flags, bits));
+		break;
+
+	case SLJIT_BSWAP:
+		for (amount = 8; amount < bits / 2; amount <<= 1)
+			FAIL_IF(bit_swap_fields(compiler, flags, bits, amount));
+		FAIL_IF(bit_rotl_imm(compiler, flags, bits, bits / 2));
+		break;
+
+	case SLJIT_BSWAP16:
+		FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, 0xff));
+		FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, SLJIT_IMM, 8));
+		FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG1, TMP_REG1, TMP_REG3, 0));
+		FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+		FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, 8));
+		FAIL_IF(bit_op2(compiler, SLJIT_OR | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
+		break;
+
+	default:
+		SLJIT_ASSERT(opcode == SLJIT_ROTL || opcode == SLJIT_ROTR);
+
+		if (src2 & SLJIT_IMM) {
+			amount = (int)(src2w & (bits - 1));
+			if (opcode == SLJIT_ROTR)
+				amount = (bits - amount) & (bits - 1);
+			if (amount != 0)
+				FAIL_IF(bit_rotl_imm(compiler, flags, bits, amount));
+			break;
+		}
+
+		/* The shift amounts are a and bits - 1 - a, where a is the rotate
+		   amount modulo bits, so the shifts are defined for a == 0 too. */
+		FAIL_IF(bit_op1(compiler, (op & SLJIT_INT_OP) ? SLJIT_MOV_SI : SLJIT_MOV, TMP_REG1, src2, src2w));
+		FAIL_IF(bit_op1(compiler, SLJIT_MOV, TMP_REG3, SLJIT_IMM, bits - 1));
+		FAIL_IF(bit_op2(compiler, SLJIT_AND | flags, TMP_REG1, TMP_REG1, TMP_REG3, 0));
+		FAIL_IF(bit_op2(compiler, SLJIT_XOR | flags, TMP_REG3, TMP_REG3, TMP_REG1, 0));
+
+		if (opcode == SLJIT_ROTL) {
+			FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG1, TMP_REG2, TMP_REG1, 0));
+			FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, 1));
+			FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+		}
+		else {
+			FAIL_IF(bit_op2(compiler, SLJIT_LSHR | flags, TMP_REG1, TMP_REG2, TMP_REG1, 0));
+			FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG2, TMP_REG2, SLJIT_IMM, 1));
+			FAIL_IF(bit_op2(compiler, SLJIT_SHL | flags, TMP_REG2, TMP_REG2, TMP_REG3, 0));
+		}
+		FAIL_IF(bit_op2(compiler, SLJIT_OR | flags, TMP_REG2, TMP_REG2, TMP_REG1, 0));
+		break;
+	}
+
+	if (GET_FLAGS(op)) {
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+		compiler->skip_checks = 1;
+#endif
+		return sljit_emit_op2(compiler, SLJIT_OR | (op & (SLJIT_INT_OP | SLJIT_SET_E)), dst, dstw, TMP_REG2, 0, TMP_REG2, 0);
+	}
+
+	if (dst == SLJIT_UNUSED)
+		return SLJIT_SUCCESS;
+
+#if (defined SLJIT_ARGUMENT_CHECKS && SLJIT_ARGUMENT_CHECKS) \
+		|| (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
 	compiler->skip_checks = 1;
 #endif
-	if (offset != 0)
-		return sljit_emit_op2(compiler, SLJIT_ADD | SLJIT_KEEP_FLAGS, dst, dstw, SLJIT_SP, 0, SLJIT_IMM, offset);
-	return sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_SP, 0);
+	return sljit_emit_op1(compiler, (op & SLJIT_INT_OP) ? SLJIT_MOV_UI : SLJIT_MOV, dst, dstw, TMP_REG2, 0);
 }
 
 #endif
@@ -1694,12 +3350,25 @@ struct sljit_compiler* sljit_create_compiler(void)
 	return NULL;
 }
 
+struct sljit_compiler* sljit_create_compiler_with_allocator(const struct sljit_allocator *allocator)
+{
+	(void)allocator;
+	SLJIT_ASSERT_STOP();
+	return NULL;
+}
+
 void sljit_free_compiler(struct sljit_compiler *compiler)
 {
 	(void)compiler;
 	SLJIT_ASSERT_STOP();
 }
 
+void sljit_reset_compiler(struct sljit_compiler *compiler)
+{
+	(void)compiler;
+	SLJIT_ASSERT_STOP();
+}
+
 void* sljit_alloc_memory(struct sljit_compiler *compiler, int size)
 {
 	(void)compiler;
@@ -1882,6 +3551,43 @@ int sljit_emit_fop2(struct sljit_compiler *compiler, int op,
 	return SLJIT_ERR_UNSUPPORTED;
 }
 
+int sljit_get_vector_size(void)
+{
+	SLJIT_ASSERT_STOP();
+	return 0;
+}
+
+int sljit_emit_vop1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	(void)compiler;
+	(void)op;
+	(void)dst;
+	(void)dstw;
+	(void)src;
+	(void)srcw;
+	SLJIT_ASSERT_STOP();
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+int sljit_emit_vop2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	(void)compiler;
+	(void)op;
+	(void)dst;
+	(void)dstw;
+	(void)src1;
+	(void)src1w;
+	(void)src2;
+	(void)src2w;
+	SLJIT_ASSERT_STOP();
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
 struct sljit_label* sljit_emit_label(struct sljit_compiler *compiler)
 {
 	(void)compiler;
@@ -1965,6 +3671,56 @@ int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 	return SLJIT_ERR_UNSUPPORTED;
 }
 
+int sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
+{
+	(void)compiler;
+	(void)type;
+	(void)dst_reg;
+	(void)src1;
+	(void)src1w;
+	(void)src2_reg;
+	SLJIT_ASSERT_STOP();
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+int sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg)
+{
+	(void)compiler;
+	(void)op;
+	(void)dst_reg;
+	(void)mem_reg;
+	(void)src_reg;
+	SLJIT_ASSERT_STOP();
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+int sljit_emit_fence(struct sljit_compiler *compiler, int type)
+{
+	(void)compiler;
+	(void)type;
+	SLJIT_ASSERT_STOP();
+	return SLJIT_ERR_UNSUPPORTED;
+}
+
+struct sljit_switch* sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count)
+{
+	(void)compiler;
+	(void)src;
+	(void)srcw;
+	(void)labels;
+	(void)count;
+	SLJIT_ASSERT_STOP();
+	return NULL;
+}
+
 int sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
 {
 	(void)compiler;
@@ -1999,4 +3755,11 @@ void sljit_set_const(unsigned long addr, long new_constant)
 	SLJIT_ASSERT_STOP();
 }
 
+void sljit_set_patches(const struct sljit_patch *patches, int count)
+{
+	(void)patches;
+	(void)count;
+	SLJIT_ASSERT_STOP();
+}
+
 #endif
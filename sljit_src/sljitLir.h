@@ -80,6 +80,9 @@ of sljitConfigInternal.h */
 
 #include "sljitConfigInternal.h"
 
+/* The return type of sljit_is_fpu_available. */
+#include <stdbool.h>
+
 /* --------------------------------------------------------------------- */
 /*  Error codes                                                          */
 /* --------------------------------------------------------------------- */
@@ -296,6 +299,40 @@ struct sljit_const {
 	unsigned long addr;
 };
 
+struct sljit_switch {
+	struct sljit_switch *next;
+	unsigned long addr;
+	long count;
+	struct sljit_label **labels;
+};
+
+/* Memory allocation callbacks for the compiler metadata (the compiler
+   structure, its internal buffers, labels, jumps, constants and the
+   memory returned by sljit_alloc_memory). The executable code is not
+   affected, it is always allocated by SLJIT_MALLOC_EXEC. The free
+   callback can be NULL, when all memory is released at once by the
+   owner of allocator_data (e.g. an arena) after sljit_free_compiler. */
+struct sljit_allocator {
+	void* (*alloc)(unsigned long size, void *allocator_data);
+	void (*free)(void *ptr, void *allocator_data);
+	void *allocator_data;
+};
+
+/* An operation buffered by SLJIT_IR_OPTIMIZER. */
+struct sljit_ir_op {
+	int op;
+	int dst;
+	long dstw;
+	int src1;
+	long src1w;
+	int src2;
+	long src2w;
+};
+
+#ifndef SLJIT_IR_MAX_OPS
+#define SLJIT_IR_MAX_OPS 32
+#endif
+
 struct sljit_compiler {
 	int error;
 	int options;
@@ -306,9 +343,16 @@ struct sljit_compiler {
 	struct sljit_label *last_label;
 	struct sljit_jump *last_jump;
 	struct sljit_const *last_const;
+	struct sljit_switch *switches;
+	struct sljit_switch *last_switch;
 
 	struct sljit_memory_fragment *buf;
 	struct sljit_memory_fragment *abuf;
+	/* Allocator of the compiler metadata. */
+	struct sljit_allocator allocator;
+	/* Fragments kept by sljit_reset_compiler for later reuse. */
+	struct sljit_memory_fragment *free_buf;
+	struct sljit_memory_fragment *free_abuf;
 
 	/* Used scratch regs. */
 	int scratches;
@@ -325,6 +369,12 @@ struct sljit_compiler {
 	/* For statistical purposes. */
 	unsigned long executable_size;
 
+	/* Operations buffered by SLJIT_IR_OPTIMIZER (allocated
+	   by the first buffered operation, kept by the reset). */
+	struct sljit_ir_op *ir_ops;
+	int ir_count;
+	int ir_flushing;
+
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
 	int args;
 #endif
@@ -335,6 +385,14 @@ struct sljit_compiler {
 
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
 	int flags_saved;
+	/* Last instruction tracked by the peephole optimizer. */
+	u_char *peephole_end;
+	int peephole_type;
+	int peephole_size;
+	int peephole_reg;
+	long peephole_offset;
+	/* The upper halves of the ymm registers might be non-zero. */
+	int ymm_used;
 #endif
 
 #if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
@@ -413,9 +471,25 @@ struct sljit_compiler {
    Returns NULL if failed. */
 struct sljit_compiler* sljit_create_compiler(void);
 
+/* Creates an sljit compiler, which allocates all of its metadata with
+   the passed allocator (see struct sljit_allocator). The allocator is
+   copied into the compiler. A NULL allocator selects malloc and free.
+   The alloc callback must return memory aligned to pointer size.
+   Returns NULL if failed. */
+struct sljit_compiler* sljit_create_compiler_with_allocator(const struct sljit_allocator *allocator);
+
 /* Free everything except the compiled machine code. */
 void sljit_free_compiler(struct sljit_compiler *compiler);
 
+/* Brings the compiler back to the state returned by sljit_create_compiler,
+   so it can be used to compile another function. All labels, jumps and
+   constants are discarded (pointers to them become invalid), but the
+   internal memory fragments are kept and reused by the next compilation.
+   The compiled machine code and the verbose output setting are not
+   affected. Useful when many small functions are compiled one after
+   the other. */
+void sljit_reset_compiler(struct sljit_compiler *compiler);
+
 /* Returns the current error code. If an error is occurred, future sljit
    calls which uses the same compiler argument returns early with the same
    error code. Thus there is no need for checking the error after every
@@ -470,8 +544,13 @@ static __inline unsigned long sljit_get_generated_code_size(struct sljit_compile
 
    The number of long arguments passed to the generated function
    are specified in the "args" parameter. The number of arguments must
-   be less than or equal to 3. The first argument goes to SLJIT_S0,
-   the second goes to SLJIT_S1 and so on. The reg set used by
+   be less than or equal to 3 (6 if SLJIT_EXTENDED_CALLS is defined).
+   The first argument goes to SLJIT_S0, the second goes to SLJIT_S1
+   and so on. When SLJIT_EXTENDED_CALLS is defined, "args" can be
+   combined (or'ed) with SLJIT_FLOAT_ARGS(n): the first n double
+   arguments go to SLJIT_FR0 ... SLJIT_FR(n-1). The word and double
+   arguments are counted separately, so their order in the C
+   prototype does not matter. The reg set used by
    the function must be declared as well. The number of scratch and
    saved regs used by the function must be passed to sljit_emit_enter.
    Only R regs between R0 and "scratches" argument can be used
@@ -492,15 +571,38 @@ static __inline unsigned long sljit_get_generated_code_size(struct sljit_compile
          0 <= fscratches <= SLJIT_NUM_FLOAT_REGS
          0 <= fsaveds <= SLJIT_NUM_FLOAT_REGS
          fscratches + fsaveds <= SLJIT_NUM_FLOAT_REGS
+         number of double arguments <= fscratches
 
    Note: every call of sljit_emit_enter and sljit_set_context
          overwrites the previous context.
 */
 
+/* Number of double arguments passed in floating point registers. Can be
+   combined with the args argument of sljit_emit_enter and sljit_set_context,
+   and with the SLJIT_CALL0 ... SLJIT_CALL6 jump types. The value of n must
+   be less than or equal to 8. Requires SLJIT_EXTENDED_CALLS. */
+#define SLJIT_FLOAT_ARGS(n)	((n) << 16)
+
 /* The absolute address returned by sljit_get_local_base with
 offset 0 is aligned to sljit_d. Otherwise it is aligned to unsigned long. */
 #define SLJIT_DOUBLE_ALIGNMENT 0x00000001
 
+/* Enables the peephole optimizer of the backend (x86 only, ignored by
+   other architectures). Redundant register moves, reloads of a value
+   just stored into the local area, and adjacent flag save / restore
+   pairs are removed while the instructions are emitted. */
+#define SLJIT_PEEPHOLE_OPTIMIZER 0x00000002
+
+/* Buffers the sljit_emit_op1 and sljit_emit_op2 calls until any other
+   function is called (labels, jumps, calls, etc.) or the buffer is full
+   (SLJIT_IR_MAX_OPS). The buffered operations are optimized before they
+   are emitted: known constants and register copies are propagated into
+   the operands, operations on constants are folded, loads of a value
+   which is already in a register are replaced by register moves, and
+   values which are overwritten before use are not computed. Operations
+   which set flags are never removed. */
+#define SLJIT_IR_OPTIMIZER 0x00000004
+
 /* The local_size must be >= 0 and <= SLJIT_MAX_LOCAL_SIZE. */
 #define SLJIT_MAX_LOCAL_SIZE	65536
 
@@ -526,7 +628,9 @@ int sljit_set_context(struct sljit_compiler *compiler,
    function does not return with anything or any opcode between SLJIT_MOV and
    SLJIT_MOV_P (see sljit_emit_op1). As for src and srcw they must be 0 if op
    is SLJIT_UNUSED, otherwise see below the description about source and
-   destination arguments. */
+   destination arguments. If SLJIT_EXTENDED_CALLS is defined, op can also be
+   SLJIT_DMOV, and the function returns with the double value of src/srcw
+   (see sljit_emit_fop1). */
 
 int sljit_emit_return(struct sljit_compiler *compiler, int op,
 	int src, long srcw);
@@ -558,6 +662,10 @@ int sljit_emit_fast_return(struct sljit_compiler *compiler, int src, long srcw);
     [reg+(reg<<imm)] - indirect indexed memory address (shift must be between 0 and 3)
                        useful for (byte, half, int, long) array access
                        (fully supported by both x86 and ARM architectures, and cheap operation on others)
+    [reg+(reg<<imm)+imm] - indirect indexed memory address with a displacement, the
+                       immediate argument is SLJIT_MEM2_DISP(shift, displacement)
+                       useful for accessing a member of an array of structures
+                       (a single instruction on x86, emulated on the other targets)
 */
 
 /*
@@ -582,6 +690,7 @@ int sljit_emit_fast_return(struct sljit_compiler *compiler, int src, long srcw);
 
    x86:    [reg+imm], -2^32+1 <= imm <= 2^32-1 (full address space on x86-32)
            [reg+(reg<<imm)] is supported
+           [reg+(reg<<imm)+imm], -2^31 <= imm <= 2^31-1 is supported
            [imm], -2^32+1 <= imm <= 2^32-1 is supported
            Write-back is not supported
    arm:    [reg+imm], -4095 <= imm <= 4095 or -255 <= imm <= 255 for signed
@@ -608,6 +717,8 @@ int sljit_emit_fast_return(struct sljit_compiler *compiler, int src, long srcw);
 #define SLJIT_MEM0()		(SLJIT_MEM)
 #define SLJIT_MEM1(r1)		(SLJIT_MEM | (r1))
 #define SLJIT_MEM2(r1, r2)	(SLJIT_MEM | (r1) | ((r2) << 8))
+/* Immediate argument of SLJIT_MEM2: (r1 + (r2 << shift) + disp). */
+#define SLJIT_MEM2_DISP(shift, disp)	((long)(disp) * 4 + (shift))
 #define SLJIT_IMM		0x40
 
 /* Set 32 bit operation mode (I) on 64 bit CPUs. The flag is totally ignored on
@@ -778,6 +889,38 @@ int sljit_emit_op0(struct sljit_compiler *compiler, int op);
 #define SLJIT_CLZ			(SLJIT_OP1_BASE + 18)
 #define SLJIT_ICLZ			(SLJIT_CLZ | SLJIT_INT_OP)
 
+/* The following bit manipulation operators are native instructions on
+   x86 and ARM-64. Other targets emit shift, logical, add and multiply
+   sequences for them. */
+
+/* Count trailing zeroes (the result is the bit length for zero)
+   Flags: I | E | K */
+#define SLJIT_CTZ			(SLJIT_OP1_BASE + 19)
+#define SLJIT_ICTZ			(SLJIT_CTZ | SLJIT_INT_OP)
+/* Count the bits which are set to 1
+   Flags: I | E | K */
+#define SLJIT_POPCNT			(SLJIT_OP1_BASE + 20)
+#define SLJIT_IPOPCNT			(SLJIT_POPCNT | SLJIT_INT_OP)
+/* Reverse the order of the bytes
+   Flags: I | K */
+#define SLJIT_BSWAP			(SLJIT_OP1_BASE + 21)
+#define SLJIT_IBSWAP			(SLJIT_BSWAP | SLJIT_INT_OP)
+/* Reverse the order of the lower two bytes, the result is zero extended
+   Flags: I | K */
+#define SLJIT_BSWAP16			(SLJIT_OP1_BASE + 22)
+#define SLJIT_IBSWAP16			(SLJIT_BSWAP16 | SLJIT_INT_OP)
+/* Prefetch the memory block at the address of src into the cache. The
+   dst must be SLJIT_UNUSED and src must be a memory operand. The memory
+   is never accessed, so an invalid address does not cause a fault.
+   L1, L2 and L3 select the cache level, ONCE requests a non-temporal
+   prefetch which minimizes cache pollution. Targets without prefetch
+   instructions ignore these operations.
+   Flags: - (never set any flags) */
+#define SLJIT_PREFETCH_L1		(SLJIT_OP1_BASE + 23)
+#define SLJIT_PREFETCH_L2		(SLJIT_OP1_BASE + 24)
+#define SLJIT_PREFETCH_L3		(SLJIT_OP1_BASE + 25)
+#define SLJIT_PREFETCH_ONCE		(SLJIT_OP1_BASE + 26)
+
 int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src, long srcw);
@@ -831,6 +974,37 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
    to bit_length - 1, the result is undefined. */
 #define SLJIT_ASHR			(SLJIT_OP2_BASE + 10)
 #define SLJIT_IASHR			(SLJIT_ASHR | SLJIT_INT_OP)
+/* Flags: I | K
+   Let bit_length be the length of the rotate operation: 32 or 64.
+   The rotate amount (src2) is taken modulo bit_length. */
+#define SLJIT_ROTL			(SLJIT_OP2_BASE + 11)
+#define SLJIT_IROTL			(SLJIT_ROTL | SLJIT_INT_OP)
+/* Flags: I | K
+   Same as SLJIT_ROTL, except the bits are rotated to the right. */
+#define SLJIT_ROTR			(SLJIT_OP2_BASE + 12)
+#define SLJIT_IROTR			(SLJIT_ROTR | SLJIT_INT_OP)
+/* Flags: I - (may destroy flags)
+   Unsigned divide of src1 by src2, which must be an immediate other
+   than 0. The division is computed by a multiplication with a constant
+   and shifts, and the SLJIT_R0 / SLJIT_R1 registers are not used.
+   Supported when SLJIT_DIV_IMM_SUPPORT is defined (x86-64 and ARM-64),
+   other targets report SLJIT_ERR_UNSUPPORTED. */
+#define SLJIT_UDIV_IMM		(SLJIT_OP2_BASE + 13)
+#define SLJIT_IUDIV_IMM		(SLJIT_UDIV_IMM | SLJIT_INT_OP)
+/* Flags: I - (may destroy flags)
+   Same as SLJIT_UDIV_IMM, except the division is signed and the quotient
+   is rounded toward zero. Note: the result of dividing the smallest
+   negative number by -1 is the smallest negative number. */
+#define SLJIT_SDIV_IMM		(SLJIT_OP2_BASE + 14)
+#define SLJIT_ISDIV_IMM		(SLJIT_SDIV_IMM | SLJIT_INT_OP)
+/* Flags: I - (may destroy flags)
+   Remainder of SLJIT_UDIV_IMM. */
+#define SLJIT_UMOD_IMM		(SLJIT_OP2_BASE + 15)
+#define SLJIT_IUMOD_IMM		(SLJIT_UMOD_IMM | SLJIT_INT_OP)
+/* Flags: I - (may destroy flags)
+   Remainder of SLJIT_SDIV_IMM, which has the sign of src1. */
+#define SLJIT_SMOD_IMM		(SLJIT_OP2_BASE + 16)
+#define SLJIT_ISMOD_IMM		(SLJIT_SMOD_IMM | SLJIT_INT_OP)
 
 int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
@@ -870,6 +1044,20 @@ int sljit_emit_op_custom(struct sljit_compiler *compiler,
  */
 bool sljit_is_fpu_available(void);
 
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+
+/* Instruction set tiers of the x86 code generator. By default every
+   extension reported by cpuid is used (LZCNT, TZCNT, POPCNT, BMI2,
+   MOVBE and AVX2). The baseline tier uses only SSE2 and cmov, which
+   allows testing the fallback code paths on modern CPUs. The tier is
+   global, and it must not be changed while code is being generated. */
+#define SLJIT_X86_TIER_BASELINE		0
+#define SLJIT_X86_TIER_NATIVE		1
+
+void sljit_x86_set_cpu_tier(int tier);
+
+#endif
+
 /* Starting index of opcodes for sljit_emit_fop1. */
 #define SLJIT_FOP1_BASE			128
 
@@ -932,6 +1120,80 @@ int sljit_emit_fop2(struct sljit_compiler *compiler, int op,
 	int src1, long src1w,
 	int src2, long src2w);
 
+/* Vector operations. The floating point registers are also vector
+   registers, which can hold 16 or 32 bytes of data divided into lanes
+   of equal size. Vector and floating point operations should not be
+   mixed on the same register: the value of a register written by a
+   vector operation is undefined for floating point operations, and
+   vice versa. The lane size must be specified for every operation
+   (SLJIT_VEC_8 ... SLJIT_VEC_64), and SLJIT_VEC_256 selects 32 byte
+   vectors. If the CPU does not support an operation, the compiler
+   error is set to SLJIT_ERR_UNSUPPORTED.
+
+   On x86, SSE2 instructions are used for 16 byte vectors, and AVX2
+   (VEX encoded) instructions for all vectors if the CPU supports
+   AVX2. The upper halves of the vector registers are cleared
+   before returns and calls if 32 byte vectors are used. */
+
+/* Returns with the maximum vector size in bytes (16 or 32), or 0 if
+   vector operations are not supported. Operations on 32 byte vectors
+   are allowed only if this function returns with 32. */
+int sljit_get_vector_size(void);
+
+/* Lane sizes of the vector operations. */
+#define SLJIT_VEC_8			0x0000
+#define SLJIT_VEC_16			0x0100
+#define SLJIT_VEC_32			0x0200
+#define SLJIT_VEC_64			0x0300
+/* Operate on 32 byte vectors instead of 16 byte vectors. */
+#define SLJIT_VEC_256			0x0400
+
+/* Starting index of opcodes for sljit_emit_vop1. */
+#define SLJIT_VOP1_BASE			192
+
+/* Loads, stores or copies a vector. Either dst or src must be a
+   register, memory operands do not need to be aligned. */
+#define SLJIT_VMOV			(SLJIT_VOP1_BASE + 0)
+/* Sets all lanes of dst (register) to the lowest bits of the integer
+   operand src (register, memory or immediate). On 32 bit machines,
+   64 bit lanes are set to the zero extended value of src. */
+#define SLJIT_VBROADCAST		(SLJIT_VOP1_BASE + 1)
+/* Sets bit n of the integer dst operand to the most significant bit
+   of lane n of src (register). The other bits of dst are cleared. */
+#define SLJIT_VMOVEMASK			(SLJIT_VOP1_BASE + 2)
+
+int sljit_emit_vop1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw);
+
+/* Starting index of opcodes for sljit_emit_vop2. All operands are
+   registers, except the second source operand of SLJIT_VSHUFFLE. */
+#define SLJIT_VOP2_BASE			224
+
+/* Lane-wise arithmetic (wraps around on overflow). */
+#define SLJIT_VADD			(SLJIT_VOP2_BASE + 0)
+#define SLJIT_VSUB			(SLJIT_VOP2_BASE + 1)
+/* Bitwise operations, the lane size has no effect. */
+#define SLJIT_VAND			(SLJIT_VOP2_BASE + 2)
+#define SLJIT_VOR			(SLJIT_VOP2_BASE + 3)
+#define SLJIT_VXOR			(SLJIT_VOP2_BASE + 4)
+/* Compares the lanes of src1 and src2, and sets all bits of the
+   corresponding lane of dst if src1 == src2 (SLJIT_VCMPEQ) or if
+   src1 > src2 as signed integers (SLJIT_VCMPGT), and clears them
+   otherwise. SLJIT_VCMPGT with 64 bit lanes needs 32 byte vector
+   support (see sljit_get_vector_size). */
+#define SLJIT_VCMPEQ			(SLJIT_VOP2_BASE + 5)
+#define SLJIT_VCMPGT			(SLJIT_VOP2_BASE + 6)
+/* Lane n of dst is set to lane ((src2w >> (2 * n)) & 0x3) of src1, where
+   src2 must be SLJIT_IMM. Only 32 bit lanes are supported. For 32 byte
+   vectors the two 16 byte halves are shuffled separately. */
+#define SLJIT_VSHUFFLE			(SLJIT_VOP2_BASE + 7)
+
+int sljit_emit_vop2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w);
+
 /* Label and jump instructions. */
 
 struct sljit_label* sljit_emit_label(struct sljit_compiler *compiler);
@@ -1000,15 +1262,39 @@ struct sljit_label* sljit_emit_label(struct sljit_compiler *compiler);
 #define SLJIT_CALL1			25
 #define SLJIT_CALL2			26
 #define SLJIT_CALL3			27
+/* The following call types require SLJIT_EXTENDED_CALLS. The
+   fourth, fifth and sixth arguments are passed in R3, R4 and R5. */
+#define SLJIT_CALL4			28
+#define SLJIT_CALL5			29
+#define SLJIT_CALL6			30
 
 /* Fast calling method. See sljit_emit_fast_enter / sljit_emit_fast_return. */
 
 /* The target can be changed during runtime (see: sljit_set_jump_addr). */
 #define SLJIT_REWRITABLE_JUMP		0x1000
 
+/* The called function returns a double, which is moved to SLJIT_FR0
+   after the call. Can be combined with the SLJIT_CALLx types, and
+   requires SLJIT_EXTENDED_CALLS. The double arguments of a call are
+   specified by SLJIT_FLOAT_ARGS(n): they are passed in SLJIT_FR0 ...
+   SLJIT_FR(n-1). All scratch floating point regs are destroyed by
+   the call. */
+#define SLJIT_CALL_RETURN_DOUBLE	0x100000
+
+/* The call replaces the current function: the saved regs are restored
+   and the stack frame is released in the same way as sljit_emit_return
+   does, and then the target is jumped to with the arguments of the call.
+   The target returns directly to the caller of the current function,
+   so chains of tail calls run in constant stack space. Can be combined
+   with the SLJIT_CALLx types (except SLJIT_CALL_RETURN_DOUBLE), and
+   requires SLJIT_TAIL_CALL_SUPPORT. */
+#define SLJIT_TAIL_CALL			0x2000
+
 /* Emit a jump instruction. The destination is not set, only the type of the jump.
-    type must be between SLJIT_EQUAL and SLJIT_CALL3
-    type can be combined (or'ed) with SLJIT_REWRITABLE_JUMP
+    type must be between SLJIT_EQUAL and SLJIT_CALL3 (SLJIT_CALL6 if
+      SLJIT_EXTENDED_CALLS is defined)
+    type can be combined (or'ed) with SLJIT_REWRITABLE_JUMP, and calls
+      with SLJIT_FLOAT_ARGS(n), SLJIT_CALL_RETURN_DOUBLE and SLJIT_TAIL_CALL
    Flags: - (never set any flags) for both conditional and unconditional jumps.
    Flags: destroy all flags for calls. */
 struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type);
@@ -1045,13 +1331,32 @@ void sljit_set_label(struct sljit_jump *jump, struct sljit_label* label);
 void sljit_set_target(struct sljit_jump *jump, unsigned long target);
 
 /* Call function or jump anywhere. Both direct and indirect form
-    type must be between SLJIT_JUMP and SLJIT_CALL3
+    type must be between SLJIT_JUMP and SLJIT_CALL3 (SLJIT_CALL6 if
+      SLJIT_EXTENDED_CALLS is defined), and calls can be combined with
+      SLJIT_FLOAT_ARGS(n), SLJIT_CALL_RETURN_DOUBLE and SLJIT_TAIL_CALL
     Direct form: set src to SLJIT_IMM() and srcw to the address
     Indirect form: any other valid addressing mode
    Flags: - (never set any flags) for unconditional jumps.
    Flags: destroy all flags for calls. */
 int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long srcw);
 
+/* Jumps to labels[src] through a jump table, which is placed after the
+   generated code by sljit_generate_code. If src (compared as an unsigned
+   machine word) is greater than or equal to count, the execution
+   continues with the next instruction instead, so this is the default
+   case of the switch. The labels array is copied, and it can be NULL;
+   the NULL items must be set by sljit_set_switch_label before the code
+   is generated. Supported when SLJIT_SWITCH_SUPPORT is defined (x86 and
+   ARM-64), otherwise SLJIT_ERR_UNSUPPORTED is set.
+    count must be greater than 0
+   Flags: destroy all flags. */
+struct sljit_switch* sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count);
+
+/* Set the destination of the index of the switch to this label. */
+void sljit_set_switch_label(struct sljit_switch *switch_, long index, struct sljit_label *label);
+
 /* Perform the operation using the conditional flags as the second argument.
    Type must always be between SLJIT_EQUAL and SLJIT_S_ORDERED. The value
    represented by the type is 1, if the condition represented by the type
@@ -1072,6 +1377,65 @@ int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 	int src, long srcw,
 	int type);
 
+/* Branch-free selection between two values using the conditional flags:
+     dst_reg = (the condition represented by type is fulfilled) ? src1 : src2_reg
+   Type must be between SLJIT_EQUAL and SLJIT_S_ORDERED, and the
+   SLJIT_INT_OP flag selects a 32 bit operation (like SLJIT_I_EQUAL).
+   dst_reg and src2_reg must be registers, src1 can be any operand, but
+   dst_reg must not be used for addressing src1 (unless dst_reg == src2_reg).
+   Implemented by conditional moves on x86 (when cmov is available) and
+   ARM-64, and by a conditional jump on other targets.
+   Flags: - (never set any flags) */
+int sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg);
+
+/* Atomic memory operations. The operation is performed on the machine
+   word (or 32 bit integer if SLJIT_INT_OP is set) at the address stored
+   in mem_reg, which must be aligned to the size of the data. mem_reg
+   must not be a virtual register (SLJIT_R3 - SLJIT_R6 on x86-32), the
+   other operands can be any registers. The op argument is the combination
+   of an operation, a memory ordering and optionally SLJIT_INT_OP.
+
+   Supported on x86 and ARM-64, other targets report SLJIT_ERR_UNSUPPORTED. */
+
+/* dst_reg = [mem_reg], src_reg must be SLJIT_UNUSED.
+   The memory ordering must not be SLJIT_ORDER_RELEASE.
+   Flags: - (never set any flags) */
+#define SLJIT_ATOMIC_LOAD		0
+/* [mem_reg] = src_reg, dst_reg must be SLJIT_UNUSED.
+   The memory ordering must not be SLJIT_ORDER_ACQUIRE.
+   Flags: - (never set any flags) */
+#define SLJIT_ATOMIC_STORE		1
+/* dst_reg = [mem_reg], [mem_reg] = src_reg (dst_reg can be SLJIT_UNUSED).
+   Flags: - (never set any flags) */
+#define SLJIT_ATOMIC_XCHG		2
+/* dst_reg = [mem_reg], [mem_reg] += src_reg (dst_reg can be SLJIT_UNUSED).
+   Flags: - (may destroy flags) */
+#define SLJIT_ATOMIC_ADD		3
+/* Compare and swap: [mem_reg] = src_reg if [mem_reg] == dst_reg, and
+   dst_reg is set to the previous value of [mem_reg] in both cases.
+   Flags: E (always set, SLJIT_EQUAL is true if the store happened) */
+#define SLJIT_ATOMIC_CAS		4
+
+/* Memory orderings (with the same meaning as in C11). */
+#define SLJIT_ORDER_RELAXED		0x00
+#define SLJIT_ORDER_ACQUIRE		0x10
+#define SLJIT_ORDER_RELEASE		0x20
+#define SLJIT_ORDER_SEQ_CST		0x30
+
+int sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg);
+
+/* Memory fence. Type must be SLJIT_ORDER_ACQUIRE, SLJIT_ORDER_RELEASE
+   or SLJIT_ORDER_SEQ_CST (full fence). Acquire and release fences
+   emit no instruction on x86.
+   Flags: - (never set any flags) */
+int sljit_emit_fence(struct sljit_compiler *compiler, int type);
+
 /* Copies the base address of SLJIT_SP + offset to dst.
    Flags: - (never set any flags) */
 int sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset);
@@ -1086,11 +1450,43 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 static __inline unsigned long sljit_get_label_addr(struct sljit_label *label) { return label->addr; }
 static __inline unsigned long sljit_get_jump_addr(struct sljit_jump *jump) { return jump->addr; }
 static __inline unsigned long sljit_get_const_addr(struct sljit_const *const_) { return const_->addr; }
-
-/* Only the address is required to rewrite the code. */
+/* Address of the jump table (count machine words). */
+static __inline unsigned long sljit_get_switch_addr(struct sljit_switch *switch_) { return switch_->addr; }
+
+/* Only the address is required to rewrite the code.
+
+   When SLJIT_ATOMIC_PATCHING is enabled (x86 only), the patched immediate
+   of every rewritable jump and constant is naturally aligned, and it is
+   replaced by a single store. Code running concurrently on other cores
+   then executes either the old or the new target (or loads the old or the
+   new constant), never a mix of the two. The store is not serializing:
+   a core may still follow the old target for a short time after the call
+   returns, so the old target must stay valid until every thread which
+   could have started executing the code before the update has left it.
+   The guarantee does not cover multiple patches: use one rewritable jump
+   to publish the result of several changes. */
 void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr);
 void sljit_set_const(unsigned long addr, long new_constant);
 
+/* Patch types of struct sljit_patch. */
+#define SLJIT_PATCH_JUMP_ADDR	0
+#define SLJIT_PATCH_CONST	1
+
+struct sljit_patch {
+	/* SLJIT_PATCH_JUMP_ADDR or SLJIT_PATCH_CONST. */
+	int type;
+	/* Returned by sljit_get_jump_addr or sljit_get_const_addr. */
+	unsigned long addr;
+	/* New target address or constant value. */
+	long value;
+};
+
+/* Applies count patches, as if sljit_set_jump_addr or sljit_set_const
+   were called for each of them, but the instruction cache is flushed
+   only once for each group of nearby patches. Sorting the patches by
+   their address produces the fewest cache flushes. */
+void sljit_set_patches(const struct sljit_patch *patches, int count);
+
 /* --------------------------------------------------------------------- */
 /*  Miscellaneous utility functions                                      */
 /* --------------------------------------------------------------------- */
@@ -315,7 +315,7 @@ struct future_patch {
 	int value;
 };
 
-static __inline int resolve_const_pool_index(struct future_patch **first_patch, unsigned long cpool_current_index, unsigned long *cpool_start_address, unsigned long *buf_ptr)
+static __inline int resolve_const_pool_index(struct sljit_compiler *compiler, struct future_patch **first_patch, unsigned long cpool_current_index, unsigned long *cpool_start_address, unsigned long *buf_ptr)
 {
 	int value;
 	struct future_patch *curr_patch, *prev_patch;
@@ -337,7 +337,7 @@ static __inline int resolve_const_pool_index(struct future_patch **first_patch,
 					prev_patch->next = curr_patch->next;
 				else
 					*first_patch = curr_patch->next;
-				free(curr_patch);
+				compiler_free(compiler, curr_patch);
 				break;
 			}
 			prev_patch = curr_patch;
@@ -347,12 +347,12 @@ static __inline int resolve_const_pool_index(struct future_patch **first_patch,
 
 	if (value >= 0) {
 		if ((unsigned long)value > cpool_current_index) {
-			curr_patch = malloc(sizeof(struct future_patch));
+			curr_patch = compiler_alloc(compiler, sizeof(struct future_patch));
 			if (!curr_patch) {
 				while (*first_patch) {
 					curr_patch = *first_patch;
 					*first_patch = (*first_patch)->next;
-					free(curr_patch);
+					compiler_free(compiler, curr_patch);
 				}
 				return SLJIT_ERR_ALLOC_FAILED;
 			}
@@ -444,6 +444,14 @@ static __inline int detect_jump_type(struct sljit_jump *jump, unsigned long *cod
 	return 0;
 }
 
+#if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
+/* The patched instructions are not at addr, so they cannot be flushed together. */
+#define PATCHED_CODE_SIZE 0
+#else
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (2 * sizeof(unsigned long))
+#endif
+
 static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 #if (defined SLJIT_CONFIG_ARM_V5 && SLJIT_CONFIG_ARM_V5)
@@ -623,7 +631,7 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 					cpool_skip_alignment--;
 				}
 				else {
-					if (resolve_const_pool_index(&first_patch, cpool_current_index, cpool_start_address, buf_ptr)) {
+					if (resolve_const_pool_index(compiler, &first_patch, cpool_current_index, cpool_start_address, buf_ptr)) {
 						SLJIT_FREE_EXEC(code);
 						compiler->error = SLJIT_ERR_ALLOC_FAILED;
 						return NULL;
@@ -713,7 +721,7 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 		buf_end = buf_ptr + compiler->cpool_fill;
 		cpool_current_index = 0;
 		while (buf_ptr < buf_end) {
-			if (resolve_const_pool_index(&first_patch, cpool_current_index, cpool_start_address, buf_ptr)) {
+			if (resolve_const_pool_index(compiler, &first_patch, cpool_current_index, cpool_start_address, buf_ptr)) {
 				SLJIT_FREE_EXEC(code);
 				compiler->error = SLJIT_ERR_ALLOC_FAILED;
 				return NULL;
@@ -1362,6 +1370,8 @@ static int getput_arg_fast(struct sljit_compiler *compiler, int inp_flags, int r
 	if (arg & OFFS_REG_MASK) {
 		if ((argw & 0x3) != 0 && !IS_TYPE1_TRANSFER(inp_flags))
 			return 0;
+		if (argw & ~0x3)
+			return 0;
 
 		if (inp_flags & ARG_TEST)
 			return 1;
@@ -1504,6 +1514,37 @@ static int getput_arg(struct sljit_compiler *compiler, int inp_flags, int reg, i
 		return SLJIT_SUCCESS;
 	}
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the address is computed
+		   into TMP_REG3, or into the base register when it is updated. */
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if (inp_flags & WRITE_BACK) {
+			FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, arg & REG_MASK, arg & REG_MASK, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+			if (getput_arg_fast(compiler, inp_flags, reg, SLJIT_MEM1(arg & REG_MASK), MEM2_DISP(argw)))
+				return compiler->error;
+			return getput_arg(compiler, inp_flags, reg, SLJIT_MEM1(arg & REG_MASK), MEM2_DISP(argw), 0, 0);
+		}
+
+		imm = (unsigned long)MEM2_DISP(argw);
+		if (imm <= (unsigned long)max_delta || imm >= (unsigned long)-max_delta) {
+			FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG3, arg & REG_MASK, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+			if (imm <= (unsigned long)max_delta) {
+				GETPUT_ARG_DATA_TRANSFER(1, 0, reg, TMP_REG3, imm);
+			}
+			else {
+				imm = (unsigned long)-(long)imm;
+				GETPUT_ARG_DATA_TRANSFER(0, 0, reg, TMP_REG3, imm);
+			}
+			return SLJIT_SUCCESS;
+		}
+
+		FAIL_IF(load_immediate(compiler, TMP_REG3, imm));
+		FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG3, TMP_REG3, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+		return push_inst(compiler, EMIT_DATA_TRANSFER(inp_flags, 1, 0, reg, arg & REG_MASK,
+			RM(TMP_REG3) | (IS_TYPE1_TRANSFER(inp_flags) ? SRC2_IMM : 0)));
+	}
+
 	if (arg & OFFS_REG_MASK) {
 		SLJIT_ASSERT((argw & 0x3) && !(max_delta & 0xf00));
 		if (inp_flags & WRITE_BACK)
@@ -1853,8 +1894,11 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src, long srcw)
 {
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -1917,8 +1961,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	int src1, long src1w,
 	int src2, long src2w)
 {
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -2031,9 +2077,18 @@ static int emit_fop_mem(struct sljit_compiler *compiler, int flags, int reg, int
 	SLJIT_ASSERT(arg & SLJIT_MEM);
 
 	if (arg & OFFS_REG_MASK) {
-		FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG1, arg & REG_MASK, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+		tmp = MEM2_DISP(argw);
+		if (!(tmp & ~0x3fc) || !(-tmp & ~0x3fc))
+			FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG1, arg & REG_MASK, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+		else {
+			/* The displacement is too large for the instruction. */
+			FAIL_IF(load_immediate(compiler, TMP_REG1, tmp));
+			FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG1, TMP_REG1, RM(OFFS_REG(arg)) | ((argw & 0x3) << 7))));
+			FAIL_IF(push_inst(compiler, EMIT_DATA_PROCESS_INS(ADD_DP, 0, TMP_REG1, arg & REG_MASK, reg_map[TMP_REG1])));
+			tmp = 0;
+		}
 		arg = SLJIT_MEM | TMP_REG1;
-		argw = 0;
+		argw = tmp;
 	}
 
 	/* Fast loads and stores. */
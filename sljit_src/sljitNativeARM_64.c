@@ -47,16 +47,24 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
   31, 0, 1, 2, 3, 4, 5, 6, 7, 12, 13, 14, 15, 16, 17, 8, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 29, 9, 10, 11, 30, 31
 };
 
+/* The float arguments are passed in v0 - v7 and v0 is a temporary reg, so
+   SLJIT_FR0 - SLJIT_FR6 are v1 - v7, and the other scratch regs are v16 - v30.
+   The saved float regs are d8 - d15 (only the lower 64 bit is preserved). */
+static const u_char freg_map[SLJIT_NUM_FLOAT_REGS + 2] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 15, 14, 13, 12, 11, 10, 9, 8, 31
+};
+
 #define W_OP (1 << 31)
 #define RD(rd) (reg_map[rd])
 #define RT(rt) (reg_map[rt])
 #define RN(rn) (reg_map[rn] << 5)
 #define RT2(rt2) (reg_map[rt2] << 10)
 #define RM(rm) (reg_map[rm] << 16)
-#define VD(vd) (vd)
-#define VT(vt) (vt)
-#define VN(vn) ((vn) << 5)
-#define VM(vm) ((vm) << 16)
+#define VD(vd) (freg_map[vd])
+#define VT(vt) (freg_map[vt])
+#define VT2(vt2) (freg_map[vt2] << 10)
+#define VN(vn) (freg_map[vn] << 5)
+#define VM(vm) (freg_map[vm] << 16)
 
 /* --------------------------------------------------------------------- */
 /*  Instrucion forms                                                     */
@@ -64,7 +72,9 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
 
 #define ADC 0x9a000000
 #define ADD 0x8b000000
+#define ADDV 0x0e31b800
 #define ADDI 0x91000000
+#define ADRP 0x90000000
 #define AND 0x8a000000
 #define ANDI 0x92000000
 #define ASRV 0x9ac02800
@@ -74,11 +84,17 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
 #define BLR 0xd63f0000
 #define BR 0xd61f0000
 #define BRK 0xd4200000
+#define CBNZ_W 0x35000000
 #define CBZ 0xb4000000
 #define CLZ 0xdac01000
+#define CNT 0x0e205800
+#define CSEL 0x9a800000
 #define CSINC 0x9a800400
+#define DMB_ISH 0xd5033bbf
+#define DMB_ISHLD 0xd50339bf
 #define EOR 0xca000000
 #define EORI 0xd2000000
+#define EXTR 0x93c00000
 #define FABS 0x1e60c000
 #define FADD 0x1e602800
 #define FCMP 0x1e602000
@@ -86,12 +102,19 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
 #define FCVTZS 0x9e780000
 #define FDIV 0x1e601800
 #define FMOV 0x1e604000
+#define FMOV_DX 0x9e670000
+#define FMOV_XD 0x9e660000
 #define FMUL 0x1e600800
 #define FNEG 0x1e614000
 #define FSUB 0x1e603800
+#define LDAR 0xc8dffc00
 #define LDRI 0xf9400000
+#define LDRI_F 0xfd400000
+#define LDR_R 0xf8606800
 #define LDP 0xa9400000
+#define LDP_F 0x6d400000
 #define LDP_PST 0xa8c00000
+#define LDXR 0xc85f7c00
 #define LSLV 0x9ac02000
 #define LSRV 0x9ac02400
 #define MADD 0x9b000000
@@ -102,7 +125,15 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
 #define ORN 0xaa200000
 #define ORR 0xaa000000
 #define ORRI 0xb2000000
+#define PRFM 0xf9800000
+#define PRFM_R 0xf8a06800
+#define PRFUM 0xf8800000
+#define RBIT 0xdac00000
 #define RET 0xd65f0000
+#define REV 0xdac00c00
+#define REV16 0x5ac00400
+#define REVW 0x5ac00800
+#define RORV 0x9ac02c00
 #define SBC 0xda000000
 #define SBFM 0x93000000
 #define SCVTF 0x9e620000
@@ -110,10 +141,14 @@ static const u_char reg_map[SLJIT_NUM_REGS + 8] = {
 #define SMADDL 0x9b200000
 #define SMULH 0x9b403c00
 #define STP 0xa9000000
+#define STP_F 0x6d000000
 #define STP_PRE 0xa9800000
+#define STLR 0xc89ffc00
 #define STRI 0xf9000000
+#define STRI_F 0xfd000000
 #define STR_FI 0x3d000000
 #define STR_FR 0x3c206800
+#define STXR 0xc8007c00
 #define STUR_FI 0x3c000000
 #define SUB 0xcb000000
 #define SUBI 0xd1000000
@@ -214,15 +249,19 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	unsigned long addr;
 	int dst;
 
+	unsigned long *table;
+	long page;
+
 	struct sljit_label *label;
 	struct sljit_jump *jump;
 	struct sljit_const *const_;
+	struct sljit_switch *switch_;
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_generate_code(compiler));
 	reverse_buf(compiler);
 
-	code = (sljit_ins*)SLJIT_MALLOC_EXEC(compiler->size * sizeof(sljit_ins));
+	code = (sljit_ins*)SLJIT_MALLOC_EXEC(compiler->size * sizeof(sljit_ins) + get_switch_tables_size(compiler));
 	PTR_FAIL_WITH_EXEC_IF(code);
 	buf = compiler->buf;
 
@@ -231,6 +270,7 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	label = compiler->labels;
 	jump = compiler->jumps;
 	const_ = compiler->consts;
+	switch_ = compiler->switches;
 
 	do {
 		buf_ptr = (sljit_ins*)buf->memory;
@@ -255,6 +295,10 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 				const_->addr = (unsigned long)code_ptr;
 				const_ = const_->next;
 			}
+			if (switch_ && switch_->addr == word_count) {
+				switch_->addr = (unsigned long)code_ptr;
+				switch_ = switch_->next;
+			}
 			code_ptr ++;
 			word_count ++;
 		} while (buf_ptr < buf_end);
@@ -271,8 +315,23 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	SLJIT_ASSERT(!label);
 	SLJIT_ASSERT(!jump);
 	SLJIT_ASSERT(!const_);
+	SLJIT_ASSERT(!switch_);
 	SLJIT_ASSERT(code_ptr - code <= (long)compiler->size);
 
+	/* The tables are placed after the code, and addressed by adrp / add. */
+	switch_ = compiler->switches;
+	while (switch_) {
+		table = write_switch_table(switch_, code_ptr);
+		buf_ptr = (sljit_ins*)switch_->addr;
+		page = (long)(((unsigned long)table >> 12) - ((unsigned long)buf_ptr >> 12));
+		SLJIT_ASSERT(page <= 0xfffff && page >= -0x100000);
+		buf_ptr[0] |= ((page & 0x3) << 29) | (((page >> 2) & 0x7ffff) << 5);
+		buf_ptr[1] |= ((unsigned long)table & 0xfff) << 10;
+		switch_->addr = (unsigned long)table;
+		code_ptr = (sljit_ins*)(table + switch_->count);
+		switch_ = switch_->next;
+	}
+
 	jump = compiler->jumps;
 	while (jump) {
 		do {
@@ -308,7 +367,7 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	}
 
 	compiler->error = SLJIT_ERR_COMPILED;
-	compiler->executable_size = (code_ptr - code) * sizeof(sljit_ins);
+	compiler->executable_size = (u_char*)code_ptr - (u_char*)code;
 	SLJIT_CACHE_FLUSH(code, code_ptr);
 	return code;
 }
@@ -512,6 +571,127 @@ static int load_immediate(struct sljit_compiler *compiler, int dst, long simm)
 			dst = TMP_ZERO; \
 	}
 
+/* Returns with an ADD or SUB instruction (with a shifted register operand),
+   which multiplies a register by value, or 0 if there is no such instruction. */
+static sljit_ins mul_imm_form(long value, int bits)
+{
+	sljit_ins ins = ADD;
+	unsigned long v;
+	int k;
+
+	/* Either value == 2^k + 1 or value == 1 - 2^k. */
+	v = (unsigned long)value - 1;
+	if (v < 2 || (v & (v - 1))) {
+		ins = SUB;
+		v = 1 - (unsigned long)value;
+		if (v < 2 || (v & (v - 1)))
+			return 0;
+	}
+
+	k = 0;
+	while (!(v & 0x1)) {
+		v >>= 1;
+		k++;
+	}
+	if (k >= bits)
+		return 0;
+	return ins | (k << 10);
+}
+
+static sljit_ins lsl_imm(sljit_ins inv_bits, int dst, int src, int shift)
+{
+	if (inv_bits)
+		return (UBFM ^ inv_bits) | RD(dst) | RN(src) | ((-shift & 0x1f) << 16) | ((31 - shift) << 10);
+	return UBFM | RD(dst) | RN(src) | (1 << 22) | ((-shift & 0x3f) << 16) | ((63 - shift) << 10);
+}
+
+/* Latency of an instruction emitted by emit_mul_imm: ADD / SUB with
+   a register shifted by more than 4 takes 2 cycles on recent cores. */
+static int mul_imm_cost(sljit_ins ins)
+{
+	if ((ins & 0x7f000000) == (UBFM & 0x7f000000))
+		return 1;
+	return (((ins >> 10) & 0x3f) > 4) ? 2 : 1;
+}
+
+/* A multiplication by a constant is replaced by at most two instructions,
+   which shift the register or add / subtract the shifted register to or
+   from itself, if their total latency is lower than the latency of MADD
+   (3 cycles). Returns SLJIT_ERR_UNSUPPORTED if the constant has no such form. */
+static int emit_mul_imm(struct sljit_compiler *compiler, sljit_ins inv_bits, int dst, int reg, long imm)
+{
+	int bits = inv_bits ? 32 : 64;
+	int shift = 0;
+	int k;
+	sljit_ins ins[2];
+	sljit_ins first, second;
+	long factor;
+
+	if (inv_bits)
+		imm = (int)imm;
+
+	if (imm == 0)
+		return push_inst(compiler, (ORR ^ inv_bits) | RD(dst) | RN(TMP_ZERO) | RM(TMP_ZERO));
+
+	while (!(imm & 0x1)) {
+		imm >>= 1;
+		shift++;
+	}
+
+	ins[1] = 0;
+	if (imm == 1) {
+		/* The 32 bit move clears the upper half of the register. */
+		if (shift == 0 && dst == reg && !inv_bits)
+			return SLJIT_SUCCESS;
+		ins[0] = shift ? lsl_imm(inv_bits, dst, reg, shift) : ((ORR ^ inv_bits) | RD(dst) | RN(TMP_ZERO) | RM(reg));
+	}
+	else if (imm == -1)
+		ins[0] = (SUB ^ inv_bits) | RD(dst) | RN(TMP_ZERO) | RM(reg) | (shift << 10);
+	else if ((first = mul_imm_form(imm, bits))) {
+		ins[0] = (first ^ inv_bits) | RD(dst) | RN(reg) | RM(reg);
+		if (shift)
+			ins[1] = lsl_imm(inv_bits, dst, dst, shift);
+	}
+	else if ((first = mul_imm_form(-imm, bits))) {
+		/* The negated product is shifted by the final NEG. */
+		ins[0] = (first ^ inv_bits) | RD(dst) | RN(reg) | RM(reg);
+		ins[1] = (SUB ^ inv_bits) | RD(dst) | RN(TMP_ZERO) | RM(dst) | (shift << 10);
+	}
+	else {
+		if (shift > 0)
+			return SLJIT_ERR_UNSUPPORTED;
+
+		/* Product of two factors. */
+		for (k = 1; k < bits - 1; k++) {
+			factor = (long)((1ul << k) + 1);
+			if (imm % factor == 0) {
+				second = mul_imm_form(imm / factor, bits);
+				if (second)
+					break;
+			}
+			factor = (long)(1 - (1ul << k));
+			if (imm % factor == 0) {
+				second = mul_imm_form(imm / factor, bits);
+				if (second)
+					break;
+			}
+		}
+
+		if (k >= bits - 1)
+			return SLJIT_ERR_UNSUPPORTED;
+
+		ins[0] = (mul_imm_form(factor, bits) ^ inv_bits) | RD(dst) | RN(reg) | RM(reg);
+		ins[1] = (second ^ inv_bits) | RD(dst) | RN(dst) | RM(dst);
+	}
+
+	if (!ins[1])
+		return push_inst(compiler, ins[0]);
+	if (mul_imm_cost(ins[0]) + mul_imm_cost(ins[1]) >= 3)
+		return SLJIT_ERR_UNSUPPORTED;
+	FAIL_IF(push_inst(compiler, ins[0]));
+	return push_inst(compiler, ins[1]);
+}
+
 static int emit_op_imm(struct sljit_compiler *compiler, int flags, int dst, long arg1, long arg2)
 {
 	/* dst must be reg, TMP_REG1
@@ -540,8 +720,15 @@ static int emit_op_imm(struct sljit_compiler *compiler, int flags, int dst, long
 
 		switch (op) {
 		case SLJIT_MUL:
+			if (!(flags & SET_FLAGS) && emit_mul_imm(compiler, inv_bits, dst, reg, imm) != SLJIT_ERR_UNSUPPORTED)
+				return compiler->error;
+			break;
 		case SLJIT_NEG:
 		case SLJIT_CLZ:
+		case SLJIT_CTZ:
+		case SLJIT_POPCNT:
+		case SLJIT_BSWAP:
+		case SLJIT_BSWAP16:
 		case SLJIT_ADDC:
 		case SLJIT_SUBC:
 			/* No form with immediate operand (except imm 0, which
@@ -634,6 +821,15 @@ static int emit_op_imm(struct sljit_compiler *compiler, int flags, int dst, long
 				FAIL_IF(push_inst(compiler, (UBFM ^ inv_bits) | RD(dst) | RN(arg1) | (1 << 22) | (imm << 16) | (63 << 10)));
 			}
 			goto set_flags;
+		case SLJIT_ROTL:
+		case SLJIT_ROTR:
+			if (flags & ARG1_IMM)
+				break;
+			if (op == SLJIT_ROTL)
+				imm = -imm;
+			if (flags & INT_OP)
+				return push_inst(compiler, (EXTR ^ (1 << 31) ^ (1 << 22)) | RD(dst) | RN(arg1) | RM(arg1) | ((imm & 0x1f) << 10));
+			return push_inst(compiler, EXTR | RD(dst) | RN(arg1) | RM(arg1) | ((imm & 0x3f) << 10));
 		default:
 			SLJIT_ASSERT_STOP();
 			break;
@@ -712,6 +908,26 @@ static int emit_op_imm(struct sljit_compiler *compiler, int flags, int dst, long
 		SLJIT_ASSERT(arg1 == TMP_REG1);
 		FAIL_IF(push_inst(compiler, (CLZ ^ inv_bits) | RD(dst) | RN(arg2)));
 		goto set_flags;
+	case SLJIT_CTZ:
+		SLJIT_ASSERT(arg1 == TMP_REG1);
+		FAIL_IF(push_inst(compiler, (RBIT ^ inv_bits) | RD(dst) | RN(arg2)));
+		FAIL_IF(push_inst(compiler, (CLZ ^ inv_bits) | RD(dst) | RN(dst)));
+		goto set_flags;
+	case SLJIT_POPCNT:
+		SLJIT_ASSERT(arg1 == TMP_REG1);
+		/* The bytes are counted by the SIMD unit. */
+		FAIL_IF(push_inst(compiler, (FMOV_DX ^ (inv_bits ? ((1 << 31) | (1 << 22)) : 0)) | VD(TMP_FREG1) | RN(arg2)));
+		FAIL_IF(push_inst(compiler, CNT | VD(TMP_FREG1) | VN(TMP_FREG1)));
+		FAIL_IF(push_inst(compiler, ADDV | VD(TMP_FREG1) | VN(TMP_FREG1)));
+		FAIL_IF(push_inst(compiler, (FMOV_XD ^ (1 << 31) ^ (1 << 22)) | RD(dst) | VN(TMP_FREG1)));
+		goto set_flags;
+	case SLJIT_BSWAP:
+		SLJIT_ASSERT(arg1 == TMP_REG1 && !(flags & SET_FLAGS));
+		return push_inst(compiler, ((flags & INT_OP) ? REVW : REV) | RD(dst) | RN(arg2));
+	case SLJIT_BSWAP16:
+		SLJIT_ASSERT(arg1 == TMP_REG1 && !(flags & SET_FLAGS));
+		FAIL_IF(push_inst(compiler, REV16 | RD(dst) | RN(arg2)));
+		return push_inst(compiler, (UBFM ^ (1 << 31)) | RD(dst) | RN(dst) | (15 << 10));
 	case SLJIT_ADD:
 		CHECK_FLAGS(1 << 29);
 		return push_inst(compiler, (ADD ^ inv_bits) | RD(dst) | RN(arg1) | RM(arg2));
@@ -753,6 +969,13 @@ static int emit_op_imm(struct sljit_compiler *compiler, int flags, int dst, long
 	case SLJIT_ASHR:
 		FAIL_IF(push_inst(compiler, (ASRV ^ inv_bits) | RD(dst) | RN(arg1) | RM(arg2)));
 		goto set_flags;
+	case SLJIT_ROTL:
+		FAIL_IF(push_inst(compiler, SUB | RD(TMP_LR) | RN(TMP_ZERO) | RM(arg2)));
+		arg2 = TMP_LR;
+		/* Fall through. */
+	case SLJIT_ROTR:
+		SLJIT_ASSERT(!(flags & SET_FLAGS));
+		return push_inst(compiler, (RORV ^ inv_bits) | RD(dst) | RN(arg1) | RM(arg2));
 	}
 
 	SLJIT_ASSERT_STOP();
@@ -846,7 +1069,8 @@ static int getput_arg_fast(struct sljit_compiler *compiler, int flags, int reg,
 	}
 
 	if (arg & OFFS_REG_MASK) {
-		argw &= 0x3;
+		if (argw & ~0x3)
+			return 0;
 		if (argw && argw != shift)
 			return 0;
 
@@ -921,6 +1145,34 @@ static int getput_arg(struct sljit_compiler *compiler, int flags, int reg,
 
 	tmp_r = (flags & STORE) ? TMP_REG3 : reg;
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the address is computed into
+		   TMP_REG3, or into the base register when it is updated. */
+		other_r = OFFS_REG(arg);
+		arg &= REG_MASK;
+		diff = MEM2_DISP(argw);
+		argw = MEM2_SHIFT(argw);
+		if (flags & UPDATE) {
+			FAIL_IF(push_inst(compiler, ADD | RD(arg) | RN(arg) | RM(other_r) | (argw << 10)));
+			return getput_arg(compiler, flags, reg, SLJIT_MEM1(arg), diff, 0, 0);
+		}
+
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if (diff <= 0xfff && diff >= -0xfff) {
+			FAIL_IF(push_inst(compiler, ADD | RD(TMP_REG3) | RN(arg) | RM(other_r) | (argw << 10)));
+			if (getput_arg_fast(compiler, flags, reg, SLJIT_MEM1(TMP_REG3), diff))
+				return compiler->error;
+			FAIL_IF(emit_set_delta(compiler, TMP_REG3, TMP_REG3, diff));
+		}
+		else {
+			FAIL_IF(load_immediate(compiler, TMP_REG3, diff));
+			FAIL_IF(push_inst(compiler, ADD | RD(TMP_REG3) | RN(TMP_REG3) | RM(arg)));
+			FAIL_IF(push_inst(compiler, ADD | RD(TMP_REG3) | RN(TMP_REG3) | RM(other_r) | (argw << 10)));
+		}
+		return push_inst(compiler, sljit_mem_imm[flags & 0x3] | (shift << 30) | RT(reg) | RN(TMP_REG3));
+	}
+
 	if ((flags & UPDATE) && (arg & REG_MASK)) {
 		/* Update only applies if a base reg exists. */
 		other_r = OFFS_REG(arg);
@@ -1056,6 +1308,8 @@ static __inline int emit_op_mem2(struct sljit_compiler *compiler, int flags, int
 	return getput_arg(compiler, flags, reg, arg1, arg1w, arg2, arg2w);
 }
 
+static int emit_fop_mem(struct sljit_compiler *compiler, int flags, int reg, int arg, long argw);
+
 /* --------------------------------------------------------------------- */
 /*  Entry, exit                                                          */
 /* --------------------------------------------------------------------- */
@@ -1070,7 +1324,8 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 	CHECK(check_sljit_emit_enter(compiler, options, args, scratches, saveds, fscratches, fsaveds, local_size));
 	set_emit_enter(compiler, options, args, scratches, saveds, fscratches, fsaveds, local_size);
 
-	saved_regs_size = GET_SAVED_REGS_SIZE(scratches, saveds, 0);
+	saved_regs_size = GET_SAVED_REGS_SIZE(scratches, saveds, 0)
+		+ GET_SAVED_FLOAT_REGS_SIZE(fscratches, fsaveds, sizeof(double));
 	local_size += saved_regs_size + SLJIT_LOCALS_OFFSET;
 	local_size = (local_size + 15) & ~0xf;
 	compiler->local_size = local_size;
@@ -1111,8 +1366,35 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 		prev = -1;
 	}
 
-	if (prev != -1)
+	if (prev != -1) {
 		FAIL_IF(push_inst(compiler, STRI | RT(prev) | RN(TMP_SP) | (offs >> 5)));
+		offs += 1 << 15;
+	}
+
+	tmp = fsaveds < SLJIT_NUM_SAVED_FLOAT_REGS ? (SLJIT_FS0 + 1 - fsaveds) : SLJIT_FIRST_SAVED_FLOAT_REG;
+	prev = -1;
+	for (i = SLJIT_FS0; i >= tmp; i--) {
+		if (prev == -1) {
+			prev = i;
+			continue;
+		}
+		FAIL_IF(push_inst(compiler, STP_F | VT(prev) | VT2(i) | RN(TMP_SP) | offs));
+		offs += 2 << 15;
+		prev = -1;
+	}
+
+	for (i = fscratches; i >= SLJIT_FIRST_SAVED_FLOAT_REG; i--) {
+		if (prev == -1) {
+			prev = i;
+			continue;
+		}
+		FAIL_IF(push_inst(compiler, STP_F | VT(prev) | VT2(i) | RN(TMP_SP) | offs));
+		offs += 2 << 15;
+		prev = -1;
+	}
+
+	if (prev != -1)
+		FAIL_IF(push_inst(compiler, STRI_F | VT(prev) | RN(TMP_SP) | (offs >> 5)));
 
 	if (compiler->local_size > (63 * sizeof(long))) {
 		/* The local_size is already adjusted by the saved regs. */
@@ -1125,12 +1407,14 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 		FAIL_IF(push_inst(compiler, ADDI | RD(SLJIT_SP) | RN(TMP_SP) | (0 << 10)));
 	}
 
-	if (args >= 1)
-		FAIL_IF(push_inst(compiler, ORR | RD(SLJIT_S0) | RN(TMP_ZERO) | RM(SLJIT_R0)));
-	if (args >= 2)
-		FAIL_IF(push_inst(compiler, ORR | RD(SLJIT_S1) | RN(TMP_ZERO) | RM(SLJIT_R1)));
-	if (args >= 3)
-		FAIL_IF(push_inst(compiler, ORR | RD(SLJIT_S2) | RN(TMP_ZERO) | RM(SLJIT_R2)));
+	/* The word arguments are passed in x0 - x5 (SLJIT_R0 - SLJIT_R5). */
+	for (i = 0; i < GET_WORD_ARGS(args); i++)
+		FAIL_IF(push_inst(compiler, ORR | RD(SLJIT_S0 - i) | RN(TMP_ZERO) | RM(SLJIT_R0 + i)));
+
+	/* The double arguments are moved from d0 - d(n-1) to
+	   SLJIT_FR0 - SLJIT_FR(n-1), which are one reg higher (see freg_map). */
+	for (i = GET_FLOAT_ARGS(args); i > 0; i--)
+		FAIL_IF(push_inst(compiler, FMOV | VD(SLJIT_FR0 + i - 1) | VN(TMP_FREG1 + i - 1)));
 
 	return SLJIT_SUCCESS;
 }
@@ -1143,7 +1427,8 @@ int sljit_set_context(struct sljit_compiler *compiler,
 	CHECK(check_sljit_set_context(compiler, options, args, scratches, saveds, fscratches, fsaveds, local_size));
 	set_set_context(compiler, options, args, scratches, saveds, fscratches, fsaveds, local_size);
 
-	local_size += GET_SAVED_REGS_SIZE(scratches, saveds, 0) + SLJIT_LOCALS_OFFSET;
+	local_size += GET_SAVED_REGS_SIZE(scratches, saveds, 0)
+		+ GET_SAVED_FLOAT_REGS_SIZE(fscratches, fsaveds, sizeof(double)) + SLJIT_LOCALS_OFFSET;
 	local_size = (local_size + 15) & ~0xf;
 	if (local_size > (63 * sizeof(long)))
 		local_size += 2 * sizeof(long);
@@ -1151,19 +1436,17 @@ int sljit_set_context(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
-int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long srcw)
+/* Restores the saved regs and releases the stack frame. Used by
+   sljit_emit_return and tail calls. */
+static int emit_stack_frame_release(struct sljit_compiler *compiler)
 {
 	int local_size;
 	int i, tmp, offs, prev, saved_regs_size;
 
-	CHECK_ERROR();
-	CHECK(check_sljit_emit_return(compiler, op, src, srcw));
-
-	FAIL_IF(emit_mov_before_return(compiler, op, src, srcw));
-
 	local_size = compiler->local_size;
 
-	saved_regs_size = GET_SAVED_REGS_SIZE(compiler->scratches, compiler->saveds, 0);
+	saved_regs_size = GET_SAVED_REGS_SIZE(compiler->scratches, compiler->saveds, 0)
+		+ GET_SAVED_FLOAT_REGS_SIZE(compiler->fscratches, compiler->fsaveds, sizeof(double));
 	if (local_size <= (63 * sizeof(long)))
 		offs = (local_size - saved_regs_size) << (15 - 3);
 	else {
@@ -1201,14 +1484,57 @@ int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long src
 		prev = -1;
 	}
 
-	if (prev != -1)
+	if (prev != -1) {
 		FAIL_IF(push_inst(compiler, LDRI | RT(prev) | RN(TMP_SP) | (offs >> 5)));
+		offs += 1 << 15;
+	}
 
-	FAIL_IF(push_inst(compiler, LDP_PST | 29 | RT2(TMP_LR)
-		| RN(TMP_SP) | (((local_size >> 3) & 0x7f) << 15)));
+	tmp = compiler->fsaveds < SLJIT_NUM_SAVED_FLOAT_REGS ? (SLJIT_FS0 + 1 - compiler->fsaveds) : SLJIT_FIRST_SAVED_FLOAT_REG;
+	prev = -1;
+	for (i = SLJIT_FS0; i >= tmp; i--) {
+		if (prev == -1) {
+			prev = i;
+			continue;
+		}
+		FAIL_IF(push_inst(compiler, LDP_F | VT(prev) | VT2(i) | RN(TMP_SP) | offs));
+		offs += 2 << 15;
+		prev = -1;
+	}
 
-	FAIL_IF(push_inst(compiler, RET | RN(TMP_LR)));
-	return SLJIT_SUCCESS;
+	for (i = compiler->fscratches; i >= SLJIT_FIRST_SAVED_FLOAT_REG; i--) {
+		if (prev == -1) {
+			prev = i;
+			continue;
+		}
+		FAIL_IF(push_inst(compiler, LDP_F | VT(prev) | VT2(i) | RN(TMP_SP) | offs));
+		offs += 2 << 15;
+		prev = -1;
+	}
+
+	if (prev != -1)
+		FAIL_IF(push_inst(compiler, LDRI_F | VT(prev) | RN(TMP_SP) | (offs >> 5)));
+
+	return push_inst(compiler, LDP_PST | 29 | RT2(TMP_LR)
+		| RN(TMP_SP) | (((local_size >> 3) & 0x7f) << 15));
+}
+
+int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long srcw)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_return(compiler, op, src, srcw));
+
+	if (op == SLJIT_DMOV) {
+		ADJUST_LOCAL_OFFSET(src, srcw);
+		if (src & SLJIT_MEM)
+			FAIL_IF(emit_fop_mem(compiler, WORD_SIZE, TMP_FREG1, src, srcw));
+		else
+			FAIL_IF(push_inst(compiler, FMOV | VD(TMP_FREG1) | VN(src)));
+	}
+	else
+		FAIL_IF(emit_mov_before_return(compiler, op, src, srcw));
+
+	FAIL_IF(emit_stack_frame_release(compiler));
+	return push_inst(compiler, RET | RN(TMP_LR));
 }
 
 /* --------------------------------------------------------------------- */
@@ -1244,18 +1570,52 @@ int sljit_emit_op0(struct sljit_compiler *compiler, int op)
 	return SLJIT_SUCCESS;
 }
 
+static int emit_prefetch(struct sljit_compiler *compiler, int op,
+	int src, long srcw)
+{
+	/* PLDL1KEEP, PLDL2KEEP, PLDL3KEEP or PLDL1STRM. */
+	sljit_ins prfop = (op == SLJIT_PREFETCH_L1) ? 0 : (op == SLJIT_PREFETCH_L2) ? 2 : (op == SLJIT_PREFETCH_L3) ? 4 : 1;
+	int base = src & REG_MASK;
+	int shift;
+
+	if (src & OFFS_REG_MASK) {
+		shift = MEM2_SHIFT(srcw);
+		srcw = MEM2_DISP(srcw);
+		if (!srcw && (!shift || shift == 3))
+			return push_inst(compiler, PRFM_R | prfop | RN(base) | RM(OFFS_REG(src)) | (shift ? (1 << 12) : 0));
+		FAIL_IF(push_inst(compiler, ADD | RD(TMP_REG1) | RN(base) | RM(OFFS_REG(src)) | (shift << 10)));
+		base = TMP_REG1;
+	}
+
+	if (base) {
+		if (srcw >= 0 && srcw <= 0x7ff8 && !(srcw & 0x7))
+			return push_inst(compiler, PRFM | prfop | RN(base) | (srcw << 7));
+		if (srcw <= 255 && srcw >= -256)
+			return push_inst(compiler, PRFUM | prfop | RN(base) | ((srcw & 0x1ff) << 12));
+	}
+
+	FAIL_IF(load_immediate(compiler, TMP_REG2, srcw));
+	if (base)
+		return push_inst(compiler, PRFM_R | prfop | RN(base) | RM(TMP_REG2));
+	return push_inst(compiler, PRFM | prfop | RN(TMP_REG2));
+}
+
 int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src, long srcw)
 {
-	int dst_r, flags, mem_flags;
+	int dst_r, flags, mem_flags, flags_src;
 	int op_flags = GET_ALL_FLAGS(op);
 
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
+	if (GET_OPCODE(op) >= SLJIT_PREFETCH_L1 && GET_OPCODE(op) <= SLJIT_PREFETCH_ONCE)
+		return emit_prefetch(compiler, GET_OPCODE(op), src, srcw);
+
 	compiler->cache_arg = 0;
 	compiler->cache_argw = 0;
 
@@ -1371,10 +1731,12 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 		flags |= UNUSED_RETURN;
 
 	if (src & SLJIT_MEM) {
-		if (getput_arg_fast(compiler, mem_flags, TMP_REG2, src, srcw))
+		/* Only the low 16 bits are swapped by BSWAP16. */
+		flags_src = (op == SLJIT_BSWAP16) ? HALF_SIZE : mem_flags;
+		if (getput_arg_fast(compiler, flags_src, TMP_REG2, src, srcw))
 			FAIL_IF(compiler->error);
 		else
-			FAIL_IF(getput_arg(compiler, mem_flags, TMP_REG2, src, srcw, dst, dstw));
+			FAIL_IF(getput_arg(compiler, flags_src, TMP_REG2, src, srcw, dst, dstw));
 		src = TMP_REG2;
 	}
 
@@ -1396,6 +1758,12 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	return SLJIT_SUCCESS;
 }
 
+static int emit_mul_high(struct sljit_compiler *compiler, int is_signed, long magic)
+{
+	FAIL_IF(load_immediate(compiler, TMP_REG1, magic));
+	return push_inst(compiler, (is_signed ? SMULH : UMULH) | RD(TMP_REG1) | RN(TMP_REG2) | RM(TMP_REG1));
+}
+
 int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src1, long src1w,
@@ -1403,8 +1771,13 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 {
 	int dst_r, flags, mem_flags;
 
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+
+	if (GET_OPCODE(op) >= SLJIT_UDIV_IMM)
+		return emit_div_imm(compiler, op, dst, dstw, src1, src1w, src2w);
+
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -1490,7 +1863,7 @@ int sljit_get_reg_index(int reg)
 int sljit_get_float_reg_index(int reg)
 {
 	CHECK_REG_INDEX(check_sljit_get_float_reg_index(reg));
-	return reg;
+	return freg_map[reg];
 }
 
 int sljit_emit_op_custom(struct sljit_compiler *compiler,
@@ -1529,15 +1902,16 @@ static int emit_fop_mem(struct sljit_compiler *compiler, int flags, int reg, int
 		ins_bits |= 1 << 22;
 
 	if (arg & OFFS_REG_MASK) {
+		diff = MEM2_DISP(argw);
 		argw &= 3;
-		if (!argw || argw == shift)
+		if (!diff && (!argw || argw == shift))
 			return push_inst(compiler, STR_FR | ins_bits | VT(reg)
 				| RN(arg & REG_MASK) | RM(OFFS_REG(arg)) | (argw ? (1 << 12) : 0));
 		other_r = OFFS_REG(arg);
 		arg &= REG_MASK;
 		FAIL_IF(push_inst(compiler, ADD | RD(TMP_REG1) | RN(arg) | RM(other_r) | (argw << 10)));
 		arg = TMP_REG1;
-		argw = 0;
+		argw = diff;
 	}
 
 	arg &= REG_MASK;
@@ -1847,9 +2221,21 @@ struct sljit_label* sljit_emit_label(struct sljit_compiler *compiler)
 	return label;
 }
 
+/* The word arguments are already in x0 - x5, only the double
+   arguments need to be moved from SLJIT_FR0 - SLJIT_FR(n-1). */
+static int call_with_float_args(struct sljit_compiler *compiler, int type)
+{
+	int i;
+
+	for (i = 0; i < GET_FLOAT_ARGS(type); i++)
+		FAIL_IF(push_inst(compiler, FMOV | VD(TMP_FREG1 + i) | VN(SLJIT_FR0 + i)));
+	return SLJIT_SUCCESS;
+}
+
 struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 {
 	struct sljit_jump *jump;
+	int return_double;
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_emit_jump(compiler, type));
@@ -1858,6 +2244,14 @@ struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 	if (!jump)
 		return NULL;
 	set_jump(jump, compiler, type & SLJIT_REWRITABLE_JUMP);
+	if (call_with_float_args(compiler, type))
+		return NULL;
+	return_double = type & SLJIT_CALL_RETURN_DOUBLE;
+	if (type & SLJIT_TAIL_CALL) {
+		if (emit_stack_frame_release(compiler))
+			return NULL;
+		type = SLJIT_JUMP;
+	}
 	type &= 0xff;
 
 	if (type < SLJIT_JUMP) {
@@ -1874,6 +2268,8 @@ struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 	if (push_inst(compiler, ((type >= SLJIT_FAST_CALL) ? BLR : BR) | RN(TMP_REG1)))
 		return NULL;
 
+	if (return_double && push_inst(compiler, FMOV | VD(SLJIT_FR0) | VN(TMP_FREG1)))
+		return NULL;
 	return jump;
 }
 
@@ -1925,23 +2321,95 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 	CHECK(check_sljit_emit_ijump(compiler, type, src, srcw));
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
-	/* In ARM, we don't need to touch the arguments. */
+	/* In ARM, we don't need to touch the word arguments. */
+	FAIL_IF(call_with_float_args(compiler, type));
+
+	if (type & SLJIT_TAIL_CALL) {
+		/* The target must be loaded before the saved regs are restored. */
+		if (src & SLJIT_MEM)
+			FAIL_IF(emit_op_mem(compiler, WORD_SIZE, TMP_REG1, src, srcw));
+		else if (!(src & SLJIT_IMM))
+			FAIL_IF(push_inst(compiler, ORR | RD(TMP_REG1) | RN(TMP_ZERO) | RM(src)));
+		if (!(src & SLJIT_IMM))
+			src = TMP_REG1;
+		FAIL_IF(emit_stack_frame_release(compiler));
+		type = SLJIT_JUMP;
+	}
+
 	if (!(src & SLJIT_IMM)) {
 		if (src & SLJIT_MEM) {
 			FAIL_IF(emit_op_mem(compiler, WORD_SIZE, TMP_REG1, src, srcw));
 			src = TMP_REG1;
 		}
-		return push_inst(compiler, ((type >= SLJIT_FAST_CALL) ? BLR : BR) | RN(src));
+		FAIL_IF(push_inst(compiler, ((type >= SLJIT_FAST_CALL) ? BLR : BR) | RN(src)));
 	}
+	else {
+		jump = ensure_abuf(compiler, sizeof(struct sljit_jump));
+		FAIL_IF(!jump);
+		set_jump(jump, compiler, JUMP_ADDR | ((type >= SLJIT_FAST_CALL) ? IS_BL : 0));
+		jump->u.target = srcw;
 
-	jump = ensure_abuf(compiler, sizeof(struct sljit_jump));
-	FAIL_IF(!jump);
-	set_jump(jump, compiler, JUMP_ADDR | ((type >= SLJIT_FAST_CALL) ? IS_BL : 0));
-	jump->u.target = srcw;
+		FAIL_IF(emit_imm64_const(compiler, TMP_REG1, 0));
+		jump->addr = compiler->size;
+		FAIL_IF(push_inst(compiler, ((type >= SLJIT_FAST_CALL) ? BLR : BR) | RN(TMP_REG1)));
+	}
 
-	FAIL_IF(emit_imm64_const(compiler, TMP_REG1, 0));
-	jump->addr = compiler->size;
-	return push_inst(compiler, ((type >= SLJIT_FAST_CALL) ? BLR : BR) | RN(TMP_REG1));
+	if (type & SLJIT_CALL_RETURN_DOUBLE)
+		return push_inst(compiler, FMOV | VD(SLJIT_FR0) | VN(TMP_FREG1));
+	return SLJIT_SUCCESS;
+}
+
+struct sljit_switch* sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count)
+{
+	struct sljit_switch *switch_;
+	int index_r = src;
+
+	CHECK_ERROR_PTR();
+	CHECK_PTR(check_sljit_emit_switch(compiler, src, srcw, labels, count));
+	ADJUST_LOCAL_OFFSET(src, srcw);
+
+	switch_ = set_switch(compiler, labels, count);
+	if (!switch_)
+		return NULL;
+
+	if (src & SLJIT_MEM) {
+		if (emit_op_mem(compiler, WORD_SIZE, TMP_REG1, src, srcw))
+			return NULL;
+		index_r = TMP_REG1;
+	}
+	else if (src & SLJIT_IMM) {
+		if (load_immediate(compiler, TMP_REG1, srcw))
+			return NULL;
+		index_r = TMP_REG1;
+	}
+
+	/* cmp index_r, count; b.hs past the dispatch */
+	if (count <= 0xfff) {
+		if (push_inst(compiler, SUBI | (1 << 29) | RD(TMP_ZERO) | RN(index_r) | (count << 10)))
+			return NULL;
+	}
+	else {
+		if (load_immediate(compiler, TMP_REG2, count))
+			return NULL;
+		if (push_inst(compiler, SUBS | RD(TMP_ZERO) | RN(index_r) | RM(TMP_REG2)))
+			return NULL;
+	}
+	if (push_inst(compiler, B_CC | (5 << 5) | 0x2))
+		return NULL;
+
+	/* The page and the offset of the table are set by sljit_generate_code. */
+	switch_->addr = compiler->size;
+	if (push_inst(compiler, ADRP | RD(TMP_REG2)))
+		return NULL;
+	if (push_inst(compiler, ADDI | RD(TMP_REG2) | RN(TMP_REG2)))
+		return NULL;
+	if (push_inst(compiler, LDR_R | (1 << 12) | RT(TMP_REG2) | RN(TMP_REG2) | RM(index_r)))
+		return NULL;
+	if (push_inst(compiler, BR | RN(TMP_REG2)))
+		return NULL;
+	return switch_;
 }
 
 int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
@@ -1994,6 +2462,101 @@ int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 	return emit_op_mem2(compiler, mem_flags | STORE, TMP_REG1, dst, dstw, 0, 0);
 }
 
+int sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
+{
+	sljit_ins inv_bits = (type & SLJIT_INT_OP) ? (1 << 31) : 0;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_select(compiler, type, dst_reg, src1, src1w, src2_reg));
+	ADJUST_LOCAL_OFFSET(src1, src1w);
+
+	if (src1 & SLJIT_IMM) {
+		FAIL_IF(load_immediate(compiler, TMP_REG1, (type & SLJIT_INT_OP) ? (int)src1w : src1w));
+		src1 = TMP_REG1;
+	}
+	else if (src1 & SLJIT_MEM) {
+		FAIL_IF(emit_op_mem(compiler, (type & SLJIT_INT_OP) ? INT_SIZE : WORD_SIZE, TMP_REG1, src1, src1w));
+		src1 = TMP_REG1;
+	}
+
+	/* get_cc returns the inverted condition code. */
+	return push_inst(compiler, (CSEL ^ inv_bits) | (get_cc(type & 0xff) << 12) | RD(dst_reg) | RN(src2_reg) | RM(src1));
+}
+
+int sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg)
+{
+	/* Selects the 32 bit forms of the arithmetic and the memory instructions. */
+	sljit_ins inv_bits = (op & SLJIT_INT_OP) ? (1 << 31) : 0;
+	sljit_ins size_bits = (op & SLJIT_INT_OP) ? (1 << 30) : 0;
+	sljit_ins load_ins = LDXR ^ size_bits;
+	sljit_ins store_ins = STXR ^ size_bits;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_atomic(compiler, op, dst_reg, mem_reg, src_reg));
+
+	compiler->cache_arg = 0;
+	compiler->cache_argw = 0;
+
+	switch (op & 0xf) {
+	case SLJIT_ATOMIC_LOAD:
+		if (op & SLJIT_ORDER_ACQUIRE)
+			return push_inst(compiler, (LDAR ^ size_bits) | RT(dst_reg) | RN(mem_reg));
+		return push_inst(compiler, (LDRI ^ size_bits) | RT(dst_reg) | RN(mem_reg));
+	case SLJIT_ATOMIC_STORE:
+		if (op & SLJIT_ORDER_RELEASE)
+			return push_inst(compiler, (STLR ^ size_bits) | RT(src_reg) | RN(mem_reg));
+		return push_inst(compiler, (STRI ^ size_bits) | RT(src_reg) | RN(mem_reg));
+	}
+
+	/* Exclusive load / store loops. */
+	if (op & SLJIT_ORDER_ACQUIRE)
+		load_ins |= 1 << 15;
+	if (op & SLJIT_ORDER_RELEASE)
+		store_ins |= 1 << 15;
+
+	FAIL_IF(push_inst(compiler, load_ins | RT(TMP_REG1) | RN(mem_reg)));
+
+	switch (op & 0xf) {
+	case SLJIT_ATOMIC_XCHG:
+		FAIL_IF(push_inst(compiler, store_ins | RM(TMP_REG3) | RT(src_reg) | RN(mem_reg)));
+		FAIL_IF(push_inst(compiler, CBNZ_W | ((-2 & 0x7ffff) << 5) | RT(TMP_REG3)));
+		break;
+	case SLJIT_ATOMIC_ADD:
+		FAIL_IF(push_inst(compiler, (ADD ^ inv_bits) | RD(TMP_REG2) | RN(TMP_REG1) | RM(src_reg)));
+		FAIL_IF(push_inst(compiler, store_ins | RM(TMP_REG3) | RT(TMP_REG2) | RN(mem_reg)));
+		FAIL_IF(push_inst(compiler, CBNZ_W | ((-3 & 0x7ffff) << 5) | RT(TMP_REG3)));
+		break;
+	default:
+		SLJIT_ASSERT((op & 0xf) == SLJIT_ATOMIC_CAS);
+		/* The zero flag is set when the values are equal, and it
+		   is not modified by the rest of the loop. */
+		FAIL_IF(push_inst(compiler, (SUBS ^ inv_bits) | RD(TMP_ZERO) | RN(TMP_REG1) | RM(dst_reg)));
+		FAIL_IF(push_inst(compiler, B_CC | (3 << 5) | 0x1 /* ne */));
+		FAIL_IF(push_inst(compiler, store_ins | RM(TMP_REG3) | RT(src_reg) | RN(mem_reg)));
+		FAIL_IF(push_inst(compiler, CBNZ_W | ((-4 & 0x7ffff) << 5) | RT(TMP_REG3)));
+		break;
+	}
+
+	if (dst_reg == SLJIT_UNUSED)
+		return SLJIT_SUCCESS;
+	return push_inst(compiler, ORR | RD(dst_reg) | RN(TMP_ZERO) | RM(TMP_REG1));
+}
+
+int sljit_emit_fence(struct sljit_compiler *compiler, int type)
+{
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_fence(compiler, type));
+
+	/* Release fences must also order the preceding loads. */
+	return push_inst(compiler, (type == SLJIT_ORDER_ACQUIRE) ? DMB_ISHLD : DMB_ISH);
+}
+
 struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, long dstw, long init_value)
 {
 	struct sljit_const *const_;
@@ -2018,16 +2581,33 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 	return const_;
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (4 * sizeof(sljit_ins))
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 	sljit_ins* inst = (sljit_ins*)addr;
 	modify_imm64_const(inst, new_addr);
-	SLJIT_CACHE_FLUSH(inst, inst + 4);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 4);
+	}
 }
 
-void sljit_set_const(unsigned long addr, long new_constant)
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
 {
 	sljit_ins* inst = (sljit_ins*)addr;
 	modify_imm64_const(inst, new_constant);
-	SLJIT_CACHE_FLUSH(inst, inst + 4);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 4);
+	}
+}
+
+void sljit_set_const(unsigned long addr, long new_constant)
+{
+	inline_set_const(addr, new_constant, 1);
 }
@@ -915,6 +915,8 @@ static int getput_arg_fast(struct sljit_compiler *compiler, int flags, int reg,
 	}
 
 	if (arg & OFFS_REG_MASK) {
+		if (argw & ~0x3)
+			return 0;
 		if (flags & ARG_TEST)
 			return 1;
 
@@ -1013,6 +1015,35 @@ static int getput_arg(struct sljit_compiler *compiler, int flags, int reg,
 
 	tmp_r = (flags & STORE) ? TMP_REG3 : reg;
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the address is computed
+		   into TMP_REG3, or into the base register when it is updated. */
+		other_r = OFFS_REG(arg);
+		arg &= 0xf;
+		diff = MEM2_DISP(argw);
+		argw &= 0x3;
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+
+		if (flags & UPDATE) {
+			FAIL_IF(push_inst32(compiler, ADD_W | RD4(arg) | RN4(arg) | RM4(other_r) | (argw << 6)));
+			if (getput_arg_fast(compiler, flags, reg, SLJIT_MEM1(arg), diff))
+				return compiler->error;
+			return getput_arg(compiler, flags, reg, SLJIT_MEM1(arg), diff, 0, 0);
+		}
+
+		if (diff <= 0xfff && diff >= -0xff) {
+			FAIL_IF(push_inst32(compiler, ADD_W | RD4(TMP_REG3) | RN4(arg) | RM4(other_r) | (argw << 6)));
+			if (diff >= 0)
+				return push_inst32(compiler, sljit_mem32[flags] | MEM_IMM12 | RT4(reg) | RN4(TMP_REG3) | diff);
+			return push_inst32(compiler, sljit_mem32[flags] | MEM_IMM8 | RT4(reg) | RN4(TMP_REG3) | -diff);
+		}
+
+		FAIL_IF(load_immediate(compiler, TMP_REG3, diff));
+		FAIL_IF(push_inst32(compiler, ADD_W | RD4(TMP_REG3) | RN4(TMP_REG3) | RM4(other_r) | (argw << 6)));
+		return push_inst32(compiler, sljit_mem32[flags] | RT4(reg) | RN4(arg) | RM4(TMP_REG3));
+	}
+
 	if ((flags & UPDATE) && (arg & REG_MASK)) {
 		/* Update only applies if a base reg exists. */
 		/* There is no caching here. */
@@ -1286,8 +1317,11 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int dst_r, flags;
 	int op_flags = GET_ALL_FLAGS(op);
 
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -1419,8 +1453,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 {
 	int dst_r, flags;
 
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -1540,9 +1576,18 @@ static int emit_fop_mem(struct sljit_compiler *compiler, int flags, int reg, int
 
 	/* Fast loads and stores. */
 	if (arg & OFFS_REG_MASK) {
-		FAIL_IF(push_inst32(compiler, ADD_W | RD4(TMP_REG2) | RN4(arg & REG_MASK) | RM4(OFFS_REG(arg)) | ((argw & 0x3) << 6)));
+		tmp = MEM2_DISP(argw);
+		if (!(tmp & ~0x3fc) || !(-tmp & ~0x3fc))
+			FAIL_IF(push_inst32(compiler, ADD_W | RD4(TMP_REG2) | RN4(arg & REG_MASK) | RM4(OFFS_REG(arg)) | ((argw & 0x3) << 6)));
+		else {
+			/* The displacement is too large for the instruction. */
+			FAIL_IF(load_immediate(compiler, TMP_REG2, tmp));
+			FAIL_IF(push_inst32(compiler, ADD_W | RD4(TMP_REG2) | RN4(TMP_REG2) | RM4(OFFS_REG(arg)) | ((argw & 0x3) << 6)));
+			FAIL_IF(push_inst16(compiler, ADD | SET_REGS44(TMP_REG2, (arg & REG_MASK))));
+			tmp = 0;
+		}
 		arg = SLJIT_MEM | TMP_REG2;
-		argw = 0;
+		argw = tmp;
 	}
 
 	if ((arg & REG_MASK) && (argw & 0x3) == 0) {
@@ -2052,16 +2097,33 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 	return const_;
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (4 * sizeof(unsigned short))
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 	unsigned short *inst = (unsigned short*)addr;
 	modify_imm32_const(inst, new_addr);
-	SLJIT_CACHE_FLUSH(inst, inst + 4);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 4);
+	}
 }
 
-void sljit_set_const(unsigned long addr, long new_constant)
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
 {
 	unsigned short *inst = (unsigned short*)addr;
 	modify_imm32_const(inst, new_constant);
-	SLJIT_CACHE_FLUSH(inst, inst + 4);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 4);
+	}
+}
+
+void sljit_set_const(unsigned long addr, long new_constant)
+{
+	inline_set_const(addr, new_constant, 1);
 }
@@ -446,7 +446,10 @@ static __inline int emit_const(struct sljit_compiler *compiler, int dst, long in
 	return push_inst(compiler, ORI | S(dst) | T(dst) | IMM(init_value), DR(dst));
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (6 * sizeof(sljit_ins))
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 	sljit_ins *inst = (sljit_ins*)addr;
 
@@ -454,10 +457,17 @@ void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
 	inst[1] = (inst[1] & 0xffff0000) | ((new_addr >> 32) & 0xffff);
 	inst[3] = (inst[3] & 0xffff0000) | ((new_addr >> 16) & 0xffff);
 	inst[5] = (inst[5] & 0xffff0000) | (new_addr & 0xffff);
-	SLJIT_CACHE_FLUSH(inst, inst + 6);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 6);
+	}
 }
 
-void sljit_set_const(unsigned long addr, long new_constant)
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
 {
 	sljit_ins *inst = (sljit_ins*)addr;
 
@@ -465,5 +475,12 @@ void sljit_set_const(unsigned long addr, long new_constant)
 	inst[1] = (inst[1] & 0xffff0000) | ((new_constant >> 32) & 0xffff);
 	inst[3] = (inst[3] & 0xffff0000) | ((new_constant >> 16) & 0xffff);
 	inst[5] = (inst[5] & 0xffff0000) | (new_constant & 0xffff);
-	SLJIT_CACHE_FLUSH(inst, inst + 6);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 6);
+	}
+}
+
+void sljit_set_const(unsigned long addr, long new_constant)
+{
+	inline_set_const(addr, new_constant, 1);
 }
@@ -758,6 +758,35 @@ static int getput_arg(struct sljit_compiler *compiler, int flags, int reg_ar, in
 	}
 	base = arg & REG_MASK;
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the address is computed into
+		   tmp_ar, or into the base register when it is updated. */
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if ((flags & WRITE_BACK) && reg_ar == DR(base)) {
+			SLJIT_ASSERT(!(flags & LOAD_DATA) && DR(TMP_REG1) != reg_ar);
+			FAIL_IF(push_inst(compiler, ADDU_W | SA(reg_ar) | TA(0) | D(TMP_REG1), DR(TMP_REG1)));
+			reg_ar = DR(TMP_REG1);
+		}
+
+		if (argw & 0x3)
+			FAIL_IF(push_inst(compiler, SLL_W | T(OFFS_REG(arg)) | D(TMP_REG3) | SH_IMM(argw & 0x3), DR(TMP_REG3)));
+
+		if (flags & WRITE_BACK) {
+			FAIL_IF(push_inst(compiler, ADDU_W | S(base) | T((argw & 0x3) ? TMP_REG3 : OFFS_REG(arg)) | D(base), DR(base)));
+			return getput_arg(compiler, flags, reg_ar, SLJIT_MEM1(base), MEM2_DISP(argw), 0, 0);
+		}
+
+		FAIL_IF(push_inst(compiler, ADDU_W | S(base) | T((argw & 0x3) ? TMP_REG3 : OFFS_REG(arg)) | DA(tmp_ar), tmp_ar));
+		argw = MEM2_DISP(argw);
+		if (argw > SIMM_MAX || argw < SIMM_MIN) {
+			FAIL_IF(load_immediate(compiler, DR(TMP_REG3), argw));
+			FAIL_IF(push_inst(compiler, ADDU_W | SA(tmp_ar) | T(TMP_REG3) | DA(tmp_ar), tmp_ar));
+			argw = 0;
+		}
+		return push_inst(compiler, data_transfer_insts[flags & MEM_MASK] | SA(tmp_ar) | TA(reg_ar) | IMM(argw), delay_slot);
+	}
+
 	if (arg & OFFS_REG_MASK) {
 		argw &= 0x3;
 		if ((flags & WRITE_BACK) && reg_ar == DR(base)) {
@@ -1086,8 +1115,11 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int flags = 0;
 #endif
 
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -1188,8 +1220,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	int flags = 0;
 #endif
 
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
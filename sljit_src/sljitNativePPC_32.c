@@ -250,20 +250,37 @@ static __inline int emit_const(struct sljit_compiler *compiler, int reg, long in
 	return push_inst(compiler, ORI | S(reg) | A(reg) | IMM(init_value));
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (2 * sizeof(sljit_ins))
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 	sljit_ins *inst = (sljit_ins*)addr;
 
 	inst[0] = (inst[0] & 0xffff0000) | ((new_addr >> 16) & 0xffff);
 	inst[1] = (inst[1] & 0xffff0000) | (new_addr & 0xffff);
-	SLJIT_CACHE_FLUSH(inst, inst + 2);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 2);
+	}
 }
 
-void sljit_set_const(unsigned long addr, long new_constant)
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
 {
 	sljit_ins *inst = (sljit_ins*)addr;
 
 	inst[0] = (inst[0] & 0xffff0000) | ((new_constant >> 16) & 0xffff);
 	inst[1] = (inst[1] & 0xffff0000) | (new_constant & 0xffff);
-	SLJIT_CACHE_FLUSH(inst, inst + 2);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 2);
+	}
+}
+
+void sljit_set_const(unsigned long addr, long new_constant)
+{
+	inline_set_const(addr, new_constant, 1);
 }
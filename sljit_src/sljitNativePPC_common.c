@@ -850,7 +850,7 @@ static int getput_arg_fast(struct sljit_compiler *compiler, int inp_flags, int r
 	SLJIT_ASSERT(arg & SLJIT_MEM);
 
 	if (arg & OFFS_REG_MASK) {
-		if (argw & 0x3)
+		if (argw)
 			return 0;
 		if (inp_flags & ARG_TEST)
 			return 1;
@@ -956,6 +956,32 @@ static int getput_arg(struct sljit_compiler *compiler, int inp_flags, int reg, i
 	if ((arg & REG_MASK) == tmp_r)
 		tmp_r = TMP_REG1;
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the sum of the
+		   shifted index and the displacement is computed into tmp_r. */
+		int index_r = (argw & 0x3) ? tmp_r : OFFS_REG(arg);
+
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if (argw & 0x3) {
+#if (defined SLJIT_CONFIG_PPC_32 && SLJIT_CONFIG_PPC_32)
+			FAIL_IF(push_inst(compiler, RLWINM | S(OFFS_REG(arg)) | A(tmp_r) | ((argw & 0x3) << 11) | ((31 - (argw & 0x3)) << 1)));
+#else
+			FAIL_IF(push_inst(compiler, RLDI(tmp_r, OFFS_REG(arg), argw & 0x3, 63 - (argw & 0x3), 1)));
+#endif
+		}
+		argw = MEM2_DISP(argw);
+		if (argw <= SIMM_MAX && argw >= SIMM_MIN)
+			FAIL_IF(push_inst(compiler, ADDI | D(tmp_r) | A(index_r) | IMM(argw)));
+		else {
+			FAIL_IF(load_immediate(compiler, TMP_REG3, argw));
+			FAIL_IF(push_inst(compiler, ADD | D(tmp_r) | A(index_r) | B(TMP_REG3)));
+		}
+		inst = data_transfer_insts[(inp_flags | INDEXED) & MEM_MASK];
+		SLJIT_ASSERT(!(inst & (INT_ALIGNED | UPDATE_REQ)));
+		return push_inst(compiler, INST_CODE_AND_DST(inst, inp_flags, reg) | A(arg & REG_MASK) | B(tmp_r));
+	}
+
 	if (arg & OFFS_REG_MASK) {
 		argw &= 0x3;
 		/* Otherwise getput_arg_fast would capture it. */
@@ -1299,8 +1325,11 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 	int flags = GET_FLAGS(op) ? ALT_SET_FLAGS : 0;
 	int op_flags = GET_ALL_FLAGS(op);
 
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -1454,8 +1483,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 {
 	int flags = GET_FLAGS(op) ? ALT_SET_FLAGS : 0;
 
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -1749,6 +1780,8 @@ static __inline int sljit_emit_fop1_convw_fromd(struct sljit_compiler *compiler,
 	SLJIT_ASSERT(dst & SLJIT_MEM);
 
 	if (dst & OFFS_REG_MASK) {
+		long disp = MEM2_DISP(dstw);
+
 		dstw &= 0x3;
 		if (dstw) {
 #if (defined SLJIT_CONFIG_PPC_32 && SLJIT_CONFIG_PPC_32)
@@ -1760,6 +1793,18 @@ static __inline int sljit_emit_fop1_convw_fromd(struct sljit_compiler *compiler,
 		}
 		else
 			dstw = OFFS_REG(dst);
+
+		if (disp <= SIMM_MAX && disp >= SIMM_MIN) {
+			if (disp) {
+				FAIL_IF(push_inst(compiler, ADDI | D(TMP_REG1) | A(dstw) | IMM(disp)));
+				dstw = TMP_REG1;
+			}
+		}
+		else {
+			FAIL_IF(load_immediate(compiler, TMP_REG3, disp));
+			FAIL_IF(push_inst(compiler, ADD | D(TMP_REG1) | A(dstw) | B(TMP_REG3)));
+			dstw = TMP_REG1;
+		}
 	}
 	else {
 		if ((dst & REG_MASK) && !dstw) {
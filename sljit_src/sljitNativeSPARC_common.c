@@ -512,7 +512,7 @@ static int getput_arg_fast(struct sljit_compiler *compiler, int flags, int reg,
 
 	if (!(flags & WRITE_BACK) || !(arg & REG_MASK)) {
 		if ((!(arg & OFFS_REG_MASK) && argw <= SIMM_MAX && argw >= SIMM_MIN)
-				|| ((arg & OFFS_REG_MASK) && (argw & 0x3) == 0)) {
+				|| ((arg & OFFS_REG_MASK) && argw == 0)) {
 			/* Works for both absoulte and relative addresses (immediate case). */
 			if (flags & ARG_TEST)
 				return 1;
@@ -535,7 +535,8 @@ static int can_cache(int arg, long argw, int next_arg, long next_argw)
 
 	/* Simple operation except for updates. */
 	if (arg & OFFS_REG_MASK) {
-		argw &= 0x3;
+		if (argw & ~0x3)
+			return 0;
 		SLJIT_ASSERT(argw);
 		next_argw &= 0x3;
 		if ((arg & OFFS_REG_MASK) == (next_arg & OFFS_REG_MASK) && argw == next_argw)
@@ -561,7 +562,25 @@ static int getput_arg(struct sljit_compiler *compiler, int flags, int reg, int a
 	}
 
 	base = arg & REG_MASK;
-	if (arg & OFFS_REG_MASK) {
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the sum of the
+		   shifted index and the displacement is computed into arg2. */
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if ((flags & LOAD_DATA) && ((flags & MEM_MASK) <= GPR_REG) && reg != base && reg != OFFS_REG(arg))
+			arg2 = reg;
+		else /* It must be a mov operation, so tmp1 must be free to use. */
+			arg2 = TMP_REG1;
+		if (argw & 0x3)
+			FAIL_IF(push_inst(compiler, SLL_W | D(arg2) | S1(OFFS_REG(arg)) | IMM_ARG | (argw & 0x3), DR(arg2)));
+		if (MEM2_DISP(argw) <= SIMM_MAX && MEM2_DISP(argw) >= SIMM_MIN)
+			FAIL_IF(push_inst(compiler, ADD | D(arg2) | S1((argw & 0x3) ? arg2 : OFFS_REG(arg)) | IMM(MEM2_DISP(argw)), DR(arg2)));
+		else {
+			FAIL_IF(load_immediate(compiler, TMP_REG3, MEM2_DISP(argw)));
+			FAIL_IF(push_inst(compiler, ADD | D(arg2) | S1((argw & 0x3) ? arg2 : OFFS_REG(arg)) | S2(TMP_REG3), DR(arg2)));
+		}
+	}
+	else if (arg & OFFS_REG_MASK) {
 		argw &= 0x3;
 		SLJIT_ASSERT(argw != 0);
 
@@ -805,8 +824,11 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 {
 	int flags = GET_FLAGS(op) ? SET_FLAGS : 0;
 
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -874,8 +896,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 {
 	int flags = GET_FLAGS(op) ? SET_FLAGS : 0;
 
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -1389,6 +1389,39 @@ static int getput_arg(struct sljit_compiler *compiler, int flags, int reg_ar, in
 
 	base = arg & REG_MASK;
 
+	if ((arg & OFFS_REG_MASK) && (argw & ~0x3)) {
+		/* [base + (index << shift) + displacement]: the address is computed into
+		   tmp_ar, or into the base register when it is updated. */
+		compiler->cache_arg = 0;
+		compiler->cache_argw = 0;
+		if ((flags & WRITE_BACK) && reg_ar == reg_map[base]) {
+			SLJIT_ASSERT(!(flags & LOAD_DATA) && reg_map[TMP_REG1] != reg_ar);
+			FAIL_IF(ADD(TMP_REG1_mapped, reg_ar, ZERO));
+			reg_ar = TMP_REG1_mapped;
+		}
+
+		if (argw & 0x3)
+			FAIL_IF(SHLI(TMP_REG3_mapped, reg_map[OFFS_REG(arg)], argw & 0x3));
+
+		if (flags & WRITE_BACK) {
+			FAIL_IF(ADD(reg_map[base], reg_map[base], reg_map[(argw & 0x3) ? TMP_REG3 : OFFS_REG(arg)]));
+			return getput_arg(compiler, flags, reg_ar, SLJIT_MEM1(base), MEM2_DISP(argw), 0, 0);
+		}
+
+		FAIL_IF(ADD(tmp_ar, reg_map[base], reg_map[(argw & 0x3) ? TMP_REG3 : OFFS_REG(arg)]));
+		argw = MEM2_DISP(argw);
+		if (argw <= SIMM_16BIT_MAX && argw >= SIMM_16BIT_MIN)
+			FAIL_IF(ADDLI(tmp_ar, tmp_ar, argw));
+		else {
+			FAIL_IF(load_immediate(compiler, TMP_REG3_mapped, argw));
+			FAIL_IF(ADD(tmp_ar, tmp_ar, TMP_REG3_mapped));
+		}
+
+		if (flags & LOAD_DATA)
+			return PB2(data_transfer_insts[flags & MEM_MASK], reg_ar, tmp_ar);
+		return PB2(data_transfer_insts[flags & MEM_MASK], tmp_ar, reg_ar);
+	}
+
 	if (arg & OFFS_REG_MASK) {
 		argw &= 0x3;
 
@@ -2216,8 +2249,11 @@ int sljit_emit_op0(struct sljit_compiler *compiler, int op) {
 
 int sljit_emit_op1(struct sljit_compiler *compiler, int op, int dst, long dstw, int src, long srcw)
 {
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
 	CHECK_ERROR();
 	check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw);
+	CHECK_BIT_OP(op, dst, dstw, src, srcw, SLJIT_IMM, 0);
+	SKIP_PREFETCH(op);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src, srcw);
 
@@ -2281,8 +2317,10 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op, int dst, long dstw,
 
 int sljit_emit_op2(struct sljit_compiler *compiler, int op, int dst, long dstw, int src1, long src1w, int src2, long src2w)
 {
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w);
+	CHECK_BIT_OP(op, dst, dstw, src1, src1w, src2, src2w);
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -2563,17 +2601,27 @@ struct sljit_const * sljit_emit_const(struct sljit_compiler *compiler, int dst,
 	return const_;
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE (4 * sizeof(sljit_ins))
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
 	sljit_ins *inst = (sljit_ins *)addr;
 
 	inst[0] = (inst[0] & ~(0xFFFFL << 43)) | (((new_addr >> 32) & 0xffff) << 43);
 	inst[1] = (inst[1] & ~(0xFFFFL << 43)) | (((new_addr >> 16) & 0xffff) << 43);
 	inst[2] = (inst[2] & ~(0xFFFFL << 43)) | ((new_addr & 0xffff) << 43);
-	SLJIT_CACHE_FLUSH(inst, inst + 3);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 3);
+	}
 }
 
-void sljit_set_const(unsigned long addr, long new_constant)
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
 {
 	sljit_ins *inst = (sljit_ins *)addr;
 
@@ -2581,5 +2629,12 @@ void sljit_set_const(unsigned long addr, long new_constant)
 	inst[1] = (inst[1] & ~(0xFFFFL << 43)) | (((new_constant >> 32) & 0xFFFFL) << 43);
 	inst[2] = (inst[2] & ~(0xFFFFL << 43)) | (((new_constant >> 16) & 0xFFFFL) << 43);
 	inst[3] = (inst[3] & ~(0xFFFFL << 43)) | ((new_constant & 0xFFFFL) << 43);
-	SLJIT_CACHE_FLUSH(inst, inst + 4);
+	if (flush) {
+		SLJIT_CACHE_FLUSH(inst, inst + 4);
+	}
+}
+
+void sljit_set_const(unsigned long addr, long new_constant)
+{
+	inline_set_const(addr, new_constant, 1);
 }
@@ -38,8 +38,15 @@ static int emit_do_imm(struct sljit_compiler *compiler, u_char opcode, long imm)
 	return SLJIT_SUCCESS;
 }
 
-static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type)
+static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type, long executable_offset)
 {
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+	if (jump->flags & SLJIT_REWRITABLE_JUMP) {
+		code_ptr = generate_patch_alignment(code_ptr, (type == SLJIT_JUMP || type >= SLJIT_FAST_CALL) ? 1 : 2, sizeof(long), executable_offset);
+		jump->addr = (unsigned long)code_ptr;
+	}
+#endif
+
 	if (type == SLJIT_JUMP) {
 		*code_ptr++ = JMP_i32;
 		jump->addr++;
@@ -57,7 +64,7 @@ static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr,
 	if (jump->flags & JUMP_LABEL)
 		jump->flags |= PATCH_MW;
 	else
-		*(long*)code_ptr = jump->u.target - (jump->addr + 4);
+		*(long*)code_ptr = jump->u.target - (jump->addr + executable_offset + 4);
 	code_ptr += 4;
 
 	return code_ptr;
@@ -216,6 +223,7 @@ int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long src
 
 	compiler->flags_saved = 0;
 	FAIL_IF(emit_mov_before_return(compiler, op, src, srcw));
+	FAIL_IF(emit_vzeroupper(compiler));
 
 	SLJIT_ASSERT(compiler->local_size > 0);
 	FAIL_IF(emit_cum_binary(compiler, ADD_r_rm, ADD_rm_r, ADD, ADD_EAX_i32,
@@ -281,6 +289,7 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	u_char *buf_ptr;
 	int flags = size & ~0xf;
 	int inst_size;
+	int shift = 0;
 
 	/* Both cannot be switched on. */
 	SLJIT_ASSERT((flags & (EX86_BIN_INS | EX86_SHIFT_INS)) != (EX86_BIN_INS | EX86_SHIFT_INS));
@@ -305,9 +314,14 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	/* Calculate size of b. */
 	inst_size += 1; /* mod r/m byte. */
 	if (b & SLJIT_MEM) {
+		if (b & OFFS_REG_MASK) {
+			shift = MEM2_SHIFT(immb);
+			immb = MEM2_DISP(immb);
+		}
+
 		if ((b & REG_MASK) == SLJIT_UNUSED)
 			inst_size += sizeof(long);
-		else if (immb != 0 && !(b & OFFS_REG_MASK)) {
+		else if (immb != 0) {
 			/* Immediate operand. */
 			if (immb <= 127 && immb >= -128)
 				inst_size += sizeof(s_char);
@@ -388,33 +402,27 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	if (!(b & SLJIT_MEM))
 		*buf_ptr++ |= MOD_REG + ((!(flags & EX86_SSE2_OP2)) ? reg_map[b] : b);
 	else if ((b & REG_MASK) != SLJIT_UNUSED) {
-		if ((b & OFFS_REG_MASK) == SLJIT_UNUSED || (b & OFFS_REG_MASK) == TO_OFFS_REG(SLJIT_SP)) {
-			if (immb != 0) {
-				if (immb <= 127 && immb >= -128)
-					*buf_ptr |= 0x40;
-				else
-					*buf_ptr |= 0x80;
-			}
-
-			if ((b & OFFS_REG_MASK) == SLJIT_UNUSED)
-				*buf_ptr++ |= reg_map[b & REG_MASK];
-			else {
-				*buf_ptr++ |= 0x04;
-				*buf_ptr++ = reg_map[b & REG_MASK] | (reg_map[OFFS_REG(b)] << 3);
-			}
-
-			if (immb != 0) {
-				if (immb <= 127 && immb >= -128)
-					*buf_ptr++ = immb; /* 8 bit displacement. */
-				else {
-					*(long*)buf_ptr = immb; /* 32 bit displacement. */
-					buf_ptr += sizeof(long);
-				}
-			}
+		if (immb != 0) {
+			if (immb <= 127 && immb >= -128)
+				*buf_ptr |= 0x40;
+			else
+				*buf_ptr |= 0x80;
 		}
+
+		if ((b & OFFS_REG_MASK) == SLJIT_UNUSED)
+			*buf_ptr++ |= reg_map[b & REG_MASK];
 		else {
 			*buf_ptr++ |= 0x04;
-			*buf_ptr++ = reg_map[b & REG_MASK] | (reg_map[OFFS_REG(b)] << 3) | (immb << 6);
+			*buf_ptr++ = reg_map[b & REG_MASK] | (reg_map[OFFS_REG(b)] << 3) | (shift << 6);
+		}
+
+		if (immb != 0) {
+			if (immb <= 127 && immb >= -128)
+				*buf_ptr++ = immb; /* 8 bit displacement. */
+			else {
+				*(long*)buf_ptr = immb; /* 32 bit displacement. */
+				buf_ptr += sizeof(long);
+			}
 		}
 	}
 	else {
@@ -39,8 +39,17 @@ static int emit_load_imm64(struct sljit_compiler *compiler, int reg, long imm)
 	return SLJIT_SUCCESS;
 }
 
-static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type)
+static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type, long executable_offset)
 {
+	int reg;
+
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+	if (jump->flags & SLJIT_REWRITABLE_JUMP)
+		code_ptr = generate_patch_alignment(code_ptr, (type < SLJIT_JUMP) ? 4 : 2, sizeof(long), executable_offset);
+#endif
+	/* Absolute address, no adjustment is needed. */
+	(void)executable_offset;
+
 	if (type < SLJIT_JUMP) {
 		/* Invert type. */
 		*code_ptr++ = get_jump_code(type ^ 0x1) - 0x10;
@@ -48,8 +57,12 @@ static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr,
 	}
 
 	SLJIT_COMPILE_ASSERT(reg_map[TMP_REG3] == 9, tmp3_is_9_first);
+	/* The sixth argument of SLJIT_CALL6 is passed in r9, but r11
+	   (SLJIT_R4) is already moved to r8 before the call. The scratch
+	   regs are not preserved by tail calls either. */
+	reg = (type == SLJIT_CALL6 || (jump->flags & IS_TAIL_CALL)) ? 3 : 1;
 	*code_ptr++ = REX_W | REX_B;
-	*code_ptr++ = MOV_r_i32 + 1;
+	*code_ptr++ = MOV_r_i32 + reg;
 	jump->addr = (unsigned long)code_ptr;
 
 	if (jump->flags & JUMP_LABEL)
@@ -60,14 +73,14 @@ static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr,
 	code_ptr += sizeof(long);
 	*code_ptr++ = REX_B;
 	*code_ptr++ = GROUP_FF;
-	*code_ptr++ = (type >= SLJIT_FAST_CALL) ? (MOD_REG | CALL_rm | 1) : (MOD_REG | JMP_rm | 1);
+	*code_ptr++ = (type >= SLJIT_FAST_CALL) ? (MOD_REG | CALL_rm | reg) : (MOD_REG | JMP_rm | reg);
 
 	return code_ptr;
 }
 
-static u_char* generate_fixed_jump(u_char *code_ptr, long addr, int type)
+static u_char* generate_fixed_jump(u_char *code_ptr, long addr, int type, long executable_offset)
 {
-	long delta = addr - ((long)code_ptr + 1 + sizeof(int));
+	long delta = addr - ((long)code_ptr + executable_offset + 1 + sizeof(int));
 
 	if (delta <= HALFWORD_MAX && delta >= HALFWORD_MIN) {
 		*code_ptr++ = (type == 2) ? CALL_i32 : JMP_i32;
@@ -87,11 +100,45 @@ static u_char* generate_fixed_jump(u_char *code_ptr, long addr, int type)
 	return code_ptr;
 }
 
+#ifdef _WIN64
+
+/* Stores or loads the callee saved xmm regs (xmm6 - xmm15), which are
+   kept at the top of the local area. */
+static int emit_saved_float_regs(struct sljit_compiler *compiler, int store)
+{
+	int i, tmp, offset;
+	u_char *inst;
+
+	offset = compiler->local_size;
+	compiler->mode32 = 1;
+
+	tmp = compiler->fsaveds < SLJIT_NUM_SAVED_FLOAT_REGS ? (SLJIT_FS0 + 1 - compiler->fsaveds) : SLJIT_FIRST_SAVED_FLOAT_REG;
+	for (i = SLJIT_FS0; i >= tmp; i--) {
+		offset -= 16;
+		inst = emit_x86_instruction(compiler, 2 | EX86_SSE2_OP1, i, 0, SLJIT_MEM1(SLJIT_SP), offset);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = store ? MOVUPS_xm_x : MOVUPS_x_xm;
+	}
+
+	for (i = compiler->fscratches; i >= SLJIT_FIRST_SAVED_FLOAT_REG; i--) {
+		offset -= 16;
+		inst = emit_x86_instruction(compiler, 2 | EX86_SSE2_OP1, i, 0, SLJIT_MEM1(SLJIT_SP), offset);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = store ? MOVUPS_xm_x : MOVUPS_x_xm;
+	}
+
+	return SLJIT_SUCCESS;
+}
+
+#endif
+
 int sljit_emit_enter(struct sljit_compiler *compiler,
 	int options, int args, int scratches, int saveds,
 	int fscratches, int fsaveds, int local_size)
 {
-	int i, tmp, size, saved_reg_size;
+	int i, tmp, size, saved_reg_size, float_args;
 	u_char *inst;
 
 	CHECK_ERROR();
@@ -99,6 +146,8 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 	set_emit_enter(compiler, options, args, scratches, saveds, fscratches, fsaveds, local_size);
 
 	compiler->flags_saved = 0;
+	float_args = GET_FLOAT_ARGS(args);
+	args = GET_WORD_ARGS(args);
 
 	/* Including the return address saved by the call instruction. */
 	saved_reg_size = GET_SAVED_REGS_SIZE(scratches, saveds, 1);
@@ -147,6 +196,21 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 			*inst++ = MOV_r_rm;
 			*inst++ = MOD_REG | (reg_lmap[SLJIT_S2] << 3) | 0x2 /* rdx */;
 		}
+		if (args > 3) {
+			*inst++ = REX_W | REX_R;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (reg_lmap[SLJIT_S3] << 3) | 0x1 /* rcx */;
+		}
+		if (args > 4) {
+			*inst++ = REX_W | REX_B;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (reg_lmap[SLJIT_S4] << 3) | 0x0 /* r8 */;
+		}
+		if (args > 5) {
+			*inst++ = REX_W | REX_R | REX_B;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (reg_lmap[SLJIT_S5] << 3) | 0x1 /* r9 */;
+		}
 #else
 		if (args > 0) {
 			*inst++ = REX_W;
@@ -166,6 +230,15 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 #endif
 	}
 
+	/* The double arguments are moved from xmm0 - xmm(n-1) to
+	   SLJIT_FR0 - SLJIT_FR(n-1), which are one reg higher. */
+	compiler->mode32 = 1;
+	for (i = float_args; i > 0; i--)
+		FAIL_IF(emit_sse2_load(compiler, 0, SLJIT_FR0 + i - 1, TMP_FREG + i - 1, 0));
+
+#ifdef _WIN64
+	local_size += GET_SAVED_FLOAT_REGS_SIZE(fscratches, fsaveds, 16);
+#endif
 	local_size = ((local_size + SLJIT_LOCALS_OFFSET + saved_reg_size + 15) & ~15) - saved_reg_size;
 	compiler->local_size = local_size;
 
@@ -224,14 +297,7 @@ int sljit_emit_enter(struct sljit_compiler *compiler,
 	}
 
 #ifdef _WIN64
-	/* Save xmm6 reg: movaps [rsp + 0x20], xmm6 */
-	if (fscratches >= 6 || fsaveds >= 1) {
-		inst = ensure_buf(compiler, 1 + 5);
-		FAIL_IF(!inst);
-		INC_SIZE(5);
-		*inst++ = GROUP_0F;
-		*(int*)inst = 0x20247429;
-	}
+	FAIL_IF(emit_saved_float_regs(compiler, 1));
 #endif
 
 	return SLJIT_SUCCESS;
@@ -249,30 +315,22 @@ int sljit_set_context(struct sljit_compiler *compiler,
 
 	/* Including the return address saved by the call instruction. */
 	saved_reg_size = GET_SAVED_REGS_SIZE(scratches, saveds, 1);
+#ifdef _WIN64
+	local_size += GET_SAVED_FLOAT_REGS_SIZE(fscratches, fsaveds, 16);
+#endif
 	compiler->local_size = ((local_size + SLJIT_LOCALS_OFFSET + saved_reg_size + 15) & ~15) - saved_reg_size;
 	return SLJIT_SUCCESS;
 }
 
-int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long srcw)
+/* Restores the saved regs and releases the stack frame. Used by
+   sljit_emit_return and tail calls. */
+static int emit_stack_frame_release(struct sljit_compiler *compiler)
 {
 	int i, tmp, size;
 	u_char *inst;
 
-	CHECK_ERROR();
-	CHECK(check_sljit_emit_return(compiler, op, src, srcw));
-
-	compiler->flags_saved = 0;
-	FAIL_IF(emit_mov_before_return(compiler, op, src, srcw));
-
 #ifdef _WIN64
-	/* Restore xmm6 reg: movaps xmm6, [rsp + 0x20] */
-	if (compiler->fscratches >= 6 || compiler->fsaveds >= 1) {
-		inst = ensure_buf(compiler, 1 + 5);
-		FAIL_IF(!inst);
-		INC_SIZE(5);
-		*inst++ = GROUP_0F;
-		*(int*)inst = 0x20247428;
-	}
+	FAIL_IF(emit_saved_float_regs(compiler, 0));
 #endif
 
 	SLJIT_ASSERT(compiler->local_size > 0);
@@ -316,6 +374,28 @@ int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long src
 			*inst++ = REX_B;
 		POP_REG(reg_lmap[i]);
 	}
+	return SLJIT_SUCCESS;
+}
+
+int sljit_emit_return(struct sljit_compiler *compiler, int op, int src, long srcw)
+{
+	u_char *inst;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_return(compiler, op, src, srcw));
+
+	compiler->flags_saved = 0;
+#ifndef _WIN64
+	if (op == SLJIT_DMOV) {
+		ADJUST_LOCAL_OFFSET(src, srcw);
+		compiler->mode32 = 1;
+		FAIL_IF(emit_sse2_load(compiler, 0, TMP_FREG, src, srcw));
+	}
+	else
+#endif
+		FAIL_IF(emit_mov_before_return(compiler, op, src, srcw));
+	FAIL_IF(emit_vzeroupper(compiler));
+	FAIL_IF(emit_stack_frame_release(compiler));
 
 	inst = ensure_buf(compiler, 1 + 1);
 	FAIL_IF(!inst);
@@ -354,6 +434,8 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	u_char rex = 0;
 	int flags = size & ~0xf;
 	int inst_size;
+	int shift = 0;
+	int mode32;
 
 	/* The immediate operand must be 32 bit. */
 	SLJIT_ASSERT(!(a & SLJIT_IMM) || compiler->mode32 || IS_HALFWORD(imma));
@@ -385,19 +467,36 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	/* Calculate size of b. */
 	inst_size += 1; /* mod r/m byte. */
 	if (b & SLJIT_MEM) {
-		if (!(b & OFFS_REG_MASK)) {
+		if (b & OFFS_REG_MASK) {
+			shift = MEM2_SHIFT(immb);
+			immb = MEM2_DISP(immb);
 			if (NOT_HALFWORD(immb)) {
+				/* TMP_REG3 = displacement + (index << shift), the base is added below. */
 				if (emit_load_imm64(compiler, TMP_REG3, immb))
 					return NULL;
+				mode32 = compiler->mode32;
+				compiler->mode32 = 0;
+				inst = emit_x86_instruction(compiler, 1, TMP_REG3, 0, SLJIT_MEM2(TMP_REG3, OFFS_REG(b)), shift);
+				compiler->mode32 = mode32;
+				if (!inst)
+					return NULL;
+				*inst = LEA_r_m;
+				b = (b & ~OFFS_REG_MASK) | TO_OFFS_REG(TMP_REG3);
+				shift = 0;
 				immb = 0;
-				if (b & REG_MASK)
-					b |= TO_OFFS_REG(TMP_REG3);
-				else
-					b |= TMP_REG3;
 			}
-			else if (reg_lmap[b & REG_MASK] == 4)
-				b |= TO_OFFS_REG(SLJIT_SP);
 		}
+		else if (NOT_HALFWORD(immb)) {
+			if (emit_load_imm64(compiler, TMP_REG3, immb))
+				return NULL;
+			immb = 0;
+			if (b & REG_MASK)
+				b |= TO_OFFS_REG(TMP_REG3);
+			else
+				b |= TMP_REG3;
+		}
+		else if (reg_lmap[b & REG_MASK] == 4)
+			b |= TO_OFFS_REG(SLJIT_SP);
 
 		if ((b & REG_MASK) == SLJIT_UNUSED)
 			inst_size += 1 + sizeof(int); /* SIB byte required to avoid RIP based addressing. */
@@ -405,7 +504,7 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 			if (reg_map[b & REG_MASK] >= 8)
 				rex |= REX_B;
 
-			if (immb != 0 && (!(b & OFFS_REG_MASK) || (b & OFFS_REG_MASK) == TO_OFFS_REG(SLJIT_SP))) {
+			if (immb != 0) {
 				/* Immediate operand. */
 				if (immb <= 127 && immb >= -128)
 					inst_size += sizeof(s_char);
@@ -422,7 +521,11 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 			}
 		}
 	}
-	else if (!(flags & EX86_SSE2_OP2) && reg_map[b] >= 8)
+	else if (!(flags & EX86_SSE2_OP2)) {
+		if (reg_map[b] >= 8)
+			rex |= REX_B;
+	}
+	else if (b >= 8)
 		rex |= REX_B;
 
 	if (a & SLJIT_IMM) {
@@ -449,7 +552,11 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	else {
 		SLJIT_ASSERT(!(flags & EX86_SHIFT_INS) || a == SLJIT_PREF_SHIFT_REG);
 		/* reg_map[SLJIT_PREF_SHIFT_REG] is less than 8. */
-		if (!(flags & EX86_SSE2_OP1) && reg_map[a] >= 8)
+		if (!(flags & EX86_SSE2_OP1)) {
+			if (reg_map[a] >= 8)
+				rex |= REX_R;
+		}
+		else if (a >= 8)
 			rex |= REX_R;
 	}
 
@@ -482,7 +589,7 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 		else if (!(flags & EX86_SSE2_OP1))
 			*buf_ptr = reg_lmap[a] << 3;
 		else
-			*buf_ptr = a << 3;
+			*buf_ptr = (a & 0x7) << 3;
 	}
 	else {
 		if (a & SLJIT_IMM) {
@@ -496,39 +603,29 @@ static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
 	}
 
 	if (!(b & SLJIT_MEM))
-		*buf_ptr++ |= MOD_REG + ((!(flags & EX86_SSE2_OP2)) ? reg_lmap[b] : b);
+		*buf_ptr++ |= MOD_REG + ((!(flags & EX86_SSE2_OP2)) ? reg_lmap[b] : (b & 0x7));
 	else if ((b & REG_MASK) != SLJIT_UNUSED) {
-		if ((b & OFFS_REG_MASK) == SLJIT_UNUSED || (b & OFFS_REG_MASK) == TO_OFFS_REG(SLJIT_SP)) {
-			if (immb != 0 || reg_lmap[b & REG_MASK] == 5) {
-				if (immb <= 127 && immb >= -128)
-					*buf_ptr |= 0x40;
-				else
-					*buf_ptr |= 0x80;
-			}
-
-			if ((b & OFFS_REG_MASK) == SLJIT_UNUSED)
-				*buf_ptr++ |= reg_lmap[b & REG_MASK];
-			else {
-				*buf_ptr++ |= 0x04;
-				*buf_ptr++ = reg_lmap[b & REG_MASK] | (reg_lmap[OFFS_REG(b)] << 3);
-			}
-
-			if (immb != 0 || reg_lmap[b & REG_MASK] == 5) {
-				if (immb <= 127 && immb >= -128)
-					*buf_ptr++ = immb; /* 8 bit displacement. */
-				else {
-					*(int*)buf_ptr = immb; /* 32 bit displacement. */
-					buf_ptr += sizeof(int);
-				}
-			}
+		if (immb != 0 || reg_lmap[b & REG_MASK] == 5) {
+			if (immb <= 127 && immb >= -128)
+				*buf_ptr |= 0x40;
+			else
+				*buf_ptr |= 0x80;
 		}
+
+		if ((b & OFFS_REG_MASK) == SLJIT_UNUSED)
+			*buf_ptr++ |= reg_lmap[b & REG_MASK];
 		else {
-			if (reg_lmap[b & REG_MASK] == 5)
-				*buf_ptr |= 0x40;
 			*buf_ptr++ |= 0x04;
-			*buf_ptr++ = reg_lmap[b & REG_MASK] | (reg_lmap[OFFS_REG(b)] << 3) | (immb << 6);
-			if (reg_lmap[b & REG_MASK] == 5)
-				*buf_ptr++ = 0;
+			*buf_ptr++ = reg_lmap[b & REG_MASK] | (reg_lmap[OFFS_REG(b)] << 3) | (shift << 6);
+		}
+
+		if (immb != 0 || reg_lmap[b & REG_MASK] == 5) {
+			if (immb <= 127 && immb >= -128)
+				*buf_ptr++ = immb; /* 8 bit displacement. */
+			else {
+				*(int*)buf_ptr = immb; /* 32 bit displacement. */
+				buf_ptr += sizeof(int);
+			}
 		}
 	}
 	else {
@@ -559,19 +656,48 @@ static __inline int call_with_args(struct sljit_compiler *compiler, int type)
 	u_char *inst;
 
 #ifndef _WIN64
-	SLJIT_COMPILE_ASSERT(reg_map[SLJIT_R1] == 6 && reg_map[SLJIT_R0] < 8 && reg_map[SLJIT_R2] < 8, args_regs);
+	int i, size, float_args = GET_FLOAT_ARGS(type);
 
-	inst = ensure_buf(compiler, 1 + ((type < SLJIT_CALL3) ? 3 : 6));
-	FAIL_IF(!inst);
-	INC_SIZE((type < SLJIT_CALL3) ? 3 : 6);
-	if (type >= SLJIT_CALL3) {
+	SLJIT_COMPILE_ASSERT(reg_map[SLJIT_R1] == 6 && reg_map[SLJIT_R0] < 8 && reg_map[SLJIT_R2] < 8
+		&& reg_map[SLJIT_R3] == 8 && reg_map[SLJIT_R4] == 11 && reg_map[SLJIT_R5] == 10, args_regs);
+
+	type &= 0xff;
+	if (type >= SLJIT_CALL1) {
+		/* A reg is always read before it is overwritten. R0 is moved
+		   first, so rax is free for the target of indirect calls. */
+		size = (type < SLJIT_CALL3) ? 3 : ((type - SLJIT_CALL1) * 3);
+		inst = ensure_buf(compiler, 1 + size);
+		FAIL_IF(!inst);
+		INC_SIZE(size);
 		*inst++ = REX_W;
 		*inst++ = MOV_r_rm;
-		*inst++ = MOD_REG | (0x2 /* rdx */ << 3) | reg_lmap[SLJIT_R2];
+		*inst++ = MOD_REG | (0x7 /* rdi */ << 3) | reg_lmap[SLJIT_R0];
+		if (type >= SLJIT_CALL3) {
+			*inst++ = REX_W;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (0x2 /* rdx */ << 3) | reg_lmap[SLJIT_R2];
+		}
+		if (type >= SLJIT_CALL4) {
+			*inst++ = REX_W | REX_B;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (0x1 /* rcx */ << 3) | reg_lmap[SLJIT_R3];
+		}
+		if (type >= SLJIT_CALL5) {
+			*inst++ = REX_W | REX_R | REX_B;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (0x0 /* r8 */ << 3) | reg_lmap[SLJIT_R4];
+		}
+		if (type >= SLJIT_CALL6) {
+			*inst++ = REX_W | REX_R | REX_B;
+			*inst++ = MOV_r_rm;
+			*inst++ = MOD_REG | (0x1 /* r9 */ << 3) | reg_lmap[SLJIT_R5];
+		}
 	}
-	*inst++ = REX_W;
-	*inst++ = MOV_r_rm;
-	*inst++ = MOD_REG | (0x7 /* rdi */ << 3) | reg_lmap[SLJIT_R0];
+
+	/* SLJIT_FR0 - SLJIT_FR(n-1) are moved to xmm0 - xmm(n-1). */
+	compiler->mode32 = 1;
+	for (i = 0; i < float_args; i++)
+		FAIL_IF(emit_sse2_load(compiler, 0, TMP_FREG + i, SLJIT_FR0 + i, 0));
 #else
 	SLJIT_COMPILE_ASSERT(reg_map[SLJIT_R1] == 2 && reg_map[SLJIT_R0] < 8 && reg_map[SLJIT_R2] < 8, args_regs);
 
@@ -162,7 +162,9 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
 #define AND_r_rm	0x23
 #define AND_rm_r	0x21
 #define ANDPD_x_xm	0x54
+#define BSF_r_rm	(/* GROUP_0F */ 0xbc)
 #define BSR_r_rm	(/* GROUP_0F */ 0xbd)
+#define BSWAP_r		(/* GROUP_0F */ 0xc8)
 #define CALL_i32	0xe8
 #define CALL_rm		(/* GROUP_FF */ 2 << 3)
 #define CDQ		0x99
@@ -171,6 +173,7 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
 #define CMP_EAX_i32	0x3d
 #define CMP_r_rm	0x3b
 #define CMP_rm_r	0x39
+#define CMPXCHG_rm_r	(/* GROUP_0F */ 0xb1)
 #define CVTPD2PS_x_xm	0x5a
 #define CVTSI2SD_x_rm	0x2a
 #define CVTTSD2SI_r_xm	0x2c
@@ -182,25 +185,34 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
 #define IMUL_r_rm	(/* GROUP_0F */ 0xaf)
 #define IMUL_r_rm_i8	0x6b
 #define IMUL_r_rm_i32	0x69
+#define JAE_i8		0x73
 #define JE_i8		0x74
 #define JNE_i8		0x75
 #define JMP_i8		0xeb
 #define JMP_i32		0xe9
 #define JMP_rm		(/* GROUP_FF */ 4 << 3)
 #define LEA_r_m		0x8d
+#define LOCK		0xf0
+#define LZCNT_r_rm	(/* GROUP_0F */ 0xbd)
+#define MFENCE		(/* GROUP_0F */ 0xae)
 #define MOV_r_rm	0x8b
 #define MOV_r_i32	0xb8
 #define MOV_rm_r	0x89
 #define MOV_rm_i32	0xc7
 #define MOV_rm8_i8	0xc6
 #define MOV_rm8_r8	0x88
+#define MOVAPS_x_xm	(/* GROUP_0F */ 0x28)
 #define MOVSD_x_xm	0x10
 #define MOVSD_xm_x	0x11
 #define MOVSXD_r_rm	0x63
+#define MOVUPS_x_xm	(/* GROUP_0F */ 0x10)
+#define MOVUPS_xm_x	(/* GROUP_0F */ 0x11)
 #define MOVSX_r_rm8	(/* GROUP_0F */ 0xbe)
 #define MOVSX_r_rm16	(/* GROUP_0F */ 0xbf)
 #define MOVZX_r_rm8	(/* GROUP_0F */ 0xb6)
 #define MOVZX_r_rm16	(/* GROUP_0F */ 0xb7)
+#define MOVBE_r_rm	(/* GROUP_0F 38 */ 0xf0)
+#define MOVBE_rm_r	(/* GROUP_0F 38 */ 0xf1)
 #define MUL		(/* GROUP_F7 */ 4 << 3)
 #define MULSD_x_xm	0x59
 #define NEG_rm		(/* GROUP_F7 */ 3 << 3)
@@ -213,13 +225,17 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
 #define OR_rm8_r8	0x08
 #define POP_r		0x58
 #define POP_rm		0x8f
+#define POPCNT_r_rm	(/* GROUP_0F */ 0xb8)
 #define POPF		0x9d
+#define PREFETCH	(/* GROUP_0F */ 0x18)
 #define PUSH_i32	0x68
 #define PUSH_r		0x50
 #define PUSH_rm		(/* GROUP_FF */ 6 << 3)
 #define PUSHF		0x9c
 #define RET_near	0xc3
 #define RET_i16		0xc2
+#define ROL		(/* SHIFT */ 0 << 3)
+#define ROR		(/* SHIFT */ 1 << 3)
 #define SBB		(/* BINARY */ 3 << 3)
 #define SBB_EAX_i32	0x1d
 #define SBB_r_rm	0x1b
@@ -234,9 +250,11 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
 #define SUBSD_x_xm	0x5c
 #define TEST_EAX_i32	0xa9
 #define TEST_rm_r	0x85
+#define TZCNT_r_rm	(/* GROUP_0F */ 0xbc)
 #define UCOMISD_x_xm	0x2e
 #define UNPCKLPD_x_xm	0x14
 #define XCHG_EAX_r	0x90
+#define XADD_rm_r	(/* GROUP_0F */ 0xc1)
 #define XCHG_r_rm	0x87
 #define XOR		(/* BINARY */ 6 << 3)
 #define XOR_EAX_i32	0x35
@@ -270,42 +288,40 @@ static const u_char reg_lmap[SLJIT_NUM_REGS + 5] = {
    if they detect the CPU features in the same time. */
 static int cpu_has_sse2 = -1;
 static int cpu_has_cmov = -1;
+static int cpu_has_avx2 = -1;
+static int cpu_has_lzcnt = -1;
+static int cpu_has_tzcnt = -1;
+static int cpu_has_popcnt = -1;
+static int cpu_has_bmi2 = -1;
+static int cpu_has_movbe = -1;
+static int cpu_tier = SLJIT_X86_TIER_NATIVE;
 
 #if defined(_MSC_VER) && _MSC_VER >= 1400
 #include <intrin.h>
 #endif
 
-static void get_cpu_features(void)
+/* Executes cpuid with eax = info[0] and ecx = info[2], and
+   stores eax, ebx, ecx and edx into info[0] ... info[3]. */
+static void execute_cpu_id(unsigned int info[4])
 {
-	unsigned int features;
-
 #if defined(_MSC_VER) && _MSC_VER >= 1400
 
-	int CPUInfo[4];
-	__cpuid(CPUInfo, 1);
-	features = (unsigned int)CPUInfo[3];
+	__cpuidex((int*)info, (int)info[0], (int)info[2]);
 
 #elif defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__SUNPRO_C)
 
 	/* AT&T syntax. */
 	__asm__ (
-		"movl $0x1, %%eax\n"
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-		/* On x86-32, there is no red zone, so this
-		   should work (no need for a local variable). */
-		"push %%ebx\n"
-#endif
+		/* The ebx register might be reserved for position
+		   independent code, so it is preserved in esi. */
+		"movl %%ebx, %%esi\n"
 		"cpuid\n"
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-		"pop %%ebx\n"
-#endif
-		"movl %%edx, %0\n"
-		: "=g" (features)
-		:
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-		: "%eax", "%ecx", "%edx"
+		"xchgl %%ebx, %%esi\n"
+		: "+a" (info[0]), "=S" (info[1]), "+c" (info[2]), "=d" (info[3])
 #else
-		: "%rax", "%rbx", "%rcx", "%rdx"
+		"cpuid\n"
+		: "+a" (info[0]), "=b" (info[1]), "+c" (info[2]), "=d" (info[3])
 #endif
 	);
 
@@ -313,12 +329,96 @@ static void get_cpu_features(void)
 
 	/* Intel syntax. */
 	__asm {
-		mov eax, 1
+		mov esi, info
+		mov eax, [esi]
+		mov ecx, [esi + 8]
 		cpuid
-		mov features, edx
+		mov [esi], eax
+		mov [esi + 4], ebx
+		mov [esi + 8], ecx
+		mov [esi + 12], edx
 	}
 
 #endif /* _MSC_VER && _MSC_VER >= 1400 */
+}
+
+/* Returns with the low 32 bit of the XCR0 register (xgetbv). */
+static unsigned int execute_get_xcr0(void)
+{
+	unsigned int xcr0;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1600
+
+	xcr0 = (unsigned int)_xgetbv(0);
+
+#elif defined(__GNUC__) || defined(__INTEL_COMPILER) || defined(__SUNPRO_C)
+
+	/* AT&T syntax. Old assemblers do not know the xgetbv mnemonic. */
+	__asm__ (
+		".byte 0x0f, 0x01, 0xd0\n"
+		: "=a" (xcr0)
+		: "c" (0)
+		: "%edx"
+	);
+
+#else /* _MSC_VER && _MSC_VER >= 1600 */
+
+	/* Intel syntax. */
+	__asm {
+		xor ecx, ecx
+		_emit 0x0f
+		_emit 0x01
+		_emit 0xd0
+		mov xcr0, eax
+	}
+
+#endif /* _MSC_VER && _MSC_VER >= 1600 */
+
+	return xcr0;
+}
+
+static void get_cpu_features(void)
+{
+	unsigned int info[4];
+	unsigned int max_leaf;
+	unsigned int features;
+	unsigned int features_ecx;
+	unsigned int leaf7_ebx = 0;
+	unsigned int ext_features_ecx = 0;
+	int has_avx;
+
+	info[0] = 0;
+	info[2] = 0;
+	execute_cpu_id(info);
+	max_leaf = info[0];
+
+	info[0] = 1;
+	info[2] = 0;
+	execute_cpu_id(info);
+	features = info[3];
+	features_ecx = info[2];
+
+	/* AVX needs the AVX and OSXSAVE bits, and the operating system
+	   must preserve the xmm and ymm registers (XCR0 bits 1 and 2). */
+	has_avx = (features_ecx & 0x18000000) == 0x18000000
+		&& (execute_get_xcr0() & 0x6) == 0x6;
+
+	if (max_leaf >= 7) {
+		info[0] = 7;
+		info[2] = 0;
+		execute_cpu_id(info);
+		leaf7_ebx = info[1];
+	}
+
+	info[0] = 0x80000000;
+	info[2] = 0;
+	execute_cpu_id(info);
+	if (info[0] >= 0x80000001) {
+		info[0] = 0x80000001;
+		info[2] = 0;
+		execute_cpu_id(info);
+		ext_features_ecx = info[2];
+	}
 
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
 	cpu_has_sse2 = (features >> 26) & 0x1;
@@ -326,8 +426,36 @@ static void get_cpu_features(void)
 	cpu_has_sse2 = true;
 #endif
 	cpu_has_cmov = (features >> 15) & 0x1;
+
+	if (cpu_tier == SLJIT_X86_TIER_BASELINE) {
+		cpu_has_avx2 = 0;
+		cpu_has_lzcnt = 0;
+		cpu_has_tzcnt = 0;
+		cpu_has_popcnt = 0;
+		cpu_has_bmi2 = 0;
+		cpu_has_movbe = 0;
+		return;
+	}
+
+	cpu_has_avx2 = has_avx && ((leaf7_ebx >> 5) & 0x1);
+	cpu_has_lzcnt = (ext_features_ecx >> 5) & 0x1;
+	cpu_has_tzcnt = (leaf7_ebx >> 3) & 0x1;
+	cpu_has_popcnt = (features_ecx >> 23) & 0x1;
+	cpu_has_bmi2 = (leaf7_ebx >> 8) & 0x1;
+	cpu_has_movbe = (features_ecx >> 22) & 0x1;
 }
 
+void sljit_x86_set_cpu_tier(int tier)
+{
+	SLJIT_ASSERT(tier == SLJIT_X86_TIER_BASELINE || tier == SLJIT_X86_TIER_NATIVE);
+	cpu_tier = tier;
+	get_cpu_features();
+}
+
+/* Record type of sljit_emit_switch. The other record types are:
+   0 - label, 1 - const, 2 / 3 - fixed call / jump, 4 + type - jump. */
+#define SWITCH_RECORD	0xff
+
 static u_char get_jump_code(int type)
 {
 	switch (type) {
@@ -384,27 +512,121 @@ static u_char get_jump_code(int type)
 	return 0;
 }
 
-static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type);
+static u_char* generate_far_jump_code(struct sljit_jump *jump, u_char *code_ptr, int type, long executable_offset);
+static __inline int emit_sse2_load(struct sljit_compiler *compiler,
+	int single, int dst, int src, long srcw);
+static u_char* emit_x86_instruction(struct sljit_compiler *compiler, int size,
+	int a, long imma, int b, long immb);
 
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-static u_char* generate_fixed_jump(u_char *code_ptr, long addr, int type);
+static u_char* generate_fixed_jump(u_char *code_ptr, long addr, int type, long executable_offset);
+#endif
+
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+
+/* Pads the code with nops until the executable address of the immediate
+   starting imm_offset bytes after code_ptr is aligned to imm_size. An
+   aligned immediate never crosses a cache line, so a single store
+   replaces it atomically. At most sizeof(long) - 1 bytes are emitted. */
+static u_char* generate_patch_alignment(u_char *code_ptr, long imm_offset, long imm_size, long executable_offset)
+{
+	long padding = -((long)code_ptr + executable_offset + imm_offset) & (imm_size - 1);
+
+	while (padding-- > 0)
+		*code_ptr++ = NOP;
+	return code_ptr;
+}
+
+/* Offset of the patched immediate in the code emitted by sljit_emit_const. */
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+#define CONST_IMM_OFFSET 1
+#else
+#define CONST_IMM_OFFSET 2
 #endif
 
-static u_char* generate_near_jump_code(struct sljit_jump *jump, u_char *code_ptr, u_char *code, int type)
+#endif /* SLJIT_ATOMIC_PATCHING */
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+
+/* Every rewritable jump has a stub after the code, which jumps to any
+   target through its target slot:
+
+     +0: offset of the rel32 field of the jump from the target slot
+     +10: jmp [rip + 0]
+     +16: target slot (returned by sljit_get_jump_addr)
+
+   The rel32 points to the target when it is in range, and to the stub
+   otherwise (see inline_set_jump_addr). */
+#define NEAR_JUMP_STUB_SIZE 24
+#define NEAR_JUMP_STUB_SLOT 16
+
+static unsigned long get_near_jump_stubs_size(struct sljit_compiler *compiler)
+{
+	struct sljit_jump *jump = compiler->jumps;
+	unsigned long size = 0;
+
+	while (jump) {
+		if (jump->flags & SLJIT_REWRITABLE_JUMP)
+			size += NEAR_JUMP_STUB_SIZE;
+		jump = jump->next;
+	}
+	return size ? size + sizeof(long) - 1 : 0;
+}
+
+/* The jump->addr is the writable address of the rel32 field. Returns with
+   the writable address of the target slot. */
+static unsigned long generate_near_jump_stub(struct sljit_jump *jump, u_char *stub, long executable_offset)
+{
+	unsigned long target = (jump->flags & JUMP_LABEL) ? jump->u.label->addr : jump->u.target;
+	unsigned long jump_addr = jump->addr + executable_offset;
+	unsigned long slot = (unsigned long)(stub + NEAR_JUMP_STUB_SLOT);
+	long disp;
+
+	*(int*)stub = (int)(jump->addr - slot);
+	memset(stub + sizeof(int), INT3, NEAR_JUMP_STUB_SLOT - 6 - sizeof(int));
+	stub[NEAR_JUMP_STUB_SLOT - 6] = GROUP_FF;
+	stub[NEAR_JUMP_STUB_SLOT - 5] = JMP_rm | 0x5 /* rip */;
+	*(int*)(stub + NEAR_JUMP_STUB_SLOT - 4) = 0;
+	*(unsigned long*)slot = target;
+
+	disp = (long)(target - (jump_addr + sizeof(int)));
+	if (disp > HALFWORD_MAX || disp < HALFWORD_MIN)
+		disp = (long)(slot + executable_offset - 6 - (jump_addr + sizeof(int)));
+	*(int*)jump->addr = (int)disp;
+	return slot;
+}
+
+#endif /* SLJIT_CONFIG_X86_64 && SLJIT_NEAR_REWRITABLE_JUMPS */
+
+static u_char* generate_near_jump_code(struct sljit_jump *jump, u_char *code_ptr, u_char *code, int type, long executable_offset)
 {
 	int short_jump;
 	unsigned long label_addr;
 
+	/* The distances are computed in the writable view. */
 	if (jump->flags & JUMP_LABEL)
 		label_addr = (unsigned long)(code + jump->u.label->size);
 	else
-		label_addr = jump->u.target;
-	short_jump = (long)(label_addr - (jump->addr + 2)) >= -128 && (long)(label_addr - (jump->addr + 2)) <= 127;
+		label_addr = jump->u.target - executable_offset;
 
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-	if ((long)(label_addr - (jump->addr + 1)) > HALFWORD_MAX || (long)(label_addr - (jump->addr + 1)) < HALFWORD_MIN)
-		return generate_far_jump_code(jump, code_ptr, type);
+	/* Rewritable jumps reach the far targets through their stub. */
+	if (!(jump->flags & SLJIT_REWRITABLE_JUMP)
+			&& ((long)(label_addr - (jump->addr + 1)) > HALFWORD_MAX || (long)(label_addr - (jump->addr + 1)) < HALFWORD_MIN))
+		return generate_far_jump_code(jump, code_ptr, type, executable_offset);
+#endif
+
+	/* The displacement of a rewritable jump must be able to hold any target. */
+	if (jump->flags & SLJIT_REWRITABLE_JUMP) {
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+		code_ptr = generate_patch_alignment(code_ptr, (type == SLJIT_JUMP || type >= SLJIT_FAST_CALL) ? 1 : 2, sizeof(int), executable_offset);
+		jump->addr = (unsigned long)code_ptr;
 #endif
+		short_jump = 0;
+	}
+	else
+		short_jump = (jump->flags & PATCH_MB) || ((long)(label_addr - (jump->addr + 2)) >= -128 && (long)(label_addr - (jump->addr + 2)) <= 127);
 
 	if (type == SLJIT_JUMP) {
 		if (short_jump)
@@ -443,6 +665,118 @@ static u_char* generate_near_jump_code(struct sljit_jump *jump, u_char *code_ptr
 	return code_ptr;
 }
 
+/* Upper bound of the size of the code generated for a jump, when it is
+   not known to be a short jump. Far jumps are only possible when the
+   target is an absolute address (or the jump is rewritable). */
+static long get_jump_size(struct sljit_jump *jump, int type)
+{
+	long size;
+
+	if (!(jump->flags & (JUMP_ADDR | SLJIT_REWRITABLE_JUMP)))
+		return (type >= SLJIT_JUMP) ? 5 : 6;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	size = (type >= SLJIT_JUMP) ? 5 : 6;
+#else
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	if (jump->flags & SLJIT_REWRITABLE_JUMP)
+		size = (type >= SLJIT_JUMP) ? 5 : 6;
+	else
+#endif
+	size = (type >= SLJIT_JUMP) ? (10 + 3) : (2 + 10 + 3);
+#endif
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+	if (jump->flags & SLJIT_REWRITABLE_JUMP)
+		size += sizeof(long) - 1;
+#endif
+	return size;
+}
+
+/* Branch relaxation: the first pass sized every jump for the worst case,
+   so forward jumps were never shortened. This pass walks the records,
+   computes an upper bound of the offset of every label and jump, and
+   marks the jumps whose displacement fits into a signed byte with
+   PATCH_MB. Forward jumps use the label offsets of the previous round,
+   which are never smaller than the current ones. Shortening a jump only
+   decreases distances, so the walk is repeated until no jump changes,
+   and the marked jumps stay in the rel8 range in the final code as well.
+   The label->size of every label and compiler->size are updated. */
+static void relax_jumps(struct sljit_compiler *compiler)
+{
+	struct sljit_memory_fragment *buf;
+	struct sljit_label *label;
+	struct sljit_jump *jump;
+	u_char *buf_ptr;
+	u_char *buf_end;
+	u_char len;
+	unsigned long offset;
+	long distance;
+	int type;
+	int changed;
+
+	if (!compiler->jumps)
+		return;
+
+	do {
+		changed = 0;
+		offset = 0;
+		buf = compiler->buf;
+		label = compiler->labels;
+		jump = compiler->jumps;
+		do {
+			buf_ptr = buf->memory;
+			buf_end = buf_ptr + buf->used_size;
+			while (buf_ptr < buf_end) {
+				len = *buf_ptr++;
+				if (len > 0) {
+					offset += len;
+					buf_ptr += len;
+					continue;
+				}
+
+				if (*buf_ptr == SWITCH_RECORD) {
+					buf_ptr++;
+					continue;
+				}
+
+				if (*buf_ptr >= 4) {
+					type = *buf_ptr - 4;
+					if ((jump->flags & (JUMP_LABEL | SLJIT_REWRITABLE_JUMP | PATCH_MB)) == JUMP_LABEL && type < SLJIT_FAST_CALL) {
+						distance = (long)(jump->u.label->size - (offset + 2));
+						if (distance >= -128 && distance <= 127) {
+							jump->flags |= PATCH_MB;
+							changed = 1;
+						}
+					}
+					offset += (jump->flags & PATCH_MB) ? 2 : get_jump_size(jump, type);
+					jump = jump->next;
+				}
+				else if (*buf_ptr == 0) {
+					label->size = offset;
+					label = label->next;
+				}
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+				else if (*buf_ptr == 1)
+					offset += sizeof(long) - 1;
+#endif
+				else if (*buf_ptr >= 2) {
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+					offset += 5;
+#else
+					offset += 10 + 3;
+#endif
+					buf_ptr += sizeof(long);
+				}
+				buf_ptr++;
+			}
+			buf = buf->next;
+		} while (buf);
+	} while (changed);
+
+	SLJIT_ASSERT(offset <= compiler->size);
+	compiler->size = offset;
+}
+
 void* sljit_generate_code(struct sljit_compiler *compiler)
 {
 	struct sljit_memory_fragment *buf;
@@ -455,20 +789,40 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	struct sljit_label *label;
 	struct sljit_jump *jump;
 	struct sljit_const *const_;
+	struct sljit_switch *switch_;
+	unsigned long *table;
+	unsigned long jump_addr;
+	unsigned long code_size;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	unsigned long stubs_size;
+#endif
+	long executable_offset;
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_generate_code(compiler));
 	reverse_buf(compiler);
-
-	/* Second code generation pass. */
-	code = (u_char*)SLJIT_MALLOC_EXEC(compiler->size);
+	relax_jumps(compiler);
+
+	/* Second code generation pass. The jump tables (and the
+	   stubs of the near rewritable jumps) follow the code. */
+	code_size = compiler->size + get_switch_tables_size(compiler);
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	stubs_size = get_near_jump_stubs_size(compiler);
+	code_size += stubs_size;
+#endif
+	code = (u_char*)SLJIT_MALLOC_EXEC(code_size);
 	PTR_FAIL_WITH_EXEC_IF(code);
 	buf = compiler->buf;
+	/* The code is written through code, but executed at code + executable_offset. */
+	executable_offset = SLJIT_EXEC_OFFSET(code);
 
 	code_ptr = code;
 	label = compiler->labels;
 	jump = compiler->jumps;
 	const_ = compiler->consts;
+	switch_ = compiler->switches;
 	do {
 		buf_ptr = buf->memory;
 		buf_end = buf_ptr + buf->used_size;
@@ -481,32 +835,47 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 				buf_ptr += len;
 			}
 			else {
-				if (*buf_ptr >= 4) {
+				if (*buf_ptr == SWITCH_RECORD) {
+					/* The record follows the instruction, which loads the table address. */
+					switch_->addr = (unsigned long)code_ptr;
+					switch_ = switch_->next;
+				}
+				else if (*buf_ptr >= 4) {
 					jump->addr = (unsigned long)code_ptr;
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+					code_ptr = generate_near_jump_code(jump, code_ptr, code, *buf_ptr - 4, executable_offset);
+#else
 					if (!(jump->flags & SLJIT_REWRITABLE_JUMP))
-						code_ptr = generate_near_jump_code(jump, code_ptr, code, *buf_ptr - 4);
+						code_ptr = generate_near_jump_code(jump, code_ptr, code, *buf_ptr - 4, executable_offset);
 					else
-						code_ptr = generate_far_jump_code(jump, code_ptr, *buf_ptr - 4);
+						code_ptr = generate_far_jump_code(jump, code_ptr, *buf_ptr - 4, executable_offset);
+#endif
 					jump = jump->next;
 				}
 				else if (*buf_ptr == 0) {
-					label->addr = (unsigned long)code_ptr;
+					label->addr = (unsigned long)code_ptr + executable_offset;
 					label->size = code_ptr - code;
 					label = label->next;
 				}
 				else if (*buf_ptr == 1) {
-					const_->addr = ((unsigned long)code_ptr) - sizeof(long);
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+					/* The record precedes the instruction. */
+					code_ptr = generate_patch_alignment(code_ptr, CONST_IMM_OFFSET, sizeof(long), executable_offset);
+					const_->addr = ((unsigned long)code_ptr) + executable_offset + CONST_IMM_OFFSET;
+#else
+					const_->addr = ((unsigned long)code_ptr) + executable_offset - sizeof(long);
+#endif
 					const_ = const_->next;
 				}
 				else {
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
 					*code_ptr++ = (*buf_ptr == 2) ? CALL_i32 : JMP_i32;
 					buf_ptr++;
-					*(long*)code_ptr = *(long*)buf_ptr - ((long)code_ptr + sizeof(long));
+					*(long*)code_ptr = *(long*)buf_ptr - ((long)code_ptr + executable_offset + sizeof(long));
 					code_ptr += sizeof(long);
 					buf_ptr += sizeof(long) - 1;
 #else
-					code_ptr = generate_fixed_jump(code_ptr, *(long*)(buf_ptr + 1), *buf_ptr);
+					code_ptr = generate_fixed_jump(code_ptr, *(long*)(buf_ptr + 1), *buf_ptr, executable_offset);
 					buf_ptr += sizeof(long);
 #endif
 				}
@@ -520,27 +889,59 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 	SLJIT_ASSERT(!label);
 	SLJIT_ASSERT(!jump);
 	SLJIT_ASSERT(!const_);
+	SLJIT_ASSERT(!switch_);
+
+	switch_ = compiler->switches;
+	while (switch_) {
+		table = write_switch_table(switch_, code_ptr);
+		jump_addr = (unsigned long)table + executable_offset;
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+		*(long*)(switch_->addr - sizeof(long)) = (long)jump_addr;
+#else
+		SLJIT_ASSERT((long)(jump_addr - (switch_->addr + executable_offset)) <= HALFWORD_MAX);
+		*(int*)(switch_->addr - sizeof(int)) = (int)(jump_addr - (switch_->addr + executable_offset));
+#endif
+		switch_->addr = jump_addr;
+		code_ptr = (u_char*)(table + switch_->count);
+		switch_ = switch_->next;
+	}
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	if (stubs_size > 0)
+		code_ptr = (u_char*)(((unsigned long)code_ptr + sizeof(long) - 1) & ~(sizeof(long) - 1));
+#endif
 
 	jump = compiler->jumps;
 	while (jump) {
+		/* The jump->addr is written through the writable view. */
+		jump_addr = jump->addr + executable_offset;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+		if (jump->flags & SLJIT_REWRITABLE_JUMP) {
+			jump_addr = generate_near_jump_stub(jump, code_ptr, executable_offset) + executable_offset;
+			code_ptr += NEAR_JUMP_STUB_SIZE;
+		} else
+#endif
 		if (jump->flags & PATCH_MB) {
-			SLJIT_ASSERT((long)(jump->u.label->addr - (jump->addr + sizeof(s_char))) >= -128 && (long)(jump->u.label->addr - (jump->addr + sizeof(s_char))) <= 127);
-			*(u_char*)jump->addr = (u_char)(jump->u.label->addr - (jump->addr + sizeof(s_char)));
+			SLJIT_ASSERT((long)(jump->u.label->addr - (jump_addr + sizeof(s_char))) >= -128 && (long)(jump->u.label->addr - (jump_addr + sizeof(s_char))) <= 127);
+			*(u_char*)jump->addr = (u_char)(jump->u.label->addr - (jump_addr + sizeof(s_char)));
 		} else if (jump->flags & PATCH_MW) {
 			if (jump->flags & JUMP_LABEL) {
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-				*(long*)jump->addr = (long)(jump->u.label->addr - (jump->addr + sizeof(long)));
+				*(long*)jump->addr = (long)(jump->u.label->addr - (jump_addr + sizeof(long)));
 #else
-				SLJIT_ASSERT((long)(jump->u.label->addr - (jump->addr + sizeof(int))) >= HALFWORD_MIN && (long)(jump->u.label->addr - (jump->addr + sizeof(int))) <= HALFWORD_MAX);
-				*(int*)jump->addr = (int)(jump->u.label->addr - (jump->addr + sizeof(int)));
+				SLJIT_ASSERT((long)(jump->u.label->addr - (jump_addr + sizeof(int))) >= HALFWORD_MIN && (long)(jump->u.label->addr - (jump_addr + sizeof(int))) <= HALFWORD_MAX);
+				*(int*)jump->addr = (int)(jump->u.label->addr - (jump_addr + sizeof(int)));
 #endif
 			}
 			else {
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-				*(long*)jump->addr = (long)(jump->u.target - (jump->addr + sizeof(long)));
+				*(long*)jump->addr = (long)(jump->u.target - (jump_addr + sizeof(long)));
 #else
-				SLJIT_ASSERT((long)(jump->u.target - (jump->addr + sizeof(int))) >= HALFWORD_MIN && (long)(jump->u.target - (jump->addr + sizeof(int))) <= HALFWORD_MAX);
-				*(int*)jump->addr = (int)(jump->u.target - (jump->addr + sizeof(int)));
+				SLJIT_ASSERT((long)(jump->u.target - (jump_addr + sizeof(int))) >= HALFWORD_MIN && (long)(jump->u.target - (jump_addr + sizeof(int))) <= HALFWORD_MAX);
+				*(int*)jump->addr = (int)(jump->u.target - (jump_addr + sizeof(int)));
 #endif
 			}
 		}
@@ -549,14 +950,15 @@ void* sljit_generate_code(struct sljit_compiler *compiler)
 			*(long*)jump->addr = jump->u.label->addr;
 #endif
 
+		jump->addr = jump_addr;
 		jump = jump->next;
 	}
 
 	/* Maybe we waste some space because of short jumps. */
-	SLJIT_ASSERT(code_ptr <= code + compiler->size);
+	SLJIT_ASSERT(code_ptr <= code + code_size);
 	compiler->error = SLJIT_ERR_COMPILED;
 	compiler->executable_size = code_ptr - code;
-	return code;
+	return (void*)(code + executable_offset);
 }
 
 /* --------------------------------------------------------------------- */
@@ -579,18 +981,76 @@ static int emit_mov(struct sljit_compiler *compiler,
 	int dst, long dstw,
 	int src, long srcw);
 
-static __inline int emit_save_flags(struct sljit_compiler *compiler)
+static int emit_mul(struct sljit_compiler *compiler,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w);
+
+static int emit_shift(struct sljit_compiler *compiler,
+	u_char mode,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w);
+
+/* Peephole optimizer (SLJIT_PEEPHOLE_OPTIMIZER): the last emitted
+   instruction is tracked, and the following instruction can replace
+   or remove it while no other record is emitted after it. */
+#define PEEPHOLE_STORE		1
+#define PEEPHOLE_SAVE_FLAGS	2
+#define PEEPHOLE_RESTORE_FLAGS	3
+
+#define PEEPHOLE_ENABLED(compiler) \
+	((compiler)->options & SLJIT_PEEPHOLE_OPTIMIZER)
+
+/* Only machine word sized moves are tracked. */
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+#define PEEPHOLE_WORD_MOV(compiler) 1
+#else
+#define PEEPHOLE_WORD_MOV(compiler) (!(compiler)->mode32)
+#endif
+
+static __inline int peephole_is_last(struct sljit_compiler *compiler, int type)
 {
-	u_char *inst;
+	return compiler->peephole_type == type
+		&& compiler->peephole_end == compiler->buf->memory + compiler->buf->used_size;
+}
+
+/* Must be called right after the record of the instruction is emitted. */
+static __inline void peephole_track(struct sljit_compiler *compiler, int type, int size)
+{
+	compiler->peephole_end = compiler->buf->memory + compiler->buf->used_size;
+	compiler->peephole_type = type;
+	compiler->peephole_size = size;
+}
+
+static __inline void peephole_remove_last(struct sljit_compiler *compiler)
+{
+	compiler->buf->used_size -= 1 + compiler->peephole_size;
+	compiler->size -= compiler->peephole_size;
+	compiler->peephole_type = 0;
+}
 
+/* Size of the code emitted by emit_save_flags and emit_restore_flags. */
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	inst = ensure_buf(compiler, 1 + 5);
-	FAIL_IF(!inst);
-	INC_SIZE(5);
+#define FLAGS_SAVE_SIZE 5
 #else
-	inst = ensure_buf(compiler, 1 + 6);
+#define FLAGS_SAVE_SIZE 6
+#endif
+
+static __inline int emit_save_flags(struct sljit_compiler *compiler)
+{
+	u_char *inst;
+
+	if (PEEPHOLE_ENABLED(compiler) && peephole_is_last(compiler, PEEPHOLE_RESTORE_FLAGS)) {
+		/* The flags were just loaded from the save slot, which is still valid. */
+		compiler->flags_saved = 1;
+		return SLJIT_SUCCESS;
+	}
+
+	inst = ensure_buf(compiler, 1 + FLAGS_SAVE_SIZE);
 	FAIL_IF(!inst);
-	INC_SIZE(6);
+	INC_SIZE(FLAGS_SAVE_SIZE);
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 	*inst++ = REX_W;
 #endif
 	*inst++ = LEA_r_m; /* lea esp/rsp, [esp/rsp + sizeof(long)] */
@@ -599,6 +1059,8 @@ static __inline int emit_save_flags(struct sljit_compiler *compiler)
 	*inst++ = (u_char)sizeof(long);
 	*inst++ = PUSHF;
 	compiler->flags_saved = 1;
+	if (PEEPHOLE_ENABLED(compiler))
+		peephole_track(compiler, PEEPHOLE_SAVE_FLAGS, FLAGS_SAVE_SIZE);
 	return SLJIT_SUCCESS;
 }
 
@@ -606,16 +1068,20 @@ static __inline int emit_restore_flags(struct sljit_compiler *compiler, int keep
 {
 	u_char *inst;
 
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	inst = ensure_buf(compiler, 1 + 5);
-	FAIL_IF(!inst);
-	INC_SIZE(5);
-	*inst++ = POPF;
-#else
-	inst = ensure_buf(compiler, 1 + 6);
+	if (PEEPHOLE_ENABLED(compiler) && peephole_is_last(compiler, PEEPHOLE_SAVE_FLAGS)) {
+		/* The flags are unchanged since they were saved. The
+		   save is only needed if the saved flags are kept. */
+		if (!keep_flags)
+			peephole_remove_last(compiler);
+		compiler->flags_saved = keep_flags;
+		return SLJIT_SUCCESS;
+	}
+
+	inst = ensure_buf(compiler, 1 + FLAGS_SAVE_SIZE);
 	FAIL_IF(!inst);
-	INC_SIZE(6);
+	INC_SIZE(FLAGS_SAVE_SIZE);
 	*inst++ = POPF;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 	*inst++ = REX_W;
 #endif
 	*inst++ = LEA_r_m; /* lea esp/rsp, [esp/rsp - sizeof(long)] */
@@ -623,6 +1089,26 @@ static __inline int emit_restore_flags(struct sljit_compiler *compiler, int keep
 	*inst++ = 0x24;
 	*inst++ = (u_char)-(s_char)sizeof(long);
 	compiler->flags_saved = keep_flags;
+	if (PEEPHOLE_ENABLED(compiler))
+		peephole_track(compiler, PEEPHOLE_RESTORE_FLAGS, FLAGS_SAVE_SIZE);
+	return SLJIT_SUCCESS;
+}
+
+/* Clears the upper halves of the ymm registers, which avoids the
+   penalty of executing SSE code after 256 bit AVX instructions. */
+static __inline int emit_vzeroupper(struct sljit_compiler *compiler)
+{
+	u_char *inst;
+
+	if (!compiler->ymm_used)
+		return SLJIT_SUCCESS;
+
+	inst = ensure_buf(compiler, 1 + 3);
+	FAIL_IF(!inst);
+	INC_SIZE(3);
+	*inst++ = 0xc5;
+	*inst++ = 0xf8;
+	*inst = 0x77;
 	return SLJIT_SUCCESS;
 }
 
@@ -654,6 +1140,7 @@ static int emit_mov(struct sljit_compiler *compiler,
 	int src, long srcw)
 {
 	u_char* inst;
+	unsigned long size;
 
 	if (dst == SLJIT_UNUSED) {
 		/* No destination, doesn't need to setup flags. */
@@ -665,9 +1152,24 @@ static int emit_mov(struct sljit_compiler *compiler,
 		return SLJIT_SUCCESS;
 	}
 	if (FAST_IS_REG(src)) {
+		if (!PEEPHOLE_ENABLED(compiler) || !PEEPHOLE_WORD_MOV(compiler)) {
+			inst = emit_x86_instruction(compiler, 1, src, 0, dst, dstw);
+			FAIL_IF(!inst);
+			*inst = MOV_rm_r;
+			return SLJIT_SUCCESS;
+		}
+		/* Moving a register to itself. */
+		if (dst == src)
+			return SLJIT_SUCCESS;
+		size = compiler->size;
 		inst = emit_x86_instruction(compiler, 1, src, 0, dst, dstw);
 		FAIL_IF(!inst);
 		*inst = MOV_rm_r;
+		if (dst == SLJIT_MEM1(SLJIT_SP)) {
+			peephole_track(compiler, PEEPHOLE_STORE, (int)(compiler->size - size));
+			compiler->peephole_reg = src;
+			compiler->peephole_offset = dstw;
+		}
 		return SLJIT_SUCCESS;
 	}
 	if (src & SLJIT_IMM) {
@@ -698,6 +1200,14 @@ static int emit_mov(struct sljit_compiler *compiler,
 		return SLJIT_SUCCESS;
 	}
 	if (FAST_IS_REG(dst)) {
+		if (PEEPHOLE_ENABLED(compiler) && src == SLJIT_MEM1(SLJIT_SP) && srcw == compiler->peephole_offset
+				&& PEEPHOLE_WORD_MOV(compiler) && peephole_is_last(compiler, PEEPHOLE_STORE)) {
+			/* Reload of the value which has just been stored. */
+			if (dst == compiler->peephole_reg)
+				return SLJIT_SUCCESS;
+			src = compiler->peephole_reg;
+			srcw = 0;
+		}
 		inst = emit_x86_instruction(compiler, 1, dst, 0, src, srcw);
 		FAIL_IF(!inst);
 		*inst = MOV_r_rm;
@@ -852,6 +1362,29 @@ int sljit_emit_op0(struct sljit_compiler *compiler, int op)
 	return SLJIT_SUCCESS;
 }
 
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+
+static int emit_mul_high(struct sljit_compiler *compiler, int is_signed, long magic)
+{
+	u_char *inst;
+
+	/* The product is computed into rdx:rax, and rdx is TMP_REG1. */
+	SLJIT_COMPILE_ASSERT(reg_map[SLJIT_R0] == 0 && reg_map[TMP_REG1] == 2, invalid_reg_assignment_for_mul_high);
+
+	compiler->flags_saved = 0;
+	compiler->mode32 = 0;
+	EMIT_MOV(compiler, TMP_REG3, 0, SLJIT_R0, 0);
+	FAIL_IF(emit_load_imm64(compiler, SLJIT_R0, magic));
+	inst = emit_x86_instruction(compiler, 1, 0, 0, TMP_REG2, 0);
+	FAIL_IF(!inst);
+	*inst++ = GROUP_F7;
+	*inst |= is_signed ? IMUL : MUL;
+	EMIT_MOV(compiler, SLJIT_R0, 0, TMP_REG3, 0);
+	return SLJIT_SUCCESS;
+}
+
+#endif
+
 #define ENCODE_PREFIX(prefix) \
 	do { \
 		inst = ensure_buf(compiler, 1 + 1); \
@@ -1166,6 +1699,21 @@ static int emit_clz(struct sljit_compiler *compiler, int op_flags,
 		srcw = 0;
 	}
 
+	if (cpu_has_lzcnt == -1)
+		get_cpu_features();
+
+	if (cpu_has_lzcnt) {
+		/* The zero flag is set when the result is zero (like xor below). */
+		dst_r = FAST_IS_REG(dst) ? dst : TMP_REG1;
+		inst = emit_x86_instruction(compiler, 2 | EX86_PREF_F3, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = LZCNT_r_rm;
+		if (dst_r == TMP_REG1)
+			return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+		return SLJIT_SUCCESS;
+	}
+
 	inst = emit_x86_instruction(compiler, 2, TMP_REG1, 0, src, srcw);
 	FAIL_IF(!inst);
 	*inst++ = GROUP_0F;
@@ -1244,42 +1792,327 @@ static int emit_clz(struct sljit_compiler *compiler, int op_flags,
 	return SLJIT_SUCCESS;
 }
 
-int sljit_emit_op1(struct sljit_compiler *compiler, int op,
+
+static int emit_ctz(struct sljit_compiler *compiler, int op_flags,
 	int dst, long dstw,
 	int src, long srcw)
 {
 	u_char* inst;
-	int update = 0;
-	int op_flags = GET_ALL_FLAGS(op);
-#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	int dst_is_ereg = 0;
-	int src_is_ereg = 0;
-#else
-#	define src_is_ereg 0
+	int dst_r;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	int size;
 #endif
 
-	CHECK_ERROR();
-	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
-	ADJUST_LOCAL_OFFSET(dst, dstw);
-	ADJUST_LOCAL_OFFSET(src, srcw);
+	if (src & SLJIT_IMM) {
+		EMIT_MOV(compiler, TMP_REG1, 0, SLJIT_IMM, srcw);
+		src = TMP_REG1;
+		srcw = 0;
+	}
 
-	CHECK_EXTRA_REGS(dst, dstw, dst_is_ereg = 1);
-	CHECK_EXTRA_REGS(src, srcw, src_is_ereg = 1);
-#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-	compiler->mode32 = op_flags & SLJIT_INT_OP;
-#endif
+	if (cpu_has_tzcnt == -1)
+		get_cpu_features();
 
-	op = GET_OPCODE(op);
-	if (op >= SLJIT_MOV && op <= SLJIT_MOVU_P) {
-#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-		compiler->mode32 = 0;
-#endif
+	dst_r = (FAST_IS_REG(dst) && dst != SLJIT_UNUSED) ? dst : TMP_REG1;
 
-		if (op_flags & SLJIT_INT_OP) {
-			if (FAST_IS_REG(src) && src == dst) {
-				if (!TYPE_CAST_NEEDED(op))
-					return SLJIT_SUCCESS;
-			}
+	if (cpu_has_tzcnt) {
+		/* The zero flag is set when the result is zero. */
+		inst = emit_x86_instruction(compiler, 2 | EX86_PREF_F3, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = TZCNT_r_rm;
+	}
+	else {
+		inst = emit_x86_instruction(compiler, 2, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = BSF_r_rm;
+
+		/* The result is the bit length if src is zero. */
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+		inst = ensure_buf(compiler, 1 + 7);
+		FAIL_IF(!inst);
+		INC_SIZE(7);
+
+		*inst++ = JNE_i8;
+		*inst++ = 5;
+		*inst++ = MOV_r_i32 + reg_map[dst_r];
+		*(int*)inst = 32;
+#else
+		size = (reg_map[dst_r] >= 8) ? 8 : 7;
+		inst = ensure_buf(compiler, 1 + size);
+		FAIL_IF(!inst);
+		INC_SIZE(size);
+
+		*inst++ = JNE_i8;
+		*inst++ = size - 2;
+		if (reg_map[dst_r] >= 8)
+			*inst++ = REX_B;
+		*inst++ = MOV_r_i32 + reg_lmap[dst_r];
+		*(int*)inst = !(op_flags & SLJIT_INT_OP) ? 64 : 32;
+#endif
+
+		if (op_flags & SLJIT_SET_E) {
+			inst = emit_x86_instruction(compiler, 1, dst_r, 0, dst_r, 0);
+			FAIL_IF(!inst);
+			*inst = TEST_rm_r;
+		}
+	}
+
+	if (dst & SLJIT_MEM)
+		return emit_mov(compiler, dst, dstw, dst_r, 0);
+	return SLJIT_SUCCESS;
+}
+
+static int emit_popcnt(struct sljit_compiler *compiler, int op_flags,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	u_char* inst;
+	int dst_r;
+	int tmp;
+	long tmpw;
+	unsigned long mask = ~0ul;
+
+	if (src & SLJIT_IMM) {
+		EMIT_MOV(compiler, TMP_REG1, 0, SLJIT_IMM, srcw);
+		src = TMP_REG1;
+		srcw = 0;
+	}
+
+	if (cpu_has_popcnt == -1)
+		get_cpu_features();
+
+	if (cpu_has_popcnt) {
+		/* The zero flag is set when the result is zero. */
+		dst_r = (FAST_IS_REG(dst) && dst != SLJIT_UNUSED) ? dst : TMP_REG1;
+		inst = emit_x86_instruction(compiler, 2 | EX86_PREF_F3, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = POPCNT_r_rm;
+
+		if (dst & SLJIT_MEM)
+			return emit_mov(compiler, dst, dstw, dst_r, 0);
+		return SLJIT_SUCCESS;
+	}
+
+	/* Counting the bits of each 2, 4 and 8 bit groups in parallel. */
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	/* [esp+0] contains the flags. */
+	tmp = SLJIT_MEM1(SLJIT_SP);
+	tmpw = sizeof(long);
+#else
+	tmp = TMP_REG3;
+	tmpw = 0;
+	if (op_flags & SLJIT_INT_OP)
+		mask = 0xffffffff;
+#endif
+
+	EMIT_MOV(compiler, TMP_REG1, 0, src, srcw);
+	EMIT_MOV(compiler, tmp, tmpw, TMP_REG1, 0);
+	FAIL_IF(emit_shift(compiler, SHR, tmp, tmpw, tmp, tmpw, SLJIT_IMM, 1));
+	FAIL_IF(emit_cum_binary(compiler, AND_r_rm, AND_rm_r, AND, AND_EAX_i32,
+		tmp, tmpw, tmp, tmpw, SLJIT_IMM, (long)(mask / 3)));
+	FAIL_IF(emit_non_cum_binary(compiler, SUB_r_rm, SUB_rm_r, SUB, SUB_EAX_i32,
+		TMP_REG1, 0, TMP_REG1, 0, tmp, tmpw));
+
+	EMIT_MOV(compiler, tmp, tmpw, TMP_REG1, 0);
+	FAIL_IF(emit_shift(compiler, SHR, tmp, tmpw, tmp, tmpw, SLJIT_IMM, 2));
+	FAIL_IF(emit_cum_binary(compiler, AND_r_rm, AND_rm_r, AND, AND_EAX_i32,
+		tmp, tmpw, tmp, tmpw, SLJIT_IMM, (long)(mask / 15 * 3)));
+	FAIL_IF(emit_cum_binary(compiler, AND_r_rm, AND_rm_r, AND, AND_EAX_i32,
+		TMP_REG1, 0, TMP_REG1, 0, SLJIT_IMM, (long)(mask / 15 * 3)));
+	FAIL_IF(emit_cum_binary(compiler, ADD_r_rm, ADD_rm_r, ADD, ADD_EAX_i32,
+		TMP_REG1, 0, TMP_REG1, 0, tmp, tmpw));
+
+	EMIT_MOV(compiler, tmp, tmpw, TMP_REG1, 0);
+	FAIL_IF(emit_shift(compiler, SHR, tmp, tmpw, tmp, tmpw, SLJIT_IMM, 4));
+	FAIL_IF(emit_cum_binary(compiler, ADD_r_rm, ADD_rm_r, ADD, ADD_EAX_i32,
+		TMP_REG1, 0, TMP_REG1, 0, tmp, tmpw));
+	FAIL_IF(emit_cum_binary(compiler, AND_r_rm, AND_rm_r, AND, AND_EAX_i32,
+		TMP_REG1, 0, TMP_REG1, 0, SLJIT_IMM, (long)(mask / 255 * 15)));
+
+	/* The sum of the bytes is moved to the highest byte. The
+	   zero flag is set by the final shift. */
+	FAIL_IF(emit_mul(compiler, TMP_REG1, 0, TMP_REG1, 0, SLJIT_IMM, (long)(mask / 255)));
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	FAIL_IF(emit_shift(compiler, SHR, TMP_REG1, 0, TMP_REG1, 0, SLJIT_IMM, 24));
+#else
+	FAIL_IF(emit_shift(compiler, SHR, TMP_REG1, 0, TMP_REG1, 0, SLJIT_IMM, !(op_flags & SLJIT_INT_OP) ? 56 : 24));
+#endif
+
+	if (dst != SLJIT_UNUSED)
+		return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
+static int emit_bswap(struct sljit_compiler *compiler,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	u_char* inst;
+	int dst_r;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	int size;
+#endif
+
+	if (dst == SLJIT_UNUSED && !(src & SLJIT_MEM))
+		return SLJIT_SUCCESS;
+
+	if (cpu_has_movbe == -1)
+		get_cpu_features();
+
+	dst_r = (FAST_IS_REG(dst) && dst != SLJIT_UNUSED) ? dst : TMP_REG1;
+
+	if (cpu_has_movbe && (src & SLJIT_MEM)) {
+		/* Loads and swaps with one instruction. */
+		inst = emit_x86_instruction(compiler, 3, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst++ = 0x38;
+		*inst = MOVBE_r_rm;
+	}
+	else if (cpu_has_movbe && (dst & SLJIT_MEM) && FAST_IS_REG(src)) {
+		inst = emit_x86_instruction(compiler, 3, src, 0, dst, dstw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst++ = 0x38;
+		*inst = MOVBE_rm_r;
+		return SLJIT_SUCCESS;
+	}
+	else {
+		if (src != dst_r)
+			EMIT_MOV(compiler, dst_r, 0, src, srcw);
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+		inst = ensure_buf(compiler, 1 + 2);
+		FAIL_IF(!inst);
+		INC_SIZE(2);
+		*inst++ = GROUP_0F;
+		*inst = BSWAP_r + reg_map[dst_r];
+#else
+		size = (!compiler->mode32 || reg_map[dst_r] >= 8) ? 3 : 2;
+		inst = ensure_buf(compiler, 1 + size);
+		FAIL_IF(!inst);
+		INC_SIZE(size);
+		if (size == 3)
+			*inst++ = (!compiler->mode32 ? REX_W : REX) | ((reg_map[dst_r] >= 8) ? REX_B : 0);
+		*inst++ = GROUP_0F;
+		*inst = BSWAP_r + reg_lmap[dst_r];
+#endif
+	}
+
+	if (dst & SLJIT_MEM)
+		return emit_mov(compiler, dst, dstw, dst_r, 0);
+	return SLJIT_SUCCESS;
+}
+
+static int emit_bswap16(struct sljit_compiler *compiler,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	u_char* inst;
+	int dst_r;
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	int mode32 = compiler->mode32;
+#endif
+
+	if (dst == SLJIT_UNUSED && !(src & SLJIT_MEM))
+		return SLJIT_SUCCESS;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 1;
+#endif
+
+	dst_r = (FAST_IS_REG(dst) && dst != SLJIT_UNUSED) ? dst : TMP_REG1;
+
+	if (src & SLJIT_IMM)
+		FAIL_IF(emit_mov(compiler, dst_r, 0, SLJIT_IMM, ((srcw & 0xff) << 8) | ((srcw >> 8) & 0xff)));
+	else {
+		inst = emit_x86_instruction(compiler, 2, dst_r, 0, src, srcw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = MOVZX_r_rm16;
+
+		/* rol dst_r16, 8 */
+		inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS | EX86_PREF_66, SLJIT_IMM, 8, dst_r, 0);
+		FAIL_IF(!inst);
+		*inst |= ROL;
+	}
+
+	if (dst & SLJIT_MEM) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = mode32;
+#endif
+		return emit_mov(compiler, dst, dstw, dst_r, 0);
+	}
+	return SLJIT_SUCCESS;
+}
+
+static int emit_prefetch(struct sljit_compiler *compiler, int op,
+	int src, long srcw)
+{
+	u_char* inst;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (cpu_has_sse2 == -1)
+		get_cpu_features();
+	/* The prefetch instructions are part of SSE. */
+	if (!cpu_has_sse2)
+		return SLJIT_SUCCESS;
+#endif
+
+	inst = emit_x86_instruction(compiler, 2 | EX86_NO_REXW, 0, 0, src, srcw);
+	FAIL_IF(!inst);
+	*inst++ = GROUP_0F;
+	*inst++ = PREFETCH;
+
+	/* prefetcht0, prefetcht1, prefetcht2 or prefetchnta. */
+	if (op == SLJIT_PREFETCH_L1)
+		*inst |= (1 << 3);
+	else if (op == SLJIT_PREFETCH_L2)
+		*inst |= (2 << 3);
+	else if (op == SLJIT_PREFETCH_L3)
+		*inst |= (3 << 3);
+	return SLJIT_SUCCESS;
+}
+
+int sljit_emit_op1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	u_char* inst;
+	int update = 0;
+	int op_flags = GET_ALL_FLAGS(op);
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	int dst_is_ereg = 0;
+	int src_is_ereg = 0;
+#else
+#	define src_is_ereg 0
+#endif
+
+	IR_RECORD_OP1(op, dst, dstw, src, srcw);
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_op1(compiler, op, dst, dstw, src, srcw));
+	ADJUST_LOCAL_OFFSET(dst, dstw);
+	ADJUST_LOCAL_OFFSET(src, srcw);
+
+	CHECK_EXTRA_REGS(dst, dstw, dst_is_ereg = 1);
+	CHECK_EXTRA_REGS(src, srcw, src_is_ereg = 1);
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = op_flags & SLJIT_INT_OP;
+#endif
+
+	op = GET_OPCODE(op);
+	if (op >= SLJIT_MOV && op <= SLJIT_MOVU_P) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 0;
+#endif
+
+		if (op_flags & SLJIT_INT_OP) {
+			if (FAST_IS_REG(src) && src == dst) {
+				if (!TYPE_CAST_NEEDED(op))
+					return SLJIT_SUCCESS;
+			}
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 			if (op == SLJIT_MOV_SI && (src & SLJIT_MEM))
 				op = SLJIT_MOV_UI;
@@ -1404,6 +2237,31 @@ int sljit_emit_op1(struct sljit_compiler *compiler, int op,
 		if (op_flags & SLJIT_KEEP_FLAGS && !compiler->flags_saved)
 			FAIL_IF(emit_save_flags(compiler));
 		return emit_clz(compiler, op_flags, dst, dstw, src, srcw);
+
+	case SLJIT_CTZ:
+		if (op_flags & SLJIT_KEEP_FLAGS && !compiler->flags_saved)
+			FAIL_IF(emit_save_flags(compiler));
+		return emit_ctz(compiler, op_flags, dst, dstw, src, srcw);
+
+	case SLJIT_POPCNT:
+		if (op_flags & SLJIT_KEEP_FLAGS && !compiler->flags_saved)
+			FAIL_IF(emit_save_flags(compiler));
+		return emit_popcnt(compiler, op_flags, dst, dstw, src, srcw);
+
+	case SLJIT_BSWAP:
+		/* The flags are not modified. */
+		return emit_bswap(compiler, dst, dstw, src, srcw);
+
+	case SLJIT_BSWAP16:
+		if (op_flags & SLJIT_KEEP_FLAGS && !compiler->flags_saved)
+			FAIL_IF(emit_save_flags(compiler));
+		return emit_bswap16(compiler, dst, dstw, src, srcw);
+
+	case SLJIT_PREFETCH_L1:
+	case SLJIT_PREFETCH_L2:
+	case SLJIT_PREFETCH_L3:
+	case SLJIT_PREFETCH_ONCE:
+		return emit_prefetch(compiler, op, src, srcw);
 	}
 
 	return SLJIT_SUCCESS;
@@ -1771,6 +2629,93 @@ static int emit_mul(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
+/* A multiplication by a constant is replaced by SHL, NEG and LEA
+   instructions if their total latency is lower than the latency of
+   IMUL (3 cycles). LEA with a scaled index register has a latency of
+   2 cycles on recent CPUs, so it computes a single factor of 3, 5 or 9.
+   Returns SLJIT_ERR_UNSUPPORTED if the constant has no such form. */
+static int emit_mul_imm(struct sljit_compiler *compiler,
+	int dst, long dstw,
+	int src, long srcw,
+	long imm)
+{
+	u_char* inst;
+	unsigned long value;
+	int dst_r, src_r;
+	int shift = 0, negate = 0, lea_shift = 0;
+
+	if (dst == SLJIT_UNUSED)
+		return SLJIT_ERR_UNSUPPORTED;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	if (compiler->mode32)
+		imm = (int)imm;
+#endif
+
+	if (imm == 0)
+		return emit_mov(compiler, dst, dstw, SLJIT_IMM, 0);
+	if (imm == 1)
+		return emit_mov(compiler, dst, dstw, src, srcw);
+
+	value = (unsigned long)imm;
+	if (imm < 0) {
+		negate = 1;
+		value = -value;
+	}
+
+	while (!(value & 0x1)) {
+		value >>= 1;
+		shift++;
+	}
+
+	if (value == 3)
+		lea_shift = 1;
+	else if (value == 5)
+		lea_shift = 2;
+	else if (value == 9)
+		lea_shift = 3;
+	else if (value != 1)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	if ((lea_shift ? 2 : 0) + (shift > 0) + negate > 2)
+		return SLJIT_ERR_UNSUPPORTED;
+
+	dst_r = FAST_IS_REG(dst) ? dst : TMP_REG1;
+
+	/* SLJIT_SP cannot be an index register. */
+	if (FAST_IS_REG(src) && src != SLJIT_SP)
+		src_r = src;
+	else {
+		EMIT_MOV(compiler, dst_r, 0, src, srcw);
+		src_r = dst_r;
+	}
+
+	if (lea_shift) {
+		inst = emit_x86_instruction(compiler, 1, dst_r, 0, SLJIT_MEM2(src_r, src_r), lea_shift);
+		FAIL_IF(!inst);
+		*inst = LEA_r_m;
+	}
+	else if (src_r != dst_r)
+		EMIT_MOV(compiler, dst_r, 0, src_r, 0);
+
+	if (shift > 0) {
+		inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS, SLJIT_IMM, shift, dst_r, 0);
+		FAIL_IF(!inst);
+		*inst |= SHL;
+	}
+
+	if (negate) {
+		inst = emit_x86_instruction(compiler, 1, 0, 0, dst_r, 0);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_F7;
+		*inst |= NEG_rm;
+	}
+
+	if (dst_r == TMP_REG1)
+		return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
 static int emit_lea_binary(struct sljit_compiler *compiler, int keep_flags,
 	int dst, long dstw,
 	int src1, long src1w,
@@ -1989,23 +2934,145 @@ static int emit_test_binary(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
-static int emit_shift(struct sljit_compiler *compiler,
-	u_char mode,
-	int dst, long dstw,
-	int src1, long src1w,
-	int src2, long src2w)
+/* SSE and VEX encoded instructions: the opcode byte is combined with
+   the mandatory prefix, the opcode map and the operand types. The prefix
+   values match the pp field of the VEX prefix. */
+#define VEC_PREF_66	0x0100
+#define VEC_PREF_F3	0x0200
+#define VEC_PREF_F2	0x0300
+#define VEC_PREF_MASK	0x0300
+#define VEC_MAP_0F38	0x0400
+#define VEC_MAP_0F3A	0x0800
+#define VEC_MAP_MASK	0x0c00
+/* 64 bit general register operand (REX.W or VEX.W). */
+#define VEC_W		0x1000
+/* 256 bit operation (VEX.L, AVX2 only). */
+#define VEC_256		0x2000
+/* The reg field (a) is a general register. */
+#define VEC_REG_GPR	0x4000
+/* The r/m field (b) is a general register. */
+#define VEC_RM_GPR	0x8000
+/* An 8 bit immediate follows the instruction. */
+#define VEC_IMM8	0x10000
+/* The vvvv field (v) is a general register. */
+#define VEC_V_GPR	0x20000
+
+#define SARX_r_rm_r	(VEC_PREF_F3 | VEC_MAP_0F38 | VEC_REG_GPR | VEC_RM_GPR | VEC_V_GPR | 0xf7)
+#define SHLX_r_rm_r	(VEC_PREF_66 | VEC_MAP_0F38 | VEC_REG_GPR | VEC_RM_GPR | VEC_V_GPR | 0xf7)
+#define SHRX_r_rm_r	(VEC_PREF_F2 | VEC_MAP_0F38 | VEC_REG_GPR | VEC_RM_GPR | VEC_V_GPR | 0xf7)
+#define RORX_r_rm_i8	(VEC_PREF_F2 | VEC_MAP_0F3A | VEC_REG_GPR | VEC_RM_GPR | VEC_IMM8 | 0xf0)
+
+/* Memory operands of VEX encoded instructions must be in [base + displacement] form. */
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+#define IS_VEX_ADDRESS(arg, argw) \
+	(((arg) & SLJIT_MEM) && ((arg) & REG_MASK) && !((arg) & OFFS_REG_MASK) && IS_HALFWORD(argw))
+#else
+#define IS_VEX_ADDRESS(arg, argw) \
+	(((arg) & SLJIT_MEM) && ((arg) & REG_MASK) && !((arg) & OFFS_REG_MASK))
+#endif
+
+/* Emits a VEX encoded instruction: a is the reg field, b is the r/m
+   field and v is the vvvv field. The memory operand must satisfy
+   IS_VEX_ADDRESS. */
+static int emit_vex_instruction(struct sljit_compiler *compiler, int ins,
+	int a, int v, int b, long bw)
 {
-	u_char* inst;
+	u_char *inst;
+	int reg;
+	int rm;
+	int inst_size;
+	u_char vex;
+
+	reg = (ins & VEC_REG_GPR) ? reg_map[a] : a;
+	if (b & SLJIT_MEM) {
+		SLJIT_ASSERT((b & REG_MASK) && !(b & OFFS_REG_MASK));
+		rm = reg_map[b & REG_MASK];
+	}
+	else
+		rm = (ins & VEC_RM_GPR) ? reg_map[b] : b;
+
+	/* VEX prefix, opcode and mod r/m byte. */
+	inst_size = 2 + 1 + 1;
+	if ((ins & (VEC_W | VEC_MAP_MASK)) || rm >= 8)
+		inst_size++;
+	if (b & SLJIT_MEM) {
+		if ((rm & 0x7) == 4)
+			inst_size++; /* SIB byte. */
+		if (bw != 0 || (rm & 0x7) == 5)
+			inst_size += (bw <= 127 && bw >= -128) ? sizeof(s_char) : sizeof(int);
+	}
 
-	if ((src2 & SLJIT_IMM) || (src2 == SLJIT_PREF_SHIFT_REG)) {
-		if (dst == src1 && dstw == src1w) {
-			inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS, src2, src2w, dst, dstw);
-			FAIL_IF(!inst);
-			*inst |= mode;
-			return SLJIT_SUCCESS;
-		}
-		if (dst == SLJIT_UNUSED) {
-			EMIT_MOV(compiler, TMP_REG1, 0, src1, src1w);
+	inst = ensure_buf(compiler, 1 + inst_size);
+	FAIL_IF(!inst);
+	INC_SIZE(inst_size);
+
+	if (ins & VEC_V_GPR)
+		v = reg_map[v];
+	vex = ((~v & 0xf) << 3) | ((ins & VEC_256) ? 0x4 : 0) | ((ins & VEC_PREF_MASK) >> 8);
+	if ((ins & (VEC_W | VEC_MAP_MASK)) || rm >= 8) {
+		*inst++ = 0xc4;
+		*inst++ = ((reg & 0x8) ? 0 : 0x80) | 0x40 | ((rm & 0x8) ? 0 : 0x20) | (1 + ((ins & VEC_MAP_MASK) >> 10));
+		*inst++ = ((ins & VEC_W) ? 0x80 : 0) | vex;
+	}
+	else {
+		*inst++ = 0xc5;
+		*inst++ = ((reg & 0x8) ? 0 : 0x80) | vex;
+	}
+	*inst++ = ins & 0xff;
+
+	if (!(b & SLJIT_MEM))
+		*inst = MOD_REG | ((reg & 0x7) << 3) | (rm & 0x7);
+	else {
+		*inst = ((reg & 0x7) << 3) | (rm & 0x7);
+		if (bw != 0 || (rm & 0x7) == 5)
+			*inst |= (bw <= 127 && bw >= -128) ? MOD_DISP8 : 0x80;
+		inst++;
+		if ((rm & 0x7) == 4)
+			*inst++ = 0x24;
+		if (bw != 0 || (rm & 0x7) == 5) {
+			if (bw <= 127 && bw >= -128)
+				*inst = (s_char)bw;
+			else
+				*(int*)inst = (int)bw;
+		}
+	}
+
+	return SLJIT_SUCCESS;
+}
+
+/* Saves or restores the shift register. All bits must be kept,
+   even if the operation is 32 bit. */
+static __inline int emit_mov_shift_reg(struct sljit_compiler *compiler, int dst, int src)
+{
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	int mode32 = compiler->mode32;
+
+	compiler->mode32 = 0;
+	FAIL_IF(emit_mov(compiler, dst, 0, src, 0));
+	compiler->mode32 = mode32;
+	return SLJIT_SUCCESS;
+#else
+	return emit_mov(compiler, dst, 0, src, 0);
+#endif
+}
+
+static int emit_shift(struct sljit_compiler *compiler,
+	u_char mode,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	u_char* inst;
+
+	if ((src2 & SLJIT_IMM) || (src2 == SLJIT_PREF_SHIFT_REG)) {
+		if (dst == src1 && dstw == src1w) {
+			inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS, src2, src2w, dst, dstw);
+			FAIL_IF(!inst);
+			*inst |= mode;
+			return SLJIT_SUCCESS;
+		}
+		if (dst == SLJIT_UNUSED) {
+			EMIT_MOV(compiler, TMP_REG1, 0, src1, src1w);
 			inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS, src2, src2w, TMP_REG1, 0);
 			FAIL_IF(!inst);
 			*inst |= mode;
@@ -2046,19 +3113,19 @@ static int emit_shift(struct sljit_compiler *compiler,
 	else if (FAST_IS_REG(dst) && dst != src2 && !ADDRESSING_DEPENDS_ON(src2, dst)) {
 		if (src1 != dst)
 			EMIT_MOV(compiler, dst, 0, src1, src1w);
-		EMIT_MOV(compiler, TMP_REG1, 0, SLJIT_PREF_SHIFT_REG, 0);
+		FAIL_IF(emit_mov_shift_reg(compiler, TMP_REG1, SLJIT_PREF_SHIFT_REG));
 		EMIT_MOV(compiler, SLJIT_PREF_SHIFT_REG, 0, src2, src2w);
 		inst = emit_x86_instruction(compiler, 1 | EX86_SHIFT_INS, SLJIT_PREF_SHIFT_REG, 0, dst, 0);
 		FAIL_IF(!inst);
 		*inst |= mode;
-		EMIT_MOV(compiler, SLJIT_PREF_SHIFT_REG, 0, TMP_REG1, 0);
+		FAIL_IF(emit_mov_shift_reg(compiler, SLJIT_PREF_SHIFT_REG, TMP_REG1));
 	}
 	else {
 		/* This case is really difficult, since ecx itself may used for
 		   addressing, and we must ensure to work even in that case. */
 		EMIT_MOV(compiler, TMP_REG1, 0, src1, src1w);
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-		EMIT_MOV(compiler, TMP_REG2, 0, SLJIT_PREF_SHIFT_REG, 0);
+		FAIL_IF(emit_mov_shift_reg(compiler, TMP_REG2, SLJIT_PREF_SHIFT_REG));
 #else
 		/* [esp+0] contains the flags. */
 		EMIT_MOV(compiler, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_PREF_SHIFT_REG, 0);
@@ -2068,7 +3135,7 @@ static int emit_shift(struct sljit_compiler *compiler,
 		FAIL_IF(!inst);
 		*inst |= mode;
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
-		EMIT_MOV(compiler, SLJIT_PREF_SHIFT_REG, 0, TMP_REG2, 0);
+		FAIL_IF(emit_mov_shift_reg(compiler, SLJIT_PREF_SHIFT_REG, TMP_REG2));
 #else
 		EMIT_MOV(compiler, SLJIT_PREF_SHIFT_REG, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
 #endif
@@ -2078,6 +3145,50 @@ static int emit_shift(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
+/* Variable shifts without using ecx. The flags are not modified.
+   src1 must be a register or satisfy IS_VEX_ADDRESS. */
+static int emit_shift_bmi2(struct sljit_compiler *compiler,
+	u_char mode,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	int ins;
+	int dst_r;
+
+	switch (mode) {
+	case SHL:
+		ins = SHLX_r_rm_r;
+		break;
+	case SHR:
+		ins = SHRX_r_rm_r;
+		break;
+	default:
+		SLJIT_ASSERT(mode == SAR);
+		ins = SARX_r_rm_r;
+		break;
+	}
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	if (!compiler->mode32)
+		ins |= VEC_W;
+#endif
+
+	dst_r = (FAST_IS_REG(dst) && dst != SLJIT_UNUSED) ? dst : TMP_REG1;
+
+	if (!FAST_IS_REG(src2)) {
+		/* The destination is written after the sources are read. */
+		EMIT_MOV(compiler, TMP_REG1, 0, src2, src2w);
+		src2 = TMP_REG1;
+	}
+
+	FAIL_IF(emit_vex_instruction(compiler, ins, dst_r, src2, src1, src1w));
+
+	if (dst_r == TMP_REG1 && dst != SLJIT_UNUSED)
+		return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
 static int emit_shift_with_flags(struct sljit_compiler *compiler,
 	u_char mode, int set_flags,
 	int dst, long dstw,
@@ -2100,6 +3211,19 @@ static int emit_shift_with_flags(struct sljit_compiler *compiler,
 			dst, dstw, src1, src1w, SLJIT_IMM, 0);
 	}
 
+	if (cpu_has_bmi2 == -1)
+		get_cpu_features();
+
+	/* The flags of the shift instruction are not used when the
+	   destination is a register, so they can be computed by cmp. */
+	if (cpu_has_bmi2 && (!set_flags || (FAST_IS_REG(dst) && dst != SLJIT_UNUSED))
+			&& (FAST_IS_REG(src1) || IS_VEX_ADDRESS(src1, src1w))) {
+		FAIL_IF(emit_shift_bmi2(compiler, mode, dst, dstw, src1, src1w, src2, src2w));
+		if (set_flags)
+			return emit_cmp_binary(compiler, dst, dstw, SLJIT_IMM, 0);
+		return SLJIT_SUCCESS;
+	}
+
 	if (!set_flags)
 		return emit_shift(compiler, mode, dst, dstw, src1, src1w, src2, src2w);
 
@@ -2113,13 +3237,69 @@ static int emit_shift_with_flags(struct sljit_compiler *compiler,
 	return SLJIT_SUCCESS;
 }
 
+static int emit_rotate(struct sljit_compiler *compiler,
+	u_char mode,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	u_char* inst;
+	int dst_r;
+	int ins = RORX_r_rm_i8;
+	int bits = 32;
+
+	if (!(src2 & SLJIT_IMM))
+		return emit_shift(compiler, mode, dst, dstw, src1, src1w, src2, src2w);
+
+	if (cpu_has_bmi2 == -1)
+		get_cpu_features();
+
+	if (!cpu_has_bmi2 || dst == SLJIT_UNUSED || !(FAST_IS_REG(src1) || IS_VEX_ADDRESS(src1, src1w)))
+		return emit_shift(compiler, mode, dst, dstw, src1, src1w, src2, src2w);
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	if (!compiler->mode32) {
+		ins |= VEC_W;
+		bits = 64;
+	}
+#endif
+
+	/* Rotating left by n is the same as rotating right by bits - n. */
+	if (mode == ROL)
+		src2w = bits - (src2w & (bits - 1));
+	src2w &= bits - 1;
+
+	dst_r = FAST_IS_REG(dst) ? dst : TMP_REG1;
+	FAIL_IF(emit_vex_instruction(compiler, ins, dst_r, 0, src1, src1w));
+
+	inst = ensure_buf(compiler, 1 + 1);
+	FAIL_IF(!inst);
+	INC_SIZE(1);
+	*inst = (u_char)src2w;
+
+	if (dst_r == TMP_REG1)
+		return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
 int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src1, long src1w,
 	int src2, long src2w)
 {
+	IR_RECORD_OP2(op, dst, dstw, src1, src1w, src2, src2w);
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_op2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+
+	if (GET_OPCODE(op) >= SLJIT_UDIV_IMM) {
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+		return emit_div_imm(compiler, op, dst, dstw, src1, src1w, src2w);
+#else
+		compiler->error = SLJIT_ERR_UNSUPPORTED;
+		return SLJIT_ERR_UNSUPPORTED;
+#endif
+	}
+
 	ADJUST_LOCAL_OFFSET(dst, dstw);
 	ADJUST_LOCAL_OFFSET(src1, src1w);
 	ADJUST_LOCAL_OFFSET(src2, src2w);
@@ -2131,6 +3311,12 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	compiler->mode32 = op & SLJIT_INT_OP;
 #endif
 
+	/* The result is not used, and the operation (including a possible
+	   save of the flags) can be omitted if it does not touch memory. */
+	if (PEEPHOLE_ENABLED(compiler) && dst == SLJIT_UNUSED && !GET_FLAGS(op)
+			&& !(src1 & SLJIT_MEM) && !(src2 & SLJIT_MEM))
+		return SLJIT_SUCCESS;
+
 	if (GET_OPCODE(op) >= SLJIT_MUL) {
 		if (GET_FLAGS(op))
 			compiler->flags_saved = 0;
@@ -2182,6 +3368,16 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 		return emit_non_cum_binary(compiler, SBB_r_rm, SBB_rm_r, SBB, SBB_EAX_i32,
 			dst, dstw, src1, src1w, src2, src2w);
 	case SLJIT_MUL:
+		if (!GET_FLAGS(op)) {
+			if ((src2 & SLJIT_IMM) && !(src1 & SLJIT_IMM)) {
+				if (emit_mul_imm(compiler, dst, dstw, src1, src1w, src2w) != SLJIT_ERR_UNSUPPORTED)
+					return compiler->error;
+			}
+			else if ((src1 & SLJIT_IMM) && !(src2 & SLJIT_IMM)) {
+				if (emit_mul_imm(compiler, dst, dstw, src2, src2w, src1w) != SLJIT_ERR_UNSUPPORTED)
+					return compiler->error;
+			}
+		}
 		return emit_mul(compiler, dst, dstw, src1, src1w, src2, src2w);
 	case SLJIT_AND:
 		if (dst == SLJIT_UNUSED)
@@ -2203,6 +3399,10 @@ int sljit_emit_op2(struct sljit_compiler *compiler, int op,
 	case SLJIT_ASHR:
 		return emit_shift_with_flags(compiler, SAR, GET_FLAGS(op),
 			dst, dstw, src1, src1w, src2, src2w);
+	case SLJIT_ROTL:
+		return emit_rotate(compiler, ROL, dst, dstw, src1, src1w, src2, src2w);
+	case SLJIT_ROTR:
+		return emit_rotate(compiler, ROR, dst, dstw, src1, src1w, src2, src2w);
 	}
 
 	return SLJIT_SUCCESS;
@@ -2300,6 +3500,10 @@ static int emit_sse2_logic(struct sljit_compiler *compiler, u_char opcode,
 static __inline int emit_sse2_load(struct sljit_compiler *compiler,
 	int single, int dst, int src, long srcw)
 {
+	/* Register to register movsd merges the value into the destination,
+	   so it depends on the previous value of dst. Movaps does not. */
+	if (FAST_IS_REG(src))
+		return emit_sse2_logic(compiler, MOVAPS_x_xm, 0, dst, src, 0);
 	return emit_sse2(compiler, MOVSD_x_xm, single, dst, src, srcw);
 }
 
@@ -2505,6 +3709,343 @@ int sljit_emit_fop2(struct sljit_compiler *compiler, int op,
 	return SLJIT_SUCCESS;
 }
 
+/* --------------------------------------------------------------------- */
+/*  Vector operators                                                     */
+/* --------------------------------------------------------------------- */
+
+#define MOVD_x_rm	(VEC_PREF_66 | VEC_RM_GPR | 0x6e)
+#define MOVDQA_x_xm	(VEC_PREF_66 | 0x6f)
+#define MOVDQU_x_xm	(VEC_PREF_F3 | 0x6f)
+#define MOVDQU_xm_x	(VEC_PREF_F3 | 0x7f)
+#define MOVMSKPD_r_x	(VEC_PREF_66 | VEC_REG_GPR | 0x50)
+#define MOVMSKPS_r_x	(VEC_REG_GPR | 0x50)
+#define PACKSSWB_x_xm	(VEC_PREF_66 | 0x63)
+#define PADDB_x_xm	(VEC_PREF_66 | 0xfc)
+#define PADDD_x_xm	(VEC_PREF_66 | 0xfe)
+#define PADDQ_x_xm	(VEC_PREF_66 | 0xd4)
+#define PADDW_x_xm	(VEC_PREF_66 | 0xfd)
+#define PAND_x_xm	(VEC_PREF_66 | 0xdb)
+#define PCMPEQB_x_xm	(VEC_PREF_66 | 0x74)
+#define PCMPEQD_x_xm	(VEC_PREF_66 | 0x76)
+#define PCMPEQQ_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x29)
+#define PCMPEQW_x_xm	(VEC_PREF_66 | 0x75)
+#define PCMPGTB_x_xm	(VEC_PREF_66 | 0x64)
+#define PCMPGTD_x_xm	(VEC_PREF_66 | 0x66)
+#define PCMPGTQ_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x37)
+#define PCMPGTW_x_xm	(VEC_PREF_66 | 0x65)
+#define PMOVMSKB_r_x	(VEC_PREF_66 | VEC_REG_GPR | 0xd7)
+#define POR_x_xm	(VEC_PREF_66 | 0xeb)
+#define PSHUFD_x_xm_i8	(VEC_PREF_66 | VEC_IMM8 | 0x70)
+#define PSHUFLW_x_xm_i8	(VEC_PREF_F2 | VEC_IMM8 | 0x70)
+#define PSUBB_x_xm	(VEC_PREF_66 | 0xf8)
+#define PSUBD_x_xm	(VEC_PREF_66 | 0xfa)
+#define PSUBQ_x_xm	(VEC_PREF_66 | 0xfb)
+#define PSUBW_x_xm	(VEC_PREF_66 | 0xf9)
+#define PUNPCKLBW_x_xm	(VEC_PREF_66 | 0x60)
+#define PUNPCKLQDQ_x_xm	(VEC_PREF_66 | 0x6c)
+#define PXOR_x_xm	(VEC_PREF_66 | 0xef)
+#define VPBROADCASTB_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x78)
+#define VPBROADCASTD_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x58)
+#define VPBROADCASTQ_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x59)
+#define VPBROADCASTW_x_xm	(VEC_PREF_66 | VEC_MAP_0F38 | 0x79)
+#define VPERMQ_y_ym_i8	(VEC_PREF_66 | VEC_MAP_0F3A | VEC_W | VEC_IMM8 | 0x00)
+
+/* Indexed by the lane size: (op & SLJIT_VEC_64) >> 8. */
+static const int vec_add_ins[4] = { PADDB_x_xm, PADDW_x_xm, PADDD_x_xm, PADDQ_x_xm };
+static const int vec_sub_ins[4] = { PSUBB_x_xm, PSUBW_x_xm, PSUBD_x_xm, PSUBQ_x_xm };
+static const int vec_cmpeq_ins[4] = { PCMPEQB_x_xm, PCMPEQW_x_xm, PCMPEQD_x_xm, PCMPEQQ_x_xm };
+static const int vec_cmpgt_ins[4] = { PCMPGTB_x_xm, PCMPGTW_x_xm, PCMPGTD_x_xm, PCMPGTQ_x_xm };
+static const int vec_broadcast_ins[4] = { VPBROADCASTB_x_xm, VPBROADCASTW_x_xm, VPBROADCASTD_x_xm, VPBROADCASTQ_x_xm };
+
+int sljit_get_vector_size(void)
+{
+	if (cpu_has_avx2 == -1)
+		get_cpu_features();
+	if (cpu_has_avx2)
+		return 32;
+	return sljit_is_fpu_available() ? 16 : 0;
+}
+
+/* Emits a vector instruction: a is the reg field, b is the r/m field
+   and v is the first source operand of the three operand VEX form.
+   Without AVX2, the legacy SSE encoding is used, where v must be
+   equal to a or must be 0 (not used). VEX encoded memory operands
+   must be in [base + displacement] form (see emit_vec_address). */
+static int emit_vec_instruction(struct sljit_compiler *compiler, int ins,
+	int a, int v, int b, long bw, int imm)
+{
+	u_char *inst;
+	int flags;
+
+	if (!cpu_has_avx2) {
+		SLJIT_ASSERT(!(ins & VEC_256) && (v == a || v == 0));
+
+		flags = EX86_SSE2;
+		if (ins & VEC_REG_GPR)
+			flags &= ~EX86_SSE2_OP1;
+		if (ins & VEC_RM_GPR)
+			flags &= ~EX86_SSE2_OP2;
+
+		switch (ins & VEC_PREF_MASK) {
+		case VEC_PREF_66:
+			flags |= EX86_PREF_66;
+			break;
+		case VEC_PREF_F3:
+			flags |= EX86_PREF_F3;
+			break;
+		case VEC_PREF_F2:
+			flags |= EX86_PREF_F2;
+			break;
+		}
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = !(ins & VEC_W);
+#endif
+		inst = emit_x86_instruction(compiler, ((ins & VEC_MAP_MASK) ? 3 : 2) | flags, a, 0, b, bw);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		if (ins & VEC_MAP_MASK)
+			*inst++ = (ins & VEC_MAP_0F3A) ? 0x3a : 0x38;
+		*inst = ins & 0xff;
+	}
+	else {
+		FAIL_IF(emit_vex_instruction(compiler, ins, a, v, b, bw));
+		if (ins & VEC_256)
+			compiler->ymm_used = 1;
+	}
+
+	if (ins & VEC_IMM8) {
+		inst = ensure_buf(compiler, 1 + 1);
+		FAIL_IF(!inst);
+		INC_SIZE(1);
+		*inst = (u_char)imm;
+	}
+	return SLJIT_SUCCESS;
+}
+
+/* Converts the memory operand to [base + displacement] form, which
+   is supported by the VEX encoder. */
+static int emit_vec_address(struct sljit_compiler *compiler, int *mem, long *memw)
+{
+	u_char *inst;
+
+	if (!cpu_has_avx2 || !(*mem & SLJIT_MEM))
+		return SLJIT_SUCCESS;
+
+	if (IS_VEX_ADDRESS(*mem, *memw))
+		return SLJIT_SUCCESS;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 0;
+#endif
+
+	inst = emit_x86_instruction(compiler, 1, TMP_REG1, 0, *mem, *memw);
+	FAIL_IF(!inst);
+	*inst = LEA_r_m;
+	*mem = SLJIT_MEM1(TMP_REG1);
+	*memw = 0;
+	return SLJIT_SUCCESS;
+}
+
+static int emit_vec_binary(struct sljit_compiler *compiler, int ins, int commutative,
+	int dst, int src1, int src2)
+{
+	if (!cpu_has_avx2) {
+		/* Two operand form: dst = dst op src2. */
+		if (dst == src2 && dst != src1) {
+			if (commutative) {
+				src2 = src1;
+				src1 = dst;
+			}
+			else {
+				FAIL_IF(emit_vec_instruction(compiler, MOVDQA_x_xm, TMP_FREG, 0, src2, 0, 0));
+				src2 = TMP_FREG;
+			}
+		}
+		if (dst != src1)
+			FAIL_IF(emit_vec_instruction(compiler, MOVDQA_x_xm, dst, 0, src1, 0, 0));
+		src1 = dst;
+	}
+	return emit_vec_instruction(compiler, ins, dst, src1, src2, 0, 0);
+}
+
+static int emit_vec_broadcast(struct sljit_compiler *compiler, int op,
+	int dst, int src, long srcw)
+{
+	int lane = op & SLJIT_VEC_64;
+	int ins = MOVD_x_rm;
+
+	CHECK_EXTRA_REGS(src, srcw, (void)0);
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	if (lane == SLJIT_VEC_64)
+		ins |= VEC_W;
+	compiler->mode32 = (lane != SLJIT_VEC_64);
+#endif
+
+	if (!FAST_IS_REG(src)) {
+		EMIT_MOV(compiler, TMP_REG1, 0, src, srcw);
+		src = TMP_REG1;
+	}
+	FAIL_IF(emit_vec_instruction(compiler, ins, dst, 0, src, 0, 0));
+
+	if (cpu_has_avx2)
+		return emit_vec_instruction(compiler, vec_broadcast_ins[lane >> 8] | ((op & SLJIT_VEC_256) ? VEC_256 : 0), dst, 0, dst, 0, 0);
+
+	switch (lane) {
+	case SLJIT_VEC_8:
+		FAIL_IF(emit_vec_instruction(compiler, PUNPCKLBW_x_xm, dst, dst, dst, 0, 0));
+		/* Fall through. */
+	case SLJIT_VEC_16:
+		FAIL_IF(emit_vec_instruction(compiler, PSHUFLW_x_xm_i8, dst, 0, dst, 0, 0));
+		/* Fall through. */
+	case SLJIT_VEC_32:
+		return emit_vec_instruction(compiler, PSHUFD_x_xm_i8, dst, 0, dst, 0, 0);
+	}
+	return emit_vec_instruction(compiler, PUNPCKLQDQ_x_xm, dst, dst, dst, 0, 0);
+}
+
+static int emit_vec_movemask(struct sljit_compiler *compiler, int op,
+	int dst, long dstw, int src)
+{
+	u_char *inst;
+	int wide = (op & SLJIT_VEC_256) ? VEC_256 : 0;
+	int dst_r;
+	int ins;
+
+	CHECK_EXTRA_REGS(dst, dstw, (void)0);
+
+	if (dst == SLJIT_UNUSED)
+		return SLJIT_SUCCESS;
+
+	dst_r = FAST_IS_REG(dst) ? dst : TMP_REG1;
+
+	switch (op & SLJIT_VEC_64) {
+	case SLJIT_VEC_16:
+		/* The signed saturation keeps the sign bits of the lanes. */
+		if (cpu_has_avx2) {
+			FAIL_IF(emit_vec_instruction(compiler, PACKSSWB_x_xm | wide, TMP_FREG, src, src, 0, 0));
+			if (wide)
+				FAIL_IF(emit_vec_instruction(compiler, VPERMQ_y_ym_i8 | VEC_256, TMP_FREG, 0, TMP_FREG, 0, 0xd8));
+		}
+		else {
+			FAIL_IF(emit_vec_instruction(compiler, MOVDQA_x_xm, TMP_FREG, 0, src, 0, 0));
+			FAIL_IF(emit_vec_instruction(compiler, PACKSSWB_x_xm, TMP_FREG, TMP_FREG, TMP_FREG, 0, 0));
+		}
+		src = TMP_FREG;
+		ins = PMOVMSKB_r_x;
+		break;
+	case SLJIT_VEC_32:
+		ins = MOVMSKPS_r_x;
+		break;
+	case SLJIT_VEC_64:
+		ins = MOVMSKPD_r_x;
+		break;
+	default:
+		ins = PMOVMSKB_r_x;
+		break;
+	}
+
+	FAIL_IF(emit_vec_instruction(compiler, ins | wide, dst_r, 0, src, 0, 0));
+
+	if ((op & SLJIT_VEC_64) == SLJIT_VEC_16) {
+		/* Clear the bits of the duplicated lanes. */
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 1;
+#endif
+		BINARY_IMM(AND, AND_rm_r, wide ? 0xffff : 0xff, dst_r, 0);
+	}
+
+	if (dst_r == TMP_REG1) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 0;
+#endif
+		return emit_mov(compiler, dst, dstw, TMP_REG1, 0);
+	}
+	return SLJIT_SUCCESS;
+}
+
+int sljit_emit_vop1(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	int wide = (op & SLJIT_VEC_256) ? VEC_256 : 0;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_vop1(compiler, op, dst, dstw, src, srcw));
+	ADJUST_LOCAL_OFFSET(dst, dstw);
+	ADJUST_LOCAL_OFFSET(src, srcw);
+
+	if (sljit_get_vector_size() < (wide ? 32 : 16)) {
+		compiler->error = SLJIT_ERR_UNSUPPORTED;
+		return SLJIT_ERR_UNSUPPORTED;
+	}
+
+	switch (GET_OPCODE(op)) {
+	case SLJIT_VMOV:
+		if (FAST_IS_REG(dst) && FAST_IS_REG(src)) {
+			if (dst == src)
+				return SLJIT_SUCCESS;
+			return emit_vec_instruction(compiler, MOVDQA_x_xm | wide, dst, 0, src, 0, 0);
+		}
+		if (FAST_IS_REG(dst)) {
+			FAIL_IF(emit_vec_address(compiler, &src, &srcw));
+			return emit_vec_instruction(compiler, MOVDQU_x_xm | wide, dst, 0, src, srcw, 0);
+		}
+		FAIL_IF(emit_vec_address(compiler, &dst, &dstw));
+		return emit_vec_instruction(compiler, MOVDQU_xm_x | wide, src, 0, dst, dstw, 0);
+
+	case SLJIT_VBROADCAST:
+		return emit_vec_broadcast(compiler, op, dst, src, srcw);
+	}
+
+	return emit_vec_movemask(compiler, op, dst, dstw, src);
+}
+
+int sljit_emit_vop2(struct sljit_compiler *compiler, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	int wide = (op & SLJIT_VEC_256) ? VEC_256 : 0;
+	int lane = (op & SLJIT_VEC_64) >> 8;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_vop2(compiler, op, dst, dstw, src1, src1w, src2, src2w));
+
+	if (sljit_get_vector_size() < (wide ? 32 : 16)
+			|| (GET_OPCODE(op) == SLJIT_VCMPGT && (op & SLJIT_VEC_64) == SLJIT_VEC_64 && !cpu_has_avx2)) {
+		compiler->error = SLJIT_ERR_UNSUPPORTED;
+		return SLJIT_ERR_UNSUPPORTED;
+	}
+
+	switch (GET_OPCODE(op)) {
+	case SLJIT_VADD:
+		return emit_vec_binary(compiler, vec_add_ins[lane] | wide, 1, dst, src1, src2);
+	case SLJIT_VSUB:
+		return emit_vec_binary(compiler, vec_sub_ins[lane] | wide, 0, dst, src1, src2);
+	case SLJIT_VAND:
+		return emit_vec_binary(compiler, PAND_x_xm | wide, 1, dst, src1, src2);
+	case SLJIT_VOR:
+		return emit_vec_binary(compiler, POR_x_xm | wide, 1, dst, src1, src2);
+	case SLJIT_VXOR:
+		return emit_vec_binary(compiler, PXOR_x_xm | wide, 1, dst, src1, src2);
+	case SLJIT_VCMPEQ:
+		if ((op & SLJIT_VEC_64) == SLJIT_VEC_64 && !cpu_has_avx2) {
+			/* SSE2 has no pcmpeqq: the 64 bit lanes are equal
+			   if both of their 32 bit halves are equal. */
+			FAIL_IF(emit_vec_binary(compiler, PCMPEQD_x_xm, 1, dst, src1, src2));
+			FAIL_IF(emit_vec_instruction(compiler, PSHUFD_x_xm_i8, TMP_FREG, 0, dst, 0, 0xb1));
+			return emit_vec_instruction(compiler, PAND_x_xm, dst, dst, TMP_FREG, 0, 0);
+		}
+		return emit_vec_binary(compiler, vec_cmpeq_ins[lane] | wide, 1, dst, src1, src2);
+	case SLJIT_VCMPGT:
+		return emit_vec_binary(compiler, vec_cmpgt_ins[lane] | wide, 0, dst, src1, src2);
+	}
+
+	return emit_vec_instruction(compiler, PSHUFD_x_xm_i8 | wide, dst, 0, src1, 0, (int)src2w);
+}
+
 /* --------------------------------------------------------------------- */
 /*  Conditional instructions                                             */
 /* --------------------------------------------------------------------- */
@@ -2546,6 +4087,7 @@ struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 {
 	u_char *inst;
 	struct sljit_jump *jump;
+	int return_double;
 
 	CHECK_ERROR_PTR();
 	CHECK_PTR(check_sljit_emit_jump(compiler, type));
@@ -2558,15 +4100,27 @@ struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 		compiler->flags_saved = 0;
 	}
 
+	if ((type & 0xff) >= SLJIT_CALL0 && emit_vzeroupper(compiler))
+		return NULL;
+
 	jump = ensure_abuf(compiler, sizeof(struct sljit_jump));
 	PTR_FAIL_IF_NULL(jump);
 	set_jump(jump, compiler, type & SLJIT_REWRITABLE_JUMP);
-	type &= 0xff;
 
-	if (type >= SLJIT_CALL1) {
+	if ((type & 0xff) >= SLJIT_CALL1 || GET_FLOAT_ARGS(type)) {
 		if (call_with_args(compiler, type))
 			return NULL;
 	}
+	return_double = type & SLJIT_CALL_RETURN_DOUBLE;
+#if (defined SLJIT_TAIL_CALL_SUPPORT && SLJIT_TAIL_CALL_SUPPORT)
+	if (type & SLJIT_TAIL_CALL) {
+		if (emit_stack_frame_release(compiler))
+			return NULL;
+		jump->flags |= IS_TAIL_CALL;
+		type = SLJIT_JUMP;
+	}
+#endif
+	type &= 0xff;
 
 	/* Worst case size. */
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
@@ -2574,12 +4128,24 @@ struct sljit_jump* sljit_emit_jump(struct sljit_compiler *compiler, int type)
 #else
 	compiler->size += (type >= SLJIT_JUMP) ? (10 + 3) : (2 + 10 + 3);
 #endif
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+	if (jump->flags & SLJIT_REWRITABLE_JUMP)
+		compiler->size += sizeof(long) - 1;
+#endif
 
 	inst = ensure_buf(compiler, 2);
 	PTR_FAIL_IF_NULL(inst);
 
 	*inst++ = 0;
 	*inst++ = type + 4;
+
+	if (return_double) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 1;
+#endif
+		if (emit_sse2_load(compiler, 0, SLJIT_FR0, TMP_FREG, 0))
+			return NULL;
+	}
 	return jump;
 }
 
@@ -2587,6 +4153,7 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 {
 	u_char *inst;
 	struct sljit_jump *jump;
+	int return_double, jump_flags;
 
 	CHECK_ERROR();
 	CHECK(check_sljit_emit_ijump(compiler, type, src, srcw));
@@ -2600,6 +4167,9 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 		compiler->flags_saved = 0;
 	}
 
+	if (type >= SLJIT_CALL0)
+		FAIL_IF(emit_vzeroupper(compiler));
+
 	if (type >= SLJIT_CALL1) {
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
 #if (defined SLJIT_X86_32_FASTCALL && SLJIT_X86_32_FASTCALL)
@@ -2616,9 +4186,48 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 			EMIT_MOV(compiler, TMP_REG1, 0, src, 0);
 			src = TMP_REG1;
 		}
+#endif
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) && !defined(_WIN64)
+		if ((type & 0xff) >= SLJIT_CALL4 && src != SLJIT_IMM) {
+			/* The argument moves overwrite rcx, r8 and r9, so the target
+			   is kept on the stack until R0 is moved to rdi. */
+			compiler->mode32 = 1;
+			inst = emit_x86_instruction(compiler, 1, 0, 0, src, srcw);
+			FAIL_IF(!inst);
+			*inst++ = GROUP_FF;
+			*inst |= PUSH_rm;
+
+			FAIL_IF(call_with_args(compiler, type));
+
+			inst = ensure_buf(compiler, 1 + 1);
+			FAIL_IF(!inst);
+			INC_SIZE(1);
+			POP_REG(reg_lmap[SLJIT_R0]);
+			src = SLJIT_R0;
+			srcw = 0;
+		}
+		else
 #endif
 		FAIL_IF(call_with_args(compiler, type));
 	}
+	return_double = type & SLJIT_CALL_RETURN_DOUBLE;
+	jump_flags = JUMP_ADDR;
+#if (defined SLJIT_TAIL_CALL_SUPPORT && SLJIT_TAIL_CALL_SUPPORT)
+	if (type & SLJIT_TAIL_CALL) {
+		/* The target must be loaded before the saved regs are restored.
+		   R0 (rax) is not needed anymore after the arguments are moved. */
+		if (src != SLJIT_IMM && src != SLJIT_R0) {
+			compiler->mode32 = 0;
+			EMIT_MOV(compiler, SLJIT_R0, 0, src, srcw);
+			src = SLJIT_R0;
+			srcw = 0;
+		}
+		FAIL_IF(emit_stack_frame_release(compiler));
+		jump_flags |= IS_TAIL_CALL;
+		type = SLJIT_JUMP;
+	}
+#endif
+	type &= 0xff;
 
 	if (src == SLJIT_IMM) {
 		jump = ensure_abuf(compiler, sizeof(struct sljit_jump));
@@ -2626,7 +4235,7 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 			compiler->error = SLJIT_ERR_ALLOC_FAILED;
 			return SLJIT_ERR_ALLOC_FAILED;
 		}
-		set_jump(jump, compiler, JUMP_ADDR);
+		set_jump(jump, compiler, jump_flags);
 		jump->u.target = srcw;
 
 		/* Worst case size. */
@@ -2655,9 +4264,101 @@ int sljit_emit_ijump(struct sljit_compiler *compiler, int type, int src, long sr
 		*inst++ = GROUP_FF;
 		*inst |= (type >= SLJIT_FAST_CALL) ? CALL_rm : JMP_rm;
 	}
+
+	if (return_double) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 1;
+#endif
+		return emit_sse2_load(compiler, 0, SLJIT_FR0, TMP_FREG, 0);
+	}
 	return SLJIT_SUCCESS;
 }
 
+struct sljit_switch* sljit_emit_switch(struct sljit_compiler *compiler,
+	int src, long srcw,
+	struct sljit_label **labels, long count)
+{
+	u_char *inst;
+	u_char *skip;
+	struct sljit_switch *switch_;
+	unsigned long size;
+	int index_r;
+
+	CHECK_ERROR_PTR();
+	CHECK_PTR(check_sljit_emit_switch(compiler, src, srcw, labels, count));
+	ADJUST_LOCAL_OFFSET(src, srcw);
+
+	CHECK_EXTRA_REGS(src, srcw, (void)0);
+
+	/* The flags are destroyed by the bounds check. */
+	compiler->flags_saved = 0;
+
+	switch_ = set_switch(compiler, labels, count);
+	if (!switch_)
+		return NULL;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 0;
+#endif
+
+	/* SLJIT_SP cannot be an index register. */
+	if (FAST_IS_REG(src) && src != SLJIT_SP)
+		index_r = src;
+	else {
+		if (emit_mov(compiler, TMP_REG1, 0, src, srcw))
+			return NULL;
+		index_r = TMP_REG1;
+	}
+
+	if (emit_cmp_binary(compiler, index_r, 0, SLJIT_IMM, count))
+		return NULL;
+
+	/* The displacement is set after the dispatch is emitted. */
+	inst = ensure_buf(compiler, 1 + 2);
+	PTR_FAIL_IF_NULL(inst);
+	INC_SIZE(2);
+	*inst++ = JAE_i8;
+	skip = inst;
+	size = compiler->size;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	/* jmp [index_r * 4 + table] */
+	inst = ensure_buf(compiler, 1 + 7);
+	PTR_FAIL_IF_NULL(inst);
+	INC_SIZE(7);
+	*inst++ = GROUP_FF;
+	*inst++ = JMP_rm | 0x4 /* SIB */;
+	*inst++ = (2 << 6) | (reg_map[index_r] << 3) | 0x5 /* no base */;
+	*(long*)inst = 0;
+#else
+	/* lea TMP_REG2, [rip + table] */
+	inst = ensure_buf(compiler, 1 + 7);
+	PTR_FAIL_IF_NULL(inst);
+	INC_SIZE(7);
+	*inst++ = REX_W | ((reg_map[TMP_REG2] >= 8) ? REX_R : 0);
+	*inst++ = LEA_r_m;
+	*inst++ = (reg_lmap[TMP_REG2] << 3) | 0x5 /* rip */;
+	*(int*)inst = 0;
+#endif
+
+	inst = ensure_buf(compiler, 2);
+	PTR_FAIL_IF_NULL(inst);
+	*inst++ = 0;
+	*inst++ = SWITCH_RECORD;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	/* REX_W is not necessary. */
+	compiler->mode32 = 1;
+	inst = emit_x86_instruction(compiler, 1, 0, 0, SLJIT_MEM2(TMP_REG2, index_r), 3);
+	PTR_FAIL_IF_NULL(inst);
+	*inst++ = GROUP_FF;
+	*inst |= JMP_rm;
+#endif
+
+	*skip = (u_char)(compiler->size - size);
+	return switch_;
+}
+
 int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 	int dst, long dstw,
 	int src, long srcw,
@@ -2845,6 +4546,268 @@ int sljit_emit_op_flags(struct sljit_compiler *compiler, int op,
 #endif /* SLJIT_CONFIG_X86_64 */
 }
 
+int sljit_emit_select(struct sljit_compiler *compiler, int type,
+	int dst_reg,
+	int src1, long src1w,
+	int src2_reg)
+{
+	u_char *inst;
+	u_char cond_mov;
+	int dst_r;
+	long dst_regw = 0;
+	long src2_regw = 0;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_select(compiler, type, dst_reg, src1, src1w, src2_reg));
+
+	if (cpu_has_cmov == -1)
+		get_cpu_features();
+
+	if (!cpu_has_cmov)
+		return emit_select_with_jump(compiler, type, dst_reg, src1, src1w, src2_reg);
+
+	ADJUST_LOCAL_OFFSET(src1, src1w);
+	CHECK_EXTRA_REGS(dst_reg, dst_regw, (void)0);
+	CHECK_EXTRA_REGS(src1, src1w, (void)0);
+	CHECK_EXTRA_REGS(src2_reg, src2_regw, (void)0);
+
+	/* The moves below do not modify the flags. */
+	if (compiler->flags_saved)
+		FAIL_IF(emit_restore_flags(compiler, 0));
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = type & SLJIT_INT_OP;
+#endif
+
+	/* cmovcc = jcc - 0x40. */
+	cond_mov = get_jump_code(type & 0xff) - 0x40;
+	dst_r = FAST_IS_REG(dst_reg) ? dst_reg : TMP_REG1;
+
+	if ((src1 & SLJIT_IMM) && dst_r != src2_reg) {
+		/* dst_r = (!condition) ? src2_reg : src1 */
+		EMIT_MOV(compiler, dst_r, 0, src1, src1w);
+		src1 = src2_reg;
+		src1w = src2_regw;
+		cond_mov ^= 0x1;
+	}
+	else if (src1 & SLJIT_IMM) {
+		/* The destination is a machine register, so TMP_REG1 is free. */
+		EMIT_MOV(compiler, TMP_REG1, 0, src1, src1w);
+		src1 = TMP_REG1;
+		src1w = 0;
+	}
+	else if (src1 == dst_r) {
+		src1 = src2_reg;
+		src1w = src2_regw;
+		cond_mov ^= 0x1;
+	}
+	else if (dst_r != src2_reg)
+		EMIT_MOV(compiler, dst_r, 0, src2_reg, src2_regw);
+
+	if (src1 != dst_r) {
+		inst = emit_x86_instruction(compiler, 2, dst_r, 0, src1, src1w);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = cond_mov;
+	}
+
+	if (dst_r == TMP_REG1)
+		return emit_mov(compiler, dst_reg, dst_regw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
+static __inline int emit_lock_prefix(struct sljit_compiler *compiler)
+{
+	u_char *inst = ensure_buf(compiler, 1 + 1);
+
+	FAIL_IF(!inst);
+	INC_SIZE(1);
+	*inst = LOCK;
+	return SLJIT_SUCCESS;
+}
+
+static int emit_atomic_cas(struct sljit_compiler *compiler, int op,
+	int dst_reg, long dst_regw,
+	int mem_reg,
+	int src_reg, long src_regw)
+{
+	u_char *inst;
+	int mem_r = mem_reg;
+	int src_r = src_reg;
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	int borrowed_r = SLJIT_UNUSED;
+#endif
+
+	/* The zero flag is set by cmpxchg. */
+	compiler->flags_saved = 0;
+
+	/* Addresses and saved registers are moved with full width. */
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 0;
+#endif
+
+	/* The compared value must be in SLJIT_R0 (eax), so the other
+	   operands cannot be stored there. */
+	if (mem_reg == SLJIT_R0) {
+		mem_r = TMP_REG1;
+		EMIT_MOV(compiler, TMP_REG1, 0, mem_reg, 0);
+	}
+
+	if (src_reg == mem_reg)
+		src_r = mem_r;
+	else if (src_reg == SLJIT_R0 || !FAST_IS_REG(src_reg)) {
+		if (mem_r != TMP_REG1)
+			src_r = TMP_REG1;
+		else {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+			src_r = TMP_REG3;
+#else
+			/* Neither mem_reg nor src_reg can be SLJIT_R1 or SLJIT_R2 here.
+			   The borrowed register is kept in the flags slot, since the
+			   flags are overwritten anyway. */
+			borrowed_r = (dst_reg != SLJIT_R1) ? SLJIT_R1 : SLJIT_R2;
+			src_r = borrowed_r;
+			EMIT_MOV(compiler, SLJIT_MEM1(SLJIT_SP), 0, borrowed_r, 0);
+#endif
+		}
+		EMIT_MOV(compiler, src_r, 0, src_reg, src_regw);
+	}
+
+	if (dst_reg != SLJIT_R0) {
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		EMIT_MOV(compiler, TMP_REG2, 0, SLJIT_R0, 0);
+#else
+		EMIT_MOV(compiler, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_R0, 0);
+#endif
+		EMIT_MOV(compiler, SLJIT_R0, 0, dst_reg, dst_regw);
+	}
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = op & SLJIT_INT_OP;
+#else
+	(void)op;
+#endif
+
+	FAIL_IF(emit_lock_prefix(compiler));
+	inst = emit_x86_instruction(compiler, 2, src_r, 0, SLJIT_MEM1(mem_r), 0);
+	FAIL_IF(!inst);
+	*inst++ = GROUP_0F;
+	*inst = CMPXCHG_rm_r;
+
+	/* The moves below do not modify the flags. */
+	if (dst_reg != SLJIT_R0) {
+		EMIT_MOV(compiler, dst_reg, dst_regw, SLJIT_R0, 0);
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+		compiler->mode32 = 0;
+		EMIT_MOV(compiler, SLJIT_R0, 0, TMP_REG2, 0);
+#else
+		EMIT_MOV(compiler, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+#endif
+	}
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (borrowed_r != SLJIT_UNUSED)
+		EMIT_MOV(compiler, borrowed_r, 0, SLJIT_MEM1(SLJIT_SP), 0);
+#endif
+	return SLJIT_SUCCESS;
+}
+
+int sljit_emit_atomic(struct sljit_compiler *compiler, int op,
+	int dst_reg,
+	int mem_reg,
+	int src_reg)
+{
+	u_char *inst;
+	int type = op & 0xf;
+	int value_r;
+	long dst_regw = 0;
+	long src_regw = 0;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_atomic(compiler, op, dst_reg, mem_reg, src_reg));
+
+	CHECK_EXTRA_REGS(dst_reg, dst_regw, (void)0);
+	CHECK_EXTRA_REGS(src_reg, src_regw, (void)0);
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = op & SLJIT_INT_OP;
+#endif
+
+	/* Loads are not reordered with other loads and stores are not
+	   reordered with other stores on x86, so only sequentially
+	   consistent stores need a locked instruction. */
+	switch (type) {
+	case SLJIT_ATOMIC_LOAD:
+		return emit_mov(compiler, dst_reg, dst_regw, SLJIT_MEM1(mem_reg), 0);
+	case SLJIT_ATOMIC_STORE:
+		if ((op & SLJIT_ORDER_SEQ_CST) != SLJIT_ORDER_SEQ_CST)
+			return emit_mov(compiler, SLJIT_MEM1(mem_reg), 0, src_reg, src_regw);
+		break;
+	case SLJIT_ATOMIC_CAS:
+		return emit_atomic_cas(compiler, op, dst_reg, dst_regw, mem_reg, src_reg, src_regw);
+	}
+
+	/* The register operand of xchg and xadd receives the previous value. */
+	value_r = (FAST_IS_REG(dst_reg) && dst_reg != SLJIT_UNUSED && dst_reg != mem_reg) ? dst_reg : TMP_REG1;
+	if (value_r != src_reg)
+		EMIT_MOV(compiler, value_r, 0, src_reg, src_regw);
+
+	if (type == SLJIT_ATOMIC_ADD) {
+		compiler->flags_saved = 0;
+		FAIL_IF(emit_lock_prefix(compiler));
+		inst = emit_x86_instruction(compiler, 2, value_r, 0, SLJIT_MEM1(mem_reg), 0);
+		FAIL_IF(!inst);
+		*inst++ = GROUP_0F;
+		*inst = XADD_rm_r;
+	}
+	else {
+		/* Exchange with a memory operand is always locked. */
+		inst = emit_x86_instruction(compiler, 1, value_r, 0, SLJIT_MEM1(mem_reg), 0);
+		FAIL_IF(!inst);
+		*inst = XCHG_r_rm;
+	}
+
+	if (value_r == TMP_REG1 && dst_reg != SLJIT_UNUSED)
+		return emit_mov(compiler, dst_reg, dst_regw, TMP_REG1, 0);
+	return SLJIT_SUCCESS;
+}
+
+int sljit_emit_fence(struct sljit_compiler *compiler, int type)
+{
+	u_char *inst;
+
+	CHECK_ERROR();
+	CHECK(check_sljit_emit_fence(compiler, type));
+
+	/* Acquire and release orderings are guaranteed by the memory model. */
+	if (type != SLJIT_ORDER_SEQ_CST)
+		return SLJIT_SUCCESS;
+
+#if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
+	if (cpu_has_sse2 == -1)
+		get_cpu_features();
+
+	if (!cpu_has_sse2) {
+		/* Two locked exchanges, which restore the original values. */
+		inst = emit_x86_instruction(compiler, 1, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), 0);
+		FAIL_IF(!inst);
+		*inst = XCHG_r_rm;
+		inst = emit_x86_instruction(compiler, 1, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), 0);
+		FAIL_IF(!inst);
+		*inst = XCHG_r_rm;
+		return SLJIT_SUCCESS;
+	}
+#endif
+
+	inst = ensure_buf(compiler, 1 + 3);
+	FAIL_IF(!inst);
+	INC_SIZE(3);
+	*inst++ = GROUP_0F;
+	*inst++ = MFENCE;
+	*inst = 0xf0;
+	return SLJIT_SUCCESS;
+}
+
 int sljit_get_local_base(struct sljit_compiler *compiler, int dst, long dstw, long offset)
 {
 	CHECK_ERROR();
@@ -2880,7 +4843,8 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 {
 	u_char *inst;
 	struct sljit_const *const_;
-#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	|| (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
 	int reg;
 #endif
 
@@ -2895,6 +4859,32 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 		return NULL;
 	set_const(const_, compiler);
 
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+	/* The constant is always loaded by a mov reg, imm instruction,
+	   which follows the record, so the immediate can be aligned. */
+	reg = SLOW_IS_REG(dst) ? dst : TMP_REG1;
+
+	inst = ensure_buf(compiler, 2);
+	if (!inst)
+		return NULL;
+
+	*inst++ = 0;
+	*inst++ = 1;
+	compiler->size += sizeof(long) - 1;
+
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	compiler->mode32 = 0;
+	if (emit_load_imm64(compiler, reg, init_value))
+		return NULL;
+#else
+	if (emit_do_imm(compiler, MOV_r_i32 + reg_map[reg], init_value))
+		return NULL;
+#endif
+
+	if (dst & SLJIT_MEM)
+		if (emit_mov(compiler, dst, dstw, TMP_REG1, 0))
+			return NULL;
+#else /* !SLJIT_ATOMIC_PATCHING */
 #if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
 	compiler->mode32 = 0;
 	reg = SLOW_IS_REG(dst) ? dst : TMP_REG1;
@@ -2921,20 +4911,57 @@ struct sljit_const* sljit_emit_const(struct sljit_compiler *compiler, int dst, l
 		if (emit_mov(compiler, dst, dstw, TMP_REG1, 0))
 			return NULL;
 #endif
+#endif /* SLJIT_ATOMIC_PATCHING */
 
 	return const_;
 }
 
-void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+/* Maximum number of bytes changed by inline_set_jump_addr and inline_set_const. */
+#define PATCHED_CODE_SIZE sizeof(long)
+
+static __inline void inline_set_jump_addr(unsigned long addr, unsigned long new_addr, int flush)
 {
+	/* The addr is in the executable view. */
+	unsigned long writable_addr = addr - SLJIT_EXEC_OFFSET((void*)addr);
+#if (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64) \
+	&& (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	long rel32_offset;
+	long disp;
+#endif
+
+	/* Unified caches. The store must not be split when the
+	   immediate is aligned (see SLJIT_ATOMIC_PATCHING). */
+	(void)flush;
 #if (defined SLJIT_CONFIG_X86_32 && SLJIT_CONFIG_X86_32)
-	*(long*)addr = new_addr - (addr + 4);
+	*(volatile long*)writable_addr = new_addr - (addr + 4);
+#elif (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS)
+	/* The addr is the target slot of the stub (see generate_near_jump_stub).
+	   A far target is stored into the slot before the rel32 is redirected
+	   to the stub, and x86 does not reorder these stores. */
+	rel32_offset = *(int*)(writable_addr - NEAR_JUMP_STUB_SLOT);
+	disp = (long)(new_addr - (addr + rel32_offset + sizeof(int)));
+	if (disp > HALFWORD_MAX || disp < HALFWORD_MIN) {
+		*(volatile unsigned long*)writable_addr = new_addr;
+		disp = -6 - (rel32_offset + (long)sizeof(int));
+	}
+	*(volatile int*)(writable_addr + rel32_offset) = (int)disp;
 #else
-	*(unsigned long*)addr = new_addr;
+	*(volatile unsigned long*)writable_addr = new_addr;
 #endif
 }
 
+void sljit_set_jump_addr(unsigned long addr, unsigned long new_addr)
+{
+	inline_set_jump_addr(addr, new_addr, 1);
+}
+
+static __inline void inline_set_const(unsigned long addr, long new_constant, int flush)
+{
+	(void)flush;
+	*(volatile long*)(addr - SLJIT_EXEC_OFFSET((void*)addr)) = new_constant;
+}
+
 void sljit_set_const(unsigned long addr, long new_constant)
 {
-	*(long*)addr = new_constant;
+	inline_set_const(addr, new_constant, 1);
 }
@@ -0,0 +1,1050 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2012 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+   The allocator works on the recorded instruction list:
+     - the list is split into basic blocks at labels and after jumps
+     - the live variables of the blocks are computed by the usual
+       iterative backward data flow algorithm
+     - the live range of a virtual register is the smallest interval
+       which contains all of its definitions, uses and the boundaries
+       of the blocks where it is live (no holes, no splitting)
+     - the intervals are allocated by linear scan (Poletto and Sarkar):
+       when no register is free, the active interval which ends last
+       is spilled to the local area for its whole life time
+
+   Every instruction has two positions: 2 * i where its sources are
+   read, and 2 * i + 1 where its destination is written. Hence the
+   destination can share a register with a source which dies there.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sljitRegAlloc.h"
+
+#define RA_ENTER	0
+#define RA_OP1		1
+#define RA_OP2		2
+#define RA_LABEL	3
+#define RA_JUMP		4
+#define RA_CMP		5
+#define RA_CALL		6
+#define RA_RETURN	7
+
+/* Machine registers, which hold the call arguments and the bases of
+   the memory operands. They are allocated only when neither is needed. */
+#define RA_TEMPORARIES	3
+
+#define IS_VREG(arg)	((arg) >= 0x100 && ((arg) & 0xff) == 0)
+#define IS_VMEM(arg)	((arg) >= 0x100 && ((arg) & 0xff) == SLJIT_MEM)
+#define VREG_INDEX(arg)	(((arg) >> 8) - 1)
+
+#define BITS_PER_WORD	(int)(sizeof(unsigned long) * 8)
+
+struct sljit_ra_label {
+	struct sljit_ra_label *next;
+	int inst;
+	struct sljit_label *label;
+};
+
+struct sljit_ra_jump {
+	struct sljit_ra_jump *next;
+	struct sljit_ra_label *target;
+	struct sljit_jump *jump;
+};
+
+struct ra_inst {
+	int type;
+	int op;
+	int dst;
+	long dstw;
+	int src1;
+	long src1w;
+	int src2;
+	long src2w;
+	int args[3];
+	union {
+		struct sljit_ra_label *label;
+		struct sljit_ra_jump *jump;
+	} u;
+};
+
+struct ra_block {
+	int first;
+	int last;
+	int succ[2];
+};
+
+struct ra_interval {
+	int vreg;
+	int start;
+	int end;
+	int crosses_call;
+};
+
+struct sljit_ra {
+	struct sljit_allocator allocator;
+	int error;
+	int options;
+	int args;
+	int local_size;
+	int vregs;
+
+	struct ra_inst *insts;
+	int inst_count;
+	int inst_size;
+
+	struct sljit_ra_label *labels;
+	struct sljit_ra_jump *jumps;
+
+	/* Results of the allocation: a machine register, or zero
+	   if the virtual register is spilled to slot[vreg]. */
+	int *reg;
+	int *slot;
+	int spilled;
+	int scratches;
+	int saveds;
+};
+
+static void* default_alloc(unsigned long size, void *allocator_data)
+{
+	(void)allocator_data;
+	return malloc(size);
+}
+
+static void default_free(void *ptr, void *allocator_data)
+{
+	(void)allocator_data;
+	free(ptr);
+}
+
+static const struct sljit_allocator default_allocator = {
+	default_alloc, default_free, NULL
+};
+
+static void* ra_alloc(struct sljit_ra *ra, unsigned long size)
+{
+	return ra->allocator.alloc(size, ra->allocator.allocator_data);
+}
+
+static void ra_free(struct sljit_ra *ra, void *ptr)
+{
+	/* A NULL free callback means the memory is released by the owner. */
+	if (ptr && ra->allocator.free)
+		ra->allocator.free(ptr, ra->allocator.allocator_data);
+}
+
+struct sljit_ra* sljit_ra_create(void)
+{
+	return sljit_ra_create_with_allocator(NULL);
+}
+
+struct sljit_ra* sljit_ra_create_with_allocator(const struct sljit_allocator *allocator)
+{
+	struct sljit_ra *ra;
+
+	if (!allocator)
+		allocator = &default_allocator;
+
+	ra = (struct sljit_ra*)allocator->alloc(sizeof(struct sljit_ra), allocator->allocator_data);
+	if (!ra)
+		return NULL;
+	memset(ra, 0, sizeof(struct sljit_ra));
+	ra->allocator = *allocator;
+	return ra;
+}
+
+void sljit_ra_free(struct sljit_ra *ra)
+{
+	struct sljit_allocator allocator = ra->allocator;
+	struct sljit_ra_label *label = ra->labels;
+	struct sljit_ra_jump *jump = ra->jumps;
+	void *next;
+
+	while (label) {
+		next = label->next;
+		ra_free(ra, label);
+		label = (struct sljit_ra_label*)next;
+	}
+	while (jump) {
+		next = jump->next;
+		ra_free(ra, jump);
+		jump = (struct sljit_ra_jump*)next;
+	}
+	ra_free(ra, ra->insts);
+	ra_free(ra, ra->reg);
+	ra_free(ra, ra->slot);
+	if (allocator.free)
+		allocator.free(ra, allocator.allocator_data);
+}
+
+int sljit_ra_get_error(struct sljit_ra *ra)
+{
+	return ra->error;
+}
+
+int sljit_ra_get_spilled_vregs(struct sljit_ra *ra)
+{
+	return ra->spilled;
+}
+
+int sljit_ra_get_scratches(struct sljit_ra *ra)
+{
+	return ra->scratches;
+}
+
+int sljit_ra_get_saveds(struct sljit_ra *ra)
+{
+	return ra->saveds;
+}
+
+/* --------------------------------------------------------------------- */
+/*  Recording                                                            */
+/* --------------------------------------------------------------------- */
+
+static struct ra_inst* add_inst(struct sljit_ra *ra, int type)
+{
+	struct ra_inst *inst;
+	int size;
+
+	if (ra->error)
+		return NULL;
+
+	if ((type == RA_ENTER) != (ra->inst_count == 0)) {
+		ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return NULL;
+	}
+
+	if (ra->inst_count >= ra->inst_size) {
+		size = ra->inst_size ? ra->inst_size * 2 : 64;
+		inst = (struct ra_inst*)ra_alloc(ra, size * sizeof(struct ra_inst));
+		if (!inst) {
+			ra->error = SLJIT_ERR_ALLOC_FAILED;
+			return NULL;
+		}
+		if (ra->insts) {
+			memcpy(inst, ra->insts, ra->inst_count * sizeof(struct ra_inst));
+			ra_free(ra, ra->insts);
+		}
+		ra->insts = inst;
+		ra->inst_size = size;
+	}
+
+	inst = ra->insts + ra->inst_count++;
+	memset(inst, 0, sizeof(struct ra_inst));
+	inst->type = type;
+	return inst;
+}
+
+/* Operand checks. The vregs counter is updated as well. */
+static int check_vreg(struct sljit_ra *ra, int arg)
+{
+	if (!IS_VREG(arg)) {
+		ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return 0;
+	}
+	if (VREG_INDEX(arg) >= ra->vregs)
+		ra->vregs = VREG_INDEX(arg) + 1;
+	return 1;
+}
+
+static int check_src(struct sljit_ra *ra, int arg)
+{
+	if (arg >= 0x100 && (IS_VREG(arg) || IS_VMEM(arg))) {
+		if (VREG_INDEX(arg) >= ra->vregs)
+			ra->vregs = VREG_INDEX(arg) + 1;
+		return 1;
+	}
+	if (arg == SLJIT_IMM || arg == SLJIT_MEM0() || arg == SLJIT_MEM1(SLJIT_SP))
+		return 1;
+	ra->error = SLJIT_ERR_BAD_ARGUMENT;
+	return 0;
+}
+
+static int check_dst(struct sljit_ra *ra, int arg)
+{
+	if (arg == SLJIT_UNUSED)
+		return 1;
+	if (arg == SLJIT_IMM) {
+		ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return 0;
+	}
+	return check_src(ra, arg);
+}
+
+int sljit_ra_emit_enter(struct sljit_ra *ra, int options, int args, int local_size)
+{
+	struct ra_inst *inst = add_inst(ra, RA_ENTER);
+
+	if (!inst)
+		return ra->error;
+	if (args < 0 || args > 3 || local_size < 0 || local_size > SLJIT_MAX_LOCAL_SIZE) {
+		ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return ra->error;
+	}
+
+	ra->options = options;
+	ra->args = args;
+	ra->local_size = local_size;
+	if (ra->vregs < args)
+		ra->vregs = args;
+	return SLJIT_SUCCESS;
+}
+
+int sljit_ra_emit_op1(struct sljit_ra *ra, int op,
+	int dst, long dstw,
+	int src, long srcw)
+{
+	struct ra_inst *inst;
+	int opcode = op & ~(SLJIT_INT_OP | SLJIT_SET_E | SLJIT_SET_U | SLJIT_SET_S | SLJIT_SET_O | SLJIT_SET_C | SLJIT_KEEP_FLAGS);
+
+	if (opcode < SLJIT_MOV || opcode > SLJIT_CLZ || (opcode >= SLJIT_MOVU && opcode <= SLJIT_MOVU_P)) {
+		if (!ra->error)
+			ra->error = SLJIT_ERR_UNSUPPORTED;
+		return ra->error;
+	}
+
+	inst = add_inst(ra, RA_OP1);
+	if (!inst || !check_dst(ra, dst) || !check_src(ra, src))
+		return ra->error;
+
+	inst->op = op;
+	inst->dst = dst;
+	inst->dstw = dstw;
+	inst->src1 = src;
+	inst->src1w = srcw;
+	return SLJIT_SUCCESS;
+}
+
+int sljit_ra_emit_op2(struct sljit_ra *ra, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	struct ra_inst *inst = add_inst(ra, RA_OP2);
+
+	if (!inst || !check_dst(ra, dst) || !check_src(ra, src1) || !check_src(ra, src2))
+		return ra->error;
+
+	inst->op = op;
+	inst->dst = dst;
+	inst->dstw = dstw;
+	inst->src1 = src1;
+	inst->src1w = src1w;
+	inst->src2 = src2;
+	inst->src2w = src2w;
+	return SLJIT_SUCCESS;
+}
+
+struct sljit_ra_label* sljit_ra_emit_label(struct sljit_ra *ra)
+{
+	struct ra_inst *inst = add_inst(ra, RA_LABEL);
+	struct sljit_ra_label *label;
+
+	if (!inst)
+		return NULL;
+
+	label = (struct sljit_ra_label*)ra_alloc(ra, sizeof(struct sljit_ra_label));
+	if (!label) {
+		ra->error = SLJIT_ERR_ALLOC_FAILED;
+		return NULL;
+	}
+	label->next = ra->labels;
+	label->inst = ra->inst_count - 1;
+	label->label = NULL;
+	ra->labels = label;
+	inst->u.label = label;
+	return label;
+}
+
+static struct sljit_ra_jump* add_jump(struct sljit_ra *ra, struct ra_inst *inst)
+{
+	struct sljit_ra_jump *jump = (struct sljit_ra_jump*)ra_alloc(ra, sizeof(struct sljit_ra_jump));
+
+	if (!jump) {
+		ra->error = SLJIT_ERR_ALLOC_FAILED;
+		return NULL;
+	}
+	jump->next = ra->jumps;
+	jump->target = NULL;
+	jump->jump = NULL;
+	ra->jumps = jump;
+	inst->u.jump = jump;
+	return jump;
+}
+
+struct sljit_ra_jump* sljit_ra_emit_jump(struct sljit_ra *ra, int type)
+{
+	struct ra_inst *inst;
+
+	if ((type & 0xff) > SLJIT_JUMP) {
+		if (!ra->error)
+			ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return NULL;
+	}
+
+	inst = add_inst(ra, RA_JUMP);
+	if (!inst)
+		return NULL;
+	inst->op = type;
+	return add_jump(ra, inst);
+}
+
+struct sljit_ra_jump* sljit_ra_emit_cmp(struct sljit_ra *ra, int type,
+	int src1, long src1w,
+	int src2, long src2w)
+{
+	struct ra_inst *inst = add_inst(ra, RA_CMP);
+
+	if (!inst || !check_src(ra, src1) || !check_src(ra, src2))
+		return NULL;
+
+	inst->op = type;
+	inst->src1 = src1;
+	inst->src1w = src1w;
+	inst->src2 = src2;
+	inst->src2w = src2w;
+	return add_jump(ra, inst);
+}
+
+void sljit_ra_set_label(struct sljit_ra_jump *jump, struct sljit_ra_label *label)
+{
+	if (jump && label)
+		jump->target = label;
+}
+
+int sljit_ra_emit_call(struct sljit_ra *ra, int type, int dst, const int *args,
+	int src, long srcw)
+{
+	struct ra_inst *inst;
+	int i;
+
+	if (type < SLJIT_CALL0 || type > SLJIT_CALL3 || IS_VMEM(src)) {
+		if (!ra->error)
+			ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return ra->error;
+	}
+
+	inst = add_inst(ra, RA_CALL);
+	if (!inst || !check_src(ra, src))
+		return ra->error;
+	if (dst != SLJIT_UNUSED && !check_vreg(ra, dst))
+		return ra->error;
+
+	inst->op = type;
+	inst->dst = dst;
+	inst->src1 = src;
+	inst->src1w = srcw;
+	for (i = 0; i < type - SLJIT_CALL0; i++) {
+		if (!check_vreg(ra, args[i]))
+			return ra->error;
+		inst->args[i] = args[i];
+	}
+	return SLJIT_SUCCESS;
+}
+
+int sljit_ra_emit_return(struct sljit_ra *ra, int op,
+	int src, long srcw)
+{
+	struct ra_inst *inst = add_inst(ra, RA_RETURN);
+
+	if (!inst)
+		return ra->error;
+	if (op != SLJIT_UNUSED && !check_src(ra, src))
+		return ra->error;
+
+	inst->op = op;
+	inst->src1 = src;
+	inst->src1w = srcw;
+	return SLJIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------- */
+/*  Live ranges                                                          */
+/* --------------------------------------------------------------------- */
+
+/* Collects the virtual registers read by an instruction. */
+static int get_uses(struct ra_inst *inst, int *uses)
+{
+	int count = 0;
+	int i;
+
+	switch (inst->type) {
+	case RA_OP1:
+	case RA_OP2:
+		if (IS_VMEM(inst->dst))
+			uses[count++] = VREG_INDEX(inst->dst);
+		/* Fall through. */
+	case RA_CMP:
+	case RA_RETURN:
+		if (inst->src1 >= 0x100)
+			uses[count++] = VREG_INDEX(inst->src1);
+		if (inst->src2 >= 0x100)
+			uses[count++] = VREG_INDEX(inst->src2);
+		break;
+	case RA_CALL:
+		if (inst->src1 >= 0x100)
+			uses[count++] = VREG_INDEX(inst->src1);
+		for (i = 0; i < inst->op - SLJIT_CALL0; i++)
+			uses[count++] = VREG_INDEX(inst->args[i]);
+		break;
+	}
+	return count;
+}
+
+/* Returns with the virtual register written by an instruction, or -1. */
+static int get_def(struct ra_inst *inst)
+{
+	switch (inst->type) {
+	case RA_OP1:
+	case RA_OP2:
+	case RA_CALL:
+		if (IS_VREG(inst->dst))
+			return VREG_INDEX(inst->dst);
+		break;
+	}
+	return -1;
+}
+
+static void extend(struct ra_interval *interval, int pos)
+{
+	if (pos < interval->start)
+		interval->start = pos;
+	if (pos > interval->end)
+		interval->end = pos;
+}
+
+#define SET_BIT(set, i)		((set)[(i) / BITS_PER_WORD] |= 1UL << ((i) % BITS_PER_WORD))
+#define GET_BIT(set, i)		(((set)[(i) / BITS_PER_WORD] >> ((i) % BITS_PER_WORD)) & 1)
+
+/* Computes the interval of each virtual register. */
+static int compute_intervals(struct sljit_ra *ra, struct ra_interval *intervals)
+{
+	struct ra_inst *inst;
+	struct ra_block *blocks;
+	int *block_of;
+	unsigned long *sets, *gen, *kill, *live_in, *live_out, *set;
+	int words = (ra->vregs + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	int block_count, b, i, j, k, v, def, changed;
+	int uses[5];
+	unsigned long new_in;
+
+	block_of = (int*)ra_alloc(ra, (ra->inst_count + 1) * sizeof(int));
+	blocks = (struct ra_block*)ra_alloc(ra, ra->inst_count * sizeof(struct ra_block));
+	sets = (unsigned long*)ra_alloc(ra, (4 * (unsigned long)ra->inst_count * words + 1) * sizeof(unsigned long));
+	if (!block_of || !blocks || !sets) {
+		ra_free(ra, block_of);
+		ra_free(ra, blocks);
+		ra_free(ra, sets);
+		return SLJIT_ERR_ALLOC_FAILED;
+	}
+	memset(sets, 0, (4 * (unsigned long)ra->inst_count * words + 1) * sizeof(unsigned long));
+
+	/* Basic blocks. */
+	block_count = 0;
+	for (i = 0; i < ra->inst_count; i++) {
+		inst = ra->insts + i;
+		if (i == 0 || inst->type == RA_LABEL
+				|| inst[-1].type == RA_JUMP || inst[-1].type == RA_CMP || inst[-1].type == RA_RETURN) {
+			if (block_count > 0)
+				blocks[block_count - 1].last = i - 1;
+			blocks[block_count].first = i;
+			block_count++;
+		}
+		block_of[i] = block_count - 1;
+	}
+	blocks[block_count - 1].last = ra->inst_count - 1;
+
+	for (b = 0; b < block_count; b++) {
+		inst = ra->insts + blocks[b].last;
+		blocks[b].succ[0] = -1;
+		blocks[b].succ[1] = -1;
+
+		if (inst->type == RA_JUMP || inst->type == RA_CMP)
+			blocks[b].succ[0] = block_of[inst->u.jump->target->inst];
+		if (inst->type != RA_RETURN && !(inst->type == RA_JUMP && (inst->op & 0xff) == SLJIT_JUMP)
+				&& b + 1 < block_count)
+			blocks[b].succ[1] = b + 1;
+	}
+
+	gen = sets;
+	kill = gen + block_count * words;
+	live_in = kill + block_count * words;
+	live_out = live_in + block_count * words;
+
+	for (b = 0; b < block_count; b++) {
+		for (i = blocks[b].first; i <= blocks[b].last; i++) {
+			inst = ra->insts + i;
+			k = get_uses(inst, uses);
+			for (j = 0; j < k; j++)
+				if (!GET_BIT(kill + b * words, uses[j]))
+					SET_BIT(gen + b * words, uses[j]);
+			def = get_def(inst);
+			if (def >= 0)
+				SET_BIT(kill + b * words, def);
+			if (inst->type == RA_ENTER)
+				for (v = 0; v < ra->args; v++)
+					SET_BIT(kill + b * words, v);
+		}
+	}
+
+	/* Backward data flow: out = union of the successor ins,
+	   in = gen | (out & ~kill). */
+	do {
+		changed = 0;
+		for (b = block_count - 1; b >= 0; b--) {
+			set = live_out + b * words;
+			for (k = 0; k < 2; k++) {
+				if (blocks[b].succ[k] < 0)
+					continue;
+				for (j = 0; j < words; j++)
+					set[j] |= live_in[blocks[b].succ[k] * words + j];
+			}
+			for (j = 0; j < words; j++) {
+				new_in = gen[b * words + j] | (set[j] & ~kill[b * words + j]);
+				if (new_in != live_in[b * words + j]) {
+					live_in[b * words + j] = new_in;
+					changed = 1;
+				}
+			}
+		}
+	} while (changed);
+
+	for (v = 0; v < ra->vregs; v++) {
+		intervals[v].vreg = v;
+		intervals[v].start = 2 * ra->inst_count;
+		intervals[v].end = -1;
+		intervals[v].crosses_call = 0;
+	}
+
+	for (b = 0; b < block_count; b++) {
+		for (v = 0; v < ra->vregs; v++) {
+			/* Live before the first, and after the last instruction. */
+			if (GET_BIT(live_in + b * words, v))
+				extend(intervals + v, 2 * blocks[b].first);
+			if (GET_BIT(live_out + b * words, v))
+				extend(intervals + v, 2 * blocks[b].last + 2);
+		}
+	}
+
+	for (i = 0; i < ra->inst_count; i++) {
+		inst = ra->insts + i;
+		k = get_uses(inst, uses);
+		for (j = 0; j < k; j++)
+			extend(intervals + uses[j], 2 * i);
+		def = get_def(inst);
+		if (def >= 0)
+			extend(intervals + def, 2 * i + 1);
+	}
+
+	/* The arguments are allocated before any other register. */
+	for (v = 0; v < ra->args; v++)
+		extend(intervals + v, 0);
+
+	ra_free(ra, block_of);
+	ra_free(ra, blocks);
+	ra_free(ra, sets);
+	return SLJIT_SUCCESS;
+}
+
+/* A value must survive a call, if it is live both before
+   and after the call instruction. */
+static int mark_call_crossing(struct sljit_ra *ra, struct ra_interval *intervals)
+{
+	int *calls_before = (int*)ra_alloc(ra, (ra->inst_count + 1) * sizeof(int));
+	int i, v, lo, hi;
+
+	if (!calls_before)
+		return SLJIT_ERR_ALLOC_FAILED;
+
+	calls_before[0] = 0;
+	for (i = 0; i < ra->inst_count; i++)
+		calls_before[i + 1] = calls_before[i] + (ra->insts[i].type == RA_CALL);
+
+	for (v = 0; v < ra->vregs; v++) {
+		if (intervals[v].end < 0)
+			continue;
+		/* Calls at lo ... hi: start <= 2 * c and 2 * c + 1 <= end. */
+		lo = (intervals[v].start + 1) / 2;
+		hi = (intervals[v].end - 1) / 2;
+		if (intervals[v].end >= 1 && hi >= lo && calls_before[hi + 1] - calls_before[lo] > 0)
+			intervals[v].crosses_call = 1;
+	}
+
+	ra_free(ra, calls_before);
+	return SLJIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------- */
+/*  Linear scan                                                          */
+/* --------------------------------------------------------------------- */
+
+static int compare_intervals(const void *a, const void *b)
+{
+	const struct ra_interval *x = *(const struct ra_interval* const*)a;
+	const struct ra_interval *y = *(const struct ra_interval* const*)b;
+
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return x->vreg - y->vreg;
+}
+
+#define IS_SAVED_REG(reg)	((reg) >= SLJIT_FIRST_SAVED_REG)
+
+static void spill(struct sljit_ra *ra, int vreg, int *slots)
+{
+	ra->reg[vreg] = 0;
+	ra->slot[vreg] = (*slots)++;
+	ra->spilled++;
+}
+
+static int linear_scan(struct sljit_ra *ra, struct ra_interval *intervals, int temporaries)
+{
+	struct ra_interval **sorted;
+	struct ra_interval **active;
+	struct ra_interval *cur;
+	int regs[SLJIT_NUM_REGS];
+	char used[SLJIT_NUM_REGS + 2];
+	int reg_count, sorted_count, active_count, slots;
+	int i, j, reg, victim;
+
+	sorted = (struct ra_interval**)ra_alloc(ra, (ra->vregs + 1) * sizeof(struct ra_interval*));
+	active = (struct ra_interval**)ra_alloc(ra, (SLJIT_NUM_REGS + 1) * sizeof(struct ra_interval*));
+	if (!sorted || !active) {
+		ra_free(ra, sorted);
+		ra_free(ra, active);
+		return SLJIT_ERR_ALLOC_FAILED;
+	}
+
+	/* Scratch registers are preferred, since they are not saved by enter. */
+	reg_count = 0;
+	for (i = temporaries; i < SLJIT_NUM_SCRATCH_REGS; i++)
+		regs[reg_count++] = SLJIT_R(i);
+	for (i = 0; i < SLJIT_NUM_SAVED_REGS; i++)
+		regs[reg_count++] = SLJIT_S(i);
+
+	sorted_count = 0;
+	for (i = 0; i < ra->vregs; i++) {
+		ra->reg[i] = 0;
+		ra->slot[i] = -1;
+		if (intervals[i].end >= 0)
+			sorted[sorted_count++] = intervals + i;
+	}
+	qsort(sorted, sorted_count, sizeof(struct ra_interval*), compare_intervals);
+
+	memset(used, 0, sizeof(used));
+	active_count = 0;
+	slots = 0;
+	ra->spilled = 0;
+	ra->scratches = temporaries;
+	ra->saveds = ra->args;
+
+	for (i = 0; i < sorted_count; i++) {
+		cur = sorted[i];
+
+		for (j = 0; j < active_count; ) {
+			if (active[j]->end < cur->start) {
+				used[ra->reg[active[j]->vreg]] = 0;
+				active[j] = active[--active_count];
+			}
+			else
+				j++;
+		}
+
+		reg = 0;
+		if (cur->vreg < ra->args) {
+			/* Arguments are processed first, so their registers are free. */
+			reg = SLJIT_S(cur->vreg);
+		}
+		else {
+			for (j = 0; j < reg_count; j++) {
+				if (!used[regs[j]] && (!cur->crosses_call || IS_SAVED_REG(regs[j]))) {
+					reg = regs[j];
+					break;
+				}
+			}
+		}
+
+		if (!reg) {
+			/* Spill the interval which ends last. */
+			victim = -1;
+			for (j = 0; j < active_count; j++) {
+				if (cur->crosses_call && !IS_SAVED_REG(ra->reg[active[j]->vreg]))
+					continue;
+				if (victim < 0 || active[j]->end > active[victim]->end)
+					victim = j;
+			}
+
+			if (victim < 0 || active[victim]->end <= cur->end) {
+				spill(ra, cur->vreg, &slots);
+				continue;
+			}
+
+			reg = ra->reg[active[victim]->vreg];
+			spill(ra, active[victim]->vreg, &slots);
+			active[victim] = active[--active_count];
+		}
+
+		ra->reg[cur->vreg] = reg;
+		used[reg] = 1;
+		active[active_count++] = cur;
+
+		if (IS_SAVED_REG(reg)) {
+			if (SLJIT_S0 - reg + 1 > ra->saveds)
+				ra->saveds = SLJIT_S0 - reg + 1;
+		}
+		else if (reg > ra->scratches)
+			ra->scratches = reg;
+	}
+
+	ra_free(ra, sorted);
+	ra_free(ra, active);
+
+	if (ra->local_size + slots * (int)sizeof(long) > SLJIT_MAX_LOCAL_SIZE)
+		return SLJIT_ERR_UNSUPPORTED;
+	return SLJIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------- */
+/*  Emitting the code                                                    */
+/* --------------------------------------------------------------------- */
+
+static void get_vreg(struct sljit_ra *ra, int vreg, int *arg, long *argw)
+{
+	if (ra->reg[vreg]) {
+		*arg = ra->reg[vreg];
+		*argw = 0;
+		return;
+	}
+	*arg = SLJIT_MEM1(SLJIT_SP);
+	*argw = ra->local_size + ra->slot[vreg] * sizeof(long);
+}
+
+/* The base of a memory operand must be loaded into a temporary
+   register if it is spilled, or it is a virtual register of x86-32. */
+static int needs_base_load(struct sljit_ra *ra, int arg)
+{
+	int reg;
+
+	if (!IS_VMEM(arg))
+		return 0;
+	reg = ra->reg[VREG_INDEX(arg)];
+	return !reg || sljit_get_reg_index(reg) < 0;
+}
+
+/* Returns with non-zero if the emitted code uses the temporary registers. */
+static int needs_temporaries(struct sljit_ra *ra)
+{
+	struct ra_inst *inst = ra->insts;
+	struct ra_inst *end = inst + ra->inst_count;
+
+	for (; inst < end; inst++) {
+		if (inst->type == RA_CALL)
+			return 1;
+		if (inst->type == RA_RETURN && inst->op == SLJIT_UNUSED)
+			continue;
+		if (needs_base_load(ra, inst->dst) || needs_base_load(ra, inst->src1) || needs_base_load(ra, inst->src2))
+			return 1;
+	}
+	return 0;
+}
+
+/* Converts an operand to a machine operand. The base register
+   is loaded into *tmp_reg (which is increased) if needed. */
+static void lower_operand(struct sljit_ra *ra, struct sljit_compiler *compiler,
+	int *arg, long *argw, int *tmp_reg)
+{
+	int base;
+	long basew;
+
+	if (IS_VREG(*arg)) {
+		get_vreg(ra, VREG_INDEX(*arg), arg, argw);
+		return;
+	}
+	if (!IS_VMEM(*arg))
+		return;
+
+	get_vreg(ra, VREG_INDEX(*arg), &base, &basew);
+	if (needs_base_load(ra, *arg)) {
+		sljit_emit_op1(compiler, SLJIT_MOV, *tmp_reg, 0, base, basew);
+		base = *tmp_reg;
+		(*tmp_reg)++;
+	}
+	*arg = SLJIT_MEM1(base);
+}
+
+static void emit_op2(struct sljit_ra *ra, struct sljit_compiler *compiler, struct ra_inst *inst)
+{
+	int dst = inst->dst, src1 = inst->src1, src2 = inst->src2;
+	long dstw = inst->dstw, src1w = inst->src1w, src2w = inst->src2w;
+	int tmp_reg = SLJIT_R0;
+
+	lower_operand(ra, compiler, &src1, &src1w, &tmp_reg);
+	lower_operand(ra, compiler, &src2, &src2w, &tmp_reg);
+
+	if (tmp_reg == SLJIT_R2 && needs_base_load(ra, dst)) {
+		/* All temporaries are used: the result is stored separately. */
+		sljit_emit_op2(compiler, inst->op, SLJIT_R0, 0, src1, src1w, src2, src2w);
+		tmp_reg = SLJIT_R1;
+		lower_operand(ra, compiler, &dst, &dstw, &tmp_reg);
+		sljit_emit_op1(compiler, (inst->op & SLJIT_INT_OP) ? SLJIT_MOV_UI : SLJIT_MOV, dst, dstw, SLJIT_R0, 0);
+		return;
+	}
+
+	lower_operand(ra, compiler, &dst, &dstw, &tmp_reg);
+	sljit_emit_op2(compiler, inst->op, dst, dstw, src1, src1w, src2, src2w);
+}
+
+static void emit_call(struct sljit_ra *ra, struct sljit_compiler *compiler, struct ra_inst *inst)
+{
+	int arg, src = inst->src1;
+	long argw, srcw = inst->src1w;
+	int i;
+
+	for (i = 0; i < inst->op - SLJIT_CALL0; i++) {
+		get_vreg(ra, VREG_INDEX(inst->args[i]), &arg, &argw);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R(i), 0, arg, argw);
+	}
+
+	if (IS_VREG(src))
+		get_vreg(ra, VREG_INDEX(src), &src, &srcw);
+	sljit_emit_ijump(compiler, inst->op, src, srcw);
+
+	if (inst->dst != SLJIT_UNUSED) {
+		get_vreg(ra, VREG_INDEX(inst->dst), &arg, &argw);
+		sljit_emit_op1(compiler, SLJIT_MOV, arg, argw, SLJIT_RETURN_REG, 0);
+	}
+}
+
+static int emit_code(struct sljit_ra *ra, struct sljit_compiler *compiler)
+{
+	struct ra_inst *inst = ra->insts;
+	struct ra_inst *end = inst + ra->inst_count;
+	struct sljit_ra_jump *jump;
+	int dst, src1, src2, tmp_reg, i;
+	long dstw, src1w, src2w;
+
+	sljit_emit_enter(compiler, ra->options, ra->args, ra->scratches, ra->saveds, 0, 0,
+		ra->local_size + ra->spilled * sizeof(long));
+
+	for (i = 0; i < ra->args; i++)
+		if (!ra->reg[i])
+			sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), ra->local_size + ra->slot[i] * sizeof(long), SLJIT_S(i), 0);
+
+	for (inst++; inst < end; inst++) {
+		dst = inst->dst;
+		dstw = inst->dstw;
+		src1 = inst->src1;
+		src1w = inst->src1w;
+		src2 = inst->src2;
+		src2w = inst->src2w;
+		tmp_reg = SLJIT_R0;
+
+		switch (inst->type) {
+		case RA_OP1:
+			lower_operand(ra, compiler, &src1, &src1w, &tmp_reg);
+			lower_operand(ra, compiler, &dst, &dstw, &tmp_reg);
+			sljit_emit_op1(compiler, inst->op, dst, dstw, src1, src1w);
+			break;
+		case RA_OP2:
+			emit_op2(ra, compiler, inst);
+			break;
+		case RA_LABEL:
+			inst->u.label->label = sljit_emit_label(compiler);
+			break;
+		case RA_JUMP:
+			inst->u.jump->jump = sljit_emit_jump(compiler, inst->op);
+			break;
+		case RA_CMP:
+			lower_operand(ra, compiler, &src1, &src1w, &tmp_reg);
+			lower_operand(ra, compiler, &src2, &src2w, &tmp_reg);
+			inst->u.jump->jump = sljit_emit_cmp(compiler, inst->op, src1, src1w, src2, src2w);
+			break;
+		case RA_CALL:
+			emit_call(ra, compiler, inst);
+			break;
+		case RA_RETURN:
+			if (inst->op != SLJIT_UNUSED)
+				lower_operand(ra, compiler, &src1, &src1w, &tmp_reg);
+			sljit_emit_return(compiler, inst->op, src1, src1w);
+			break;
+		}
+	}
+
+	if (sljit_get_compiler_error(compiler))
+		return sljit_get_compiler_error(compiler);
+
+	for (jump = ra->jumps; jump; jump = jump->next)
+		sljit_set_label(jump->jump, jump->target->label);
+	return SLJIT_SUCCESS;
+}
+
+int sljit_ra_compile(struct sljit_ra *ra, struct sljit_compiler *compiler)
+{
+	struct ra_interval *intervals;
+	struct sljit_ra_jump *jump;
+
+	if (ra->error)
+		return ra->error;
+	if (ra->inst_count == 0) {
+		ra->error = SLJIT_ERR_BAD_ARGUMENT;
+		return ra->error;
+	}
+	for (jump = ra->jumps; jump; jump = jump->next) {
+		if (!jump->target) {
+			ra->error = SLJIT_ERR_BAD_ARGUMENT;
+			return ra->error;
+		}
+	}
+
+	ra_free(ra, ra->reg);
+	ra_free(ra, ra->slot);
+	ra->reg = (int*)ra_alloc(ra, (ra->vregs + 1) * sizeof(int));
+	ra->slot = (int*)ra_alloc(ra, (ra->vregs + 1) * sizeof(int));
+	intervals = (struct ra_interval*)ra_alloc(ra, (ra->vregs + 1) * sizeof(struct ra_interval));
+	if (!ra->reg || !ra->slot || !intervals) {
+		ra_free(ra, intervals);
+		ra->error = SLJIT_ERR_ALLOC_FAILED;
+		return ra->error;
+	}
+
+	ra->error = compute_intervals(ra, intervals);
+	if (!ra->error)
+		ra->error = mark_call_crossing(ra, intervals);
+	if (!ra->error) {
+		/* The temporaries are allocated first, and reserved only if
+		   the resulting code needs them. */
+		ra->error = linear_scan(ra, intervals, 0);
+		if (!ra->error && needs_temporaries(ra))
+			ra->error = linear_scan(ra, intervals, RA_TEMPORARIES);
+	}
+	ra_free(ra, intervals);
+
+	if (!ra->error)
+		ra->error = emit_code(ra, compiler);
+	return ra->error;
+}
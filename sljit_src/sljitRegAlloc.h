@@ -0,0 +1,142 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2012 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SLJIT_REG_ALLOC_H_
+#define _SLJIT_REG_ALLOC_H_
+
+/*
+   ------------------------------------------------------------------------
+    Virtual register layer
+   ------------------------------------------------------------------------
+
+   The functions below record the code of a single function, which uses
+   an unlimited number of virtual registers instead of the SLJIT_R and
+   SLJIT_S registers. The sljit_ra_compile function maps the virtual
+   registers to machine registers with a linear scan register allocator
+   and emits the code (starting with sljit_emit_enter) into a compiler.
+   The scratches and saveds arguments of sljit_emit_enter are computed
+   from the result of the allocation. Virtual registers, which cannot be
+   kept in machine registers, are spilled to the local area.
+
+   The file is not included by sljitLir.c: add sljitRegAlloc.c to the
+   build environment when the layer is used.
+
+   Operand forms (arg, argw):
+     SLJIT_VREG(n), 0    : virtual register n (n >= 0)
+     SLJIT_VMEM1(n), w   : memory at the address stored in virtual
+                           register n increased by w
+     SLJIT_MEM0(), w     : memory at the absolute address w
+     SLJIT_MEM1(SLJIT_SP), w : the local area requested by the local_size
+                           argument of sljit_ra_emit_enter
+     SLJIT_IMM, w        : immediate (source only)
+     SLJIT_UNUSED, 0     : the result is discarded (destination only)
+
+   Supported: integer sljit_emit_op1 (except SLJIT_MOVU forms) and
+   sljit_emit_op2 operations including the status flags, labels, jumps,
+   compares, calls and return. Floating point operations are not
+   supported. The machine registers R0 - R2 hold the call arguments and
+   the bases of spilled memory operands: they are allocated only when the
+   function has no calls and every memory operand has its base in a
+   machine register.
+*/
+
+#include "sljitLir.h"
+
+#define SLJIT_VREG(n)		(((n) + 1) << 8)
+#define SLJIT_VMEM1(n)		(SLJIT_MEM | SLJIT_VREG(n))
+
+struct sljit_ra;
+struct sljit_ra_label;
+struct sljit_ra_jump;
+
+/* Returns NULL if there is not enough memory. */
+struct sljit_ra* sljit_ra_create(void);
+
+/* Same as sljit_ra_create, except all memory of the ra (including the
+   temporary buffers of sljit_ra_compile) is allocated by the passed
+   allocator (see struct sljit_allocator). The allocator is copied into
+   the ra. A NULL allocator selects malloc and free. */
+struct sljit_ra* sljit_ra_create_with_allocator(const struct sljit_allocator *allocator);
+void sljit_ra_free(struct sljit_ra *ra);
+
+/* Returns with the first error of the recording functions or
+   sljit_ra_compile. Errors are sticky: the recording functions
+   do nothing after an error. */
+int sljit_ra_get_error(struct sljit_ra *ra);
+
+/* Must be the first recorded operation. The arguments are passed
+   in SLJIT_VREG(0) - SLJIT_VREG(args - 1). The options and local_size
+   arguments are passed to sljit_emit_enter (the spill slots are
+   allocated after the local_size bytes). */
+int sljit_ra_emit_enter(struct sljit_ra *ra, int options, int args, int local_size);
+
+int sljit_ra_emit_op1(struct sljit_ra *ra, int op,
+	int dst, long dstw,
+	int src, long srcw);
+
+int sljit_ra_emit_op2(struct sljit_ra *ra, int op,
+	int dst, long dstw,
+	int src1, long src1w,
+	int src2, long src2w);
+
+/* The returned labels and jumps are owned by the ra. */
+struct sljit_ra_label* sljit_ra_emit_label(struct sljit_ra *ra);
+
+/* The type must be a flag condition or SLJIT_JUMP. */
+struct sljit_ra_jump* sljit_ra_emit_jump(struct sljit_ra *ra, int type);
+
+struct sljit_ra_jump* sljit_ra_emit_cmp(struct sljit_ra *ra, int type,
+	int src1, long src1w,
+	int src2, long src2w);
+
+/* Every jump must have a target before sljit_ra_compile is called. */
+void sljit_ra_set_label(struct sljit_ra_jump *jump, struct sljit_ra_label *label);
+
+/* Calls the function specified by src / srcw (SLJIT_IMM, SLJIT_VREG,
+   SLJIT_MEM0 or SLJIT_MEM1(SLJIT_SP) operand). The type is between
+   SLJIT_CALL0 and SLJIT_CALL3, and args contains the virtual registers
+   (SLJIT_VREG form) of the arguments. The return value is stored into
+   dst, which is an SLJIT_VREG or SLJIT_UNUSED. */
+int sljit_ra_emit_call(struct sljit_ra *ra, int type, int dst, const int *args,
+	int src, long srcw);
+
+/* Same as sljit_emit_return. */
+int sljit_ra_emit_return(struct sljit_ra *ra, int op,
+	int src, long srcw);
+
+/* Allocates the registers, and emits the recorded function into the
+   compiler. The jumps and labels are set as well, so the code can be
+   generated by sljit_generate_code afterwards. */
+int sljit_ra_compile(struct sljit_ra *ra, struct sljit_compiler *compiler);
+
+/* Results of the last sljit_ra_compile call: the number of virtual
+   registers kept in the local area, and the number of scratch and saved
+   registers passed to sljit_emit_enter. */
+int sljit_ra_get_spilled_vregs(struct sljit_ra *ra);
+int sljit_ra_get_scratches(struct sljit_ra *ra);
+int sljit_ra_get_saveds(struct sljit_ra *ra);
+
+#endif /* _SLJIT_REG_ALLOC_H_ */
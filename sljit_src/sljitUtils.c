@@ -34,14 +34,16 @@
 
 #if (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
 
-static __inline void allocator_grab_lock(void)
+static __inline void allocator_grab_lock(int shard)
 {
 	/* Always successful. */
+	(void)shard;
 }
 
-static __inline void allocator_release_lock(void)
+static __inline void allocator_release_lock(int shard)
 {
 	/* Always successful. */
+	(void)shard;
 }
 
 #endif /* SLJIT_EXECUTABLE_ALLOCATOR */
@@ -66,20 +68,20 @@ void SLJIT_CALL sljit_release_lock(void)
 
 #if (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
 
-static HANDLE allocator_mutex = 0;
+static HANDLE allocator_mutex[SLJIT_EXECUTABLE_ALLOCATOR_SHARDS];
 
-static __inline void allocator_grab_lock(void)
+static __inline void allocator_grab_lock(int shard)
 {
 	/* No idea what to do if an error occures. Static mutexes should never fail... */
-	if (!allocator_mutex)
-		allocator_mutex = CreateMutex(NULL, TRUE, NULL);
+	if (!allocator_mutex[shard])
+		allocator_mutex[shard] = CreateMutex(NULL, TRUE, NULL);
 	else
-		WaitForSingleObject(allocator_mutex, INFINITE);
+		WaitForSingleObject(allocator_mutex[shard], INFINITE);
 }
 
-static __inline void allocator_release_lock(void)
+static __inline void allocator_release_lock(int shard)
 {
-	ReleaseMutex(allocator_mutex);
+	ReleaseMutex(allocator_mutex[shard]);
 }
 
 #endif /* SLJIT_EXECUTABLE_ALLOCATOR */
@@ -110,18 +112,48 @@ void SLJIT_CALL sljit_release_lock(void)
 
 #include <pthread.h>
 
+#if (SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1)
+
+static pthread_mutex_t allocator_mutex[SLJIT_EXECUTABLE_ALLOCATOR_SHARDS];
+static pthread_once_t allocator_mutex_once = PTHREAD_ONCE_INIT;
+
+static void init_allocator_mutex(void)
+{
+	int i;
+
+	for (i = 0; i < SLJIT_EXECUTABLE_ALLOCATOR_SHARDS; i++)
+		pthread_mutex_init(&allocator_mutex[i], NULL);
+}
+
+static __inline void allocator_grab_lock(int shard)
+{
+	pthread_once(&allocator_mutex_once, init_allocator_mutex);
+	pthread_mutex_lock(&allocator_mutex[shard]);
+}
+
+static __inline void allocator_release_lock(int shard)
+{
+	pthread_mutex_unlock(&allocator_mutex[shard]);
+}
+
+#else /* SLJIT_EXECUTABLE_ALLOCATOR_SHARDS <= 1 */
+
 static pthread_mutex_t allocator_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static __inline void allocator_grab_lock(void)
+static __inline void allocator_grab_lock(int shard)
 {
+	(void)shard;
 	pthread_mutex_lock(&allocator_mutex);
 }
 
-static __inline void allocator_release_lock(void)
+static __inline void allocator_release_lock(int shard)
 {
+	(void)shard;
 	pthread_mutex_unlock(&allocator_mutex);
 }
 
+#endif /* SLJIT_EXECUTABLE_ALLOCATOR_SHARDS > 1 */
+
 #endif /* SLJIT_EXECUTABLE_ALLOCATOR */
 
 #if (defined SLJIT_UTIL_GLOBAL_LOCK && SLJIT_UTIL_GLOBAL_LOCK)
@@ -0,0 +1,156 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+   Multi-threaded stress benchmark of the executable allocator.
+
+   Every thread allocates and frees blocks of random size. A part of the
+   blocks is exchanged through a shared table, so they are freed by a
+   different thread than the one which allocated them. The benchmark is
+   built twice: bin/alloc_bench uses a sharded allocator and
+   bin/alloc_bench_global uses the single global allocator.
+
+   Usage: alloc_bench [max_threads] [operations_per_thread]
+*/
+
+#include <err.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sljitBenchUtil.h"
+
+#define LOCAL_SLOTS	64
+#define SHARED_SLOTS	1024
+
+static void* volatile shared_slots[SHARED_SLOTS];
+static long operations;
+
+struct thread_data {
+	pthread_t thread;
+	unsigned int seed;
+};
+
+static unsigned int next_random(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 8;
+}
+
+static void* bench_thread(void *arg)
+{
+	struct thread_data *data = (struct thread_data*)arg;
+	void *local_slots[LOCAL_SLOTS];
+	void *ptr;
+	unsigned int rnd;
+	unsigned long size;
+	long i;
+
+	memset(local_slots, 0, sizeof(local_slots));
+
+	for (i = 0; i < operations; i++) {
+		rnd = next_random(&data->seed);
+		size = 64 + (rnd & 0x7ff);
+
+		ptr = sljit_malloc_exec(size);
+		if (!ptr)
+			errx(1, "cannot allocate executable memory");
+		/* Touch the memory like a code generator. */
+		*(u_char*)ptr = 0xc3;
+
+		if (rnd & 0x3000) {
+			rnd = (rnd >> 16) % LOCAL_SLOTS;
+			if (local_slots[rnd])
+				sljit_free_exec(local_slots[rnd]);
+			local_slots[rnd] = ptr;
+		}
+		else {
+			/* Cross-thread free: the previous owner of the slot is
+			   usually allocated by another thread. */
+			ptr = __sync_lock_test_and_set(&shared_slots[(rnd >> 16) % SHARED_SLOTS], ptr);
+			if (ptr)
+				sljit_free_exec(ptr);
+		}
+	}
+
+	for (i = 0; i < LOCAL_SLOTS; i++)
+		if (local_slots[i])
+			sljit_free_exec(local_slots[i]);
+	return NULL;
+}
+
+static double run_bench(int thread_count)
+{
+	struct thread_data *threads;
+	double start, end;
+	int i;
+
+	threads = (struct thread_data*)calloc(thread_count, sizeof(struct thread_data));
+	if (!threads)
+		errx(1, "out of memory");
+
+	start = now_ns();
+	for (i = 0; i < thread_count; i++) {
+		threads[i].seed = 0x1234567 * (i + 1);
+		if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]))
+			errx(1, "cannot create thread");
+	}
+	for (i = 0; i < thread_count; i++)
+		pthread_join(threads[i].thread, NULL);
+	end = now_ns();
+
+	for (i = 0; i < SHARED_SLOTS; i++)
+		if (shared_slots[i]) {
+			sljit_free_exec(shared_slots[i]);
+			shared_slots[i] = NULL;
+		}
+	sljit_free_unused_memory_exec();
+
+	free(threads);
+	return (end - start) / 1e9;
+}
+
+int main(int argc, char* argv[])
+{
+	int max_threads = (argc >= 2) ? atoi(argv[1]) : 16;
+	int thread_count;
+	double elapsed;
+
+	operations = (argc >= 3) ? atol(argv[2]) : 200000;
+	if (max_threads < 1 || operations < 1)
+		errx(1, "usage: %s [max_threads] [operations_per_thread]", argv[0]);
+
+	printf("Executable allocator shards: %d\n", SLJIT_EXECUTABLE_ALLOCATOR_SHARDS);
+	printf("threads   time (s)   Mops/s\n");
+	for (thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+		elapsed = run_bench(thread_count);
+		printf("%7d %10.3f %8.2f\n", thread_count, elapsed,
+			(double)thread_count * operations / elapsed / 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2012 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SLJIT_BENCH_UTIL_H_
+#define _SLJIT_BENCH_UTIL_H_
+
+/*
+   Helpers shared by the benchmarks of test_src.
+
+   Benchmarks which measure the programs of sljitTest.c define
+   BENCH_TEST_SUITE before including this file. The tests are compiled
+   through wrappers, which add suite_options to the options of every
+   sljit_emit_enter call and sum the generated code sizes into
+   suite_code_size. The tests can read the added options from
+   TEST_SUITE_OPTIONS.
+*/
+
+#include <time.h>
+
+#include "sljitLir.h"
+
+static __inline double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Returns with zero if the time stamp counter is not available. */
+static __inline unsigned long long read_cycles(void)
+{
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+#ifdef BENCH_TEST_SUITE
+
+static int suite_options;
+static unsigned long suite_code_size;
+
+static int suite_emit_enter(struct sljit_compiler *compiler,
+	int options, int args, int scratches, int saveds,
+	int fscratches, int fsaveds, int local_size)
+{
+	return sljit_emit_enter(compiler, options | suite_options, args, scratches, saveds, fscratches, fsaveds, local_size);
+}
+
+static void* suite_generate_code(struct sljit_compiler *compiler)
+{
+	void *code = sljit_generate_code(compiler);
+
+	if (code)
+		suite_code_size += sljit_get_generated_code_size(compiler);
+	return code;
+}
+
+#define TEST_SUITE_OPTIONS suite_options
+#define sljit_emit_enter suite_emit_enter
+#define sljit_generate_code suite_generate_code
+#include "sljitTest.c"
+#undef sljit_emit_enter
+#undef sljit_generate_code
+
+#endif /* BENCH_TEST_SUITE */
+
+#endif /* _SLJIT_BENCH_UTIL_H_ */
@@ -0,0 +1,290 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+   Floating point kernels which need many float registers.
+
+   The polynomial kernel evaluates a degree 11 polynomial with Horner's
+   method for every element of an array and sums the results. The dot
+   kernel computes a dot product with eight partial sums. Each kernel is
+   compiled twice: with 6 float registers (the number available before
+   all XMM / NEON registers were exposed), where the values which do not
+   fit are kept in locals, and with all SLJIT_NUM_FLOAT_REGS registers.
+   The results are compared, and the run time per element is printed.
+
+   The floating point tests of sljitTest.c are measured as well: the
+   total size of their generated code, and the time of compiling and
+   running all of them once. Except test52, which uses every float
+   register, these tests need at most six float registers, so they
+   show the cost of the wider register file rather than a gain.
+
+   Usage: float_reg_bench [elements] [rounds]
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_TEST_SUITE
+#include "sljitBenchUtil.h"
+
+/* The tests of sljitTest.c which use floating point operations. */
+static void (*const suite_tests[])(void) = {
+	test13, test14, test26, test32, test39, test41,
+	test43, test45, test48, test49, test50, test52,
+};
+
+#define SUITE_TEST_COUNT (int)(sizeof(suite_tests) / sizeof(suite_tests[0]))
+
+typedef long (SLJIT_CALL *bench_func)(long data, long length, long consts);
+
+#define LIMITED_FLOAT_REGS 6
+#define POLY_DEGREE 11
+#define DOT_SUMS 8
+
+/* Layout of the consts array. */
+#define CONST_ZERO (POLY_DEGREE + 1)
+#define CONST_RESULT (POLY_DEGREE + 2)
+#define CONST_COUNT (POLY_DEGREE + 3)
+
+/* Value number index is kept in a float register if it is below
+   regs, and in the local area otherwise. */
+static void get_value(int regs, int index, int *arg, long *argw)
+{
+	if (index < regs) {
+		*arg = SLJIT_FR(index);
+		*argw = 0;
+		return;
+	}
+	*arg = SLJIT_MEM1(SLJIT_SP);
+	*argw = (index - regs) * sizeof(double);
+}
+
+/* Values: x, acc, sum, c0 ... c11. */
+static void emit_poly(struct sljit_compiler *compiler, int regs)
+{
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	int x, acc, sum, c;
+	long xw, accw, sumw, cw;
+	int k;
+
+	get_value(regs, 0, &x, &xw);
+	get_value(regs, 1, &acc, &accw);
+	get_value(regs, 2, &sum, &sumw);
+
+	for (k = 0; k <= POLY_DEGREE; k++) {
+		get_value(regs, 3 + k, &c, &cw);
+		sljit_emit_fop1(compiler, SLJIT_DMOV, c, cw, SLJIT_MEM1(SLJIT_S2), k * sizeof(double));
+	}
+	sljit_emit_fop1(compiler, SLJIT_DMOV, sum, sumw, SLJIT_MEM1(SLJIT_S2), CONST_ZERO * sizeof(double));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+
+	loop = sljit_emit_label(compiler);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, x, xw, SLJIT_MEM2(SLJIT_S0, SLJIT_R0), SLJIT_DOUBLE_SHIFT);
+	get_value(regs, 3 + POLY_DEGREE, &c, &cw);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, acc, accw, c, cw);
+	for (k = POLY_DEGREE - 1; k >= 0; k--) {
+		get_value(regs, 3 + k, &c, &cw);
+		sljit_emit_fop2(compiler, SLJIT_DMUL, acc, accw, acc, accw, x, xw);
+		sljit_emit_fop2(compiler, SLJIT_DADD, acc, accw, acc, accw, c, cw);
+	}
+	sljit_emit_fop2(compiler, SLJIT_DADD, sum, sumw, sum, sumw, acc, accw);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_set_label(jump, loop);
+
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S2), CONST_RESULT * sizeof(double), sum, sumw);
+}
+
+/* Values: t, p0 ... p7. The second array follows the first one. */
+static void emit_dot(struct sljit_compiler *compiler, int regs)
+{
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	int t, p, p0;
+	long tw, pw, p0w;
+	int k;
+
+	get_value(regs, 0, &t, &tw);
+	get_value(regs, 1, &p0, &p0w);
+
+	for (k = 0; k < DOT_SUMS; k++) {
+		get_value(regs, 1 + k, &p, &pw);
+		sljit_emit_fop1(compiler, SLJIT_DMOV, p, pw, SLJIT_MEM1(SLJIT_S2), CONST_ZERO * sizeof(double));
+	}
+
+	/* S1 is the end of the first array, which is the start of the second. */
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R0, 0, SLJIT_S1, 0, SLJIT_IMM, SLJIT_DOUBLE_SHIFT);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S1, 0, SLJIT_S0, 0, SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+
+	loop = sljit_emit_label(compiler);
+	for (k = 0; k < DOT_SUMS; k++) {
+		get_value(regs, 1 + k, &p, &pw);
+		sljit_emit_fop1(compiler, SLJIT_DMOV, t, tw, SLJIT_MEM1(SLJIT_R0), k * sizeof(double));
+		sljit_emit_fop2(compiler, SLJIT_DMUL, t, tw, t, tw, SLJIT_MEM1(SLJIT_R1), k * sizeof(double));
+		sljit_emit_fop2(compiler, SLJIT_DADD, p, pw, p, pw, t, tw);
+	}
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, DOT_SUMS * sizeof(double));
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, DOT_SUMS * sizeof(double));
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_set_label(jump, loop);
+
+	for (k = 1; k < DOT_SUMS; k++) {
+		get_value(regs, 1 + k, &p, &pw);
+		sljit_emit_fop2(compiler, SLJIT_DADD, p0, p0w, p0, p0w, p, pw);
+	}
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S2), CONST_RESULT * sizeof(double), p0, p0w);
+}
+
+static const struct {
+	const char *name;
+	int values;
+	void (*emit_body)(struct sljit_compiler *compiler, int regs);
+} programs[] = {
+	{ "polynomial", 3 + POLY_DEGREE + 1, emit_poly },
+	{ "dot", 1 + DOT_SUMS, emit_dot },
+};
+
+#define PROGRAM_COUNT (int)(sizeof(programs) / sizeof(programs[0]))
+
+static unsigned long run_suite(long rounds, double *us)
+{
+	unsigned long code_size;
+	double start;
+	long i;
+	int k;
+
+	silent = 1;
+	suite_code_size = 0;
+	for (k = 0; k < SUITE_TEST_COUNT; k++)
+		suite_tests[k]();
+	code_size = suite_code_size;
+
+	start = now_ns();
+	for (i = 0; i < rounds; i++)
+		for (k = 0; k < SUITE_TEST_COUNT; k++)
+			suite_tests[k]();
+	*us = (now_ns() - start) / (rounds * 1000.0);
+
+	if (successful_tests != (rounds + 1) * SUITE_TEST_COUNT)
+		errx(1, "sljitTest.c: %d of %ld tests failed", (int)((rounds + 1) * SUITE_TEST_COUNT - successful_tests), (rounds + 1) * SUITE_TEST_COUNT);
+	return code_size;
+}
+
+static void* compile_program(int index, int regs)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler();
+	int values = programs[index].values;
+	void *code;
+
+	if (!compiler)
+		errx(1, "cannot create compiler");
+
+	if (regs > values)
+		regs = values;
+
+	sljit_emit_enter(compiler, 0, 3, 2, 3, regs, 0, (values - regs) * sizeof(double));
+	programs[index].emit_body(compiler, regs);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code = sljit_generate_code(compiler);
+	if (!code)
+		errx(1, "cannot generate code: %d", sljit_get_compiler_error(compiler));
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static double run_program(int index, int regs, double *data, long length, double *consts, long rounds, double *ns)
+{
+	void *code = compile_program(index, regs);
+	bench_func func = (bench_func)SLJIT_FUNC_OFFSET(code);
+	double start;
+	long i;
+
+	/* Warm up. */
+	func((long)data, length, (long)consts);
+
+	start = now_ns();
+	for (i = 0; i < rounds; i++)
+		func((long)data, length, (long)consts);
+	*ns = (now_ns() - start) / ((double)rounds * length);
+
+	sljit_free_code(code);
+	return consts[CONST_RESULT];
+}
+
+int main(int argc, char *argv[])
+{
+	long length = 4096;
+	long rounds = 20000;
+	double consts[CONST_COUNT];
+	double *data;
+	double before, after, ns_before, ns_after, suite_us;
+	unsigned long suite_size;
+	long i;
+	int k;
+
+	if (argc >= 2)
+		length = atol(argv[1]);
+	if (argc >= 3)
+		rounds = atol(argv[2]);
+	if (length <= 0 || (length % DOT_SUMS) != 0 || rounds <= 0)
+		errx(1, "invalid arguments (the element count must be a multiple of %d)", DOT_SUMS);
+
+	/* The dot kernel reads two arrays. */
+	data = (double*)malloc(2 * length * sizeof(double));
+	if (!data)
+		errx(1, "out of memory");
+	for (i = 0; i < 2 * length; i++)
+		data[i] = (double)(i % 97) / 97.0 - 0.5;
+	for (k = 0; k <= POLY_DEGREE; k++)
+		consts[k] = 1.0 / (k + 1);
+	consts[CONST_ZERO] = 0.0;
+
+	printf("float regs: %d (limited: %d)\n", SLJIT_NUM_FLOAT_REGS, LIMITED_FLOAT_REGS);
+
+	suite_size = run_suite(rounds / 100 + 1, &suite_us);
+	printf("sljitTest.c float tests: %d tests, %lu bytes, %.1f us/round\n\n", SUITE_TEST_COUNT, suite_size, suite_us);
+
+	printf("%-12s %14s %14s\n", "program", "ns/elem(6)", "ns/elem(all)");
+
+	for (k = 0; k < PROGRAM_COUNT; k++) {
+		before = run_program(k, LIMITED_FLOAT_REGS, data, length, consts, rounds, &ns_before);
+		after = run_program(k, SLJIT_NUM_FLOAT_REGS, data, length, consts, rounds, &ns_after);
+
+		if (before != after)
+			errx(1, "%s: result mismatch: %f != %f", programs[k].name, before, after);
+
+		printf("%-12s %14.3f %14.3f\n", programs[k].name, ns_before, ns_after);
+	}
+
+	free(data);
+	return 0;
+}
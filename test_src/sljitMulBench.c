@@ -0,0 +1,144 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+   Multiplication by immediates, which are replaced by shifts, LEA
+   instructions (x86) or shifted additions and subtractions (ARM-64).
+
+   For every multiplier in the range, a loop computing a dependent chain
+   of multiplications is compiled twice: with the multiplier as an
+   immediate operand, and with the multiplier loaded into a register,
+   which always emits a multiply instruction. The results are compared,
+   and the code size and the run time per iteration are printed.
+
+   Usage: mul_bench [first multiplier] [last multiplier] [iterations]
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sljitBenchUtil.h"
+
+typedef long (SLJIT_CALL *bench_func)(long iterations, long multiplier);
+
+struct bench_result {
+	unsigned long code_size;
+	long value;
+	double ns;
+};
+
+static void* compile_program(long multiplier, int use_imm, unsigned long *code_size)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler();
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	void *code;
+
+	if (!compiler)
+		errx(1, "cannot create compiler");
+
+	/* for (R1 = 0; R1 != S0; R1++) R0 = R0 * multiplier + R1; return R0; */
+	sljit_emit_enter(compiler, 0, 2, 2, 2, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 0);
+	loop = sljit_emit_label(compiler);
+	if (use_imm)
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, multiplier);
+	else
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R1, 0, SLJIT_S0, 0);
+	sljit_set_label(jump, loop);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code = sljit_generate_code(compiler);
+	if (!code)
+		errx(1, "cannot generate code: %d", sljit_get_compiler_error(compiler));
+	*code_size = sljit_get_generated_code_size(compiler);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static void run_program(long multiplier, int use_imm, long iterations, struct bench_result *result)
+{
+	void *code = compile_program(multiplier, use_imm, &result->code_size);
+	bench_func func = (bench_func)SLJIT_FUNC_OFFSET(code);
+	double start;
+
+	/* Warm up. */
+	func(iterations / 10 + 1, multiplier);
+
+	start = now_ns();
+	result->value = func(iterations, multiplier);
+	result->ns = now_ns() - start;
+
+	sljit_free_code(code);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_result reg;
+	struct bench_result imm;
+	long first = 1;
+	long last = 1024;
+	long iterations = 1000000;
+	double reg_total = 0.0, imm_total = 0.0;
+	long multiplier;
+
+	if (argc >= 2)
+		first = atol(argv[1]);
+	if (argc >= 3)
+		last = atol(argv[2]);
+	if (argc >= 4)
+		iterations = atol(argv[3]);
+	if (first > last || iterations <= 0)
+		errx(1, "invalid arguments");
+
+	printf("%-10s %10s %10s %12s %12s\n", "multiplier", "size(reg)", "size(imm)",
+		"ns/iter(reg)", "ns/iter(imm)");
+
+	for (multiplier = first; multiplier <= last; multiplier++) {
+		run_program(multiplier, 0, iterations, &reg);
+		run_program(multiplier, 1, iterations, &imm);
+
+		if (reg.value != imm.value)
+			errx(1, "%ld: result mismatch: %ld != %ld", multiplier, reg.value, imm.value);
+
+		printf("%-10ld %10lu %10lu %12.3f %12.3f\n", multiplier, reg.code_size, imm.code_size,
+			reg.ns / iterations, imm.ns / iterations);
+		reg_total += reg.ns;
+		imm_total += imm.ns;
+	}
+
+	printf("%-10s %10s %10s %12.3f %12.3f\n", "average", "", "",
+		reg_total / ((double)iterations * (last - first + 1)),
+		imm_total / ((double)iterations * (last - first + 1)));
+	return 0;
+}
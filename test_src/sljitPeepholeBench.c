@@ -0,0 +1,217 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+   Code size and speed of the peephole optimizer (SLJIT_PEEPHOLE_OPTIMIZER).
+
+   First the programs of sljitTest.c are compiled and run without and
+   with the optimizer, and the total size of the generated code is
+   printed. These programs run only once, so their run time is
+   dominated by the compilation and the result checks.
+
+   The cycle counts are measured on loops which follow the instruction
+   patterns of sljitTest.c: locals used as temporaries, the virtual
+   registers of x86-32 and operations with SLJIT_KEEP_FLAGS. The generic
+   program contains the patterns removed by the optimizer. Every
+   program is compiled without and with the optimizer, the results are
+   compared, and the generated code size and the run time of the loop
+   are printed.
+
+   Usage: peephole_bench [iterations]
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_TEST_SUITE
+#include "sljitBenchUtil.h"
+
+static unsigned long run_suite(int options)
+{
+	char *argv[] = { "peephole_bench", "-s", NULL };
+
+	suite_options = options;
+	suite_code_size = 0;
+	successful_tests = 0;
+	sljit_test(2, argv);
+	return suite_code_size;
+}
+
+typedef long (SLJIT_CALL *bench_func)(long iterations);
+
+struct bench_result {
+	unsigned long code_size;
+	long value;
+	double ns;
+	unsigned long long cycles;
+};
+
+/* sum += ((i + sum) * 3) ^ i, the values pass through the locals. */
+static void emit_locals(struct sljit_compiler *compiler)
+{
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R2, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+	sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_MEM1(SLJIT_SP), 2 * sizeof(long), SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, 3);
+	sljit_emit_op2(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), 2 * sizeof(long), SLJIT_R2, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_R0, 0);
+}
+
+/* The same computation with the higher registers, which are
+   mapped to the local area on x86-32. */
+static void emit_virtual_regs(struct sljit_compiler *compiler)
+{
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R3, 0, SLJIT_R2, 0, SLJIT_S2, 0);
+	sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R4, 0, SLJIT_R3, 0, SLJIT_IMM, 3);
+	sljit_emit_op2(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R4, 0, SLJIT_R2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S2, 0, SLJIT_S2, 0, SLJIT_R0, 0);
+}
+
+/* Flags are computed once and kept across operations which modify them. */
+static void emit_keep_flags(struct sljit_compiler *compiler)
+{
+	sljit_emit_op2(compiler, SLJIT_AND | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R2, 0, SLJIT_IMM, 1);
+	sljit_emit_op2(compiler, SLJIT_MUL | SLJIT_KEEP_FLAGS, SLJIT_R0, 0, SLJIT_R2, 0, SLJIT_IMM, 5);
+	sljit_emit_op_flags(compiler, SLJIT_OR | SLJIT_KEEP_FLAGS, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_ZERO);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_KEEP_FLAGS, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R2, 0);
+	sljit_emit_op_flags(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_NOT_ZERO);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_R0, 0);
+}
+
+/* Generic code which scales by an element size of 1 and spills a
+   temporary, while the flags of a test are kept. The flags are saved
+   and restored with nothing between them, and the spilled value is
+   reloaded right after it is stored. */
+static void emit_generic(struct sljit_compiler *compiler)
+{
+	sljit_emit_op2(compiler, SLJIT_AND | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R2, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_R2, 0);
+	sljit_emit_op2(compiler, SLJIT_MUL | SLJIT_KEEP_FLAGS, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	sljit_emit_op_flags(compiler, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_ZERO);
+	sljit_emit_op2(compiler, SLJIT_AND | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R0, 0, SLJIT_IMM, 2);
+	sljit_emit_op2(compiler, SLJIT_SHL | SLJIT_KEEP_FLAGS, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 0);
+	sljit_emit_op_flags(compiler, SLJIT_OR, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_NOT_ZERO);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 2 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_SP), 2 * sizeof(long));
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_R1, 0);
+}
+
+static const struct {
+	const char *name;
+	void (*emit_body)(struct sljit_compiler *compiler);
+} programs[] = {
+	{ "locals", emit_locals },
+	{ "virtual_regs", emit_virtual_regs },
+	{ "keep_flags", emit_keep_flags },
+	{ "generic", emit_generic },
+};
+
+#define PROGRAM_COUNT (int)(sizeof(programs) / sizeof(programs[0]))
+
+static void* compile_program(int index, int options, unsigned long *code_size)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler();
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	void *code;
+
+	if (!compiler)
+		errx(1, "cannot create compiler");
+
+	/* for (R2 = 0; R2 != S0; R2++) body; return sum; */
+	sljit_emit_enter(compiler, options, 1, 5, 3, 0, 0, 3 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S2, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 0);
+	loop = sljit_emit_label(compiler);
+	programs[index].emit_body(compiler);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R2, 0, SLJIT_R2, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R2, 0, SLJIT_S0, 0);
+	sljit_set_label(jump, loop);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_RETURN_REG, 0, SLJIT_S2, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
+
+	code = sljit_generate_code(compiler);
+	if (!code)
+		errx(1, "cannot generate code: %d", sljit_get_compiler_error(compiler));
+	*code_size = sljit_get_generated_code_size(compiler);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static void run_program(int index, int options, long iterations, struct bench_result *result)
+{
+	void *code = compile_program(index, options, &result->code_size);
+	bench_func func = (bench_func)SLJIT_FUNC_OFFSET(code);
+	unsigned long long cycles;
+	double start;
+
+	/* Warm up. */
+	func(iterations / 10 + 1);
+
+	start = now_ns();
+	cycles = read_cycles();
+	result->value = func(iterations);
+	result->cycles = read_cycles() - cycles;
+	result->ns = now_ns() - start;
+
+	sljit_free_code(code);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_result before;
+	struct bench_result after;
+	long iterations = 50000000;
+	int i;
+
+	if (argc >= 2)
+		iterations = atol(argv[1]);
+	if (iterations <= 0)
+		errx(1, "invalid iteration count");
+
+	before.code_size = run_suite(0);
+	after.code_size = run_suite(SLJIT_PEEPHOLE_OPTIMIZER);
+	printf("sljitTest.c programs: %lu bytes, %lu bytes with the optimizer\n\n", before.code_size, after.code_size);
+
+	printf("%-14s %10s %10s %12s %12s %12s %12s\n", "program", "size", "size(opt)",
+		"ns/iter", "ns/iter(opt)", "cyc/iter", "cyc/iter(opt)");
+
+	for (i = 0; i < PROGRAM_COUNT; i++) {
+		run_program(i, 0, iterations, &before);
+		run_program(i, SLJIT_PEEPHOLE_OPTIMIZER, iterations, &after);
+
+		if (before.value != after.value)
+			errx(1, "%s: result mismatch: %ld != %ld", programs[i].name, before.value, after.value);
+
+		printf("%-14s %10lu %10lu %12.3f %12.3f %12.3f %12.3f\n", programs[i].name,
+			before.code_size, after.code_size,
+			before.ns / iterations, after.ns / iterations,
+			(double)before.cycles / iterations, (double)after.cycles / iterations);
+	}
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+   Random access gather loop with and without software prefetch.
+
+   The program computes sum(table[index[i]]), where the table is much
+   larger than the caches and the index array is random, so every
+   iteration waits for a cache miss. In the dependent loop the address
+   also depends on the sum computed so far (the dependency does not
+   change the result), so the misses cannot overlap, like in pointer
+   chasing code. The prefetching variants load index[i + distance] and
+   prefetch the table entry it refers to before the current entry is
+   read. The run time per element is printed for each prefetch operation.
+
+   Usage: prefetch_bench [table size in MB] [distance] [rounds]
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sljitBenchUtil.h"
+
+typedef long (SLJIT_CALL *bench_func)(long index, long length, long table);
+
+static const struct {
+	const char *name;
+	int op;
+} programs[] = {
+	{ "none", 0 },
+	{ "l1", SLJIT_PREFETCH_L1 },
+	{ "l2", SLJIT_PREFETCH_L2 },
+	{ "l3", SLJIT_PREFETCH_L3 },
+	{ "once", SLJIT_PREFETCH_ONCE },
+};
+
+#define PROGRAM_COUNT (int)(sizeof(programs) / sizeof(programs[0]))
+
+static void* compile_program(int op, int dependent, long distance)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler();
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	void *code;
+
+	if (!compiler)
+		errx(1, "cannot create compiler");
+
+	/* for (R2 = 0; R2 != S1; R2++) S3 += S2[S0[R2]]; */
+	sljit_emit_enter(compiler, 0, 3, 3, 4, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S3, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 0);
+	loop = sljit_emit_label(compiler);
+	if (op) {
+		/* The index array is padded, index[i + distance] is always valid. */
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_R2, 0, SLJIT_IMM, distance);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R1), SLJIT_WORD_SHIFT);
+		sljit_emit_op1(compiler, op, SLJIT_UNUSED, 0, SLJIT_MEM2(SLJIT_S2, SLJIT_R1), SLJIT_WORD_SHIFT);
+	}
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R2), SLJIT_WORD_SHIFT);
+	if (dependent) {
+		/* R0 += S3 & 0, which cannot be resolved before the previous load. */
+		sljit_emit_op2(compiler, SLJIT_AND, SLJIT_R1, 0, SLJIT_S3, 0, SLJIT_IMM, 0);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	}
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S3, 0, SLJIT_S3, 0, SLJIT_MEM2(SLJIT_S2, SLJIT_R0), SLJIT_WORD_SHIFT);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R2, 0, SLJIT_R2, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R2, 0, SLJIT_S1, 0);
+	sljit_set_label(jump, loop);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_S3, 0);
+
+	code = sljit_generate_code(compiler);
+	if (!code)
+		errx(1, "cannot generate code: %d", sljit_get_compiler_error(compiler));
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+int main(int argc, char *argv[])
+{
+	bench_func func;
+	void *code;
+	long *table;
+	long *index;
+	long table_mb = 256;
+	long distance = 16;
+	long rounds = 3;
+	long table_length;
+	long length;
+	long expected = 0;
+	long value;
+	double start;
+	double ns;
+	double base_ns = 0;
+	long i;
+	long j;
+	int dependent;
+	int p;
+
+	if (argc >= 2)
+		table_mb = atol(argv[1]);
+	if (argc >= 3)
+		distance = atol(argv[2]);
+	if (argc >= 4)
+		rounds = atol(argv[3]);
+	if (table_mb <= 0 || distance <= 0 || rounds <= 0)
+		errx(1, "invalid arguments");
+
+	table_length = table_mb * 1024 * 1024 / sizeof(long);
+	length = table_length / 4;
+
+	table = malloc(table_length * sizeof(long));
+	index = malloc((length + distance) * sizeof(long));
+	if (!table || !index)
+		errx(1, "out of memory");
+
+	srand(1);
+	for (i = 0; i < table_length; i++)
+		table[i] = i & 0xff;
+	for (i = 0; i < length + distance; i++)
+		index[i] = (((long)rand() << 16) ^ rand()) % table_length;
+	for (i = 0; i < length; i++)
+		expected += table[index[i]];
+
+	printf("table: %ld MB, elements: %ld, distance: %ld\n\n", table_mb, length, distance);
+	printf("%-10s %-8s %12s %10s\n", "loop", "prefetch", "ns/elem", "speedup");
+
+	for (dependent = 0; dependent < 2; dependent++) {
+		for (p = 0; p < PROGRAM_COUNT; p++) {
+			code = compile_program(programs[p].op, dependent, distance);
+			func = (bench_func)SLJIT_FUNC_OFFSET(code);
+
+			start = now_ns();
+			for (j = 0; j < rounds; j++) {
+				value = func((long)index, length, (long)table);
+				if (value != expected)
+					errx(1, "%s: result mismatch: %ld != %ld", programs[p].name, value, expected);
+			}
+			ns = (now_ns() - start) / ((double)length * rounds);
+
+			if (p == 0)
+				base_ns = ns;
+			printf("%-10s %-8s %12.3f %9.2fx\n", dependent ? "dependent" : "gather",
+				programs[p].name, ns, base_ns / ns);
+
+			sljit_free_code(code);
+		}
+	}
+
+	free(table);
+	free(index);
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ *    Stack-less Just-In-Time compiler
+ *
+ *    Copyright 2009-2010 Zoltan Herczeg (hzmester@freemail.hu). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice, this list of
+ *      conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *      of conditions and the following disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER(S) AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER(S) OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+   Branchy code against sljit_emit_select.
+
+   Both programs compute sum(min(data[i], pivot)): the first one with
+   a conditional jump around a move, the second one with a select.
+   The input is random (the jump is mispredicted half of the time) or
+   sorted (the jump is always predicted), and the run time per element
+   is printed for each combination.
+
+   Usage: select_bench [elements] [rounds]
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sljitBenchUtil.h"
+
+typedef long (SLJIT_CALL *bench_func)(long data, long length, long pivot);
+
+static int compare_long(const void *a, const void *b)
+{
+	long x = *(const long*)a;
+	long y = *(const long*)b;
+
+	return (x > y) - (x < y);
+}
+
+static void* compile_program(int use_select)
+{
+	struct sljit_compiler *compiler = sljit_create_compiler();
+	struct sljit_label *loop;
+	struct sljit_jump *jump;
+	void *code;
+
+	if (!compiler)
+		errx(1, "cannot create compiler");
+
+	/* for (R2 = 0; R2 != S1; R2++) S2 += min(S0[R2], pivot); */
+	sljit_emit_enter(compiler, 0, 3, 4, 4, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S3, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S2, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 0);
+	loop = sljit_emit_label(compiler);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R2), SLJIT_WORD_SHIFT);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_S, SLJIT_UNUSED, 0, SLJIT_R1, 0, SLJIT_S3, 0);
+	if (use_select)
+		sljit_emit_select(compiler, SLJIT_SIG_LESS, SLJIT_R0, SLJIT_R1, 0, SLJIT_S3);
+	else {
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S3, 0);
+		jump = sljit_emit_jump(compiler, SLJIT_SIG_GREATER_EQUAL);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_R1, 0);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+	}
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S2, 0, SLJIT_S2, 0, SLJIT_R0, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R2, 0, SLJIT_R2, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_R2, 0, SLJIT_S1, 0);
+	sljit_set_label(jump, loop);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_S2, 0);
+
+	code = sljit_generate_code(compiler);
+	if (!code)
+		errx(1, "cannot generate code: %d", sljit_get_compiler_error(compiler));
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static double run_program(void *code, long *data, long length, long rounds, long *value)
+{
+	bench_func func = (bench_func)SLJIT_FUNC_OFFSET(code);
+	double start;
+	long i;
+
+	/* Warm up. */
+	*value = func((long)data, length, 1 << 19);
+
+	start = now_ns();
+	for (i = 0; i < rounds; i++) {
+		if (func((long)data, length, 1 << 19) != *value)
+			errx(1, "result changed between rounds");
+	}
+	return (now_ns() - start) / ((double)length * rounds);
+}
+
+int main(int argc, char *argv[])
+{
+	void *branch_code;
+	void *select_code;
+	long *data;
+	long length = 1 << 16;
+	long rounds = 500;
+	long branch_value;
+	long select_value;
+	double branch_ns;
+	double select_ns;
+	int sorted;
+	long i;
+
+	if (argc >= 2)
+		length = atol(argv[1]);
+	if (argc >= 3)
+		rounds = atol(argv[2]);
+	if (length <= 0 || rounds <= 0)
+		errx(1, "invalid arguments");
+
+	data = malloc(length * sizeof(long));
+	if (!data)
+		errx(1, "out of memory");
+
+	srand(1);
+	for (i = 0; i < length; i++)
+		data[i] = rand() & ((1 << 20) - 1);
+
+	branch_code = compile_program(0);
+	select_code = compile_program(1);
+
+	printf("%-8s %14s %14s\n", "input", "branch ns/elem", "select ns/elem");
+
+	for (sorted = 0; sorted < 2; sorted++) {
+		if (sorted)
+			qsort(data, length, sizeof(long), compare_long);
+
+		branch_ns = run_program(branch_code, data, length, rounds, &branch_value);
+		select_ns = run_program(select_code, data, length, rounds, &select_value);
+
+		if (branch_value != select_value)
+			errx(1, "result mismatch: %ld != %ld", branch_value, select_value);
+
+		printf("%-8s %14.3f %14.3f\n", sorted ? "sorted" : "random", branch_ns, select_ns);
+	}
+
+	sljit_free_code(branch_code);
+	sljit_free_code(select_code);
+	free(data);
+	return 0;
+}
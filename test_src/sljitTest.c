@@ -31,6 +31,12 @@
 #include <string.h>
 
 #include "sljitLir.h"
+#include "sljitRegAlloc.h"
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS) \
+	&& (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+#include <sys/mman.h>
+#endif
 
 #if defined _WIN32 || defined _WIN64
 #define COLOR_RED
@@ -99,6 +105,12 @@ static void test_exec_allocator(void)
 	void *ptr1;
 	void *ptr2;
 	void *ptr3;
+#if (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
+	struct sljit_exec_allocator_stats stats;
+	void *ptrs[256];
+	unsigned int seed = 12345;
+	int i;
+#endif
 
 	if (verbose)
 		printf("Run executable allocator test\n");
@@ -106,6 +118,11 @@ static void test_exec_allocator(void)
 	MALLOC_EXEC(ptr1, 32);
 	MALLOC_EXEC(ptr2, 512);
 	MALLOC_EXEC(ptr3, 512);
+#if (defined SLJIT_WX_EXECUTABLE_ALLOCATOR && SLJIT_WX_EXECUTABLE_ALLOCATOR)
+	/* The executable view is a separate mapping, and both can be freed. */
+	SLJIT_ASSERT(SLJIT_EXEC_OFFSET(ptr1) != 0);
+	ptr3 = (u_char*)ptr3 + SLJIT_EXEC_OFFSET(ptr3);
+#endif
 	SLJIT_FREE_EXEC(ptr2);
 	SLJIT_FREE_EXEC(ptr3);
 	SLJIT_FREE_EXEC(ptr1);
@@ -126,6 +143,32 @@ static void test_exec_allocator(void)
 	SLJIT_FREE_EXEC(ptr3);
 	SLJIT_FREE_EXEC(ptr1);
 	SLJIT_FREE_EXEC(ptr2);
+
+#if (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
+	/* Random sizes and release order to exercise the free lists. */
+	for (i = 0; i < 256; i++) {
+		seed = seed * 1103515245 + 12345;
+		MALLOC_EXEC(ptrs[i], 16 + ((seed >> 8) % 3000));
+	}
+	sljit_get_exec_allocator_stats(&stats);
+	SLJIT_ASSERT(stats.allocated_size >= 256 * 16 && stats.total_size >= stats.allocated_size);
+	for (i = 0; i < 256; i += 2)
+		SLJIT_FREE_EXEC(ptrs[i]);
+	for (i = 0; i < 128; i += 2) {
+		seed = seed * 1103515245 + 12345;
+		MALLOC_EXEC(ptrs[i], 16 + ((seed >> 8) % 6000));
+	}
+	for (i = 1; i < 256; i += 2)
+		SLJIT_FREE_EXEC(ptrs[i]);
+	for (i = 0; i < 128; i += 2)
+		SLJIT_FREE_EXEC(ptrs[i]);
+	sljit_get_exec_allocator_stats(&stats);
+	SLJIT_ASSERT(stats.allocated_size == 0 && stats.free_block_count > 0);
+	sljit_free_unused_memory_exec();
+	sljit_get_exec_allocator_stats(&stats);
+	SLJIT_ASSERT(stats.total_size == 0 && stats.free_block_count == 0);
+#endif
+
 #if (defined SLJIT_UTIL_GLOBAL_LOCK && SLJIT_UTIL_GLOBAL_LOCK)
 	/* Just call the global locks. */
 	sljit_grab_lock();
@@ -4939,6 +4982,2185 @@ static void test53(void)
 	successful_tests++;
 }
 
+/* Fails when the budget is zero, a negative budget is unlimited. */
+static void* test54_alloc(unsigned long size, void *allocator_data)
+{
+	long *budget = (long*)allocator_data;
+
+	if (*budget == 0)
+		return NULL;
+	if (*budget > 0)
+		(*budget)--;
+	return malloc(size);
+}
+
+static void test54_free(void *ptr, void *allocator_data)
+{
+	(void)allocator_data;
+	free(ptr);
+}
+
+static void test54(void)
+{
+	/* Test sljit_reset_compiler. */
+	executable_code code1;
+	executable_code code2;
+	executable_code code3;
+	struct sljit_allocator allocator;
+	long budget;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jump;
+	struct sljit_label* label;
+	int i;
+
+	if (verbose)
+		printf("Run test54\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* Fill several buf and abuf fragments. */
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+	for (i = 0; i < 1000; i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R0, 0, SLJIT_IMM, -1);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 3);
+		label = sljit_emit_label(compiler);
+		sljit_set_label(jump, label);
+	}
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code1.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+
+	sljit_reset_compiler(compiler);
+	FAILED(sljit_get_compiler_error(compiler) != SLJIT_SUCCESS, "test54 case 1 failed\n");
+	FAILED(sljit_get_generated_code_size(compiler) != 0, "test54 case 2 failed\n");
+
+	sljit_emit_enter(compiler, 0, 2, 2, 2, 0, 0, 0);
+	for (i = 0; i < 500; i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_SIG_LESS, SLJIT_S0, 0, SLJIT_IMM, 0);
+		sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_S0, 0, SLJIT_S0, 0, SLJIT_S1, 0);
+		label = sljit_emit_label(compiler);
+		sljit_set_label(jump, label);
+	}
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_S0, 0);
+
+	code2.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+
+	/* Reset before the code is generated. */
+	sljit_reset_compiler(compiler);
+	sljit_emit_enter(compiler, 0, 0, 1, 0, 0, 0, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 1);
+	sljit_reset_compiler(compiler);
+	sljit_emit_enter(compiler, 0, 0, 1, 0, 0, 0, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 2);
+	FAILED(sljit_get_compiler_error(compiler) != SLJIT_SUCCESS, "test54 case 3 failed\n");
+	sljit_free_compiler(compiler);
+
+	FAILED(code1.func1(7) != 3007, "test54 case 4 failed\n");
+	FAILED(code2.func2(1001, 2) != 1, "test54 case 5 failed\n");
+	FAILED(code2.func2(-5, 2) != -5, "test54 case 6 failed\n");
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+
+	/* Reset after a failed compilation. */
+	budget = -1;
+	allocator.alloc = test54_alloc;
+	allocator.free = test54_free;
+	allocator.allocator_data = &budget;
+	compiler = sljit_create_compiler_with_allocator(&allocator);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	budget = 2;
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	for (i = 0; i < 2000; i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_S0, 0, SLJIT_IMM, i);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S0, 0, SLJIT_S0, 0, SLJIT_IMM, 1);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+	}
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_S0, 0);
+	FAILED(sljit_get_compiler_error(compiler) != SLJIT_ERR_ALLOC_FAILED, "test54 case 7 failed\n");
+	FAILED(sljit_generate_code(compiler) != NULL, "test54 case 8 failed\n");
+
+	budget = -1;
+	sljit_reset_compiler(compiler);
+	FAILED(sljit_get_compiler_error(compiler) != SLJIT_SUCCESS, "test54 case 9 failed\n");
+
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, 6);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code3.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code3.func1(7) != 42, "test54 case 10 failed\n");
+
+	sljit_free_code(code3.code);
+	successful_tests++;
+}
+
+struct test55_arena {
+	char *memory;
+	unsigned long used;
+	unsigned long size;
+	int allocs;
+	int frees;
+};
+
+static void* test55_alloc(unsigned long size, void *allocator_data)
+{
+	struct test55_arena *arena = (struct test55_arena*)allocator_data;
+	void *ptr;
+
+	size = (size + sizeof(long) - 1) & ~(sizeof(long) - 1);
+	if (arena->used + size > arena->size)
+		return NULL;
+	ptr = arena->memory + arena->used;
+	arena->used += size;
+	arena->allocs++;
+	return ptr;
+}
+
+static void test55_free(void *ptr, void *allocator_data)
+{
+	struct test55_arena *arena = (struct test55_arena*)allocator_data;
+
+	(void)ptr;
+	arena->frees++;
+}
+
+static void test55(void)
+{
+	/* Test sljit_create_compiler_with_allocator. */
+	executable_code code;
+	struct sljit_allocator allocator;
+	struct test55_arena arena;
+	struct sljit_compiler* compiler;
+	struct sljit_jump* jump;
+	int i;
+
+	if (verbose)
+		printf("Run test55\n");
+
+	arena.size = 64 * 1024;
+	arena.memory = (char*)malloc(arena.size);
+	FAILED(!arena.memory, "cannot allocate arena\n");
+	arena.used = 0;
+	arena.allocs = 0;
+	arena.frees = 0;
+
+	allocator.alloc = test55_alloc;
+	allocator.free = test55_free;
+	allocator.allocator_data = &arena;
+
+	compiler = sljit_create_compiler_with_allocator(&allocator);
+	if (!compiler)
+		free(arena.memory);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+	for (i = 0; i < 600; i++) {
+		jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R0, 0, SLJIT_IMM, -1);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 2);
+		sljit_set_label(jump, sljit_emit_label(compiler));
+	}
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	if (sljit_get_compiler_error(compiler) != SLJIT_ERR_COMPILED)
+		free(arena.memory);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	if (arena.allocs < 4 || arena.allocs != arena.frees)
+		free(arena.memory);
+	FAILED(arena.allocs < 4, "test55 case 1 failed\n");
+	FAILED(arena.allocs != arena.frees, "test55 case 2 failed\n");
+	FAILED(code.func1(5) != 1205, "test55 case 3 failed\n");
+	sljit_free_code(code.code);
+
+	/* Without a free callback the arena is released at once. */
+	arena.used = 0;
+	allocator.free = NULL;
+	compiler = sljit_create_compiler_with_allocator(&allocator);
+	if (!compiler)
+		free(arena.memory);
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, 10);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	sljit_free_compiler(compiler);
+	free(arena.memory);
+
+	FAILED(!code.code, "test55 case 4 failed\n");
+	FAILED(code.func1(15) != 5, "test55 case 5 failed\n");
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test56(void)
+{
+	/* Test sljit_set_patches. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jump;
+	struct sljit_const* const1;
+	struct sljit_const* const2;
+	struct sljit_label* label1;
+	struct sljit_label* label2;
+	struct sljit_patch patches[3];
+	long buf[2];
+
+	if (verbose)
+		printf("Run test56\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 1, 1, 0, 0, 0);
+	const1 = sljit_emit_const(compiler, SLJIT_MEM1(SLJIT_S0), 0, 10);
+	const2 = sljit_emit_const(compiler, SLJIT_R0, 0, 20);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(long), SLJIT_R0, 0);
+	jump = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+	label1 = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 1);
+	label2 = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 2);
+	sljit_set_label(jump, label1);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+
+	FAILED(code.func1((long)&buf) != 1, "test56 case 1 failed\n");
+	FAILED(buf[0] != 10 || buf[1] != 20, "test56 case 2 failed\n");
+
+	patches[0].type = SLJIT_PATCH_JUMP_ADDR;
+	patches[0].addr = sljit_get_jump_addr(jump);
+	patches[0].value = (long)sljit_get_label_addr(label2);
+	patches[1].type = SLJIT_PATCH_CONST;
+	patches[1].addr = sljit_get_const_addr(const1);
+	patches[1].value = -5;
+	patches[2].type = SLJIT_PATCH_CONST;
+	patches[2].addr = sljit_get_const_addr(const2);
+	patches[2].value = 0x12345678;
+	sljit_set_patches(patches, 3);
+
+	FAILED(code.func1((long)&buf) != 2, "test56 case 3 failed\n");
+	FAILED(buf[0] != -5 || buf[1] != 0x12345678, "test56 case 4 failed\n");
+
+	/* Only the first patch is applied. */
+	patches[0].value = (long)sljit_get_label_addr(label1);
+	patches[1].value = 77;
+	sljit_set_patches(patches, 1);
+	sljit_free_compiler(compiler);
+
+	FAILED(code.func1((long)&buf) != 1, "test56 case 5 failed\n");
+	FAILED(buf[0] != -5 || buf[1] != 0x12345678, "test56 case 6 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test57(void)
+{
+	/* Test the alignment of patched immediates. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jumps[8];
+	struct sljit_const* consts[8];
+	struct sljit_label* label1;
+	struct sljit_label* label2;
+	unsigned long const_addr[8];
+	unsigned long jump_addr[8];
+	unsigned long label1_addr;
+	unsigned long label2_addr;
+	long buf[8];
+	int i, j;
+
+	if (verbose)
+		printf("Run test57\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 3, 1, 0, 0, 0);
+	for (i = 0; i < 8; i++) {
+		/* Shift the instructions by i bytes on x86. */
+		for (j = 0; j < i; j++)
+			sljit_emit_op0(compiler, SLJIT_NOP);
+		consts[i] = sljit_emit_const(compiler, (i & 0x1) ? SLJIT_MEM1(SLJIT_S0) : SLJIT_R1, (i & 0x1) ? i * sizeof(long) : 0, i);
+		if (!(i & 0x1))
+			sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), i * sizeof(long), SLJIT_R1, 0);
+		if (i & 0x2)
+			jumps[i] = sljit_emit_cmp(compiler, SLJIT_EQUAL | SLJIT_REWRITABLE_JUMP, SLJIT_R1, 0, SLJIT_R1, 0);
+		else
+			jumps[i] = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+		sljit_set_label(jumps[i], sljit_emit_label(compiler));
+	}
+	label1 = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 1);
+	label2 = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 2);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	for (i = 0; i < 8; i++) {
+		const_addr[i] = sljit_get_const_addr(consts[i]);
+		jump_addr[i] = sljit_get_jump_addr(jumps[i]);
+	}
+	label1_addr = sljit_get_label_addr(label1);
+	label2_addr = sljit_get_label_addr(label2);
+	sljit_free_compiler(compiler);
+
+	FAILED(code.func1((long)&buf) != 1, "test57 case 1 failed\n");
+	for (i = 0; i < 8; i++) {
+		FAILED(buf[i] != i, "test57 case 2 failed\n");
+#if (defined SLJIT_ATOMIC_PATCHING && SLJIT_ATOMIC_PATCHING)
+		FAILED(const_addr[i] & (sizeof(long) - 1), "test57 case 3 failed\n");
+		/* The rel32 on x86-32, the imm64 or the target slot of the stub on x86-64. */
+		FAILED(jump_addr[i] & (sizeof(long) - 1), "test57 case 4 failed\n");
+#endif
+		sljit_set_const(const_addr[i], -i);
+	}
+
+	sljit_set_jump_addr(jump_addr[5], label2_addr);
+	sljit_set_jump_addr(jump_addr[7], label1_addr);
+	FAILED(code.func1((long)&buf) != 2, "test57 case 5 failed\n");
+	for (i = 0; i < 6; i++)
+		FAILED(buf[i] != -i, "test57 case 6 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS) \
+	&& (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+static long SLJIT_CALL test58_func(void)
+{
+	return 500;
+}
+#endif
+
+static void test58(void)
+{
+	/* Test rewritable jumps between separately generated code blocks. */
+	executable_code code1;
+	executable_code code2;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jump1;
+	struct sljit_jump* jump2;
+	struct sljit_label* label;
+	unsigned long jump1_addr;
+	unsigned long jump2_addr;
+	unsigned long label_addr;
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS) \
+	&& (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	executable_code code3;
+	u_char *far_code;
+#endif
+
+	if (verbose)
+		printf("Run test58\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* Both functions must have the same frame. */
+	sljit_emit_enter(compiler, 0, 1, 2, 1, 0, 0, 0);
+	jump1 = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+	sljit_set_label(jump1, sljit_emit_label(compiler));
+	jump2 = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL | SLJIT_REWRITABLE_JUMP, SLJIT_S0, 0, SLJIT_IMM, 0);
+	sljit_set_label(jump2, sljit_emit_label(compiler));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0, SLJIT_S0, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
+
+	code1.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	jump1_addr = sljit_get_jump_addr(jump1);
+	jump2_addr = sljit_get_jump_addr(jump2);
+
+	sljit_reset_compiler(compiler);
+	sljit_emit_enter(compiler, 0, 1, 2, 1, 0, 0, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, -1);
+	label = sljit_emit_label(compiler);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_RETURN_REG, 0, SLJIT_S0, 0, SLJIT_IMM, 100);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
+
+	code2.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	label_addr = sljit_get_label_addr(label);
+	sljit_free_compiler(compiler);
+
+	FAILED(code1.func1(5) != 5, "test58 case 1 failed\n");
+
+	sljit_set_jump_addr(jump2_addr, label_addr);
+	FAILED(code1.func1(5) != 105, "test58 case 2 failed\n");
+	FAILED(code1.func1(0) != 0, "test58 case 3 failed\n");
+
+	sljit_set_jump_addr(jump1_addr, label_addr);
+	FAILED(code1.func1(0) != 100, "test58 case 4 failed\n");
+
+#if (defined SLJIT_NEAR_REWRITABLE_JUMPS && SLJIT_NEAR_REWRITABLE_JUMPS) \
+	&& (defined SLJIT_CONFIG_X86_64 && SLJIT_CONFIG_X86_64)
+	/* Targets out of the rel32 range are reached through the stub of the jump. */
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 0, 1, 0, 0, 0, 0);
+	jump1 = sljit_emit_jump(compiler, SLJIT_CALL0 | SLJIT_REWRITABLE_JUMP);
+	sljit_set_target(jump1, SLJIT_FUNC_OFFSET(test58_func));
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
+
+	code3.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	jump1_addr = sljit_get_jump_addr(jump1);
+	sljit_free_compiler(compiler);
+
+	FAILED(code3.func0() != 500, "test58 case 5 failed\n");
+
+	/* mov eax, 300; ret, mapped 8 GByte away from the code (if the hint is honored). */
+	far_code = (u_char*)mmap((void*)(((unsigned long)code3.code & ~0xfffUL) + (1UL << 33)), 4096,
+		PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (far_code != MAP_FAILED) {
+		far_code[0] = 0xb8;
+		*(int*)(far_code + 1) = 300;
+		far_code[5] = 0xc3;
+
+		sljit_set_jump_addr(jump1_addr, (unsigned long)far_code);
+		FAILED(code3.func0() != 300, "test58 case 6 failed\n");
+		sljit_set_jump_addr(jump1_addr, SLJIT_FUNC_OFFSET(code2.code));
+		FAILED(code3.func0() != -1, "test58 case 7 failed\n");
+		sljit_set_jump_addr(jump1_addr, (unsigned long)far_code);
+		FAILED(code3.func0() != 300, "test58 case 8 failed\n");
+		sljit_set_jump_addr(jump1_addr, SLJIT_FUNC_OFFSET(test58_func));
+		FAILED(code3.func0() != 500, "test58 case 9 failed\n");
+		munmap(far_code, 4096);
+	}
+	sljit_free_code(code3.code);
+#endif
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+	successful_tests++;
+}
+
+static void test59(void)
+{
+	/* Test forward jump relaxation. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jumps[8];
+	struct sljit_label* label;
+	int i;
+
+	if (verbose)
+		printf("Run test59\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* A chain of checks similar to the regex engine: every match
+	   jumps forward to the common return path. */
+	sljit_emit_enter(compiler, 0, 1, 2, 1, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0);
+	for (i = 0; i < 8; i++) {
+		jumps[i] = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_S0, 0, SLJIT_IMM, i * 3);
+		sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	}
+	label = sljit_emit_label(compiler);
+	for (i = 0; i < 8; i++)
+		sljit_set_label(jumps[i], label);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+	/* All jumps must use the same (rel8) form, so they are evenly spaced. */
+	for (i = 1; i < 7; i++)
+		FAILED(sljit_get_jump_addr(jumps[i + 1]) - sljit_get_jump_addr(jumps[i]) != sljit_get_jump_addr(jumps[1]) - sljit_get_jump_addr(jumps[0]), "test59 case 1 failed\n");
+#endif
+	sljit_free_compiler(compiler);
+
+	for (i = 0; i < 8; i++)
+		FAILED(code.func1(i * 3) != i, "test59 case 2 failed\n");
+	FAILED(code.func1(1) != 8, "test59 case 3 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void* test60_compile(int options, unsigned long *code_size)
+{
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	void *code;
+
+	if (!compiler)
+		return NULL;
+
+	sljit_emit_enter(compiler, options, 1, 3, 1, 0, 0, 2 * sizeof(long));
+	/* Store followed by reloads from the same slot. */
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_S0, 0, SLJIT_IMM, 7);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_SP), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_R1, 0);
+	/* Flags kept across operations whose result is not used. */
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_U, SLJIT_UNUSED, 0, SLJIT_S0, 0, SLJIT_IMM, 10);
+	sljit_emit_op2(compiler, SLJIT_ADD | SLJIT_KEEP_FLAGS, SLJIT_UNUSED, 0, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_op2(compiler, SLJIT_XOR | SLJIT_KEEP_FLAGS, SLJIT_UNUSED, 0, SLJIT_R1, 0, SLJIT_S0, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_UNUSED, 0, SLJIT_LESS);
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 8);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code = sljit_generate_code(compiler);
+	*code_size = sljit_get_generated_code_size(compiler);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static void test60(void)
+{
+	/* Test the peephole optimizer. */
+	executable_code code1;
+	executable_code code2;
+	unsigned long size1;
+	unsigned long size2;
+
+	if (verbose)
+		printf("Run test60\n");
+
+	code1.code = test60_compile(0, &size1);
+	code2.code = test60_compile(SLJIT_PEEPHOLE_OPTIMIZER, &size2);
+	FAILED(!code1.code || !code2.code, "test60 case 1 failed\n");
+
+	FAILED(code1.func1(5) != (1 << 8) + 12, "test60 case 2 failed\n");
+	FAILED(code2.func1(5) != (1 << 8) + 12, "test60 case 3 failed\n");
+	FAILED(code1.func1(20) != 27, "test60 case 4 failed\n");
+	FAILED(code2.func1(20) != 27, "test60 case 5 failed\n");
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+#ifdef TEST_SUITE_OPTIONS
+	/* A benchmark may enable the optimizer for both functions. */
+	if (!(TEST_SUITE_OPTIONS & SLJIT_PEEPHOLE_OPTIMIZER))
+#endif
+	FAILED(size2 >= size1, "test60 case 6 failed\n");
+#endif
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+	successful_tests++;
+}
+
+static void test61(void)
+{
+	/* Test vector operations. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	unsigned char in[64];
+	unsigned char out[16 * 10];
+	long res[8];
+	long expected;
+	int vector_size = sljit_get_vector_size();
+	int i;
+
+	if (verbose)
+		printf("Run test61\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	if (vector_size == 0) {
+		if (verbose)
+			printf("no vector support, test61 skipped\n");
+		successful_tests++;
+		sljit_free_compiler(compiler);
+		return;
+	}
+
+	for (i = 0; i < 32; i++) {
+		in[i] = i + 1;
+		in[32 + i] = (i % 3 == 0) ? (i + 1) : (200 + i);
+	}
+	for (i = 0; i < 16 * 10; i++)
+		out[i] = 0xaa;
+	for (i = 0; i < 8; i++)
+		res[i] = -1;
+
+	sljit_emit_enter(compiler, 0, 3, 4, 3, 5, 0, 0);
+
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_FR0, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_FR1, 0, SLJIT_MEM1(SLJIT_S0), 32);
+	/* out[0]: a + b (8 bit lanes) */
+	sljit_emit_vop2(compiler, SLJIT_VADD | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 0, SLJIT_FR2, 0);
+	/* out[16]: a - b (32 bit lanes), the destination is the second source. */
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_FR3, 0, SLJIT_FR1, 0);
+	sljit_emit_vop2(compiler, SLJIT_VSUB | SLJIT_VEC_32, SLJIT_FR3, 0, SLJIT_FR0, 0, SLJIT_FR3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 16);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM2(SLJIT_S1, SLJIT_R1), 0, SLJIT_FR3, 0);
+	/* res[0]: movemask(a == b) (8 bit lanes) */
+	sljit_emit_vop2(compiler, SLJIT_VCMPEQ | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_8, SLJIT_R3, 0, SLJIT_FR2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S2), 0, SLJIT_R3, 0);
+	/* out[32]: (a ^ b) & a | b */
+	sljit_emit_vop2(compiler, SLJIT_VXOR | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+	sljit_emit_vop2(compiler, SLJIT_VAND | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR2, 0);
+	sljit_emit_vop2(compiler, SLJIT_VOR | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_FR2, 0, SLJIT_FR1, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 32, SLJIT_FR2, 0);
+	/* out[48]: broadcast 16 bit immediate, out[64]: broadcast 8 bit register */
+	sljit_emit_vop1(compiler, SLJIT_VBROADCAST | SLJIT_VEC_16, SLJIT_FR2, 0, SLJIT_IMM, 0x71234);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 48, SLJIT_FR2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 0x1c5);
+	sljit_emit_vop1(compiler, SLJIT_VBROADCAST | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_R3, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 64, SLJIT_FR2, 0);
+	/* out[80]: broadcast 32 bit memory, out[96]: broadcast 64 bit immediate */
+	sljit_emit_vop1(compiler, SLJIT_VBROADCAST | SLJIT_VEC_32, SLJIT_FR2, 0, SLJIT_MEM1(SLJIT_S0), 4);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 80, SLJIT_FR2, 0);
+	sljit_emit_vop1(compiler, SLJIT_VBROADCAST | SLJIT_VEC_64, SLJIT_FR2, 0, SLJIT_IMM, 0x76543210);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 96, SLJIT_FR2, 0);
+	/* out[112]: a with reversed 32 bit lanes */
+	sljit_emit_vop2(compiler, SLJIT_VSHUFFLE | SLJIT_VEC_32, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_IMM, 0x1b);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_MEM1(SLJIT_S1), 112, SLJIT_FR2, 0);
+	/* res[1]: movemask(b > a) (16 bit lanes), res[2]: (32 bit lanes), res[3]: movemask(a == a) (64 bit lanes) */
+	sljit_emit_vop2(compiler, SLJIT_VCMPGT | SLJIT_VEC_16, SLJIT_FR2, 0, SLJIT_FR1, 0, SLJIT_FR0, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_16, SLJIT_MEM1(SLJIT_S2), sizeof(long), SLJIT_FR2, 0);
+	sljit_emit_vop2(compiler, SLJIT_VCMPGT | SLJIT_VEC_32, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_32, SLJIT_R0, 0, SLJIT_FR2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S2), 2 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8, SLJIT_FR2, 0, SLJIT_MEM1(SLJIT_S0), 8);
+	sljit_emit_vop2(compiler, SLJIT_VCMPEQ | SLJIT_VEC_64, SLJIT_FR2, 0, SLJIT_FR2, 0, SLJIT_FR0, 0);
+	sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_64, SLJIT_MEM1(SLJIT_S2), 3 * sizeof(long), SLJIT_FR2, 0);
+
+	if (vector_size >= 32) {
+		sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8 | SLJIT_VEC_256, SLJIT_FR0, 0, SLJIT_MEM1(SLJIT_S0), 0);
+		sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8 | SLJIT_VEC_256, SLJIT_FR1, 0, SLJIT_MEM1(SLJIT_S0), 32);
+		/* out[128]: a + b (16 bit lanes, 32 bytes) */
+		sljit_emit_vop2(compiler, SLJIT_VADD | SLJIT_VEC_16 | SLJIT_VEC_256, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+		sljit_emit_vop1(compiler, SLJIT_VMOV | SLJIT_VEC_8 | SLJIT_VEC_256, SLJIT_MEM1(SLJIT_S1), 128, SLJIT_FR2, 0);
+		/* res[4]: movemask(a == b) (8 bit lanes), res[5]: movemask(b > a) (16 bit lanes) */
+		sljit_emit_vop2(compiler, SLJIT_VCMPEQ | SLJIT_VEC_8 | SLJIT_VEC_256, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+		sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_8 | SLJIT_VEC_256, SLJIT_MEM1(SLJIT_S2), 4 * sizeof(long), SLJIT_FR2, 0);
+		sljit_emit_vop2(compiler, SLJIT_VCMPGT | SLJIT_VEC_16 | SLJIT_VEC_256, SLJIT_FR2, 0, SLJIT_FR1, 0, SLJIT_FR0, 0);
+		sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_16 | SLJIT_VEC_256, SLJIT_MEM1(SLJIT_S2), 5 * sizeof(long), SLJIT_FR2, 0);
+		/* res[6]: movemask(a > broadcast(-1)) (64 bit lanes) */
+		sljit_emit_vop1(compiler, SLJIT_VBROADCAST | SLJIT_VEC_64 | SLJIT_VEC_256, SLJIT_FR3, 0, SLJIT_IMM, -1);
+		sljit_emit_vop2(compiler, SLJIT_VCMPGT | SLJIT_VEC_64 | SLJIT_VEC_256, SLJIT_FR2, 0, SLJIT_FR0, 0, SLJIT_FR3, 0);
+		sljit_emit_vop1(compiler, SLJIT_VMOVEMASK | SLJIT_VEC_64 | SLJIT_VEC_256, SLJIT_MEM1(SLJIT_S2), 6 * sizeof(long), SLJIT_FR2, 0);
+	}
+
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func3((long)in, (long)out, (long)res);
+
+	for (i = 0; i < 16; i++) {
+		FAILED(out[i] != (unsigned char)(in[i] + in[32 + i]), "test61 case 1 failed\n");
+		FAILED(out[32 + i] != (((in[i] ^ in[32 + i]) & in[i]) | in[32 + i]), "test61 case 2 failed\n");
+		FAILED(out[48 + i] != ((i & 0x1) ? 0x12 : 0x34), "test61 case 3 failed\n");
+		FAILED(out[64 + i] != 0xc5, "test61 case 4 failed\n");
+		FAILED(out[80 + i] != in[4 + (i & 0x3)], "test61 case 5 failed\n");
+		FAILED(out[96 + i] != ((i & 0x7) < 4 ? (0x10 + 0x22 * (i & 0x7)) : 0), "test61 case 6 failed\n");
+		FAILED(out[112 + i] != in[(3 - (i >> 2)) * 4 + (i & 0x3)], "test61 case 7 failed\n");
+	}
+	for (i = 0; i < 4; i++) {
+		expected = (long)(in[i * 4] | (in[i * 4 + 1] << 8) | (in[i * 4 + 2] << 16) | ((unsigned int)in[i * 4 + 3] << 24))
+			- (long)(in[32 + i * 4] | (in[32 + i * 4 + 1] << 8) | (in[32 + i * 4 + 2] << 16) | ((unsigned int)in[32 + i * 4 + 3] << 24));
+		FAILED(*(unsigned int*)(out + 16 + i * 4) != (unsigned int)expected, "test61 case 8 failed\n");
+	}
+	FAILED(res[0] != 0x9249, "test61 case 9 failed\n");
+	FAILED(res[1] != 0x92, "test61 case 10 failed\n");
+	FAILED(res[2] != 0x6, "test61 case 11 failed\n");
+	FAILED(res[3] != 0x0, "test61 case 12 failed\n");
+
+	if (vector_size >= 32) {
+		for (i = 0; i < 32; i += 2)
+			FAILED(*(unsigned short*)(out + 128 + i) != (unsigned short)((in[i] | (in[i + 1] << 8)) + (in[32 + i] | (in[32 + i + 1] << 8))), "test61 case 13 failed\n");
+		FAILED(res[4] != 0x49249249, "test61 case 14 failed\n");
+		FAILED(res[5] != 0x2492, "test61 case 15 failed\n");
+		FAILED(res[6] != 0xf, "test61 case 16 failed\n");
+	}
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test62(void)
+{
+	/* Test conditional select. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[12];
+	int i;
+
+	if (verbose)
+		printf("Run test62\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	for (i = 0; i < 12; i++)
+		buf[i] = -1;
+	buf[0] = 4321;
+	buf[1] = 9876;
+
+	sljit_emit_enter(compiler, 0, 1, 5, 3, 0, 0, sizeof(long));
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 7);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_U, SLJIT_UNUSED, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	/* buf[2]: register operands. */
+	sljit_emit_select(compiler, SLJIT_LESS, SLJIT_R2, SLJIT_R0, 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(long), SLJIT_R2, 0);
+	/* buf[3]: the flags are not modified by the previous select. */
+	sljit_emit_select(compiler, SLJIT_GREATER, SLJIT_R2, SLJIT_R0, 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long), SLJIT_R2, 0);
+	/* buf[4], buf[5]: dst_reg == src1. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 100);
+	sljit_emit_select(compiler, SLJIT_LESS, SLJIT_R3, SLJIT_R3, 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_select(compiler, SLJIT_GREATER_EQUAL, SLJIT_R3, SLJIT_R3, 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_R3, 0);
+	/* buf[6]: dst_reg == src2_reg with an immediate source. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 200);
+	sljit_emit_select(compiler, SLJIT_LESS, SLJIT_R4, SLJIT_IMM, -33, SLJIT_R4);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_R4, 0);
+	/* buf[7]: immediate source, condition is false. */
+	sljit_emit_select(compiler, SLJIT_GREATER, SLJIT_R3, SLJIT_IMM, -1, SLJIT_R4);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_R3, 0);
+	/* buf[8], buf[9]: memory sources. */
+	sljit_emit_select(compiler, SLJIT_LESS_EQUAL, SLJIT_R2, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long), SLJIT_R2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_MEM1(SLJIT_S0), sizeof(long));
+	sljit_emit_op2(compiler, SLJIT_ADD | SLJIT_KEEP_FLAGS, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_select(compiler, SLJIT_LESS, SLJIT_R1, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long), SLJIT_R1, 0);
+	/* buf[10]: 32 bit select. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, -1);
+	sljit_emit_op2(compiler, SLJIT_ISUB | SLJIT_SET_S, SLJIT_UNUSED, 0, SLJIT_R2, 0, SLJIT_IMM, 0);
+	sljit_emit_select(compiler, SLJIT_SIG_LESS | SLJIT_INT_OP, SLJIT_R2, SLJIT_IMM, -77, SLJIT_R0);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_R2, 0, SLJIT_R2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 10 * sizeof(long), SLJIT_R2, 0);
+	/* buf[11]: the flags are still available. */
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 11 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_SIG_LESS);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)&buf);
+
+	FAILED(buf[2] != 5, "test62 case 1 failed\n");
+	FAILED(buf[3] != 7, "test62 case 2 failed\n");
+	FAILED(buf[4] != 100, "test62 case 3 failed\n");
+	FAILED(buf[5] != 7, "test62 case 4 failed\n");
+	FAILED(buf[6] != -33, "test62 case 5 failed\n");
+	FAILED(buf[7] != -33, "test62 case 6 failed\n");
+	FAILED(buf[8] != 4321, "test62 case 7 failed\n");
+	FAILED(buf[9] != 9876, "test62 case 8 failed\n");
+	FAILED(buf[10] != -77, "test62 case 9 failed\n");
+	FAILED(buf[11] != 1, "test62 case 10 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test63_run(long *buf)
+{
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 5, 3, 0, 0, 0);
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, -256);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 3);
+	/* buf[1]: memory source. */
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(long), SLJIT_R1, 0);
+	/* buf[2]: memory destination. */
+	sljit_emit_op2(compiler, SLJIT_LSHR, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(long), SLJIT_R2, 0, SLJIT_R0, 0);
+	/* buf[3]: the count is a virtual register on x86-32. */
+	sljit_emit_op2(compiler, SLJIT_ASHR, SLJIT_R3, 0, SLJIT_R2, 0, SLJIT_R4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long), SLJIT_R3, 0);
+	/* buf[4]: the count is loaded from memory. */
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 12 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(long), SLJIT_R1, 0);
+	/* buf[5]: the destination is the count register. */
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R0, 0, SLJIT_R4, 0, SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_R0, 0);
+	/* buf[6]: 32 bit shift which sets the zero flag. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 31);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 2);
+	sljit_emit_op2(compiler, SLJIT_ISHL | SLJIT_SET_E, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_R0, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_I_EQUAL);
+	/* buf[7]: the flags are kept. */
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R4, 0, SLJIT_IMM, 3);
+	sljit_emit_op2(compiler, SLJIT_LSHR | SLJIT_KEEP_FLAGS, SLJIT_R3, 0, SLJIT_R3, 0, SLJIT_R4, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	/* buf[8] - buf[11]: count leading zeroes. */
+	sljit_emit_op1(compiler, SLJIT_CLZ, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_CLZ, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 0xffff);
+	sljit_emit_op1(compiler, SLJIT_ICLZ | SLJIT_SET_E, SLJIT_R1, 0, SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 10 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 11 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_I_NOT_ZERO);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)buf);
+	sljit_free_code(code.code);
+}
+
+static void test63(void)
+{
+	/* Test shifts and clz on every instruction set tier. */
+	long buf[13];
+	int tier;
+	int i;
+
+	if (verbose)
+		printf("Run test63\n");
+
+	for (tier = 0; tier < 2; tier++) {
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+		sljit_x86_set_cpu_tier(tier ? SLJIT_X86_TIER_NATIVE : SLJIT_X86_TIER_BASELINE);
+#endif
+		for (i = 0; i < 13; i++)
+			buf[i] = -1;
+		buf[0] = 0x1234;
+		buf[10] = 0;
+		buf[12] = 2;
+
+		test63_run(buf);
+
+		FAILED(buf[1] != 0x1234 << 5, "test63 case 1 failed\n");
+		FAILED(buf[2] != (long)((unsigned long)-256 >> 5), "test63 case 2 failed\n");
+		FAILED(buf[3] != -32, "test63 case 3 failed\n");
+		FAILED(buf[4] != 0x1234 << 7, "test63 case 4 failed\n");
+		FAILED(buf[5] != 3 << 5, "test63 case 5 failed\n");
+		FAILED(buf[6] != 1, "test63 case 6 failed\n");
+		FAILED(buf[7] != 1, "test63 case 7 failed\n");
+		FAILED(buf[8] != (long)sizeof(long) * 8 - 13, "test63 case 8 failed\n");
+		FAILED(buf[9] != (long)sizeof(long) * 8, "test63 case 9 failed\n");
+		FAILED(*(int*)(buf + 10) != 16, "test63 case 10 failed\n");
+		FAILED(buf[11] != 1, "test63 case 11 failed\n");
+	}
+
+	successful_tests++;
+}
+
+static void test64_run(long *buf)
+{
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 1, 5, 3, 0, 0, 0);
+
+	/* buf[1] - buf[4]: count trailing zeroes. */
+	sljit_emit_op1(compiler, SLJIT_CTZ, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_CTZ, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_ICTZ | SLJIT_SET_E, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_I_EQUAL);
+	/* buf[5] - buf[9]: population count. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, -1);
+	sljit_emit_op1(compiler, SLJIT_POPCNT, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 0x70f0f);
+	sljit_emit_op1(compiler, SLJIT_POPCNT, SLJIT_R3, 0, SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 0);
+	sljit_emit_op1(compiler, SLJIT_IPOPCNT | SLJIT_SET_E, SLJIT_R1, 0, SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_I_ZERO);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R0, 0, SLJIT_IMM, -1);
+	sljit_emit_op1(compiler, SLJIT_POPCNT | SLJIT_KEEP_FLAGS, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op2(compiler, SLJIT_ROTL | SLJIT_KEEP_FLAGS, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_R0, 0);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	/* buf[11] - buf[15]: byte swap. */
+	sljit_emit_op1(compiler, SLJIT_BSWAP, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 10 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 11 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_BSWAP, SLJIT_MEM1(SLJIT_S0), 12 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_IBSWAP, SLJIT_R3, 0, SLJIT_IMM, 0x11223344);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 13 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_BSWAP16, SLJIT_R0, 0, SLJIT_IMM, 0x1234);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 14 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_BSWAP16, SLJIT_MEM1(SLJIT_S0), 15 * sizeof(long), SLJIT_MEM1(SLJIT_S0), 16 * sizeof(long));
+	/* buf[17] - buf[21]: rotate. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 0x81);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 1);
+	sljit_emit_op2(compiler, SLJIT_ROTR, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, 4);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 17 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ROTL, SLJIT_MEM1(SLJIT_S0), 18 * sizeof(long), SLJIT_R0, 0, SLJIT_IMM, 4);
+	sljit_emit_op2(compiler, SLJIT_IROTL, SLJIT_R3, 0, SLJIT_MEM1(SLJIT_S0), 19 * sizeof(long), SLJIT_R4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 19 * sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op2(compiler, SLJIT_IROTR, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_R4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 20 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_IROTR, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S0), 21 * sizeof(long), SLJIT_IMM, 8);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 21 * sizeof(long), SLJIT_R1, 0);
+	/* buf[22] - buf[23]: the shift register keeps all of its bits. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, (long)SLJIT_W(0x123456789abcdef0));
+	sljit_emit_op2(compiler, SLJIT_IROTL, SLJIT_MEM1(SLJIT_S0), 22 * sizeof(long), SLJIT_R0, 0, SLJIT_R4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 23 * sizeof(long), SLJIT_R2, 0);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)buf);
+	sljit_free_code(code.code);
+}
+
+static void test64(void)
+{
+	/* Test bit manipulation operations on every instruction set tier. */
+	long buf[24];
+	long bits = sizeof(long) * 8;
+	int tier;
+	int i;
+
+	if (verbose)
+		printf("Run test64\n");
+
+	for (tier = 0; tier < 2; tier++) {
+#if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
+		sljit_x86_set_cpu_tier(tier ? SLJIT_X86_TIER_NATIVE : SLJIT_X86_TIER_BASELINE);
+#endif
+		for (i = 0; i < 24; i++)
+			buf[i] = -1;
+		buf[0] = 0xf00;
+		buf[3] = 0;
+		buf[7] = 0;
+		buf[10] = 0x12345678;
+		buf[13] = 0;
+		buf[16] = 0x7fffabcd;
+		buf[19] = 0x80000001;
+		buf[20] = 0;
+		buf[21] = 0x12345678;
+
+		test64_run(buf);
+
+		FAILED(buf[1] != 8, "test64 case 1 failed\n");
+		FAILED(buf[2] != bits, "test64 case 2 failed\n");
+		FAILED(*(int*)(buf + 3) != 0, "test64 case 3 failed\n");
+		FAILED(buf[4] != 1, "test64 case 4 failed\n");
+		FAILED(buf[5] != bits, "test64 case 5 failed\n");
+		FAILED(buf[6] != 11, "test64 case 6 failed\n");
+		FAILED(*(int*)(buf + 7) != 0, "test64 case 7 failed\n");
+		FAILED(buf[8] != 1, "test64 case 8 failed\n");
+		FAILED(buf[9] != 1, "test64 case 9 failed\n");
+		FAILED(buf[11] != (long)((unsigned long)0x78563412 << (bits - 32)), "test64 case 10 failed\n");
+		FAILED(buf[12] != 0x12345678, "test64 case 11 failed\n");
+		FAILED(*(int*)(buf + 13) != 0x44332211, "test64 case 12 failed\n");
+		FAILED(buf[14] != 0x3412, "test64 case 13 failed\n");
+		FAILED(buf[15] != 0xcdab, "test64 case 14 failed\n");
+		FAILED(buf[17] != (long)(((unsigned long)1 << (bits - 4)) | 0x8), "test64 case 15 failed\n");
+		FAILED(buf[18] != 0x810, "test64 case 16 failed\n");
+		FAILED(*(int*)(buf + 19) != 3, "test64 case 17 failed\n");
+		FAILED(*(int*)(buf + 20) != (int)0x80000040, "test64 case 18 failed\n");
+		FAILED(*(int*)(buf + 21) != 0x78123456, "test64 case 19 failed\n");
+		FAILED(*(int*)(buf + 22) != 0x102, "test64 case 20 failed\n");
+		FAILED(buf[23] != (long)SLJIT_W(0x123456789abcdef0), "test64 case 21 failed\n");
+	}
+
+	successful_tests++;
+}
+
+static void test65(void)
+{
+	/* Test atomic operations. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[18];
+	int *ibuf = (int*)(buf + 16);
+	int i;
+
+	if (verbose)
+		printf("Run test65\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+#if !(defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86) && !(defined SLJIT_CONFIG_ARM_64 && SLJIT_CONFIG_ARM_64)
+	if (verbose)
+		printf("no atomic support, test65 skipped\n");
+	successful_tests++;
+	sljit_free_compiler(compiler);
+	return;
+#endif
+
+	for (i = 0; i < 16; i++)
+		buf[i] = -1;
+	buf[0] = 10;
+	buf[2] = 0;
+	ibuf[0] = 100;
+	ibuf[1] = 0x12345678;
+
+	sljit_emit_enter(compiler, 0, 1, 5, 3, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S1, 0, SLJIT_S0, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S2, 0, SLJIT_S0, 0, SLJIT_IMM, 2 * sizeof(long));
+	sljit_emit_fence(compiler, SLJIT_ORDER_SEQ_CST);
+
+	/* buf[1], buf[2]: loads and stores. */
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_LOAD | SLJIT_ORDER_ACQUIRE, SLJIT_R3, SLJIT_S1, SLJIT_UNUSED);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(long), SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 20);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_STORE | SLJIT_ORDER_SEQ_CST, SLJIT_UNUSED, SLJIT_S1, SLJIT_R1);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_STORE | SLJIT_ORDER_RELEASE, SLJIT_UNUSED, SLJIT_S2, SLJIT_R3);
+	sljit_emit_fence(compiler, SLJIT_ORDER_RELEASE);
+	/* buf[3], buf[4]: exchange and fetch-add. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 30);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_XCHG | SLJIT_ORDER_SEQ_CST, SLJIT_R4, SLJIT_S1, SLJIT_R4);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long), SLJIT_R4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 5);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_ADD | SLJIT_ORDER_RELAXED, SLJIT_R2, SLJIT_S1, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(long), SLJIT_R2, 0);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_ADD | SLJIT_ORDER_SEQ_CST, SLJIT_UNUSED, SLJIT_S1, SLJIT_R1);
+	/* buf[5], buf[6]: successful compare and swap, the flags are not
+	   modified by the load. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 40);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 50);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_CAS | SLJIT_ORDER_SEQ_CST, SLJIT_R0, SLJIT_S1, SLJIT_R1);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_LOAD | SLJIT_ORDER_RELAXED, SLJIT_R2, SLJIT_S1, SLJIT_UNUSED);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_R0, 0);
+	/* buf[7], buf[8]: failed compare and swap. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 7);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 99);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_CAS | SLJIT_ORDER_ACQUIRE, SLJIT_R3, SLJIT_S1, SLJIT_R4);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long), SLJIT_R3, 0);
+	/* buf[9] - buf[11]: the address is in SLJIT_R0. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 123);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 10);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 77);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_CAS | SLJIT_ORDER_RELEASE, SLJIT_R2, SLJIT_R0, SLJIT_R3);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_MEM1(SLJIT_S0), 10 * sizeof(long), SLJIT_R0, 0, SLJIT_S2, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_S0), 11 * sizeof(long), SLJIT_R1, 0, SLJIT_R2, 0);
+	/* buf[12] - buf[15]: 32 bit operations. */
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S2, 0, SLJIT_S0, 0, SLJIT_IMM, 16 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_ADD | SLJIT_ORDER_SEQ_CST | SLJIT_INT_OP, SLJIT_R2, SLJIT_S2, SLJIT_R1);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 12 * sizeof(long), SLJIT_R2, 0);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_LOAD | SLJIT_ORDER_SEQ_CST | SLJIT_INT_OP, SLJIT_R1, SLJIT_S2, SLJIT_UNUSED);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 13 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 101);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, -5);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_CAS | SLJIT_ORDER_SEQ_CST | SLJIT_INT_OP, SLJIT_R0, SLJIT_S2, SLJIT_R1);
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 14 * sizeof(long), SLJIT_UNUSED, 0, SLJIT_I_EQUAL);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 9);
+	sljit_emit_atomic(compiler, SLJIT_ATOMIC_XCHG | SLJIT_ORDER_ACQUIRE | SLJIT_INT_OP, SLJIT_R4, SLJIT_S2, SLJIT_R4);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S0), 15 * sizeof(long), SLJIT_R4, 0);
+	sljit_emit_fence(compiler, SLJIT_ORDER_ACQUIRE);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)buf);
+	FAILED(buf[0] != 50, "test65 case 1 failed\n");
+	FAILED(buf[1] != 10, "test65 case 2 failed\n");
+	FAILED(buf[2] != 77, "test65 case 3 failed\n");
+	FAILED(buf[3] != 20, "test65 case 4 failed\n");
+	FAILED(buf[4] != 30, "test65 case 5 failed\n");
+	FAILED(buf[5] != 1, "test65 case 6 failed\n");
+	FAILED(buf[6] != 40, "test65 case 7 failed\n");
+	FAILED(buf[7] != 0, "test65 case 8 failed\n");
+	FAILED(buf[8] != 50, "test65 case 9 failed\n");
+	FAILED(buf[9] != 1, "test65 case 10 failed\n");
+	FAILED(buf[10] != 0, "test65 case 11 failed\n");
+	FAILED(buf[11] != 133, "test65 case 12 failed\n");
+	FAILED(*(int*)(buf + 12) != 100, "test65 case 13 failed\n");
+	FAILED(*(int*)(buf + 13) != 101, "test65 case 14 failed\n");
+	FAILED(buf[14] != 1, "test65 case 15 failed\n");
+	FAILED(*(int*)(buf + 15) != -5, "test65 case 16 failed\n");
+	FAILED(ibuf[0] != 9, "test65 case 17 failed\n");
+	FAILED(ibuf[1] != 0x12345678, "test65 case 18 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test66(void)
+{
+	/* Test [base + (index << shift) + displacement] addressing. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[10];
+	unsigned char bbuf[8];
+	double dbuf[3];
+	int i;
+
+	if (verbose)
+		printf("Run test66\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	for (i = 0; i < 10; i++)
+		buf[i] = -1;
+	buf[3] = -1234;
+	buf[4] = 5;
+	buf[8] = (long)bbuf;
+	buf[9] = (long)dbuf;
+	for (i = 0; i < 8; i++)
+		bbuf[i] = 0x10 + i;
+	dbuf[0] = 0.0;
+	dbuf[1] = 5.25;
+	dbuf[2] = 7.5;
+
+	sljit_emit_enter(compiler, 0, 1, 3, 3, 1, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 2);
+	/* buf[0]: load with a small displacement. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, sizeof(long)));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_R0, 0);
+	/* buf[4]: read-modify-write. */
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM2(SLJIT_S0, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, 2 * sizeof(long)),
+		SLJIT_MEM2(SLJIT_S0, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, 2 * sizeof(long)), SLJIT_IMM, 10);
+	/* buf[1]: negative displacement. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM2(SLJIT_S0, SLJIT_R2), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, -4 * (long)sizeof(long)), SLJIT_IMM, 77);
+	/* buf[2]: 32 bit displacement. */
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_S1, 0, SLJIT_S0, 0, SLJIT_IMM, 100000);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM2(SLJIT_S1, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, 100000),
+		SLJIT_MEM2(SLJIT_S1, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, 100000 + sizeof(long)));
+	/* buf[5]: byte access. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S2, 0, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV_UB, SLJIT_R0, 0, SLJIT_MEM2(SLJIT_S2, SLJIT_R1), SLJIT_MEM2_DISP(0, 3));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_R0, 0);
+	/* buf[6], buf[7]: update. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOVU, SLJIT_R0, 0, SLJIT_MEM2(SLJIT_R2, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_WORD_SHIFT, sizeof(long)));
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_R2, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_R0, 0);
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+	/* buf[3]: displacement which does not fit into 32 bit. */
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_S1, 0, SLJIT_S0, 0, SLJIT_IMM, SLJIT_W(0x300000000));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM2(SLJIT_S1, SLJIT_R1), SLJIT_MEM2_DISP(0, SLJIT_W(0x300000000) + 3 * sizeof(long) - 2),
+		SLJIT_MEM2(SLJIT_S1, SLJIT_R1), SLJIT_MEM2_DISP(0, SLJIT_W(0x300000000) + 4 * sizeof(long) - 2));
+#endif
+	if (sljit_is_fpu_available()) {
+		/* dbuf[0]: floating point load and store. */
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S2, 0, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long));
+		sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_FR0, 0, SLJIT_MEM2(SLJIT_S2, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_DOUBLE_SHIFT, -(long)sizeof(double)));
+		sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM2(SLJIT_S2, SLJIT_R1), SLJIT_MEM2_DISP(SLJIT_DOUBLE_SHIFT, -2 * (long)sizeof(double)), SLJIT_FR0, 0);
+	}
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)buf);
+	FAILED(buf[0] != -1234, "test66 case 1 failed\n");
+	FAILED(buf[1] != 77, "test66 case 2 failed\n");
+	FAILED(buf[2] != -1234, "test66 case 3 failed\n");
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+	FAILED(buf[3] != 15, "test66 case 4 failed\n");
+#else
+	FAILED(buf[3] != -1234, "test66 case 4 failed\n");
+#endif
+	FAILED(buf[4] != 15, "test66 case 5 failed\n");
+	FAILED(buf[5] != 0x15, "test66 case 6 failed\n");
+	FAILED(buf[6] != 3 * (long)sizeof(long), "test66 case 7 failed\n");
+	FAILED(buf[7] != -1234, "test66 case 8 failed\n");
+	if (sljit_is_fpu_available())
+		FAILED(dbuf[0] != 5.25, "test66 case 9 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test67(void)
+{
+	/* Test prefetch. */
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[4];
+
+	if (verbose)
+		printf("Run test67\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	buf[0] = 0;
+	buf[1] = 0;
+	buf[2] = 0;
+	buf[3] = 0;
+
+	sljit_emit_enter(compiler, 0, 1, 3, 1, 0, 0, 2 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_op2(compiler, SLJIT_SUB | SLJIT_SET_E, SLJIT_UNUSED, 0, SLJIT_R0, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L1, SLJIT_UNUSED, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L2, SLJIT_UNUSED, 0, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L3, SLJIT_UNUSED, 0, SLJIT_MEM1(SLJIT_S0), -0x12345);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_ONCE, SLJIT_UNUSED, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R1), SLJIT_WORD_SHIFT);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L1, SLJIT_UNUSED, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R0), 1);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L2, SLJIT_UNUSED, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+	/* Invalid addresses must not cause a fault. */
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L3, SLJIT_UNUSED, 0, SLJIT_MEM0(), 0);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_ONCE, SLJIT_UNUSED, 0, SLJIT_MEM1(SLJIT_R1), -64);
+	sljit_emit_op1(compiler, SLJIT_PREFETCH_L1, SLJIT_UNUSED, 0, SLJIT_MEM2(SLJIT_S0, SLJIT_R0), SLJIT_MEM2_DISP(2, 100));
+	sljit_emit_op_flags(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 0, SLJIT_UNUSED, 0, SLJIT_EQUAL);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)buf);
+	FAILED(buf[0] != 1, "test67 case 1 failed\n");
+	FAILED(buf[1] != 5, "test67 case 2 failed\n");
+	FAILED(buf[2] != 1, "test67 case 3 failed\n");
+	FAILED(buf[3] != 0, "test67 case 4 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+
+static long SLJIT_CALL func4(long a, long b, long c, long d)
+{
+	return a * 1000 + b * 100 + c * 10 + d;
+}
+
+static long SLJIT_CALL func5(long a, long b, long c, long d, long e)
+{
+	return a * b + c * d - e;
+}
+
+static long SLJIT_CALL func6(long a, long b, long c, long d, long e, long f)
+{
+	return a + b * 10 + c * 100 + d * 1000 + e * 10000 + f * 100000;
+}
+
+static double SLJIT_CALL dfunc2(double a, long b, double c)
+{
+	return a * (double)b + c;
+}
+
+static double SLJIT_CALL dfunc6(long a, double x, long b, long c, long d, long e, long f)
+{
+	return x * (double)(a + b * 10 + c * 100 + d * 1000 + e * 10000 + f * 100000);
+}
+
+#endif
+
+static void test68(void)
+{
+	/* Test calls with more than three and double arguments. */
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+	executable_code code;
+	executable_code code2;
+	struct sljit_compiler* compiler;
+	struct sljit_jump* jump;
+	double buf[2];
+#endif
+
+	if (verbose)
+		printf("Run test68\n");
+
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+	if (!sljit_is_fpu_available()) {
+		if (verbose)
+			printf("no fpu available, test68 skipped\n");
+		successful_tests++;
+		return;
+	}
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 6, 6, 6, 0, 0, 2 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S5, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_S3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R5, 0, SLJIT_S0, 0);
+	jump = sljit_emit_jump(compiler, SLJIT_CALL6);
+	sljit_set_target(jump, SLJIT_FUNC_OFFSET(func6));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R0, 0);
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_S3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R5, 0, SLJIT_IMM, SLJIT_FUNC_OFFSET(func4));
+	sljit_emit_ijump(compiler, SLJIT_CALL4, SLJIT_R5, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R0, 0);
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_IMM, SLJIT_FUNC_OFFSET(func5));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_S3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_S4, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_S5, 0);
+	sljit_emit_ijump(compiler, SLJIT_CALL5, SLJIT_MEM1(SLJIT_SP), sizeof(long));
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_RETURN_REG, 0, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R0, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(((long (SLJIT_CALL *)(long, long, long, long, long, long))code.code)(1, 2, 3, 4, 5, 6)
+		!= 123456 + 1234 + 20, "test68 case 1 failed\n");
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* double f(double x, long p, double y, long q, double *buf) */
+	sljit_emit_enter(compiler, 0, 3 | SLJIT_FLOAT_ARGS(2), 6, 3, 3, 0, 2 * sizeof(long));
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S2), 0, SLJIT_FR1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+	jump = sljit_emit_jump(compiler, SLJIT_CALL1 | SLJIT_FLOAT_ARGS(2) | SLJIT_CALL_RETURN_DOUBLE);
+	sljit_set_target(jump, SLJIT_FUNC_OFFSET(dfunc2));
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S2), sizeof(double), SLJIT_FR0, 0);
+
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, SLJIT_FUNC_OFFSET(dfunc6));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 2);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 3);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R5, 0, SLJIT_IMM, 6);
+	sljit_emit_ijump(compiler, SLJIT_CALL6 | SLJIT_FLOAT_ARGS(1) | SLJIT_CALL_RETURN_DOUBLE, SLJIT_MEM1(SLJIT_SP), 0);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_FR0, 0);
+	sljit_emit_return(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_SP), 0);
+
+	code2.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	buf[0] = 0.0;
+	buf[1] = 0.0;
+	FAILED(((double (SLJIT_CALL *)(double, long, double, long, double*))code2.code)(1.5, 4, 0.25, 7, buf)
+		!= 6.25 * 657321.0, "test68 case 2 failed\n");
+	FAILED(buf[0] != 0.25, "test68 case 3 failed\n");
+	FAILED(buf[1] != 6.25, "test68 case 4 failed\n");
+
+	sljit_free_code(code.code);
+	sljit_free_code(code2.code);
+#else
+	if (verbose)
+		printf("no extended calls available, test68 skipped\n");
+#endif
+	successful_tests++;
+}
+
+static void test69(void)
+{
+	/* Test tail calls. */
+#if (defined SLJIT_TAIL_CALL_SUPPORT && SLJIT_TAIL_CALL_SUPPORT)
+	executable_code code;
+	executable_code code2;
+	executable_code code3;
+	struct sljit_compiler* compiler;
+	struct sljit_label* label;
+	struct sljit_jump* jump;
+	struct sljit_jump* jump2;
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+	executable_code code4;
+#endif
+#endif
+
+	if (verbose)
+		printf("Run test69\n");
+
+#if (defined SLJIT_TAIL_CALL_SUPPORT && SLJIT_TAIL_CALL_SUPPORT)
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* long sum(long n, long acc) { return n == 0 ? acc : sum(n - 1, acc + n); } */
+	label = sljit_emit_label(compiler);
+	sljit_emit_enter(compiler, 0, 2, 2, 2, 0, 0, 2 * sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_S1, 0);
+	jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_S0, 0, SLJIT_IMM, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_SP), sizeof(long), SLJIT_S0, 0);
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, 1);
+	jump2 = sljit_emit_jump(compiler, SLJIT_CALL2 | SLJIT_TAIL_CALL);
+	sljit_set_label(jump2, label);
+	sljit_set_label(jump, sljit_emit_label(compiler));
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_S1, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* The saved regs must be preserved across the chain of tail calls. */
+	sljit_emit_enter(compiler, 0, 1, 3, 3, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S1, 0, SLJIT_IMM, 111);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_S2, 0, SLJIT_IMM, 222);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 0);
+	sljit_emit_ijump(compiler, SLJIT_CALL2, SLJIT_IMM, SLJIT_FUNC_OFFSET(code.code));
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_S2, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code2.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 3, 3, 3, 0, 0, sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, SLJIT_FUNC_OFFSET(func));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S2, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S1, 0);
+	sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R2, 0, SLJIT_S0, 0, SLJIT_IMM, 10);
+	sljit_emit_ijump(compiler, SLJIT_CALL3 | SLJIT_TAIL_CALL, SLJIT_MEM1(SLJIT_SP), 0);
+
+	code3.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code.func2(4, 10) != 20, "test69 case 1 failed\n");
+	FAILED(code2.func1(1000000) != 500000500000L + 333, "test69 case 2 failed\n");
+	FAILED(code3.func3(5, 6, 7) != 50 + 6 + 7 + 5, "test69 case 3 failed\n");
+
+#if (defined SLJIT_EXTENDED_CALLS && SLJIT_EXTENDED_CALLS)
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	sljit_emit_enter(compiler, 0, 2, 6, 2, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_S1, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, 3);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_IMM, 4);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_IMM, 5);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R5, 0, SLJIT_IMM, 6);
+	sljit_emit_ijump(compiler, SLJIT_CALL6 | SLJIT_TAIL_CALL, SLJIT_IMM, SLJIT_FUNC_OFFSET(func6));
+
+	code4.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code4.func2(1, 2) != 654312, "test69 case 4 failed\n");
+	sljit_free_code(code4.code);
+#endif
+
+	sljit_free_code(code.code);
+	sljit_free_code(code2.code);
+	sljit_free_code(code3.code);
+#else
+	if (verbose)
+		printf("no tail calls available, test69 skipped\n");
+#endif
+	successful_tests++;
+}
+
+static void test70(void)
+{
+	/* Test all float registers. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	struct sljit_jump* jump;
+	double buf[SLJIT_NUM_FLOAT_REGS + 2];
+	double expected;
+	int i;
+
+	if (verbose)
+		printf("Run test70\n");
+
+	if (!sljit_is_fpu_available()) {
+		if (verbose)
+			printf("no fpu available, test70 skipped\n");
+		successful_tests++;
+		return;
+	}
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	for (i = 0; i < SLJIT_NUM_FLOAT_REGS; i++)
+		buf[i] = i + 1;
+	buf[SLJIT_NUM_FLOAT_REGS] = 0;
+	buf[SLJIT_NUM_FLOAT_REGS + 1] = 0;
+
+	sljit_emit_enter(compiler, 0, 1, 1, 1, SLJIT_NUM_SCRATCH_FLOAT_REGS, SLJIT_NUM_SAVED_FLOAT_REGS, 0);
+
+	/* Every reg is used as a source and as a destination. */
+	for (i = 0; i < SLJIT_NUM_FLOAT_REGS; i++)
+		sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_FR(i), 0, SLJIT_MEM1(SLJIT_S0), i * sizeof(double));
+	for (i = SLJIT_NUM_FLOAT_REGS - 1; i > 0; i--)
+		sljit_emit_fop2(compiler, SLJIT_DMUL, SLJIT_FR(i), 0, SLJIT_FR(i), 0, SLJIT_FR(i - 1), 0);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_FR0, 0, SLJIT_FR(SLJIT_NUM_FLOAT_REGS - 1), 0);
+	for (i = 1; i < SLJIT_NUM_FLOAT_REGS; i++)
+		sljit_emit_fop2(compiler, SLJIT_DADD, SLJIT_FR0, 0, SLJIT_FR0, 0, SLJIT_FR(i), 0);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S0), SLJIT_NUM_FLOAT_REGS * sizeof(double), SLJIT_FR0, 0);
+
+	/* The saved regs must be preserved by a function, which uses all regs. */
+	for (i = 0; i < SLJIT_NUM_SAVED_FLOAT_REGS; i++)
+		sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_FS(i), 0, SLJIT_MEM1(SLJIT_S0), i * sizeof(double));
+	jump = sljit_emit_jump(compiler, SLJIT_CALL0);
+	sljit_emit_fop1(compiler, SLJIT_DMOV, SLJIT_MEM1(SLJIT_S0), (SLJIT_NUM_FLOAT_REGS + 1) * sizeof(double), SLJIT_MEM1(SLJIT_S0), SLJIT_NUM_FLOAT_REGS * sizeof(double));
+	for (i = 0; i < SLJIT_NUM_SAVED_FLOAT_REGS; i++)
+		sljit_emit_fop2(compiler, SLJIT_DADD, SLJIT_MEM1(SLJIT_S0), (SLJIT_NUM_FLOAT_REGS + 1) * sizeof(double), SLJIT_MEM1(SLJIT_S0), (SLJIT_NUM_FLOAT_REGS + 1) * sizeof(double), SLJIT_FS(i), 0);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	sljit_set_label(jump, sljit_emit_label(compiler));
+	sljit_emit_enter(compiler, 0, 0, 1, 0, SLJIT_NUM_FLOAT_REGS, 0, 0);
+	for (i = 0; i < SLJIT_NUM_FLOAT_REGS; i++)
+		sljit_emit_fop2(compiler, SLJIT_DSUB, SLJIT_FR(i), 0, SLJIT_FR(i), 0, SLJIT_FR(i), 0);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func1((long)&buf);
+
+	/* FR(i) = (i + 1) * i, except FR0 = 1, and the sum is stored. */
+	expected = SLJIT_NUM_FLOAT_REGS * (SLJIT_NUM_FLOAT_REGS - 1);
+	for (i = 1; i < SLJIT_NUM_FLOAT_REGS; i++)
+		expected += (i + 1) * i;
+	FAILED(buf[SLJIT_NUM_FLOAT_REGS] != expected, "test70 case 1 failed\n");
+	for (i = 0; i < SLJIT_NUM_SAVED_FLOAT_REGS; i++)
+		expected += i + 1;
+	FAILED(buf[SLJIT_NUM_FLOAT_REGS + 1] != expected, "test70 case 2 failed\n");
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+#define RA_PRESSURE 32
+
+static void test71(void)
+{
+	/* Test the virtual register layer. */
+	executable_code code;
+	struct sljit_compiler* compiler;
+	struct sljit_ra* ra;
+	struct sljit_ra_label* label;
+	struct sljit_ra_jump* jump;
+	struct sljit_allocator allocator;
+	long vals[RA_PRESSURE];
+	long buf[6];
+	long sum;
+	long budget;
+	int args[3];
+	int i, k;
+
+	if (verbose)
+		printf("Run test71\n");
+
+	/* More live values than machine registers, updated in a loop. */
+	ra = sljit_ra_create();
+	FAILED(!ra, "cannot create ra\n");
+
+	sljit_ra_emit_enter(ra, 0, 3, 0);
+	for (k = 0; k < RA_PRESSURE; k++) {
+		sljit_ra_emit_op2(ra, SLJIT_MUL, SLJIT_VREG(3 + k), 0, SLJIT_VREG(0), 0, SLJIT_IMM, k + 1);
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(3 + k), 0, SLJIT_VREG(3 + k), 0, SLJIT_VREG(1), 0);
+	}
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(40), 0, SLJIT_IMM, 0);
+	label = sljit_ra_emit_label(ra);
+	for (k = 0; k < RA_PRESSURE; k++) {
+		sljit_ra_emit_op2(ra, SLJIT_XOR, SLJIT_VREG(41), 0, SLJIT_VREG(3 + (k + 1) % RA_PRESSURE), 0, SLJIT_VREG(40), 0);
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(3 + k), 0, SLJIT_VREG(3 + k), 0, SLJIT_VREG(41), 0);
+	}
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(40), 0, SLJIT_VREG(40), 0, SLJIT_IMM, 1);
+	jump = sljit_ra_emit_cmp(ra, SLJIT_LESS, SLJIT_VREG(40), 0, SLJIT_IMM, 10);
+	sljit_ra_set_label(jump, label);
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(42), 0, SLJIT_IMM, 0);
+	for (k = 0; k < RA_PRESSURE; k++)
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(42), 0, SLJIT_VREG(42), 0, SLJIT_VREG(3 + k), 0);
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VMEM1(2), 0, SLJIT_VREG(42), 0);
+	sljit_ra_emit_return(ra, SLJIT_MOV, SLJIT_VREG(42), 0);
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+	FAILED(sljit_ra_compile(ra, compiler) != SLJIT_SUCCESS, "test71 case 1 failed\n");
+	FAILED(sljit_ra_get_spilled_vregs(ra) == 0, "test71 case 2 failed\n");
+	FAILED(sljit_ra_get_saveds(ra) < 3, "test71 case 3 failed\n");
+	sljit_ra_free(ra);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	for (k = 0; k < RA_PRESSURE; k++)
+		vals[k] = 7 * (k + 1) - 3;
+	for (i = 0; i < 10; i++)
+		for (k = 0; k < RA_PRESSURE; k++)
+			vals[k] += vals[(k + 1) % RA_PRESSURE] ^ i;
+	sum = 0;
+	for (k = 0; k < RA_PRESSURE; k++)
+		sum += vals[k];
+
+	buf[0] = 0;
+	FAILED(code.func3(7, -3, (long)&buf) != sum, "test71 case 4 failed\n");
+	FAILED(buf[0] != sum, "test71 case 5 failed\n");
+	sljit_free_code(code.code);
+
+	/* Values live across calls. */
+	ra = sljit_ra_create();
+	FAILED(!ra, "cannot create ra\n");
+
+	sljit_ra_emit_enter(ra, 0, 1, 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(1), 0, SLJIT_VREG(0), 0, SLJIT_IMM, 1);
+	sljit_ra_emit_op2(ra, SLJIT_MUL, SLJIT_VREG(2), 0, SLJIT_VREG(0), 0, SLJIT_IMM, 3);
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(3), 0, SLJIT_IMM, SLJIT_FUNC_OFFSET(func));
+	args[0] = SLJIT_VREG(0);
+	args[1] = SLJIT_VREG(1);
+	args[2] = SLJIT_VREG(2);
+	sljit_ra_emit_call(ra, SLJIT_CALL3, SLJIT_VREG(4), args, SLJIT_IMM, SLJIT_FUNC_OFFSET(func));
+	args[0] = SLJIT_VREG(4);
+	args[1] = SLJIT_VREG(2);
+	args[2] = SLJIT_VREG(1);
+	sljit_ra_emit_call(ra, SLJIT_CALL3, SLJIT_VREG(5), args, SLJIT_VREG(3), 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(5), 0, SLJIT_VREG(5), 0, SLJIT_VREG(1), 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(5), 0, SLJIT_VREG(5), 0, SLJIT_VREG(2), 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(5), 0, SLJIT_VREG(5), 0, SLJIT_VREG(0), 0);
+	sljit_ra_emit_return(ra, SLJIT_MOV, SLJIT_VREG(5), 0);
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+	FAILED(sljit_ra_compile(ra, compiler) != SLJIT_SUCCESS, "test71 case 6 failed\n");
+	sljit_ra_free(ra);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code.func1(10) != 14 * 10 + 13, "test71 case 7 failed\n");
+	sljit_free_code(code.code);
+
+	/* Memory operands with spilled base registers. */
+	ra = sljit_ra_create();
+	FAILED(!ra, "cannot create ra\n");
+
+	sljit_ra_emit_enter(ra, 0, 1, 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(1), 0, SLJIT_VREG(0), 0, SLJIT_IMM, sizeof(long));
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(2), 0, SLJIT_VREG(0), 0, SLJIT_IMM, 2 * sizeof(long));
+	for (k = 0; k < RA_PRESSURE; k++)
+		sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(3 + k), 0, SLJIT_IMM, k + 1);
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(40), 0, SLJIT_IMM, 0);
+	for (k = 0; k < RA_PRESSURE; k++)
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(40), 0, SLJIT_VREG(40), 0, SLJIT_VREG(3 + k), 0);
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VMEM1(0), 4 * sizeof(long), SLJIT_VREG(40), 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VMEM1(0), 3 * sizeof(long), SLJIT_VMEM1(1), 0, SLJIT_VMEM1(2), 0);
+	sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VMEM1(1), 4 * sizeof(long), SLJIT_VMEM1(0), 3 * sizeof(long), SLJIT_IMM, 1);
+	sljit_ra_emit_return(ra, SLJIT_MOV, SLJIT_VMEM1(2), sizeof(long));
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+	FAILED(sljit_ra_compile(ra, compiler) != SLJIT_SUCCESS, "test71 case 8 failed\n");
+	FAILED(sljit_ra_get_spilled_vregs(ra) < 3, "test71 case 9 failed\n");
+	sljit_ra_free(ra);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	buf[0] = 1;
+	buf[1] = 2;
+	buf[2] = 3;
+	buf[3] = 0;
+	buf[4] = 0;
+	buf[5] = 0;
+	FAILED(code.func1((long)&buf) != 5, "test71 case 10 failed\n");
+	FAILED(buf[3] != 5, "test71 case 11 failed\n");
+	FAILED(buf[4] != RA_PRESSURE * (RA_PRESSURE + 1) / 2, "test71 case 12 failed\n");
+	FAILED(buf[5] != 6, "test71 case 13 failed\n");
+	sljit_free_code(code.code);
+
+	/* Recording errors. */
+	ra = sljit_ra_create();
+	FAILED(!ra, "cannot create ra\n");
+	sljit_ra_emit_op1(ra, SLJIT_MOV, SLJIT_VREG(0), 0, SLJIT_IMM, 0);
+	FAILED(sljit_ra_get_error(ra) != SLJIT_ERR_BAD_ARGUMENT, "test71 case 14 failed\n");
+	sljit_ra_free(ra);
+
+	/* All memory of the ra comes from the allocator. */
+	allocator.alloc = test54_alloc;
+	allocator.free = test54_free;
+	allocator.allocator_data = &budget;
+	budget = 2;
+	ra = sljit_ra_create_with_allocator(&allocator);
+	FAILED(!ra, "cannot create ra\n");
+	sljit_ra_emit_enter(ra, 0, 1, 0);
+	FAILED(sljit_ra_get_error(ra) != SLJIT_SUCCESS, "test71 case 15 failed\n");
+	FAILED(sljit_ra_emit_label(ra) != NULL, "test71 case 16 failed\n");
+	FAILED(sljit_ra_get_error(ra) != SLJIT_ERR_ALLOC_FAILED, "test71 case 17 failed\n");
+	FAILED(budget != 0, "test71 case 18 failed\n");
+	sljit_ra_free(ra);
+
+	/* No calls and no memory operands: R0 - R2 are allocated as well. */
+	ra = sljit_ra_create();
+	FAILED(!ra, "cannot create ra\n");
+
+	sljit_ra_emit_enter(ra, 0, 1, 0);
+	for (k = 1; k < SLJIT_NUM_REGS; k++) {
+		sljit_ra_emit_op2(ra, SLJIT_MUL, SLJIT_VREG(k), 0, SLJIT_VREG(0), 0, SLJIT_IMM, k);
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(k), 0, SLJIT_VREG(k), 0, SLJIT_IMM, k);
+	}
+	for (k = 2; k < SLJIT_NUM_REGS; k++)
+		sljit_ra_emit_op2(ra, SLJIT_ADD, SLJIT_VREG(1), 0, SLJIT_VREG(1), 0, SLJIT_VREG(k), 0);
+	sljit_ra_emit_return(ra, SLJIT_MOV, SLJIT_VREG(1), 0);
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+	FAILED(sljit_ra_compile(ra, compiler) != SLJIT_SUCCESS, "test71 case 19 failed\n");
+	FAILED(sljit_ra_get_spilled_vregs(ra) != 0, "test71 case 20 failed\n");
+	sljit_ra_free(ra);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code.func1(5) != 6 * (SLJIT_NUM_REGS - 1) * SLJIT_NUM_REGS / 2, "test71 case 21 failed\n");
+	sljit_free_code(code.code);
+
+	successful_tests++;
+}
+
+#undef RA_PRESSURE
+
+static void* test72_compile(int options, unsigned long *code_size)
+{
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	void *code;
+
+	if (!compiler)
+		return NULL;
+
+	sljit_emit_enter(compiler, options, 2, 4, 2, 0, 0, 2 * sizeof(long));
+	/* Constant folding. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 6);
+	sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, 7);
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_NEG, SLJIT_R2, 0, SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ISUB, SLJIT_R3, 0, SLJIT_IMM, 5, SLJIT_IMM, 8);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_R3, 0, SLJIT_R3, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), 0, SLJIT_R3, 0);
+	/* Copy propagation, the copies are dead. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_S0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_R3, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R2, 0);
+	/* Redundant load and dead store. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, 1);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_MEM1(SLJIT_SP), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_R1, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R3, 0, SLJIT_R1, 0);
+	/* A load through a changed base register is kept. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S1), sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_S1, 0, SLJIT_S1, 0, SLJIT_IMM, sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_S1), sizeof(long));
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code = sljit_generate_code(compiler);
+	*code_size = sljit_get_generated_code_size(compiler);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+static void test72(void)
+{
+	/* Test the IR optimizer. */
+	executable_code code1;
+	executable_code code2;
+	unsigned long size1;
+	unsigned long size2;
+	long buf[3];
+
+	if (verbose)
+		printf("Run test72\n");
+
+	code1.code = test72_compile(0, &size1);
+	code2.code = test72_compile(SLJIT_IR_OPTIMIZER, &size2);
+	FAILED(!code1.code || !code2.code, "test72 case 1 failed\n");
+
+	buf[0] = 0;
+	buf[1] = 0;
+	buf[2] = 5;
+	FAILED(code1.func2(100, (long)&buf) != 105, "test72 case 2 failed\n");
+	FAILED(buf[0] != -3, "test72 case 3 failed\n");
+	FAILED(buf[1] != 100, "test72 case 4 failed\n");
+
+	buf[0] = 0;
+	buf[1] = 0;
+	buf[2] = 5;
+	FAILED(code2.func2(100, (long)&buf) != 105, "test72 case 5 failed\n");
+	FAILED(buf[0] != -3, "test72 case 6 failed\n");
+	FAILED(buf[1] != 100, "test72 case 7 failed\n");
+	FAILED(size2 >= size1, "test72 case 8 failed\n");
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+	successful_tests++;
+}
+
+static void test73(void)
+{
+	/* Test division by immediate. */
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[17];
+	int ibuf[4];
+	int i;
+#endif
+
+	if (verbose)
+		printf("Run test73\n");
+
+#if (defined SLJIT_DIV_IMM_SUPPORT && SLJIT_DIV_IMM_SUPPORT)
+	FAILED(!compiler, "cannot create compiler\n");
+
+	for (i = 0; i < 17; i++)
+		buf[i] = -1;
+	buf[0] = 1000000007;
+	buf[1] = -1000000007;
+	for (i = 0; i < 4; i++)
+		ibuf[i] = -1;
+
+	sljit_emit_enter(compiler, 0, 2, 5, 2, 0, 0, sizeof(long));
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, 1234);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, 5678);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_MEM1(SLJIT_S0), 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_MEM1(SLJIT_S0), sizeof(long));
+	/* buf[2] - buf[5]: generic divisors. */
+	sljit_emit_op2(compiler, SLJIT_UDIV_IMM, SLJIT_MEM1(SLJIT_S0), 2 * sizeof(long), SLJIT_R2, 0, SLJIT_IMM, 7);
+	sljit_emit_op2(compiler, SLJIT_SDIV_IMM, SLJIT_R4, 0, SLJIT_R3, 0, SLJIT_IMM, 7);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 3 * sizeof(long), SLJIT_R4, 0);
+	sljit_emit_op2(compiler, SLJIT_UMOD_IMM, SLJIT_MEM1(SLJIT_S0), 4 * sizeof(long), SLJIT_MEM1(SLJIT_S0), 0, SLJIT_IMM, 1000);
+	sljit_emit_op2(compiler, SLJIT_SMOD_IMM, SLJIT_MEM1(SLJIT_S0), 5 * sizeof(long), SLJIT_R3, 0, SLJIT_IMM, -1000);
+	/* buf[6] - buf[9]: powers of two. */
+	sljit_emit_op2(compiler, SLJIT_UDIV_IMM, SLJIT_MEM1(SLJIT_S0), 6 * sizeof(long), SLJIT_R2, 0, SLJIT_IMM, 16);
+	sljit_emit_op2(compiler, SLJIT_SDIV_IMM, SLJIT_MEM1(SLJIT_S0), 7 * sizeof(long), SLJIT_R3, 0, SLJIT_IMM, 16);
+	sljit_emit_op2(compiler, SLJIT_SDIV_IMM, SLJIT_MEM1(SLJIT_S0), 8 * sizeof(long), SLJIT_R3, 0, SLJIT_IMM, -16);
+	sljit_emit_op2(compiler, SLJIT_SMOD_IMM, SLJIT_MEM1(SLJIT_S0), 9 * sizeof(long), SLJIT_R3, 0, SLJIT_IMM, 16);
+	/* buf[10] - buf[12]: large and trivial divisors. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, -1);
+	sljit_emit_op2(compiler, SLJIT_UDIV_IMM, SLJIT_MEM1(SLJIT_S0), 10 * sizeof(long), SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, -3);
+	sljit_emit_op2(compiler, SLJIT_SDIV_IMM, SLJIT_MEM1(SLJIT_S0), 11 * sizeof(long), SLJIT_R2, 0, SLJIT_IMM, -1);
+	sljit_emit_op2(compiler, SLJIT_UMOD_IMM, SLJIT_MEM1(SLJIT_S0), 12 * sizeof(long), SLJIT_R2, 0, SLJIT_IMM, 1);
+	/* ibuf[0] - ibuf[3]: 32 bit operations. */
+	sljit_emit_op2(compiler, SLJIT_IUDIV_IMM, SLJIT_R4, 0, SLJIT_IMM, -10, SLJIT_IMM, 3);
+	sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S1), 0, SLJIT_R4, 0);
+	sljit_emit_op2(compiler, SLJIT_ISDIV_IMM, SLJIT_MEM1(SLJIT_S1), sizeof(int), SLJIT_IMM, -10, SLJIT_IMM, 3);
+	sljit_emit_op2(compiler, SLJIT_IUMOD_IMM, SLJIT_MEM1(SLJIT_S1), 2 * sizeof(int), SLJIT_IMM, -10, SLJIT_IMM, 3);
+	sljit_emit_op2(compiler, SLJIT_ISMOD_IMM, SLJIT_MEM1(SLJIT_S1), 3 * sizeof(int), SLJIT_IMM, -10, SLJIT_IMM, -3);
+	/* buf[13] - buf[14]: SLJIT_R0 and SLJIT_R1 are preserved. */
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 13 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 14 * sizeof(long), SLJIT_R1, 0);
+	/* buf[15] - buf[16]: the source and destination are the same. */
+	sljit_emit_op2(compiler, SLJIT_SDIV_IMM, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 10);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 15 * sizeof(long), SLJIT_R0, 0);
+	sljit_emit_op2(compiler, SLJIT_UMOD_IMM, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 10);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), 16 * sizeof(long), SLJIT_R1, 0);
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func2((long)&buf, (long)&ibuf);
+
+	FAILED(buf[2] != 142857143, "test73 case 1 failed\n");
+	FAILED(buf[3] != -142857143, "test73 case 2 failed\n");
+	FAILED(buf[4] != 7, "test73 case 3 failed\n");
+	FAILED(buf[5] != -7, "test73 case 4 failed\n");
+	FAILED(buf[6] != 62500000, "test73 case 5 failed\n");
+	FAILED(buf[7] != -62500000, "test73 case 6 failed\n");
+	FAILED(buf[8] != 62500000, "test73 case 7 failed\n");
+	FAILED(buf[9] != -7, "test73 case 8 failed\n");
+	FAILED(buf[10] != 1, "test73 case 9 failed\n");
+	FAILED(buf[11] != -1000000007, "test73 case 10 failed\n");
+	FAILED(buf[12] != 0, "test73 case 11 failed\n");
+	FAILED(ibuf[0] != 1431655762, "test73 case 12 failed\n");
+	FAILED(ibuf[1] != -3, "test73 case 13 failed\n");
+	FAILED(ibuf[2] != 0, "test73 case 14 failed\n");
+	FAILED(ibuf[3] != -1, "test73 case 15 failed\n");
+	FAILED(buf[13] != 1234, "test73 case 16 failed\n");
+	FAILED(buf[14] != 5678, "test73 case 17 failed\n");
+	FAILED(buf[15] != 123, "test73 case 18 failed\n");
+	FAILED(buf[16] != 8, "test73 case 19 failed\n");
+
+	sljit_free_code(code.code);
+#else
+	if (verbose)
+		printf("no division by immediate available, test73 skipped\n");
+#endif
+	successful_tests++;
+}
+
+static void test74(void)
+{
+	/* Test multiplication by immediate. */
+	static const long mul[] = {
+		0, 1, 2, 3, 5, 9, 10, 12, 15, 17, 25, 36, 45, 63, 81, 96,
+		127, 255, 257, 1000, 1023, 1025, -1, -2, -3, -5, -9, -15, -16, -63, -255, -1000
+	};
+#define MUL_COUNT (int)(sizeof(mul) / sizeof(mul[0]))
+	executable_code code;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	long buf[3 * MUL_COUNT + 1];
+	int ibuf[MUL_COUNT];
+	long x = -1234567;
+	int ix = 987654321;
+	int i;
+
+	if (verbose)
+		printf("Run test74\n");
+
+	FAILED(!compiler, "cannot create compiler\n");
+
+	for (i = 0; i < 3 * MUL_COUNT + 1; i++)
+		buf[i] = -1;
+	for (i = 0; i < MUL_COUNT; i++)
+		ibuf[i] = -1;
+	buf[3 * MUL_COUNT] = x;
+
+	sljit_emit_enter(compiler, 0, 2, 5, 2, 0, 0, 0);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, x);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_IMM, ix);
+	for (i = 0; i < MUL_COUNT; i++) {
+		/* Register source and destination. */
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R2, 0, SLJIT_R0, 0, SLJIT_IMM, mul[i]);
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), i * sizeof(long), SLJIT_R2, 0);
+		/* Memory source, the immediate is the first operand. */
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R3, 0, SLJIT_IMM, mul[i], SLJIT_MEM1(SLJIT_S0), 3 * MUL_COUNT * sizeof(long));
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), (MUL_COUNT + i) * sizeof(long), SLJIT_R3, 0);
+		/* Memory destination, the source is the same as the destination. */
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_S0), (2 * MUL_COUNT + i) * sizeof(long), SLJIT_R0, 0);
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_MEM1(SLJIT_S0), (2 * MUL_COUNT + i) * sizeof(long), SLJIT_MEM1(SLJIT_S0), (2 * MUL_COUNT + i) * sizeof(long), SLJIT_IMM, mul[i]);
+		/* 32 bit operation. */
+		sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R4, 0, SLJIT_R1, 0);
+		sljit_emit_op2(compiler, SLJIT_IMUL, SLJIT_R4, 0, SLJIT_R4, 0, SLJIT_IMM, mul[i]);
+		sljit_emit_op1(compiler, SLJIT_MOV_SI, SLJIT_MEM1(SLJIT_S1), i * sizeof(int), SLJIT_R4, 0);
+	}
+	sljit_emit_return(compiler, SLJIT_UNUSED, 0, 0);
+
+	code.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	code.func2((long)&buf, (long)&ibuf);
+
+	for (i = 0; i < MUL_COUNT; i++) {
+		FAILED(buf[i] != (long)((unsigned long)x * (unsigned long)mul[i]), "test74 case 1 failed\n");
+		FAILED(buf[MUL_COUNT + i] != buf[i], "test74 case 2 failed\n");
+		FAILED(buf[2 * MUL_COUNT + i] != buf[i], "test74 case 3 failed\n");
+		FAILED(ibuf[i] != (int)((unsigned int)ix * (unsigned int)mul[i]), "test74 case 4 failed\n");
+	}
+#undef MUL_COUNT
+
+	sljit_free_code(code.code);
+	successful_tests++;
+}
+
+static void test75(void)
+{
+	/* Test switch. */
+#if (defined SLJIT_SWITCH_SUPPORT && SLJIT_SWITCH_SUPPORT)
+	executable_code code1;
+	executable_code code2;
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_switch *switch_;
+	struct sljit_jump *jump;
+	struct sljit_jump *ends[40];
+	struct sljit_label *labels[40];
+	struct sljit_label *label;
+	unsigned long table;
+	unsigned long label_addr[3];
+	int i;
+#endif
+
+	if (verbose)
+		printf("Run test75\n");
+
+#if (defined SLJIT_SWITCH_SUPPORT && SLJIT_SWITCH_SUPPORT)
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* Forward labels, which are set after the switch is emitted. */
+	sljit_emit_enter(compiler, 0, 1, 3, 1, 0, 0, 0);
+	switch_ = sljit_emit_switch(compiler, SLJIT_S0, 0, NULL, 4);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, -1);
+	labels[0] = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 10);
+	labels[1] = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 11);
+	labels[2] = sljit_emit_label(compiler);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_IMM, 12);
+	sljit_set_switch_label(switch_, 0, labels[0]);
+	sljit_set_switch_label(switch_, 1, labels[1]);
+	sljit_set_switch_label(switch_, 2, labels[2]);
+	sljit_set_switch_label(switch_, 3, labels[0]);
+
+	code1.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	table = sljit_get_switch_addr(switch_);
+	for (i = 0; i < 3; i++)
+		label_addr[i] = sljit_get_label_addr(labels[i]);
+	sljit_free_compiler(compiler);
+
+	FAILED(((unsigned long*)table)[0] != label_addr[0], "test75 case 1 failed\n");
+	FAILED(((unsigned long*)table)[2] != label_addr[2], "test75 case 2 failed\n");
+	FAILED(((unsigned long*)table)[3] != label_addr[0], "test75 case 3 failed\n");
+	FAILED(code1.func1(0) != 10, "test75 case 4 failed\n");
+	FAILED(code1.func1(1) != 11, "test75 case 5 failed\n");
+	FAILED(code1.func1(2) != 12, "test75 case 6 failed\n");
+	FAILED(code1.func1(3) != 10, "test75 case 7 failed\n");
+	FAILED(code1.func1(4) != -1, "test75 case 8 failed\n");
+	FAILED(code1.func1(-1) != -1, "test75 case 9 failed\n");
+
+	compiler = sljit_create_compiler();
+	FAILED(!compiler, "cannot create compiler\n");
+
+	/* Backward labels passed to sljit_emit_switch, and a memory index. */
+	sljit_emit_enter(compiler, 0, 1, 3, 1, 0, 0, sizeof(long));
+	jump = sljit_emit_jump(compiler, SLJIT_JUMP);
+	for (i = 0; i < 40; i++) {
+		labels[i] = sljit_emit_label(compiler);
+		sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_IMM, i + 1);
+		ends[i] = sljit_emit_jump(compiler, SLJIT_JUMP);
+	}
+	label = sljit_emit_label(compiler);
+	sljit_set_label(jump, label);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), 0, SLJIT_S0, 0);
+	sljit_emit_switch(compiler, SLJIT_MEM1(SLJIT_SP), 0, labels, 40);
+	sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, -1);
+	label = sljit_emit_label(compiler);
+	for (i = 0; i < 40; i++)
+		sljit_set_label(ends[i], label);
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code2.code = sljit_generate_code(compiler);
+	CHECK(compiler);
+	sljit_free_compiler(compiler);
+
+	FAILED(code2.func1(0) != 0, "test75 case 10 failed\n");
+	FAILED(code2.func1(7) != 7 * 8, "test75 case 11 failed\n");
+	FAILED(code2.func1(39) != 39 * 40, "test75 case 12 failed\n");
+	FAILED(code2.func1(40) != -1, "test75 case 13 failed\n");
+	FAILED(code2.func1(-40) != -1, "test75 case 14 failed\n");
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+#else
+	if (verbose)
+		printf("no switch available, test75 skipped\n");
+#endif
+	successful_tests++;
+}
+
+static void* test76_compile(int options, FILE *verbose_file)
+{
+	struct sljit_compiler* compiler = sljit_create_compiler();
+	struct sljit_jump* jump;
+	void *code;
+
+	if (!compiler)
+		return NULL;
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	sljit_compiler_verbose(compiler, verbose_file);
+#endif
+
+	sljit_emit_enter(compiler, options, 1, 2, 1, 0, 0, 0);
+	/* The buffered operations are emitted by sljit_emit_cmp. */
+	sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_S0, 0, SLJIT_IMM, 5);
+	sljit_emit_op2(compiler, SLJIT_SHL, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	jump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R1, 0, SLJIT_IMM, 20);
+	sljit_emit_op2(compiler, SLJIT_SUB, SLJIT_R0, 0, SLJIT_R0, 0, SLJIT_IMM, 1);
+	sljit_set_label(jump, sljit_emit_label(compiler));
+	sljit_emit_return(compiler, SLJIT_MOV, SLJIT_R0, 0);
+
+	code = sljit_generate_code(compiler);
+	sljit_free_compiler(compiler);
+	return code;
+}
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+static int test76_same_listing(FILE *listing1, FILE *listing2)
+{
+	char line1[256];
+	char line2[256];
+	int same = 1;
+
+	rewind(listing1);
+	rewind(listing2);
+	while (same && fgets(line1, sizeof(line1), listing1)) {
+		if (!fgets(line2, sizeof(line2), listing2) || strcmp(line1, line2) != 0)
+			same = 0;
+	}
+	if (same && fgets(line2, sizeof(line2), listing2))
+		same = 0;
+	fclose(listing1);
+	fclose(listing2);
+	return same;
+}
+#endif
+
+static void test76(void)
+{
+	/* Test the verbose output of the IR optimizer. */
+	executable_code code1;
+	executable_code code2;
+	FILE *listing1 = NULL;
+	FILE *listing2 = NULL;
+
+	if (verbose)
+		printf("Run test76\n");
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	listing1 = tmpfile();
+	listing2 = tmpfile();
+	FAILED(!listing1 || !listing2, "cannot create temporary file\n");
+#endif
+
+	code1.code = test76_compile(0, listing1);
+	code2.code = test76_compile(SLJIT_IR_OPTIMIZER, listing2);
+	FAILED(!code1.code || !code2.code, "test76 case 1 failed\n");
+
+	FAILED(code1.func1(5) != 10, "test76 case 2 failed\n");
+	FAILED(code1.func1(6) != 10, "test76 case 3 failed\n");
+	FAILED(code2.func1(5) != 10, "test76 case 4 failed\n");
+	FAILED(code2.func1(6) != 10, "test76 case 5 failed\n");
+
+	sljit_free_code(code1.code);
+	sljit_free_code(code2.code);
+
+#if (defined SLJIT_VERBOSE && SLJIT_VERBOSE)
+	/* Every operation is listed once, in the same order. */
+	FAILED(!test76_same_listing(listing1, listing2), "test76 case 6 failed\n");
+#endif
+
+	successful_tests++;
+}
+
 void sljit_test(int argc, char* argv[])
 {
 	int has_arg = (argc >= 2 && argv[1][0] == '-' && argv[1][2] == '\0');
@@ -5004,12 +7226,35 @@ void sljit_test(int argc, char* argv[])
 	test51();
 	test52();
 	test53();
+	test54();
+	test55();
+	test56();
+	test57();
+	test58();
+	test59();
+	test60();
+	test61();
+	test62();
+	test63();
+	test64();
+	test65();
+	test66();
+	test67();
+	test68();
+	test69();
+	test70();
+	test71();
+	test72();
+	test73();
+	test74();
+	test75();
+	test76();
 
 #if (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
 	sljit_free_unused_memory_exec();
 #endif
 
-#	define TEST_COUNT 53
+#	define TEST_COUNT 76
 
 	printf("SLJIT tests: ");
 	if (successful_tests == TEST_COUNT)